@@ -0,0 +1,290 @@
+#ifndef ATOMICBITARRAY_H
+#define ATOMICBITARRAY_H
+
+#include "BitArray.h"
+
+#include <atomic>
+#include <thread>
+
+// fixed size array of Bits-bit elements that many threads update at once
+// an element inside one word is changed by a CAS loop on that word (lock-free, neighbours are kept);
+// an element across two words (Bits that don't divide 64) is changed by two CAS loops under
+// one of lock_stripes spin locks (picked by the first word), its loads take the lock too => never torn
+template<size_t Bits>
+class AtomicBitArray {
+public:
+	static constexpr bool is_always_lock_free = 64 % Bits == 0;
+	static constexpr size_t lock_stripes = 256;
+private:
+	static_assert(Bits >= 1 && Bits <= 63, "Bits must be in [1..63]");
+	static constexpr uint64_t mask_ = bitarray_detail::mask_of<Bits>();
+
+	struct alignas(64) stripe {	// a cache line per lock
+		std::atomic<bool> locked{ false };
+	};
+
+	std::unique_ptr<std::atomic<uint64_t>[]> words_;
+	std::unique_ptr<stripe[]> stripes_;	// only when elements can cross words
+	size_t size_;
+
+	static constexpr std::memory_order load_order(std::memory_order order);	// order of a load in an RMW
+	inline void lock(size_t word) const;
+	inline void unlock(size_t word) const;
+	inline void check_index(size_t index) const;
+	inline void check_value(uint64_t val) const;
+
+	// f(old, val) => true and val to write it, false to keep old; returns old
+	template<typename F> uint64_t modify(size_t index, F f, std::memory_order order);
+public:
+	explicit AtomicBitArray(size_t size = 0);	// zeros
+	explicit AtomicBitArray(const BitArray<Bits>& other);
+	AtomicBitArray(AtomicBitArray<Bits>&& other) noexcept;
+	AtomicBitArray(const AtomicBitArray<Bits>& other) = delete;
+
+	AtomicBitArray& operator=(AtomicBitArray<Bits>&& other) noexcept;
+	AtomicBitArray& operator=(const AtomicBitArray<Bits>& other) = delete;
+
+	inline size_t size() const;
+	inline bool empty() const;
+
+	// index >= size() => std::out_of_range, a value > 2^Bits - 1 => std::overflow_error (nothing is changed)
+	uint64_t load(size_t index, std::memory_order order = std::memory_order_seq_cst) const;
+	void store(size_t index, uint64_t val, std::memory_order order = std::memory_order_seq_cst);
+	uint64_t exchange(size_t index, uint64_t val, std::memory_order order = std::memory_order_seq_cst);
+	// strong: false only if the element != expected (expected gets it)
+	bool compare_exchange(size_t index, uint64_t& expected, uint64_t desired, std::memory_order order = std::memory_order_seq_cst);
+
+	// return the old value; fetch_add/fetch_sub wrap modulo 2^Bits like std::atomic,
+	// the saturating ones stop at 2^Bits - 1 / 0 (and don't write once there)
+	uint64_t fetch_add(size_t index, uint64_t val, std::memory_order order = std::memory_order_seq_cst);
+	uint64_t fetch_sub(size_t index, uint64_t val, std::memory_order order = std::memory_order_seq_cst);
+	uint64_t fetch_add_saturate(size_t index, uint64_t val = 1, std::memory_order order = std::memory_order_seq_cst);
+	uint64_t fetch_sub_saturate(size_t index, uint64_t val = 1, std::memory_order order = std::memory_order_seq_cst);
+
+	BitArray<Bits> snapshot() const;	// word by word, not one instant if writers are running
+};
+
+// implementation
+
+// AtomicBitArray
+template<size_t Bits>
+AtomicBitArray<Bits>::AtomicBitArray(size_t size)
+	: words_(std::make_unique<std::atomic<uint64_t>[]>(bitarray_detail::words_for(size * Bits))), size_(size) {
+	if constexpr (!is_always_lock_free) {
+		stripes_ = std::make_unique<stripe[]>(lock_stripes);
+	}
+	for (size_t i{}; i < bitarray_detail::words_for(size * Bits); ++i) {
+		words_[i].store(0, std::memory_order_relaxed);
+	}
+}
+
+template<size_t Bits>
+AtomicBitArray<Bits>::AtomicBitArray(const BitArray<Bits>& other)
+	: AtomicBitArray(other.size()) {
+	for (size_t i{}; i < bitarray_detail::words_for(size_ * Bits); ++i) {
+		words_[i].store(other.memory_[i], std::memory_order_relaxed);
+	}
+}
+
+template<size_t Bits>
+AtomicBitArray<Bits>::AtomicBitArray(AtomicBitArray<Bits>&& other) noexcept
+	: words_(std::move(other.words_)), stripes_(std::move(other.stripes_)), size_(other.size_) {
+	other.size_ = 0;
+}
+
+template<size_t Bits>
+AtomicBitArray<Bits>& AtomicBitArray<Bits>::operator=(AtomicBitArray<Bits>&& other) noexcept {
+	if (&other != this) {
+		words_ = std::move(other.words_);
+		stripes_ = std::move(other.stripes_);
+		size_ = other.size_;
+		other.size_ = 0;
+	}
+
+	return *this;
+}
+
+template<size_t Bits>
+constexpr std::memory_order AtomicBitArray<Bits>::load_order(std::memory_order order) {
+	return order == std::memory_order_release ? std::memory_order_relaxed
+		: order == std::memory_order_acq_rel ? std::memory_order_acquire
+		: order;
+}
+
+template<size_t Bits>
+inline void AtomicBitArray<Bits>::lock(size_t word) const {
+	std::atomic<bool>& locked = stripes_[word % lock_stripes].locked;
+	while (locked.exchange(true, std::memory_order_acquire)) {
+		while (locked.load(std::memory_order_relaxed)) {	// wait without taking the line
+			std::this_thread::yield();
+		}
+	}
+}
+
+template<size_t Bits>
+inline void AtomicBitArray<Bits>::unlock(size_t word) const {
+	stripes_[word % lock_stripes].locked.store(false, std::memory_order_release);
+}
+
+template<size_t Bits>
+inline void AtomicBitArray<Bits>::check_index(size_t index) const {
+	if (index >= size_) {
+		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+	}
+}
+
+template<size_t Bits>
+inline void AtomicBitArray<Bits>::check_value(uint64_t val) const {
+	if (val > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+}
+
+template<size_t Bits>
+template<typename F>
+uint64_t AtomicBitArray<Bits>::modify(size_t index, F f, std::memory_order order) {
+	check_index(index);
+	const size_t bit = index * Bits;
+	const size_t word = bit / 64;
+	const size_t offset = bit % 64;
+
+	if (is_always_lock_free || offset + Bits <= 64) {	// in 1 word
+		const size_t shift = 64 - offset - Bits;
+		uint64_t current = words_[word].load(load_order(order));
+		for (;;) {
+			const uint64_t old = (current >> shift) & mask_;
+			uint64_t val;
+			if (!f(old, val)) {
+				return old;
+			}
+			const uint64_t next = (current & ~(mask_ << shift)) | (val << shift);
+			if (words_[word].compare_exchange_weak(current, next, order, load_order(order))) {
+				return old;
+			}
+		}
+	}
+
+	// in 2 words: the lock keeps other writers of this element out, CAS keeps the neighbours
+	const size_t second_len = offset + Bits - 64;
+	lock(word);
+	const uint64_t old = ((words_[word].load(std::memory_order_relaxed) << second_len)
+		| (words_[word + 1].load(std::memory_order_relaxed) >> (64 - second_len))) & mask_;
+	uint64_t val;
+	if (f(old, val)) {
+		const uint64_t first_mask = mask_ >> second_len;
+		const uint64_t second_mask = ~(~uint64_t(0) >> second_len);
+		uint64_t current = words_[word].load(std::memory_order_relaxed);
+		while (!words_[word].compare_exchange_weak(current, (current & ~first_mask) | (val >> second_len),
+			order, std::memory_order_relaxed)) {
+		}
+		current = words_[word + 1].load(std::memory_order_relaxed);
+		while (!words_[word + 1].compare_exchange_weak(current, (current & ~second_mask) | (val << (64 - second_len)),
+			order, std::memory_order_relaxed)) {
+		}
+	}
+	unlock(word);
+
+	return old;
+}
+
+template<size_t Bits>
+inline size_t AtomicBitArray<Bits>::size() const {
+	return size_;
+}
+
+template<size_t Bits>
+inline bool AtomicBitArray<Bits>::empty() const {
+	return size_ == 0;
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::load(size_t index, std::memory_order order) const {
+	check_index(index);
+	const size_t bit = index * Bits;
+	const size_t word = bit / 64;
+	const size_t offset = bit % 64;
+
+	if (is_always_lock_free || offset + Bits <= 64) {
+		return (words_[word].load(order) >> (64 - offset - Bits)) & mask_;
+	}
+
+	const size_t second_len = offset + Bits - 64;
+	lock(word);
+	const uint64_t val = ((words_[word].load(order) << second_len) | (words_[word + 1].load(order) >> (64 - second_len))) & mask_;
+	unlock(word);
+
+	return val;
+}
+
+template<size_t Bits>
+void AtomicBitArray<Bits>::store(size_t index, uint64_t val, std::memory_order order) {
+	exchange(index, val, order);
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::exchange(size_t index, uint64_t val, std::memory_order order) {
+	check_value(val);
+
+	return modify(index, [val](uint64_t, uint64_t& next) {
+		next = val;
+		return true;
+	}, order);
+}
+
+template<size_t Bits>
+bool AtomicBitArray<Bits>::compare_exchange(size_t index, uint64_t& expected, uint64_t desired, std::memory_order order) {
+	check_value(desired);
+
+	const uint64_t wanted = expected;
+	expected = modify(index, [wanted, desired](uint64_t old, uint64_t& next) {
+		next = desired;
+		return old == wanted;
+	}, order);
+
+	return expected == wanted;
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::fetch_add(size_t index, uint64_t val, std::memory_order order) {
+	return modify(index, [val](uint64_t old, uint64_t& next) {
+		next = (old + val) & mask_;
+		return true;
+	}, order);
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::fetch_sub(size_t index, uint64_t val, std::memory_order order) {
+	return modify(index, [val](uint64_t old, uint64_t& next) {
+		next = (old - val) & mask_;
+		return true;
+	}, order);
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::fetch_add_saturate(size_t index, uint64_t val, std::memory_order order) {
+	return modify(index, [val](uint64_t old, uint64_t& next) {
+		next = val > mask_ - old ? mask_ : old + val;
+		return next != old;
+	}, order);
+}
+
+template<size_t Bits>
+uint64_t AtomicBitArray<Bits>::fetch_sub_saturate(size_t index, uint64_t val, std::memory_order order) {
+	return modify(index, [val](uint64_t old, uint64_t& next) {
+		next = val > old ? 0 : old - val;
+		return next != old;
+	}, order);
+}
+
+template<size_t Bits>
+BitArray<Bits> AtomicBitArray<Bits>::snapshot() const {
+	BitArray<Bits> copy;
+	copy.resize(size_);
+	for (size_t i{}; i < bitarray_detail::words_for(size_ * Bits); ++i) {
+		copy.memory_[i] = words_[i].load(std::memory_order_acquire);
+	}
+
+	return copy;
+}
+
+#endif
@@ -3,645 +3,4174 @@
 
 #include <cstdint>
 #include <exception>
+#include <stdexcept>
 #include <vector>
 #include <string>
 #include <assert.h>
 #include <type_traits>
+#include <utility>
+#include <numeric>
+#include <initializer_list>
+#include <memory_resource>
+#include <new>
+#include <istream>
+#include <ostream>
+#include <iterator>
+#include <cstddef>
+#include <algorithm>
+#include <memory>
+
+#if !defined(BITARRAY_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITARRAY_X86_DISPATCH 1
+#define BITARRAY_TARGET_AVX2 __attribute__((target("avx2,popcnt,bmi2")))
+#define BITARRAY_TARGET_AVX512 __attribute__((target("avx512f,avx512bw,avx2,popcnt,bmi2")))
+#define BITARRAY_TARGET_POPCNT __attribute__((target("popcnt")))
+#define BITARRAY_TARGET_VPOPCNT __attribute__((target("avx512f,avx512vpopcntdq,popcnt")))
+#include <immintrin.h>
+#endif
+
+// bodies shared by a generic function and its target clone must be inlined into both
+#if defined(__GNUC__)
+#define BITARRAY_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#define BITARRAY_ALWAYS_INLINE inline
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define BITARRAY_HAS_MMAP 1
+#include <sys/mman.h>
+#endif
+
+// result of element arithmetic that doesn't fit Bits
+enum class BitArrayOverflow {
+	throw_error,	// std::overflow_error, the element is not changed
+	wrap,			// modulo 2^Bits
+	saturate		// clamped to [0, 2^Bits - 1]
+};
 
-template<size_t Bits>
-class BitArray {
-public:
-	class iterator;
-private:
-	const uint64_t mask_ = get_mask();
-	uint64_t* memory_;
+// packing kernels (shared by all widths)
+// element i occupies bits [i * Bits, i * Bits + Bits) counting from the high bit of memory[0]
+namespace bitarray_detail {
+	template<size_t Bits>
+	constexpr uint64_t mask_of() {
+		if constexpr (Bits >= 64) {
+			return ~uint64_t(0);
+		}
+		else {
+			return (uint64_t(1) << Bits) - 1;
+		}
+	}
 
-	size_t size_;
-	size_t capacity_;
+	// group - the shortest run of elements that fills whole words (lcm(Bits, 64) bits)
+	template<size_t Bits>
+	constexpr size_t group_elems = 64 / std::gcd(Bits, size_t(64));
+	template<size_t Bits>
+	constexpr size_t group_words = Bits / std::gcd(Bits, size_t(64));
 
-	inline const uint64_t get_mask() const;
-	inline bool is_overflow(const uint64_t& val) const;
+	constexpr size_t words_for(size_t bits) {
+		return (bits + 63) / 64;
+	}
 
-	template<typename T_it>
-	void init_from_range(const T_it& beg_it, const T_it& end_it);
-	template<typename T_it>
-	void add_from_range(const T_it& beg_it, const T_it& end_it);
+	template<size_t Bits>
+	inline uint64_t get(const uint64_t* memory, size_t index) {
+		const size_t bit = index * Bits;
+		const uint64_t* place = memory + bit / 64;
+		const size_t offset = bit % 64;
 
-	class BitArrayRef {
-	private:
-		uint64_t* place_ptr;
-		uint32_t bit_index;
-		BitArray<Bits>* ref_ptr;
+		if constexpr (64 % Bits == 0) {	// only in 1 word
+			return (*place >> (64 - offset - Bits)) & mask_of<Bits>();
+		}
+		else {	// can be in 2 words
+			if (offset + Bits <= 64) {
+				return (*place >> (64 - offset - Bits)) & mask_of<Bits>();
+			}
+			return ((place[0] << (offset + Bits - 64)) | (place[1] >> (128 - offset - Bits))) & mask_of<Bits>();
+		}
+	}
 
-		inline BitArrayRef(BitArray<Bits>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index);
-		inline BitArrayRef(const BitArray<Bits>::BitArrayRef& other);
-		friend class BitArray<Bits>;
-		friend class BitArray<Bits>::iterator;
-	public:
-		inline operator uint64_t() const;
+	// val must be <= mask_of<Bits>()
+	template<size_t Bits>
+	inline void set(uint64_t* memory, size_t index, uint64_t val) {
+		const size_t bit = index * Bits;
+		uint64_t* place = memory + bit / 64;
+		const size_t offset = bit % 64;
 
-		inline BitArrayRef& operator=(const uint64_t& other);
-		BitArrayRef& operator=(const BitArray<Bits>::BitArrayRef& other_ref) = delete;
-		inline BitArrayRef& operator+=(const uint64_t& other);
-		inline BitArrayRef& operator-=(const uint64_t& other);
-		inline BitArrayRef& operator*=(const uint64_t& other);
-		inline BitArrayRef& operator/=(const uint64_t& other);
-		inline BitArrayRef& operator++();	// previx
-		inline BitArrayRef& operator--();	// prefix
-		inline uint64_t operator++(int);	// postfix
-		inline uint64_t operator--(int);	// postfix
-		inline bool operator==(const BitArray<Bits>::BitArrayRef& other_ref) const;
-		inline bool operator!=(const BitArray<Bits>::BitArrayRef& other_ref) const;
+		if (64 % Bits == 0 || offset + Bits <= 64) {	// in 1 word
+			const size_t shift = 64 - offset - Bits;
+			*place = (*place & ~(mask_of<Bits>() << shift)) | (val << shift);
+		}
+		else {	// in 2 words
+			const size_t second_len = offset + Bits - 64;
+			place[0] = (place[0] & ~(mask_of<Bits>() >> second_len)) | (val >> second_len);
+			place[1] = (place[1] & (~uint64_t(0) >> second_len)) | (val << (64 - second_len));
+		}
+	}
+
+	// one lane of a group, all shifts are compile-time constants
+	template<size_t Bits, size_t Lane>
+	inline uint64_t group_get(const uint64_t* group) {
+		constexpr size_t word = Lane * Bits / 64;
+		constexpr size_t offset = Lane * Bits % 64;
+
+		if constexpr (offset + Bits <= 64) {
+			return (group[word] >> (64 - offset - Bits)) & mask_of<Bits>();
+		}
+		else {
+			return ((group[word] << (offset + Bits - 64)) | (group[word + 1] >> (128 - offset - Bits))) & mask_of<Bits>();
+		}
+	}
+
+	// group words must be zeroed before
+	template<size_t Bits, size_t Lane>
+	inline void group_put(uint64_t* group, uint64_t val) {
+		constexpr size_t word = Lane * Bits / 64;
+		constexpr size_t offset = Lane * Bits % 64;
+
+		if constexpr (offset + Bits <= 64) {
+			group[word] |= val << (64 - offset - Bits);
+		}
+		else {
+			group[word] |= val >> (offset + Bits - 64);
+			group[word + 1] |= val << (128 - offset - Bits);
+		}
+	}
+
+	template<size_t Bits, typename T, size_t... Lanes>
+	inline void unpack_group(const uint64_t* group, T* out, std::index_sequence<Lanes...>) {
+		((out[Lanes] = static_cast<T>(group_get<Bits, Lanes>(group))), ...);
+	}
+
+	// returns OR of all the values (overflow check is up to the caller)
+	template<size_t Bits, typename T, size_t... Lanes>
+	inline uint64_t pack_group(uint64_t* group, const T* in, std::index_sequence<Lanes...>) {
+		uint64_t words[group_words<Bits>]{};
+		uint64_t all = 0;
+		((all |= static_cast<uint64_t>(in[Lanes]),
+			group_put<Bits, Lanes>(words, static_cast<uint64_t>(in[Lanes]) & mask_of<Bits>())), ...);
+		for (size_t i{}; i < group_words<Bits>; ++i) {
+			group[i] = words[i];
+		}
+
+		return all;
+	}
+
+	template<size_t Bits, typename T>
+	inline void unpack_groups_swar(const uint64_t* in, size_t groups, T* out) {
+		for (; groups; --groups) {
+			unpack_group<Bits>(in, out, std::make_index_sequence<group_elems<Bits>>{});
+			in += group_words<Bits>;
+			out += group_elems<Bits>;
+		}
+	}
+
+	template<size_t Bits, typename T>
+	inline uint64_t pack_groups_swar(uint64_t* out, size_t groups, const T* in) {
+		uint64_t all = 0;
+		for (; groups; --groups) {
+			all |= pack_group<Bits>(out, in, std::make_index_sequence<group_elems<Bits>>{});
+			out += group_words<Bits>;
+			in += group_elems<Bits>;
+		}
+
+		return all;
+	}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	constexpr bool is_little_endian = false;
+#else
+	constexpr bool is_little_endian = true;
+#endif
+
+	inline uint64_t byte_swap(uint64_t val) {
+#if defined(__GNUC__)
+		return __builtin_bswap64(val);
+#else
+		val = ((val & 0x00FF00FF00FF00FFull) << 8) | ((val >> 8) & 0x00FF00FF00FF00FFull);
+		val = ((val & 0x0000FFFF0000FFFFull) << 16) | ((val >> 16) & 0x0000FFFF0000FFFFull);
+		return (val << 32) | (val >> 32);
+#endif
+	}
+
+	inline size_t popcount(uint64_t val) {
+#if defined(__GNUC__)
+		return static_cast<size_t>(__builtin_popcountll(val));
+#else
+		val = val - ((val >> 1) & 0x5555555555555555ull);
+		val = (val & 0x3333333333333333ull) + ((val >> 2) & 0x3333333333333333ull);
+		val = (val + (val >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		return static_cast<size_t>((val * 0x0101010101010101ull) >> 56);
+#endif
+	}
+
+	// val != 0
+	inline size_t leading_zeros(uint64_t val) {
+#if defined(__GNUC__)
+		return static_cast<size_t>(__builtin_clzll(val));
+#else
+		size_t count = 0;
+		for (; !(val >> 63); val <<= 1) {
+			++count;
+		}
+		return count;
+#endif
+	}
+
+	inline void store_le(unsigned char* out, uint64_t val, size_t bytes) {
+		for (size_t i{}; i < bytes; ++i) {
+			out[i] = static_cast<unsigned char>(val >> (8 * i));
+		}
+	}
+
+	inline uint64_t load_le(const unsigned char* in, size_t bytes) {
+		uint64_t val = 0;
+		for (size_t i{}; i < bytes; ++i) {
+			val |= uint64_t(in[i]) << (8 * i);
+		}
+		return val;
+	}
+
+	// stream format: header + chunks of little endian words (+ checksum of every chunk)
+	constexpr char stream_magic[8] = { 'B', 'A', 'S', 'T', 'R', 'E', 'A', 'M' };
+	constexpr uint32_t stream_version = 1;
+	constexpr uint32_t stream_msb_first = 1;
+	constexpr uint32_t stream_checksum_flag = 1;
+	constexpr size_t stream_header_size = 40;
+	constexpr size_t stream_chunk_words = size_t(1) << 16;	// 512 KiB
+
+	inline uint64_t rotl(uint64_t val, int shift) {
+		return (val << shift) | (val >> (64 - shift));
+	}
+
+	// 4 independent lanes to keep up with disk bandwidth
+	inline uint64_t checksum(const uint64_t* words, size_t count) {
+		constexpr uint64_t prime1 = 0x9E3779B185EBCA87ull;
+		constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4Full;
+		uint64_t lanes[4] = { prime1, prime2, ~prime1, ~prime2 };
+
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4) {
+			for (size_t lane{}; lane < 4; ++lane) {
+				lanes[lane] = rotl(lanes[lane] + words[i + lane] * prime2, 31) * prime1;
+			}
+		}
+		for (; i < count; ++i) {
+			lanes[i % 4] = rotl(lanes[i % 4] + words[i] * prime2, 31) * prime1;
+		}
+
+		uint64_t hash = count * prime1;
+		for (size_t lane{}; lane < 4; ++lane) {
+			hash = rotl(hash ^ lanes[lane], 27) * prime2 + prime1;
+		}
+		hash ^= hash >> 29;
+
+		return hash;
+	}
+
+	enum class simd_level { none, avx2, avx512 };
+
+	inline simd_level cpu_simd_level() {
+#ifdef BITARRAY_X86_DISPATCH
+		static const simd_level level = [] {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw")) {
+				return simd_level::avx512;
+			}
+			if (__builtin_cpu_supports("avx2")) {
+				return simd_level::avx2;
+			}
+			return simd_level::none;
+		}();
+		return level;
+#else
+		return simd_level::none;
+#endif
+	}
+
+	enum class popcount_level { none, popcnt, avx2, vpopcntdq };
+
+	inline popcount_level cpu_popcount_level() {
+#ifdef BITARRAY_X86_DISPATCH
+		static const popcount_level level = [] {
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vpopcntdq")) {
+				return popcount_level::vpopcntdq;
+			}
+			if (__builtin_cpu_supports("avx2")) {
+				return popcount_level::avx2;
+			}
+			if (__builtin_cpu_supports("popcnt")) {
+				return popcount_level::popcnt;
+			}
+			return popcount_level::none;
+		}();
+		return level;
+#else
+		return popcount_level::none;
+#endif
+	}
+
+	// widths that divide a byte lane layout and integer outputs wide enough for them
+	template<size_t Bits, typename T>
+	constexpr bool simd_unpackable = (Bits == 1 || Bits == 2 || Bits == 4 || Bits == 8 || Bits == 16 || Bits == 32)
+		&& std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) * 8 >= Bits;
+
+	// element bytes already in order, same size packing is just a shuffle
+	template<size_t Bits, typename T>
+	constexpr bool simd_packable = (Bits == 8 || Bits == 16 || Bits == 32)
+		&& std::is_integral_v<T> && !std::is_same_v<T, bool> && sizeof(T) * 8 == Bits;
+
+#ifdef BITARRAY_X86_DISPATCH
+	// puts elements of every word in memory order (MSB-first word => little endian lanes)
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_word_order(__m256i v) {
+		if constexpr (Bits == 32) {
+			return _mm256_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1));
+		}
+		else if constexpr (Bits == 16) {
+			const __m256i order = _mm256_setr_epi8(
+				6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13, 10, 11, 8, 9,
+				6, 7, 4, 5, 2, 3, 0, 1, 14, 15, 12, 13, 10, 11, 8, 9);
+			return _mm256_shuffle_epi8(v, order);
+		}
+		else {	// bytes
+			const __m256i order = _mm256_setr_epi8(
+				7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8,
+				7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+			return _mm256_shuffle_epi8(v, order);
+		}
+	}
+
+	// h - 16 bytes of Size-byte lanes, widened to T
+	template<size_t Size, typename T, size_t Part = 0>
+	BITARRAY_TARGET_AVX2 inline void avx2_widen(T* out, __m128i h) {
+		constexpr size_t per_part = 32 / sizeof(T);
+		if constexpr (Part * per_part < 16 / Size) {
+			const __m128i part = _mm_srli_si128(h, Part * per_part * Size);
+			__m256i wide;
+			if constexpr (Size == 1 && sizeof(T) == 2) {
+				wide = _mm256_cvtepu8_epi16(part);
+			}
+			else if constexpr (Size == 1 && sizeof(T) == 4) {
+				wide = _mm256_cvtepu8_epi32(part);
+			}
+			else if constexpr (Size == 1 && sizeof(T) == 8) {
+				wide = _mm256_cvtepu8_epi64(part);
+			}
+			else if constexpr (Size == 2 && sizeof(T) == 4) {
+				wide = _mm256_cvtepu16_epi32(part);
+			}
+			else if constexpr (Size == 2 && sizeof(T) == 8) {
+				wide = _mm256_cvtepu16_epi64(part);
+			}
+			else {	// 4 => 8
+				wide = _mm256_cvtepu32_epi64(part);
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + Part * per_part), wide);
+			avx2_widen<Size, T, Part + 1>(out, h);
+		}
+	}
+
+	// v - 32 bytes of Size-byte lanes
+	template<size_t Size, typename T>
+	BITARRAY_TARGET_AVX2 inline void avx2_store(T* out, __m256i v) {
+		if constexpr (sizeof(T) == Size) {
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out), v);
+		}
+		else {
+			avx2_widen<Size, T>(out, _mm256_castsi256_si128(v));
+			avx2_widen<Size, T>(out + 16 / Size, _mm256_extracti128_si256(v, 1));
+		}
+	}
+
+	// v - 32 bytes, each holds one Unit-bit chunk (Bits < 8) in its low bits
+	template<size_t Bits, size_t Unit, typename T>
+	BITARRAY_TARGET_AVX2 inline void avx2_expand(T* out, __m256i v) {
+		if constexpr (Unit == Bits) {
+			avx2_store<1>(out, v);
+		}
+		else {
+			constexpr int half = Unit / 2;
+			const __m256i low_mask = _mm256_set1_epi8((1 << half) - 1);
+			const __m256i high = _mm256_and_si256(_mm256_srli_epi16(v, half), low_mask);
+			const __m256i low = _mm256_and_si256(v, low_mask);
+			const __m256i a = _mm256_unpacklo_epi8(high, low);
+			const __m256i b = _mm256_unpackhi_epi8(high, low);
+			avx2_expand<Bits, half>(out, _mm256_permute2x128_si256(a, b, 0x20));
+			avx2_expand<Bits, half>(out + 32 * half / Bits, _mm256_permute2x128_si256(a, b, 0x31));
+		}
+	}
+
+	// returns count of processed words (multiple of 4)
+	template<size_t Bits, typename T>
+	BITARRAY_TARGET_AVX2 size_t unpack_words_avx2(const uint64_t* in, size_t words, T* out) {
+		constexpr size_t elems = 256 / Bits;	// per 4 words
+		size_t done = 0;
+		for (; done + 4 <= words; done += 4) {
+			const __m256i v = avx2_word_order<Bits>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + done)));
+			if constexpr (Bits >= 8) {
+				avx2_store<Bits / 8>(out, v);
+			}
+			else {
+				avx2_expand<Bits, 8>(out, v);
+			}
+			out += elems;
+		}
+
+		return done;
+	}
+
+	// OR of the Bits-bit lanes of word (64 % Bits == 0)
+	template<size_t Bits>
+	inline uint64_t fold_lanes(uint64_t word) {
+		for (size_t shift = 32; shift >= Bits; shift /= 2) {
+			word |= word >> shift;
+		}
+		return word & mask_of<Bits>();
+	}
+
+	// all |= OR of the packed values (like pack_groups_swar)
+	template<size_t Bits, typename T>
+	BITARRAY_TARGET_AVX2 size_t pack_words_avx2(uint64_t* out, size_t words, const T* in, uint64_t& all) {
+		__m256i values = _mm256_setzero_si256();
+		size_t done = 0;
+		for (; done + 4 <= words; done += 4) {
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + done), avx2_word_order<Bits>(v));
+			values = _mm256_or_si256(values, v);
+			in += 256 / Bits;
+		}
+
+		alignas(32) uint64_t lanes[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), values);
+		all |= fold_lanes<Bits>(lanes[0] | lanes[1] | lanes[2] | lanes[3]);
+		return done;
+	}
+
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX512 inline __m512i avx512_word_order(__m512i v) {
+		if constexpr (Bits == 32) {
+			return _mm512_shuffle_epi32(v, _MM_PERM_CDAB);
+		}
+		else {
+			const __m256i order = avx2_word_order<Bits>(_mm256_setr_epi8(
+				0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+				0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15));
+			return _mm512_shuffle_epi8(v, _mm512_broadcast_i64x4(order));
+		}
+	}
+
+	template<size_t Bits, size_t Unit, typename T>
+	BITARRAY_TARGET_AVX512 inline void avx512_expand(T* out, __m512i v) {
+		if constexpr (Unit == Bits) {
+			if constexpr (sizeof(T) == 1) {
+				_mm512_storeu_si512(out, v);
+			}
+			else {
+				avx2_store<1>(out, _mm512_castsi512_si256(v));
+				avx2_store<1>(out + 32, _mm512_extracti64x4_epi64(v, 1));
+			}
+		}
+		else {
+			constexpr int half = Unit / 2;
+			const __m512i low_mask = _mm512_set1_epi8((1 << half) - 1);
+			const __m512i high = _mm512_and_si512(_mm512_srli_epi16(v, half), low_mask);
+			const __m512i low = _mm512_and_si512(v, low_mask);
+			const __m512i a = _mm512_unpacklo_epi8(high, low);
+			const __m512i b = _mm512_unpackhi_epi8(high, low);
+			avx512_expand<Bits, half>(out, _mm512_permutex2var_epi64(a, _mm512_setr_epi64(0, 1, 8, 9, 2, 3, 10, 11), b));
+			avx512_expand<Bits, half>(out + 64 * half / Bits, _mm512_permutex2var_epi64(a, _mm512_setr_epi64(4, 5, 12, 13, 6, 7, 14, 15), b));
+		}
+	}
+
+	// returns count of processed words (multiple of 8)
+	template<size_t Bits, typename T>
+	BITARRAY_TARGET_AVX512 size_t unpack_words_avx512(const uint64_t* in, size_t words, T* out) {
+		constexpr size_t elems = 512 / Bits;	// per 8 words
+		size_t done = 0;
+		for (; done + 8 <= words; done += 8) {
+			const __m512i v = avx512_word_order<Bits>(_mm512_loadu_si512(in + done));
+			if constexpr (Bits >= 8) {
+				if constexpr (sizeof(T) * 8 == Bits) {
+					_mm512_storeu_si512(out, v);
+				}
+				else {
+					avx2_store<Bits / 8>(out, _mm512_castsi512_si256(v));
+					avx2_store<Bits / 8>(out + elems / 2, _mm512_extracti64x4_epi64(v, 1));
+				}
+			}
+			else {
+				avx512_expand<Bits, 8>(out, v);
+			}
+			out += elems;
+		}
+
+		return done;
+	}
+
+	template<size_t Bits, typename T>
+	BITARRAY_TARGET_AVX512 size_t pack_words_avx512(uint64_t* out, size_t words, const T* in, uint64_t& all) {
+		__m512i values = _mm512_setzero_si512();
+		size_t done = 0;
+		for (; done + 8 <= words; done += 8) {
+			const __m512i v = _mm512_loadu_si512(in);
+			_mm512_storeu_si512(out + done, avx512_word_order<Bits>(v));
+			values = _mm512_or_si512(values, v);
+			in += 512 / Bits;
+		}
+
+		all |= fold_lanes<Bits>(static_cast<uint64_t>(_mm512_reduce_or_epi64(values)));
+		return done;
+	}
+#endif
+
+	template<size_t Bits, typename T>
+	inline void unpack_groups(const uint64_t* in, size_t groups, T* out) {
+#ifdef BITARRAY_X86_DISPATCH
+		if constexpr (simd_unpackable<Bits, T>) {	// group is 1 word
+			const simd_level level = cpu_simd_level();
+			size_t done = 0;
+			if (level == simd_level::avx512) {
+				done = unpack_words_avx512<Bits>(in, groups, out);
+			}
+			else if (level == simd_level::avx2) {
+				done = unpack_words_avx2<Bits>(in, groups, out);
+			}
+			in += done;
+			out += done * group_elems<Bits>;
+			groups -= done;
+		}
+#endif
+		unpack_groups_swar<Bits>(in, groups, out);
+	}
+
+	template<size_t Bits, typename T>
+	inline uint64_t pack_groups(uint64_t* out, size_t groups, const T* in) {
+		uint64_t all = 0;
+#ifdef BITARRAY_X86_DISPATCH
+		if constexpr (simd_packable<Bits, T>) {	// group is 1 word, values always fit
+			const simd_level level = cpu_simd_level();
+			size_t done = 0;
+			if (level == simd_level::avx512) {
+				done = pack_words_avx512<Bits>(out, groups, in, all);
+			}
+			else if (level == simd_level::avx2) {
+				done = pack_words_avx2<Bits>(out, groups, in, all);
+			}
+			out += done;
+			in += done * group_elems<Bits>;
+			groups -= done;
+		}
+#endif
+		return all | pack_groups_swar<Bits>(out, groups, in);
+	}
+
+	// out[i] = element (first + i)
+	template<size_t Bits, typename T>
+	void unpack(const uint64_t* memory, size_t first, size_t count, T* out) {
+		for (; count && first % group_elems<Bits>; --count) {	// head
+			*(out++) = static_cast<T>(get<Bits>(memory, first++));
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		unpack_groups<Bits>(memory + first / group_elems<Bits> * group_words<Bits>, groups, out);
+		first += groups * group_elems<Bits>;
+		out += groups * group_elems<Bits>;
+		count -= groups * group_elems<Bits>;
+
+		for (; count; --count) {	// tail
+			*(out++) = static_cast<T>(get<Bits>(memory, first++));
+		}
+	}
+
+	// element (first + i) = in[i], returns OR of all the values (overflow check is up to the caller)
+	template<size_t Bits, typename T>
+	uint64_t pack(uint64_t* memory, size_t first, size_t count, const T* in) {
+		uint64_t all = 0;
+		for (; count && first % group_elems<Bits>; --count) {	// head
+			const uint64_t val = static_cast<uint64_t>(*(in++));
+			all |= val;
+			set<Bits>(memory, first++, val & mask_of<Bits>());
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		all |= pack_groups<Bits>(memory + first / group_elems<Bits> * group_words<Bits>, groups, in);
+		first += groups * group_elems<Bits>;
+		in += groups * group_elems<Bits>;
+		count -= groups * group_elems<Bits>;
+
+		for (; count; --count) {	// tail
+			const uint64_t val = static_cast<uint64_t>(*(in++));
+			all |= val;
+			set<Bits>(memory, first++, val & mask_of<Bits>());
+		}
+
+		return all;
+	}
+
+	// every element of [first, first + count) = val (val must be <= mask_of<Bits>())
+	template<size_t Bits>
+	void fill(uint64_t* memory, size_t first, size_t count, uint64_t val) {
+		for (; count && first % group_elems<Bits>; --count) {	// head
+			set<Bits>(memory, first++, val);
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		if (groups) {
+			uint64_t pattern[group_words<Bits>]{};
+			for (size_t lane{}; lane < group_elems<Bits>; ++lane) {
+				set<Bits>(pattern, lane, val);
+			}
+
+			uint64_t* out = memory + first / group_elems<Bits> * group_words<Bits>;
+			for (size_t group{}; group < groups; ++group) {
+				for (size_t word{}; word < group_words<Bits>; ++word) {
+					*(out++) = pattern[word];
+				}
+			}
+			first += groups * group_elems<Bits>;
+			count -= groups * group_elems<Bits>;
+		}
+
+		for (; count; --count) {	// tail
+			set<Bits>(memory, first++, val);
+		}
+	}
+
+	// lane-wise arithmetic: Saturate - clamp to [0, mask], otherwise modulo 2^Bits
+	template<size_t Bits, bool Sub, bool Saturate>
+	inline uint64_t lane_add_sub(uint64_t x, uint64_t y) {
+		if constexpr (Sub) {
+			if constexpr (Saturate) {
+				return x < y ? 0 : x - y;
+			}
+			else {
+				return (x - y) & mask_of<Bits>();
+			}
+		}
+		else {
+			if constexpr (Saturate) {
+				return x + y > mask_of<Bits>() ? mask_of<Bits>() : x + y;
+			}
+			else {
+				return (x + y) & mask_of<Bits>();
+			}
+		}
+	}
+
+	// SWAR helpers for widths that divide 64 (lanes never cross words)
+	template<size_t Bits>
+	constexpr uint64_t lane_ones = ~uint64_t(0) / mask_of<Bits>();	// 1 in every lane
+	template<size_t Bits>
+	constexpr uint64_t lane_high = lane_ones<Bits> << (Bits - 1);	// top bit of every lane
+
+	// flag at the top bit of a lane => whole lane set
+	template<size_t Bits>
+	inline uint64_t lane_fill(uint64_t flags) {
+		return (flags << 1) - (flags >> (Bits - 1));
+	}
+
+	// all lanes at once, carries are cut at lane top bits
+	template<size_t Bits, bool Sub, bool Saturate>
+	inline uint64_t swar_add_sub(uint64_t x, uint64_t y) {
+		constexpr uint64_t high = lane_high<Bits>;
+		if constexpr (Sub) {
+			const uint64_t diff = ((x | high) - (y & ~high)) ^ ((x ^ ~y) & high);
+			if constexpr (Saturate) {
+				const uint64_t borrow = ((~x & y) | (~(x ^ y) & diff)) & high;
+				return diff & ~lane_fill<Bits>(borrow);
+			}
+			else {
+				return diff;
+			}
+		}
+		else {
+			const uint64_t sum = ((x & ~high) + (y & ~high)) ^ ((x ^ y) & high);
+			if constexpr (Saturate) {
+				const uint64_t carry = ((x & y) | ((x | y) & ~sum)) & high;
+				return sum | lane_fill<Bits>(carry);
+			}
+			else {
+				return sum;
+			}
+		}
+	}
+
+	// carry/borrow out of every lane (at its top bit) of swar_add_sub
+	template<size_t Bits, bool Sub>
+	inline uint64_t swar_overflow(uint64_t x, uint64_t y) {
+		constexpr uint64_t high = lane_high<Bits>;
+		if constexpr (Sub) {
+			const uint64_t diff = ((x | high) - (y & ~high)) ^ ((x ^ ~y) & high);
+			return ((~x & y) | (~(x ^ y) & diff)) & high;
+		}
+		else {
+			const uint64_t sum = ((x & ~high) + (y & ~high)) ^ ((x ^ y) & high);
+			return ((x & y) | ((x | y) & ~sum)) & high;
+		}
+	}
+
+	// top bit of every lane, for each word of a group
+	template<size_t Bits>
+	struct group_high {
+		uint64_t words[group_words<Bits>]{};
+
+		constexpr group_high() {
+			for (size_t lane{}; lane < group_elems<Bits>; ++lane) {
+				words[lane * Bits / 64] |= uint64_t(1) << (63 - lane * Bits % 64);
+			}
+		}
 	};
-public:
-	class iterator {
-	private:
-		BitArrayRef bit_ref;
-		inline iterator(BitArray<Bits>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index);
-		friend class BitArray<Bits>;
-	public:
-		iterator();
-		iterator(const BitArray<Bits>::iterator& other_it);
 
-		inline BitArrayRef& operator*();
-		inline iterator& operator++();	// prefix
-		inline iterator& operator--();	// prefix
-		inline iterator& operator+=(const uint64_t& val);
-		inline iterator& operator-=(const uint64_t& val);
-		inline iterator operator+(size_t value) const;
-		inline iterator operator-(size_t value) const;
-		inline iterator& operator=(const BitArray<Bits>::iterator& other);
-		inline size_t operator-(BitArray<Bits>::iterator other_it);
-		inline bool operator==(const BitArray<Bits>::iterator& other) const;
-		inline bool operator!=(const BitArray<Bits>::iterator& other) const;
-		inline bool operator<(const BitArray<Bits>::iterator& other) const;
-		inline bool operator>(const BitArray<Bits>::iterator& other) const;
-		inline bool operator<=(const BitArray<Bits>::iterator& other) const;
-		inline bool operator>=(const BitArray<Bits>::iterator& other) const;
-	};
+	// swar_add_sub for lanes that cross words: the group is one big number (word 0 - high part),
+	// carries/borrows go from word to word only inside a crossing lane
+	// Check - x is not changed, returns carry/borrow flags of all the lanes
+	template<size_t Bits, bool Sub, bool Saturate, bool Check = false>
+	inline uint64_t group_add_sub(uint64_t* x, const uint64_t* y) {
+		constexpr group_high<Bits> high{};
+		uint64_t flags[group_words<Bits>];	// carry/borrow out of every lane (at its top bit)
+		uint64_t carry = 0;
+		for (size_t k = group_words<Bits>; k--;) {
+			const uint64_t a = x[k];
+			const uint64_t b = y[k];
+			const uint64_t h = high.words[k];
+			if constexpr (Sub) {
+				const uint64_t left = a | h;
+				const uint64_t right = b & ~h;
+				const uint64_t part = left - right;
+				const uint64_t diff = (part - carry) ^ ((a ^ ~b) & h);
+				carry = (left < right) | (part < carry);
+				flags[k] = ((~a & b) | (~(a ^ b) & diff)) & h;
+				if constexpr (!Check) {
+					x[k] = diff;
+				}
+			}
+			else {
+				const uint64_t left = a & ~h;
+				const uint64_t part = left + (b & ~h);
+				const uint64_t sum = (part + carry) ^ ((a ^ b) & h);
+				carry = (part < left) | (part + carry < part);
+				flags[k] = ((a & b) | ((a | b) & ~sum)) & h;
+				if constexpr (!Check) {
+					x[k] = sum;
+				}
+			}
+		}
+
+		if constexpr (Check) {
+			uint64_t all = 0;
+			for (size_t k{}; k < group_words<Bits>; ++k) {
+				all |= flags[k];
+			}
+			return all;
+		}
+		else if constexpr (Saturate) {	// lane_fill over the group: (flags << 1) - (flags >> (Bits - 1))
+			uint64_t borrow = 0;
+			for (size_t k = group_words<Bits>; k--;) {
+				const uint64_t up = (flags[k] << 1) | (k + 1 < group_words<Bits> ? flags[k + 1] >> 63 : 0);
+				const uint64_t down = (flags[k] >> (Bits - 1)) | (k ? flags[k - 1] << (65 - Bits) : 0);
+				const uint64_t part = up - down;
+				const uint64_t lanes = part - borrow;
+				borrow = (up < down) | (part < borrow);
+				x[k] = Sub ? x[k] & ~lanes : x[k] | lanes;
+			}
+		}
+		return 0;
+	}
+
+	// val in every lane of a group
+	template<size_t Bits>
+	inline void group_pattern(uint64_t* group, uint64_t val) {
+		for (size_t k{}; k < group_words<Bits>; ++k) {
+			group[k] = 0;
+		}
+		for (size_t lane{}; lane < group_elems<Bits>; ++lane) {
+			set<Bits>(group, lane, val);
+		}
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	template<size_t Bits, bool Sub, bool Saturate>
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_add_sub(__m256i x, __m256i y) {
+		if constexpr (Bits == 8) {	// lane order doesn't matter for lane-wise ops
+			return Sub ? (Saturate ? _mm256_subs_epu8(x, y) : _mm256_sub_epi8(x, y))
+				: (Saturate ? _mm256_adds_epu8(x, y) : _mm256_add_epi8(x, y));
+		}
+		else if constexpr (Bits == 16) {
+			return Sub ? (Saturate ? _mm256_subs_epu16(x, y) : _mm256_sub_epi16(x, y))
+				: (Saturate ? _mm256_adds_epu16(x, y) : _mm256_add_epi16(x, y));
+		}
+		else {	// same as swar_add_sub
+			const __m256i high = _mm256_set1_epi64x(static_cast<long long>(lane_high<Bits>));
+			const __m256i low = _mm256_andnot_si256(high, y);
+			if constexpr (Sub) {
+				const __m256i diff = _mm256_xor_si256(_mm256_sub_epi64(_mm256_or_si256(x, high), low),
+					_mm256_andnot_si256(_mm256_xor_si256(x, y), high));
+				if constexpr (Saturate) {
+					const __m256i borrow = _mm256_and_si256(_mm256_or_si256(_mm256_andnot_si256(x, y),
+						_mm256_andnot_si256(_mm256_xor_si256(x, y), diff)), high);
+					return _mm256_andnot_si256(_mm256_sub_epi64(_mm256_slli_epi64(borrow, 1), _mm256_srli_epi64(borrow, Bits - 1)), diff);
+				}
+				else {
+					return diff;
+				}
+			}
+			else {
+				const __m256i sum = _mm256_xor_si256(_mm256_add_epi64(_mm256_andnot_si256(high, x), low),
+					_mm256_and_si256(_mm256_xor_si256(x, y), high));
+				if constexpr (Saturate) {
+					const __m256i carry = _mm256_and_si256(_mm256_or_si256(_mm256_and_si256(x, y),
+						_mm256_andnot_si256(sum, _mm256_or_si256(x, y))), high);
+					return _mm256_or_si256(sum, _mm256_sub_epi64(_mm256_slli_epi64(carry, 1), _mm256_srli_epi64(carry, Bits - 1)));
+				}
+				else {
+					return sum;
+				}
+			}
+		}
+	}
+
+	// words[i] = words[i] +/- other[i] (Broadcast: other[0]), returns words done
+	template<size_t Bits, bool Sub, bool Saturate, bool Broadcast>
+	BITARRAY_TARGET_AVX2 size_t add_sub_words_avx2(uint64_t* words, const uint64_t* other, size_t count) {
+		__m256i pattern = _mm256_setzero_si256();
+		if constexpr (Broadcast) {	// other may be null otherwise (empty arrays)
+			pattern = _mm256_set1_epi64x(static_cast<long long>(other[0]));
+		}
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			const __m256i y = Broadcast ? pattern : _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), avx2_add_sub<Bits, Sub, Saturate>(x, y));
+		}
+
+		return i;
+	}
+
+	BITARRAY_TARGET_AVX2 inline size_t shift_words_avx2(uint64_t* words, size_t count, size_t shift, uint64_t keep) {
+		const __m128i by = _mm_cvtsi64_si128(static_cast<long long>(shift));
+		const __m256i keep_mask = _mm256_set1_epi64x(static_cast<long long>(keep));
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), _mm256_and_si256(_mm256_srl_epi64(x, by), keep_mask));
+		}
+
+		return i;
+	}
+#endif
+
+	// element i = element i +/- (Broadcast ? val : element i of other), i in [first, first + count)
+	// other has the same layout (same first), val must be <= mask_of<Bits>()
+	template<size_t Bits, bool Sub, bool Saturate, bool Broadcast>
+	void add_sub(uint64_t* memory, const uint64_t* other, uint64_t val, size_t first, size_t count) {
+		for (; count && first % group_elems<Bits>; --count, ++first) {	// head
+			set<Bits>(memory, first, lane_add_sub<Bits, Sub, Saturate>(get<Bits>(memory, first),
+				Broadcast ? val : get<Bits>(other, first)));
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		uint64_t* words = memory + first / group_elems<Bits> * group_words<Bits>;
+		const uint64_t* other_words = Broadcast ? nullptr : other + first / group_elems<Bits> * group_words<Bits>;
+		if constexpr (64 % Bits == 0) {	// group = 1 word => SWAR
+			const uint64_t pattern = val * lane_ones<Bits>;
+			size_t done = 0;
+#ifdef BITARRAY_X86_DISPATCH
+			if (cpu_simd_level() != simd_level::none) {
+				done = add_sub_words_avx2<Bits, Sub, Saturate, Broadcast>(words, Broadcast ? &pattern : other_words, groups);
+			}
+#endif
+			for (size_t i = done; i < groups; ++i) {
+				words[i] = swar_add_sub<Bits, Sub, Saturate>(words[i], Broadcast ? pattern : other_words[i]);
+			}
+		}
+		else {	// lanes cross words => group at once
+			uint64_t pattern[group_words<Bits>];
+			if constexpr (Broadcast) {
+				group_pattern<Bits>(pattern, val);
+			}
+			for (size_t group{}; group < groups; ++group) {
+				group_add_sub<Bits, Sub, Saturate>(words, Broadcast ? pattern : other_words);
+				words += group_words<Bits>;
+				if constexpr (!Broadcast) {
+					other_words += group_words<Bits>;
+				}
+			}
+		}
+		first += groups * group_elems<Bits>;
+		count -= groups * group_elems<Bits>;
+
+		for (; count; --count, ++first) {	// tail
+			set<Bits>(memory, first, lane_add_sub<Bits, Sub, Saturate>(get<Bits>(memory, first),
+				Broadcast ? val : get<Bits>(other, first)));
+		}
+	}
+
+	// true if add_sub would overflow (below 0 for Sub) in any element, nothing is written
+	template<size_t Bits, bool Sub, bool Broadcast>
+	bool add_sub_overflows(uint64_t* memory, const uint64_t* other, uint64_t val, size_t first, size_t count) {
+		auto lane_overflows = [](uint64_t x, uint64_t y) {
+			return Sub ? x < y : x + y > mask_of<Bits>();
+		};
+		bool any = false;
+		for (; count && first % group_elems<Bits>; --count, ++first) {	// head
+			any |= lane_overflows(get<Bits>(memory, first), Broadcast ? val : get<Bits>(other, first));
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		uint64_t* words = memory + first / group_elems<Bits> * group_words<Bits>;
+		const uint64_t* other_words = Broadcast ? nullptr : other + first / group_elems<Bits> * group_words<Bits>;
+		uint64_t flags = 0;
+		if constexpr (64 % Bits == 0) {
+			const uint64_t pattern = val * lane_ones<Bits>;
+			for (size_t i{}; i < groups; ++i) {
+				flags |= swar_overflow<Bits, Sub>(words[i], Broadcast ? pattern : other_words[i]);
+			}
+		}
+		else {
+			uint64_t pattern[group_words<Bits>];
+			if constexpr (Broadcast) {
+				group_pattern<Bits>(pattern, val);
+			}
+			for (size_t group{}; group < groups; ++group) {
+				flags |= group_add_sub<Bits, Sub, false, true>(words, Broadcast ? pattern : other_words);
+				words += group_words<Bits>;
+				if constexpr (!Broadcast) {
+					other_words += group_words<Bits>;
+				}
+			}
+		}
+		first += groups * group_elems<Bits>;
+		count -= groups * group_elems<Bits>;
+
+		for (; count; --count, ++first) {	// tail
+			any |= lane_overflows(get<Bits>(memory, first), Broadcast ? val : get<Bits>(other, first));
+		}
+
+		return any || flags;
+	}
+
+	// element i = element i >> shift, i in [first, first + count), shift < Bits
+	template<size_t Bits>
+	void shift_right(uint64_t* memory, size_t first, size_t count, size_t shift) {
+		for (; count && first % group_elems<Bits>; --count, ++first) {	// head
+			set<Bits>(memory, first, get<Bits>(memory, first) >> shift);
+		}
+
+		const size_t groups = count / group_elems<Bits>;
+		uint64_t* words = memory + first / group_elems<Bits> * group_words<Bits>;
+		if constexpr (64 % Bits == 0) {	// bits moved into the next lane are cut by keep
+			const uint64_t keep = (mask_of<Bits>() >> shift) * lane_ones<Bits>;
+			size_t done = 0;
+#ifdef BITARRAY_X86_DISPATCH
+			if (cpu_simd_level() != simd_level::none) {
+				done = shift_words_avx2(words, groups, shift, keep);
+			}
+#endif
+			for (size_t i = done; i < groups; ++i) {
+				words[i] = (words[i] >> shift) & keep;
+			}
+		}
+		else {	// the group is shifted as one bit stream (word 0 first)
+			uint64_t keep[group_words<Bits>];
+			group_pattern<Bits>(keep, mask_of<Bits>() >> shift);
+			for (size_t group{}; group < groups; ++group) {
+				for (size_t k = group_words<Bits>; k--;) {
+					words[k] = ((words[k] >> shift) | (k ? words[k - 1] << (64 - shift) : 0)) & keep[k];
+				}
+				words += group_words<Bits>;
+			}
+		}
+		first += groups * group_elems<Bits>;
+		count -= groups * group_elems<Bits>;
+
+		for (; count; --count, ++first) {	// tail
+			set<Bits>(memory, first, get<Bits>(memory, first) >> shift);
+		}
+	}
+
+	// lane predicates of the search functions
+	enum class lane_test { equal, not_equal, less };
+
+	template<lane_test Test>
+	inline bool lane_passes(uint64_t x, uint64_t val) {
+		return Test == lane_test::equal ? x == val : Test == lane_test::not_equal ? x != val : x < val;
+	}
+
+	// top bit of every lane that is not zero: the low bits carry into the top bit
+	template<size_t Bits>
+	inline uint64_t swar_nonzero(uint64_t x) {
+		constexpr uint64_t high = lane_high<Bits>;
+		return (((x & ~high) + ~high) | x) & high;
+	}
+
+	// flags[k] - top bits of the lanes passing Test for word k of the group,
+	// crossing lanes are handled as one big number (word 0 - high part) like in group_add_sub;
+	// a carry never leaves its lane and no lane covers a whole word => carry out of a word doesn't depend on carry in
+	template<size_t Bits, lane_test Test>
+	inline void group_select(const uint64_t* x, const uint64_t* pattern, uint64_t* flags) {
+		if constexpr (64 % Bits == 0) {
+			if constexpr (Test == lane_test::less) {
+				flags[0] = swar_overflow<Bits, true>(x[0], pattern[0]);
+			}
+			else {
+				const uint64_t nonzero = swar_nonzero<Bits>(x[0] ^ pattern[0]);
+				flags[0] = Test == lane_test::not_equal ? nonzero : nonzero ^ lane_high<Bits>;
+			}
+		}
+		else {
+			static constexpr group_high<Bits> high{};
+			uint64_t carry = 0;
+			for (size_t k = group_words<Bits>; k--;) {
+				const uint64_t h = high.words[k];
+				if constexpr (Test == lane_test::less) {	// borrow of x - pattern
+					const uint64_t a = x[k];
+					const uint64_t b = pattern[k];
+					const uint64_t left = a | h;
+					const uint64_t right = b & ~h;
+					const uint64_t part = left - right;
+					const uint64_t diff = (part - carry) ^ ((a ^ ~b) & h);
+					carry = left < right;
+					flags[k] = ((~a & b) | (~(a ^ b) & diff)) & h;
+				}
+				else {
+					const uint64_t v = x[k] ^ pattern[k];
+					const uint64_t part = (v & ~h) + ~h;
+					const uint64_t sum = part + carry;
+					carry = part < ~h;
+					const uint64_t nonzero = (sum | v) & h;
+					flags[k] = Test == lane_test::not_equal ? nonzero : nonzero ^ h;
+				}
+			}
+		}
+	}
+
+	// lanes passing Test in whole groups
+	template<size_t Bits, lane_test Test>
+	inline size_t count_groups(const uint64_t* words, const uint64_t* pattern, size_t groups) {
+		size_t hits = 0;
+		for (size_t group{}; group < groups; ++group) {
+			uint64_t flags[group_words<Bits>];
+			group_select<Bits, Test>(words + group * group_words<Bits>, pattern, flags);
+			for (size_t k{}; k < group_words<Bits>; ++k) {
+				hits += popcount(flags[k]);
+			}
+		}
+
+		return hits;
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	// same code with the popcnt instruction
+	template<size_t Bits, lane_test Test>
+	BITARRAY_TARGET_AVX2 size_t count_groups_popcnt(const uint64_t* words, const uint64_t* pattern, size_t groups) {
+		return count_groups<Bits, Test>(words, pattern, groups);
+	}
+
+	// group_select for 4 words (64 % Bits == 0)
+	template<size_t Bits, lane_test Test>
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_select(__m256i x, __m256i pattern) {
+		const __m256i high = _mm256_set1_epi64x(static_cast<long long>(lane_high<Bits>));
+		if constexpr (Bits == 8 || Bits == 16 || Bits == 32) {	// native unsigned lanes
+			__m256i hit;	// all ones in equal lanes (x >= p lanes for less)
+			if constexpr (Test == lane_test::less) {	// x < p <=> max(x, p) != x
+				hit = Bits == 8 ? _mm256_cmpeq_epi8(_mm256_max_epu8(x, pattern), x)
+					: Bits == 16 ? _mm256_cmpeq_epi16(_mm256_max_epu16(x, pattern), x)
+					: _mm256_cmpeq_epi32(_mm256_max_epu32(x, pattern), x);
+			}
+			else {
+				hit = Bits == 8 ? _mm256_cmpeq_epi8(x, pattern)
+					: Bits == 16 ? _mm256_cmpeq_epi16(x, pattern)
+					: _mm256_cmpeq_epi32(x, pattern);
+			}
+			return Test == lane_test::equal ? _mm256_and_si256(hit, high) : _mm256_andnot_si256(hit, high);
+		}
+		else if constexpr (Test == lane_test::less) {	// same as swar_overflow<Bits, true>
+			const __m256i diff = _mm256_xor_si256(_mm256_sub_epi64(_mm256_or_si256(x, high), _mm256_andnot_si256(high, pattern)),
+				_mm256_andnot_si256(_mm256_xor_si256(x, pattern), high));
+			return _mm256_and_si256(_mm256_or_si256(_mm256_andnot_si256(x, pattern),
+				_mm256_andnot_si256(_mm256_xor_si256(x, pattern), diff)), high);
+		}
+		else {	// same as swar_nonzero
+			const __m256i low = _mm256_set1_epi64x(static_cast<long long>(~lane_high<Bits>));
+			const __m256i v = _mm256_xor_si256(x, pattern);
+			const __m256i nonzero = _mm256_and_si256(_mm256_or_si256(_mm256_add_epi64(_mm256_and_si256(v, low), low), v), high);
+			return Test == lane_test::not_equal ? nonzero : _mm256_xor_si256(nonzero, high);
+		}
+	}
+
+	// bits set in every 64-bit lane (nibble lookup, summed by sad)
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_popcount(__m256i v) {
+		const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+			0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+		const __m256i nibble = _mm256_set1_epi8(0x0F);
+		const __m256i count = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, _mm256_and_si256(v, nibble)),
+			_mm256_shuffle_epi8(lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble)));
+		return _mm256_sad_epu8(count, _mm256_setzero_si256());
+	}
+
+	// returns words without a hit before the first block of 4 that has one (multiple of 4)
+	template<size_t Bits, lane_test Test>
+	BITARRAY_TARGET_AVX2 size_t find_words_avx2(const uint64_t* words, uint64_t pattern, size_t count) {
+		const __m256i p = _mm256_set1_epi64x(static_cast<long long>(pattern));
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i flags = avx2_select<Bits, Test>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), p);
+			if (!_mm256_testz_si256(flags, flags)) {
+				break;
+			}
+		}
+
+		return i;
+	}
+
+	// hits += lanes passing Test, returns words done
+	template<size_t Bits, lane_test Test>
+	BITARRAY_TARGET_AVX2 size_t count_words_avx2(const uint64_t* words, uint64_t pattern, size_t count, size_t& hits) {
+		const __m256i p = _mm256_set1_epi64x(static_cast<long long>(pattern));
+		__m256i sums = _mm256_setzero_si256();
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i flags = avx2_select<Bits, Test>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), p);
+			sums = _mm256_add_epi64(sums, avx2_popcount(flags));
+		}
+
+		alignas(32) uint64_t lanes[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+		hits += static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+		return i;
+	}
+
+	// index of the first word that differs, count if none
+	BITARRAY_TARGET_AVX2 inline size_t mismatch_words_avx2(const uint64_t* left, const uint64_t* right, size_t count) {
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i diff = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(left + i)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i*>(right + i)));
+			if (!_mm256_testz_si256(diff, diff)) {
+				break;
+			}
+		}
+		for (; i < count && left[i] == right[i]; ++i) {
+		}
+
+		return i;
+	}
+#endif
+
+	// first element of [first, last) passing Test against val, last if none (val must be <= mask_of<Bits>())
+	template<size_t Bits, lane_test Test>
+	size_t find(const uint64_t* memory, size_t first, size_t last, uint64_t val) {
+		for (; first < last && first % group_elems<Bits>; ++first) {	// head
+			if (lane_passes<Test>(get<Bits>(memory, first), val)) {
+				return first;
+			}
+		}
+
+		uint64_t pattern[group_words<Bits>];
+		group_pattern<Bits>(pattern, val);
+		const size_t groups = (last - first) / group_elems<Bits>;
+		const uint64_t* words = memory + first / group_elems<Bits> * group_words<Bits>;
+		size_t group{};
+#ifdef BITARRAY_X86_DISPATCH
+		if constexpr (64 % Bits == 0) {
+			if (cpu_simd_level() != simd_level::none) {
+				group = find_words_avx2<Bits, Test>(words, pattern[0], groups);
+			}
+		}
+#endif
+		for (; group < groups; ++group) {
+			uint64_t flags[group_words<Bits>];
+			group_select<Bits, Test>(words + group * group_words<Bits>, pattern, flags);
+			for (size_t k{}; k < group_words<Bits>; ++k) {
+				if (flags[k]) {
+					return first + group * group_elems<Bits> + (k * 64 + leading_zeros(flags[k])) / Bits;
+				}
+			}
+		}
+		first += groups * group_elems<Bits>;
+
+		for (; first < last; ++first) {	// tail
+			if (lane_passes<Test>(get<Bits>(memory, first), val)) {
+				return first;
+			}
+		}
+
+		return last;
+	}
+
+	// elements of [first, last) passing Test against val (val must be <= mask_of<Bits>())
+	template<size_t Bits, lane_test Test>
+	size_t count(const uint64_t* memory, size_t first, size_t last, uint64_t val) {
+		size_t hits = 0;
+		for (; first < last && first % group_elems<Bits>; ++first) {	// head
+			hits += lane_passes<Test>(get<Bits>(memory, first), val);
+		}
+
+		uint64_t pattern[group_words<Bits>];
+		group_pattern<Bits>(pattern, val);
+		const size_t groups = (last - first) / group_elems<Bits>;
+		const uint64_t* words = memory + first / group_elems<Bits> * group_words<Bits>;
+		size_t group{};
+#ifdef BITARRAY_X86_DISPATCH
+		if (cpu_simd_level() != simd_level::none) {
+			if constexpr (64 % Bits == 0) {
+				group = count_words_avx2<Bits, Test>(words, pattern[0], groups, hits);
+			}
+			else {
+				hits += count_groups_popcnt<Bits, Test>(words, pattern, groups);
+				group = groups;
+			}
+		}
+#endif
+		hits += count_groups<Bits, Test>(words + group * group_words<Bits>, pattern, groups - group);
+		first += groups * group_elems<Bits>;
+
+		for (; first < last; ++first) {	// tail
+			hits += lane_passes<Test>(get<Bits>(memory, first), val);
+		}
+
+		return hits;
+	}
+
+	// index of the first word that differs, count if none
+	inline size_t mismatch_words(const uint64_t* left, const uint64_t* right, size_t count) {
+#ifdef BITARRAY_X86_DISPATCH
+		if (cpu_simd_level() != simd_level::none) {
+			return mismatch_words_avx2(left, right, count);
+		}
+#endif
+		size_t i{};
+		for (; i < count && left[i] == right[i]; ++i) {
+		}
+
+		return i;
+	}
+
+	enum class word_op { and_, or_, xor_, andnot };
+
+	template<word_op Op>
+	inline uint64_t apply(uint64_t x, uint64_t y) {
+		return Op == word_op::and_ ? x & y : Op == word_op::or_ ? x | y : Op == word_op::xor_ ? x ^ y : x & ~y;
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	// returns words done
+	template<word_op Op>
+	BITARRAY_TARGET_AVX2 size_t bitwise_words_avx2(uint64_t* words, const uint64_t* other, size_t count) {
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i x = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			const __m256i y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(other + i));
+			const __m256i r = Op == word_op::and_ ? _mm256_and_si256(x, y) : Op == word_op::or_ ? _mm256_or_si256(x, y)
+				: Op == word_op::xor_ ? _mm256_xor_si256(x, y) : _mm256_andnot_si256(y, x);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(words + i), r);
+		}
+
+		return i;
+	}
+
+	// 4 accumulators => the popcnt false output dependency doesn't serialize the loop
+	BITARRAY_TARGET_POPCNT inline size_t popcount_words_popcnt(const uint64_t* words, size_t count) {
+		uint64_t sums[4]{};
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			for (size_t lane{}; lane < 4; ++lane) {
+				sums[lane] += static_cast<uint64_t>(__builtin_popcountll(words[i + lane]));
+			}
+		}
+		for (; i < count; ++i) {
+			sums[0] += static_cast<uint64_t>(__builtin_popcountll(words[i]));
+		}
+
+		return static_cast<size_t>(sums[0] + sums[1] + sums[2] + sums[3]);
+	}
+
+	BITARRAY_TARGET_AVX2 inline size_t popcount_words_avx2(const uint64_t* words, size_t count) {
+		__m256i sums = _mm256_setzero_si256();
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			sums = _mm256_add_epi64(sums, avx2_popcount(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i))));
+		}
+
+		alignas(32) uint64_t lanes[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+		size_t total = static_cast<size_t>(lanes[0] + lanes[1] + lanes[2] + lanes[3]);
+		for (; i < count; ++i) {
+			total += static_cast<size_t>(__builtin_popcountll(words[i]));
+		}
+		return total;
+	}
+
+	BITARRAY_TARGET_VPOPCNT inline size_t popcount_words_vpopcnt(const uint64_t* words, size_t count) {
+		__m512i sums = _mm512_setzero_si512();
+		size_t i{};
+		for (; i + 8 <= count; i += 8) {
+			sums = _mm512_add_epi64(sums, _mm512_popcnt_epi64(_mm512_loadu_si512(words + i)));
+		}
+		if (i < count) {	// masked load, the rest of the vector is zero
+			const __mmask8 rest = static_cast<__mmask8>((1u << (count - i)) - 1);
+			sums = _mm512_add_epi64(sums, _mm512_popcnt_epi64(_mm512_maskz_loadu_epi64(rest, words + i)));
+		}
+
+		return static_cast<size_t>(_mm512_reduce_add_epi64(sums));
+	}
+#endif
+
+	// words[i] = words[i] Op other[i]
+	template<word_op Op>
+	void bitwise(uint64_t* words, const uint64_t* other, size_t count) {
+		size_t i{};
+#ifdef BITARRAY_X86_DISPATCH
+		if (cpu_simd_level() != simd_level::none) {
+			i = bitwise_words_avx2<Op>(words, other, count);
+		}
+#endif
+		for (; i < count; ++i) {
+			words[i] = apply<Op>(words[i], other[i]);
+		}
+	}
+
+	// set bits of count words
+	inline size_t popcount_words(const uint64_t* words, size_t count) {
+#ifdef BITARRAY_X86_DISPATCH
+		switch (cpu_popcount_level()) {
+		case popcount_level::vpopcntdq:
+			return popcount_words_vpopcnt(words, count);
+		case popcount_level::avx2:
+			return popcount_words_avx2(words, count);
+		case popcount_level::popcnt:
+			return popcount_words_popcnt(words, count);
+		default:
+			break;
+		}
+#endif
+		size_t total = 0;
+		for (size_t i{}; i < count; ++i) {
+			total += popcount(words[i]);
+		}
+		return total;
+	}
+
+	// count (1..64) bits from bit position, left aligned
+	inline uint64_t read_bits(const uint64_t* memory, size_t bit, size_t count) {
+		const size_t word = bit / 64;
+		const size_t offset = bit % 64;
+
+		uint64_t val = memory[word] << offset;
+		if (offset + count > 64) {
+			val |= memory[word + 1] >> (64 - offset);
+		}
+
+		return val & (~uint64_t(0) << (64 - count));
+	}
+
+	// count (1..64) bits to bit position, val is left aligned
+	inline void write_bits(uint64_t* memory, size_t bit, size_t count, uint64_t val) {
+		const size_t word = bit / 64;
+		const size_t offset = bit % 64;
+		const uint64_t mask = ~uint64_t(0) << (64 - count);
+
+		if (offset + count <= 64) {	// in 1 word
+			memory[word] = (memory[word] & ~(mask >> offset)) | ((val & mask) >> offset);
+		}
+		else {	// in 2 words
+			const size_t second_len = offset + count - 64;
+			memory[word] = (memory[word] & ~(~uint64_t(0) >> offset)) | (val >> offset);
+			memory[word + 1] = (memory[word + 1] & (~uint64_t(0) >> second_len))
+				| ((val << (64 - offset)) & ~(~uint64_t(0) >> second_len));
+		}
+	}
+
+	// bit-granular memmove: [src, src + count) bits of src_memory => [dst, dst + count) bits of dst_memory
+	// destination is written by whole words, source words are joined with funnel shifts
+	inline void move_bits(uint64_t* dst_memory, size_t dst, const uint64_t* src_memory, size_t src, size_t count) {
+		if (!count || (dst_memory == src_memory && dst == src)) {
+			return;
+		}
+
+		if (dst_memory != src_memory || dst < src) {	// forward
+			const size_t head = (64 - dst % 64) % 64 < count ? (64 - dst % 64) % 64 : count;
+			if (head) {
+				write_bits(dst_memory, dst, head, read_bits(src_memory, src, head));
+				dst += head;
+				src += head;
+				count -= head;
+			}
+
+			uint64_t* out = dst_memory + dst / 64;
+			const uint64_t* in = src_memory + src / 64;
+			const size_t shift = src % 64;
+			const size_t words = count / 64;
+			if (shift == 0) {
+				for (size_t i{}; i < words; ++i) {
+					out[i] = in[i];
+				}
+			}
+			else {
+				for (size_t i{}; i < words; ++i) {
+					out[i] = (in[i] << shift) | (in[i + 1] >> (64 - shift));
+				}
+			}
+			dst += words * 64;
+			src += words * 64;
+			count -= words * 64;
+
+			if (count) {	// tail
+				write_bits(dst_memory, dst, count, read_bits(src_memory, src, count));
+			}
+		}
+		else {	// backward (overlapped, dst > src)
+			size_t dst_end = dst + count;
+			size_t src_end = src + count;
+
+			const size_t tail = dst_end % 64 < count ? dst_end % 64 : count;
+			if (tail) {
+				dst_end -= tail;
+				src_end -= tail;
+				count -= tail;
+				write_bits(dst_memory, dst_end, tail, read_bits(src_memory, src_end, tail));
+			}
+
+			const size_t words = count / 64;
+			uint64_t* out = dst_memory + (dst_end - words * 64) / 64;
+			const uint64_t* in = src_memory + (src_end - words * 64) / 64;
+			const size_t shift = (src_end - words * 64) % 64;
+			if (shift == 0) {
+				for (size_t i = words; i; --i) {
+					out[i - 1] = in[i - 1];
+				}
+			}
+			else {
+				for (size_t i = words; i; --i) {
+					out[i - 1] = (in[i - 1] << shift) | (in[i] >> (64 - shift));
+				}
+			}
+			count -= words * 64;
+
+			if (count) {	// head
+				write_bits(dst_memory, dst, count, read_bits(src_memory, src, count));
+			}
+		}
+	}
+
+	// width conversion: blocks of elements go through a small buffer (stays in L1) between the kernels of both widths
+	constexpr size_t repack_block = 256;	// multiple of every group_elems => whole groups are written
+
+	// element i (To bits) of dst = element i (From bits) of src for [0, count), returns OR of the written values
+	// Saturate - values over mask_of<To>() are clamped, otherwise cut to To bits (overflow check is up to the caller)
+	// dst == src is allowed for To <= From: a block is written below the bits of the next one
+	template<size_t From, size_t To, bool Saturate>
+	uint64_t repack(const uint64_t* src, uint64_t* dst, size_t count) {
+		uint64_t all = 0;
+		uint64_t buffer[repack_block];
+		for (size_t first{}; first < count; first += repack_block) {
+			const size_t n = count - first < repack_block ? count - first : repack_block;
+			unpack<From>(src, first, n, buffer);
+			if constexpr (Saturate && To < From) {
+				for (size_t i{}; i < n; ++i) {
+					buffer[i] = buffer[i] > mask_of<To>() ? mask_of<To>() : buffer[i];
+				}
+			}
+			all |= pack<To>(dst, first, n, buffer);
+		}
+
+		return all;
+	}
+
+	// OR of elements [0, count): whole groups are OR-ed word by word, their lanes are joined after
+	template<size_t Bits>
+	uint64_t or_all(const uint64_t* memory, size_t count) {
+		uint64_t acc[group_words<Bits>]{};
+		const size_t groups = count / group_elems<Bits>;
+		for (size_t group{}; group < groups; ++group, memory += group_words<Bits>) {
+			for (size_t word{}; word < group_words<Bits>; ++word) {
+				acc[word] |= memory[word];
+			}
+		}
+
+		uint64_t all = 0;
+		for (size_t lane{}; lane < group_elems<Bits>; ++lane) {
+			all |= get<Bits>(acc, lane);
+		}
+		for (size_t i{}; i < count % group_elems<Bits>; ++i) {	// tail
+			all |= get<Bits>(memory, i);
+		}
+
+		return all;
+	}
+
+	// bits needed for val (at least 1)
+	inline size_t width_of(uint64_t val) {
+		return val ? 64 - leading_zeros(val) : 1;
+	}
+
+	// sorting: counting sort for widths with few values, LSD radix sort (8-bit digits) over packed words otherwise
+	template<size_t Bits>
+	constexpr bool counting_sortable = Bits <= 16;
+
+	// counts - 2^Bits zeros; values are counted, then written back as runs by the fill kernel
+	template<size_t Bits>
+	void counting_sort(uint64_t* memory, size_t count, size_t* counts) {
+		uint64_t buffer[repack_block];
+		for (size_t first{}; first < count; first += repack_block) {
+			const size_t n = count - first < repack_block ? count - first : repack_block;
+			unpack<Bits>(memory, first, n, buffer);
+			for (size_t i{}; i < n; ++i) {
+				++counts[buffer[i]];
+			}
+		}
+
+		size_t first = 0;
+		for (uint64_t val{}; val <= mask_of<Bits>(); ++val) {
+			if (counts[val]) {
+				fill<Bits>(memory, first, counts[val], val);
+				first += counts[val];
+			}
+		}
+	}
+
+	// scratch - as many words as memory with zeroed bits after count;
+	// every pass reads one array in blocks and scatters into the other, a digit shared by all the values is skipped
+	// returns true if the result is in scratch
+	template<size_t Bits>
+	bool radix_sort(uint64_t* memory, uint64_t* scratch, size_t count) {
+		constexpr size_t digits = (Bits + 7) / 8;
+		std::unique_ptr<size_t[]> counts(new size_t[digits * 256]());	// all the histograms in one scan
+		uint64_t buffer[repack_block];
+		for (size_t first{}; first < count; first += repack_block) {
+			const size_t n = count - first < repack_block ? count - first : repack_block;
+			unpack<Bits>(memory, first, n, buffer);
+			for (size_t i{}; i < n; ++i) {
+				for (size_t digit{}; digit < digits; ++digit) {
+					++counts[digit * 256 + ((buffer[i] >> (digit * 8)) & 255)];
+				}
+			}
+		}
+
+		uint64_t* src = memory;
+		uint64_t* dst = scratch;
+		for (size_t digit{}; digit < digits; ++digit) {
+			size_t* positions = counts.get() + digit * 256;
+			if (positions[(get<Bits>(memory, 0) >> (digit * 8)) & 255] == count) {
+				continue;
+			}
+			for (size_t bucket{}, total{}; bucket < 256; ++bucket) {	// counts => first positions
+				const size_t bucket_count = positions[bucket];
+				positions[bucket] = total;
+				total += bucket_count;
+			}
+
+			for (size_t first{}; first < count; first += repack_block) {
+				const size_t n = count - first < repack_block ? count - first : repack_block;
+				unpack<Bits>(src, first, n, buffer);
+				for (size_t i{}; i < n; ++i) {
+					set<Bits>(dst, positions[(buffer[i] >> (digit * 8)) & 255]++, buffer[i]);
+				}
+			}
+			std::swap(src, dst);
+		}
+
+		return src == scratch;
+	}
+
+	// sorts count elements in place; counting sort only once count reaches 2^Bits (below that clearing and scanning
+	// the counters costs more than the radix passes), counters and scratch never come from the array's resource
+	template<size_t Bits>
+	void sort(uint64_t* memory, size_t count) {
+		if constexpr (counting_sortable<Bits>) {
+			if (count >= (size_t(1) << Bits)) {
+				if constexpr (Bits <= 8) {
+					size_t counts[size_t(1) << Bits]{};
+					counting_sort<Bits>(memory, count, counts);
+				}
+				else {
+					std::vector<size_t> counts(size_t(1) << Bits, 0);
+					counting_sort<Bits>(memory, count, counts.data());
+				}
+				return;
+			}
+		}
+
+		const size_t word_count = (count * Bits + 63) / 64;
+		std::vector<uint64_t> scratch(word_count, 0);
+		if (radix_sort<Bits>(memory, scratch.data(), count)) {
+			for (size_t i{}; i < word_count; ++i) {
+				memory[i] = scratch[i];
+			}
+		}
+	}
+
+	// first index in sorted [first, last) with element >= val, probes are plain gets (branch-free halving)
+	template<size_t Bits>
+	size_t lower_bound(const uint64_t* memory, size_t first, size_t last, uint64_t val) {
+		if (first == last) {
+			return first;
+		}
+
+		size_t len = last - first;
+		while (len > 1) {
+			const size_t half = len / 2;
+			first = get<Bits>(memory, first + half - 1) < val ? first + half : first;
+			len -= half;
+		}
+
+		return first + (get<Bits>(memory, first) < val);
+	}
+
+	// reductions: widths dividing 64 work on whole words (SWAR, AVX2), other widths on decoded blocks
+
+	// sum of the lanes of one word (64 % Bits == 0): neighbour lanes are added into lanes twice as wide
+	// until the total fits one lane, then a multiply by the lane-ones constant adds all of them into the top lane
+	template<size_t Bits>
+	inline uint64_t word_lane_sum(uint64_t w) {
+		if constexpr (Bits == 1) {
+			return popcount(w);
+		}
+		else if constexpr (Bits == 2) {	// 4-bit lanes <= 6 => bytes <= 12
+			w = (w & 0x3333333333333333ull) + ((w >> 2) & 0x3333333333333333ull);
+			w = (w + (w >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+			return (w * 0x0101010101010101ull) >> 56;
+		}
+		else if constexpr (Bits == 4) {	// bytes <= 30, total <= 240
+			w = (w & 0x0F0F0F0F0F0F0F0Full) + ((w >> 4) & 0x0F0F0F0F0F0F0F0Full);
+			return (w * 0x0101010101010101ull) >> 56;
+		}
+		else if constexpr (Bits == 8) {	// 16-bit lanes <= 510, total <= 2040
+			w = (w & 0x00FF00FF00FF00FFull) + ((w >> 8) & 0x00FF00FF00FF00FFull);
+			return (w * 0x0001000100010001ull) >> 48;
+		}
+		else if constexpr (Bits == 16) {	// the total needs 18 bits => two 32-bit lanes
+			w = (w & 0x0000FFFF0000FFFFull) + ((w >> 16) & 0x0000FFFF0000FFFFull);
+			return (w & 0xFFFFFFFFull) + (w >> 32);
+		}
+		else {
+			return (w & 0xFFFFFFFFull) + (w >> 32);
+		}
+	}
+
+	// lane-wise min (Max - max) of two words (64 % Bits == 0): the borrow of a lane picks it
+	template<size_t Bits, bool Max>
+	inline uint64_t word_lane_min(uint64_t x, uint64_t acc) {
+		const uint64_t take = lane_fill<Bits>(Max ? swar_overflow<Bits, true>(acc, x) : swar_overflow<Bits, true>(x, acc));
+		return (x & take) | (acc & ~take);
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	// lane sums of 4 words in 4 64-bit lanes (64 % Bits == 0, Bits > 1), bytes are summed by sad
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_lane_sum(__m256i v) {
+		if constexpr (Bits == 2) {
+			const __m256i pairs = _mm256_set1_epi8(0x33);
+			v = _mm256_add_epi8(_mm256_and_si256(v, pairs), _mm256_and_si256(_mm256_srli_epi16(v, 2), pairs));
+			v = _mm256_and_si256(_mm256_add_epi8(v, _mm256_srli_epi16(v, 4)), _mm256_set1_epi8(0x0F));
+			return _mm256_sad_epu8(v, _mm256_setzero_si256());
+		}
+		else if constexpr (Bits == 4) {
+			const __m256i nibble = _mm256_set1_epi8(0x0F);
+			v = _mm256_add_epi8(_mm256_and_si256(v, nibble), _mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+			return _mm256_sad_epu8(v, _mm256_setzero_si256());
+		}
+		else if constexpr (Bits == 8) {
+			return _mm256_sad_epu8(v, _mm256_setzero_si256());
+		}
+		else {
+			if constexpr (Bits == 16) {
+				v = _mm256_add_epi32(_mm256_and_si256(v, _mm256_set1_epi32(0xFFFF)), _mm256_srli_epi32(v, 16));
+			}
+			return _mm256_add_epi64(_mm256_and_si256(v, _mm256_set1_epi64x(0xFFFFFFFFll)), _mm256_srli_epi64(v, 32));
+		}
+	}
+
+	// total += lanes of words, returns words done (multiple of 4)
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 size_t sum_words_avx2(const uint64_t* words, size_t count, uint64_t& total) {
+		__m256i sums = _mm256_setzero_si256();
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			sums = _mm256_add_epi64(sums, avx2_lane_sum<Bits>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i))));
+		}
+
+		alignas(32) uint64_t lanes[4];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), sums);
+		total += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		return i;
+	}
+
+	// lane-wise min and max of words into low/high (Bits 8, 16, 32 - native unsigned lanes), returns words done
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 size_t minmax_words_avx2(const uint64_t* words, size_t count, uint64_t& low, uint64_t& high) {
+		__m256i lows = _mm256_set1_epi64x(static_cast<long long>(low));
+		__m256i highs = _mm256_set1_epi64x(static_cast<long long>(high));
+		size_t i{};
+		for (; i + 4 <= count; i += 4) {
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i));
+			lows = Bits == 8 ? _mm256_min_epu8(lows, v) : Bits == 16 ? _mm256_min_epu16(lows, v) : _mm256_min_epu32(lows, v);
+			highs = Bits == 8 ? _mm256_max_epu8(highs, v) : Bits == 16 ? _mm256_max_epu16(highs, v) : _mm256_max_epu32(highs, v);
+		}
+
+		alignas(32) uint64_t lanes[8];
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes), lows);
+		_mm256_store_si256(reinterpret_cast<__m256i*>(lanes + 4), highs);
+		for (size_t k{}; k < 4; ++k) {
+			low = word_lane_min<Bits, false>(lanes[k], low);
+			high = word_lane_min<Bits, true>(lanes[k + 4], high);
+		}
+		return i;
+	}
+#endif
+
+	// sum of [first, first + count) modulo 2^64
+	template<size_t Bits>
+	uint64_t sum(const uint64_t* memory, size_t first, size_t count) {
+		uint64_t total = 0;
+		if constexpr (64 % Bits == 0) {
+			for (; count && first % group_elems<Bits>; --count) {	// head
+				total += get<Bits>(memory, first++);
+			}
+
+			const uint64_t* words = memory + first / group_elems<Bits>;
+			const size_t word_count = count / group_elems<Bits>;
+			size_t word{};
+#ifdef BITARRAY_X86_DISPATCH
+			if constexpr (Bits > 1) {
+				if (cpu_simd_level() != simd_level::none) {
+					word = sum_words_avx2<Bits>(words, word_count, total);
+				}
+			}
+			else {
+				total += popcount_words(words, word_count);
+				word = word_count;
+			}
+#endif
+			for (; word < word_count; ++word) {
+				total += word_lane_sum<Bits>(words[word]);
+			}
+			first += word_count * group_elems<Bits>;
+			count -= word_count * group_elems<Bits>;
+
+			for (; count; --count) {	// tail
+				total += get<Bits>(memory, first++);
+			}
+		}
+		else {	// lanes cross words => decoded blocks
+			uint64_t buffer[repack_block];
+			for (; count;) {
+				const size_t n = count < repack_block ? count : repack_block;
+				unpack<Bits>(memory, first, n, buffer);
+				for (size_t i{}; i < n; ++i) {
+					total += buffer[i];
+				}
+				first += n;
+				count -= n;
+			}
+		}
+
+		return total;
+	}
+
+	// min and max of [first, first + count), count > 0
+	template<size_t Bits>
+	std::pair<uint64_t, uint64_t> minmax(const uint64_t* memory, size_t first, size_t count) {
+		uint64_t low = mask_of<Bits>();
+		uint64_t high = 0;
+		if constexpr (64 % Bits == 0) {
+			for (; count && first % group_elems<Bits>; --count, ++first) {	// head
+				const uint64_t val = get<Bits>(memory, first);
+				low = val < low ? val : low;
+				high = val > high ? val : high;
+			}
+
+			const uint64_t* words = memory + first / group_elems<Bits>;
+			const size_t word_count = count / group_elems<Bits>;
+			uint64_t lows = ~uint64_t(0);	// lane-wise
+			uint64_t highs = 0;
+			size_t word{};
+#ifdef BITARRAY_X86_DISPATCH
+			if constexpr (Bits == 8 || Bits == 16 || Bits == 32) {
+				if (cpu_simd_level() != simd_level::none) {
+					word = minmax_words_avx2<Bits>(words, word_count, lows, highs);
+				}
+			}
+#endif
+			for (; word < word_count; ++word) {
+				lows = word_lane_min<Bits, false>(words[word], lows);
+				highs = word_lane_min<Bits, true>(words[word], highs);
+			}
+			if (word_count) {
+				for (size_t lane{}; lane < group_elems<Bits>; ++lane) {
+					const uint64_t lane_low = get<Bits>(&lows, lane);
+					const uint64_t lane_high = get<Bits>(&highs, lane);
+					low = lane_low < low ? lane_low : low;
+					high = lane_high > high ? lane_high : high;
+				}
+			}
+			first += word_count * group_elems<Bits>;
+			count -= word_count * group_elems<Bits>;
+
+			for (; count; --count, ++first) {	// tail
+				const uint64_t val = get<Bits>(memory, first);
+				low = val < low ? val : low;
+				high = val > high ? val : high;
+			}
+		}
+		else {	// lanes cross words => decoded blocks
+			uint64_t buffer[repack_block];
+			for (; count;) {
+				const size_t n = count < repack_block ? count : repack_block;
+				unpack<Bits>(memory, first, n, buffer);
+				for (size_t i{}; i < n; ++i) {
+					low = buffer[i] < low ? buffer[i] : low;
+					high = buffer[i] > high ? buffer[i] : high;
+				}
+				first += n;
+				count -= n;
+			}
+		}
+
+		return { low, high };
+	}
+
+	// prefix sums of [first, first + count) from init: blocks decoded by the unpack kernel, summed into out
+	// returns init + sum of the range (modulo 2^64)
+	template<size_t Bits, bool Inclusive>
+	uint64_t scan(const uint64_t* memory, size_t first, size_t count, uint64_t* out, uint64_t init) {
+		uint64_t buffer[repack_block];
+		for (size_t done{}; done < count; done += repack_block) {
+			const size_t n = count - done < repack_block ? count - done : repack_block;
+			unpack<Bits>(memory, first + done, n, buffer);
+			for (size_t i{}; i < n; ++i) {
+				const uint64_t val = buffer[i];
+				out[done + i] = Inclusive ? init + val : init;
+				init += val;
+			}
+		}
+
+		return init;
+	}
+
+	// random access batches: prefetch the word of element i + distance while reading element i
+	constexpr size_t batch_prefetch_distance = 16;
+
+	template<bool Write>
+	inline void prefetch(const uint64_t* place) {
+#if defined(__GNUC__)
+		__builtin_prefetch(place, Write ? 1 : 0, 3);
+#else
+		(void)place;
+#endif
+	}
+
+	template<size_t Bits>
+	void gather_scalar(const uint64_t* memory, const size_t* idx, size_t n, uint64_t* out, size_t distance) {
+		size_t i{};
+		for (; i + distance < n; ++i) {
+			prefetch<false>(memory + idx[i + distance] * Bits / 64);
+			out[i] = get<Bits>(memory, idx[i]);
+		}
+		for (; i < n; ++i) {
+			out[i] = get<Bits>(memory, idx[i]);
+		}
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	// idx * Bits for 64-bit lanes (no 64-bit mullo in AVX2)
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 inline __m256i avx2_bit_of(__m256i index) {
+		const __m256i bits = _mm256_set1_epi64x(Bits);
+		const __m256i low = _mm256_mul_epu32(index, bits);
+		const __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(index, 32), bits);
+		return _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+	}
+
+	// 4 elements per step: gather the word, and the next word only for elements crossing it
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX2 size_t gather_avx2(const uint64_t* memory, const size_t* idx, size_t n, uint64_t* out, size_t distance) {
+		const long long* base = reinterpret_cast<const long long*>(memory);
+		size_t i{};
+		for (; i + 4 <= n; i += 4) {
+			for (size_t k = i + distance; k < i + distance + 4 && k < n; ++k) {
+				prefetch<false>(memory + idx[k] * Bits / 64);
+			}
+
+			const __m256i bit = avx2_bit_of<Bits>(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(idx + i)));
+			const __m256i word = _mm256_srli_epi64(bit, 6);
+			const __m256i offset = _mm256_and_si256(bit, _mm256_set1_epi64x(63));
+			__m256i val = _mm256_sllv_epi64(_mm256_i64gather_epi64(base, word, 8), offset);
+			if constexpr (64 % Bits != 0) {
+				const __m256i cross = _mm256_cmpgt_epi64(offset, _mm256_set1_epi64x(64 - Bits));
+				const __m256i next = _mm256_mask_i64gather_epi64(_mm256_setzero_si256(), base + 1, word, cross, 8);
+				val = _mm256_or_si256(val, _mm256_srlv_epi64(next, _mm256_sub_epi64(_mm256_set1_epi64x(64), offset)));
+			}
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), _mm256_srli_epi64(val, 64 - Bits));
+		}
+
+		return i;
+	}
+
+	template<size_t Bits>
+	BITARRAY_TARGET_AVX512 size_t gather_avx512(const uint64_t* memory, const size_t* idx, size_t n, uint64_t* out, size_t distance) {
+		const __m512i bits = _mm512_set1_epi64(Bits);
+		size_t i{};
+		for (; i + 8 <= n; i += 8) {
+			for (size_t k = i + distance; k < i + distance + 8 && k < n; ++k) {
+				prefetch<false>(memory + idx[k] * Bits / 64);
+			}
+
+			const __m512i index = _mm512_loadu_si512(idx + i);
+			const __m512i bit = _mm512_add_epi64(_mm512_mul_epu32(index, bits),
+				_mm512_slli_epi64(_mm512_mul_epu32(_mm512_srli_epi64(index, 32), bits), 32));
+			const __m512i word = _mm512_srli_epi64(bit, 6);
+			const __m512i offset = _mm512_and_si512(bit, _mm512_set1_epi64(63));
+			__m512i val = _mm512_sllv_epi64(_mm512_i64gather_epi64(word, memory, 8), offset);
+			if constexpr (64 % Bits != 0) {
+				const __mmask8 cross = _mm512_cmpgt_epu64_mask(offset, _mm512_set1_epi64(64 - Bits));
+				const __m512i next = _mm512_mask_i64gather_epi64(_mm512_setzero_si512(), cross, word, memory + 1, 8);
+				val = _mm512_or_si512(val, _mm512_srlv_epi64(next, _mm512_sub_epi64(_mm512_set1_epi64(64), offset)));
+			}
+			_mm512_storeu_si512(out + i, _mm512_srli_epi64(val, 64 - Bits));
+		}
+
+		return i;
+	}
+#endif
+
+	// out[i] = element idx[i]
+	template<size_t Bits>
+	void gather(const uint64_t* memory, const size_t* idx, size_t n, uint64_t* out, size_t distance) {
+		size_t done = 0;
+#ifdef BITARRAY_X86_DISPATCH
+		const simd_level level = cpu_simd_level();
+		if (level == simd_level::avx512) {
+			done = gather_avx512<Bits>(memory, idx, n, out, distance);
+		}
+		else if (level == simd_level::avx2) {
+			done = gather_avx2<Bits>(memory, idx, n, out, distance);
+		}
+#endif
+		gather_scalar<Bits>(memory, idx + done, n - done, out + done, distance);
+	}
+
+	// element idx[i] = vals[i] in order (the last of equal indices wins), vals must be <= mask_of<Bits>()
+	// scalar: lanes of a vector scatter could share a word
+	template<size_t Bits>
+	void scatter(uint64_t* memory, const size_t* idx, const uint64_t* vals, size_t n, size_t distance) {
+		size_t i{};
+		for (; i + distance < n; ++i) {
+			prefetch<true>(memory + idx[i + distance] * Bits / 64);
+			set<Bits>(memory, idx[i], vals[i]);
+		}
+		for (; i < n; ++i) {
+			set<Bits>(memory, idx[i], vals[i]);
+		}
+	}
+
+	// idx grouped by word range: one stable counting pass over the high bits of the word index,
+	// so every bucket touches a small (cache sized) slice of memory, equal indices keep their order
+	// sorted[i] = idx[positions[i]]
+	template<size_t Bits>
+	void batch_order(const size_t* idx, size_t n, size_t max_index, size_t* sorted, size_t* positions) {
+		constexpr size_t bucket_bits = 11;
+		const size_t max_word = max_index * Bits / 64;
+		size_t shift = 0;
+		while ((max_word >> shift) >= (size_t(1) << bucket_bits)) {
+			++shift;
+		}
+
+		std::vector<size_t> start((size_t(1) << bucket_bits) + 1, 0);
+		for (size_t i{}; i < n; ++i) {
+			++start[(idx[i] * Bits / 64 >> shift) + 1];
+		}
+		for (size_t bucket{}; bucket < (size_t(1) << bucket_bits); ++bucket) {
+			start[bucket + 1] += start[bucket];
+		}
+
+		for (size_t i{}; i < n; ++i) {
+			const size_t place = start[idx[i] * Bits / 64 >> shift]++;
+			sorted[place] = idx[i];
+			positions[place] = i;
+		}
+	}
+
+	// position (0 - the high bit) of set bit number k (from 0) of word, k < popcount(word)
+	// broadword: byte counts summed by a multiply, the byte is found without branches (k is random)
+	BITARRAY_ALWAYS_INLINE size_t select_in_word(uint64_t word, size_t k) {
+		constexpr uint64_t ones_step = 0x0101010101010101ull;
+		constexpr uint64_t high_step = 0x8080808080808080ull;
+		const uint64_t bytes = byte_swap(word);	// high byte of word first
+		uint64_t counts = bytes - ((bytes >> 1) & 0x5555555555555555ull);
+		counts = (counts & 0x3333333333333333ull) + ((counts >> 2) & 0x3333333333333333ull);
+		counts = (counts + (counts >> 4)) & 0x0F0F0F0F0F0F0F0Full;
+		const uint64_t sums = counts * ones_step;	// byte i - ones of bytes 0..i
+		const size_t byte = popcount((((k * ones_step) | high_step) - sums) & high_step);	// bytes with sum <= k
+		k -= ((sums << 8) >> (byte * 8)) & 0xFF;
+
+		uint64_t bits = (word >> (56 - byte * 8)) & 0xFF;
+		size_t pos = byte * 8;
+		for (size_t width = 4; width; width /= 2) {	// halves of the high end
+			const size_t high = popcount(bits >> (8 - width));
+			const size_t skip = (k >= high) * width;
+			k -= (k >= high) * high;
+			pos += skip;
+			bits = (bits << skip) & 0xFF;
+		}
+
+		return pos;
+	}
+
+	// rank/select directory over the words of BitArray<1> (MSB-first bits):
+	// a word per 2048-bit block - ones before the block (relative to its 2^32-bit region) in the high 32 bits,
+	// ones of its first three 512-bit sub-blocks in 3 x 10 low bits (3.1% of the bits);
+	// the block of every select_sample-th one/zero narrows the select search (1.6% at most)
+	class rank_select_index {
+	public:
+		static constexpr size_t block_bits = 2048;
+		static constexpr size_t sub_bits = 512;
+		static constexpr size_t region_blocks = (size_t(1) << 32) / block_bits;
+		static constexpr size_t select_sample = 4096;
+		static constexpr size_t up_to_date = SIZE_MAX;
+
+		size_t dirty_from = 0;	// first bit changed since the last update
+
+		void update(const uint64_t* words, size_t size);	// blocks from dirty_from on, size in bits
+		inline size_t rank1(const uint64_t* words, size_t pos) const;	// ones in [0, pos), pos <= size
+		template<bool One>
+		size_t select(const uint64_t* words, size_t k) const;	// position of one/zero number k, k < ones/zeros
+		inline size_t ones() const;
+		inline size_t size() const;
+	private:
+		// the scans are compiled once more with the popcnt instruction
+		BITARRAY_ALWAYS_INLINE size_t rank1_scan(const uint64_t* words, size_t pos) const;
+		template<bool One>
+		BITARRAY_ALWAYS_INLINE size_t select_scan(const uint64_t* words, size_t k) const;
+#ifdef BITARRAY_X86_DISPATCH
+		BITARRAY_TARGET_POPCNT inline size_t rank1_popcnt(const uint64_t* words, size_t pos) const;
+		template<bool One>
+		BITARRAY_TARGET_POPCNT size_t select_popcnt(const uint64_t* words, size_t k) const;
+#endif
+
+		std::vector<uint64_t> blocks_;
+		std::vector<uint64_t> regions_;	// ones before every region
+		std::vector<size_t> select1_hints_;	// block of one number i * select_sample
+		std::vector<size_t> select0_hints_;
+		size_t size_ = 0;
+		size_t ones_ = 0;
+
+		inline size_t ones_before(size_t block) const;
+	};
+
+	inline size_t rank_select_index::ones_before(size_t block) const {
+		return block < blocks_.size() ? static_cast<size_t>(regions_[block / region_blocks] + (blocks_[block] >> 32)) : ones_;
+	}
+
+	inline void rank_select_index::update(const uint64_t* words, size_t size) {
+		const size_t first_block = (dirty_from < size ? dirty_from : size) / block_bits;
+		size_t ones = ones_before(first_block);	// blocks before first_block are unchanged
+		size_t zeros = first_block * block_bits - ones;
+
+		const size_t block_count = (size + block_bits - 1) / block_bits;
+		const size_t word_count = (size + 63) / 64;
+		blocks_.resize(block_count);
+		regions_.resize((block_count + region_blocks - 1) / region_blocks);
+		select1_hints_.resize((ones + select_sample - 1) / select_sample);
+		select0_hints_.resize((zeros + select_sample - 1) / select_sample);
+
+		for (size_t block = first_block; block < block_count; ++block) {
+			if (block % region_blocks == 0) {
+				regions_[block / region_blocks] = ones;
+			}
+			uint64_t entry = uint64_t(ones - regions_[block / region_blocks]) << 32;
+			size_t block_ones = 0;
+			for (size_t sub{}; sub < block_bits / sub_bits; ++sub) {
+				const size_t first_word = block * (block_bits / 64) + sub * (sub_bits / 64);
+				const size_t count = first_word >= word_count ? 0
+					: word_count - first_word < sub_bits / 64 ? word_count - first_word : sub_bits / 64;
+				const size_t sub_ones = popcount_words(words + first_word, count);
+				if (sub < 3) {
+					entry |= uint64_t(sub_ones) << (sub * 10);
+				}
+				block_ones += sub_ones;
+			}
+			blocks_[block] = entry;
+
+			const size_t bits = size - block * block_bits < block_bits ? size - block * block_bits : block_bits;
+			ones += block_ones;
+			zeros += bits - block_ones;
+			while (select1_hints_.size() * select_sample < ones) {
+				select1_hints_.push_back(block);
+			}
+			while (select0_hints_.size() * select_sample < zeros) {
+				select0_hints_.push_back(block);
+			}
+		}
+
+		size_ = size;
+		ones_ = ones;
+		dirty_from = up_to_date;
+	}
+
+	inline size_t rank_select_index::rank1(const uint64_t* words, size_t pos) const {
+#ifdef BITARRAY_X86_DISPATCH
+		if (cpu_popcount_level() != popcount_level::none) {
+			return rank1_popcnt(words, pos);
+		}
+#endif
+		return rank1_scan(words, pos);
+	}
+
+	template<bool One>
+	size_t rank_select_index::select(const uint64_t* words, size_t k) const {
+#ifdef BITARRAY_X86_DISPATCH
+		if (cpu_popcount_level() != popcount_level::none) {
+			return select_popcnt<One>(words, k);
+		}
+#endif
+		return select_scan<One>(words, k);
+	}
+
+#ifdef BITARRAY_X86_DISPATCH
+	BITARRAY_TARGET_POPCNT inline size_t rank_select_index::rank1_popcnt(const uint64_t* words, size_t pos) const {
+		return rank1_scan(words, pos);
+	}
+
+	template<bool One>
+	BITARRAY_TARGET_POPCNT size_t rank_select_index::select_popcnt(const uint64_t* words, size_t k) const {
+		return select_scan<One>(words, k);
+	}
+#endif
+
+	BITARRAY_ALWAYS_INLINE size_t rank_select_index::rank1_scan(const uint64_t* words, size_t pos) const {
+		if (pos == size_) {
+			return ones_;
+		}
+
+		const size_t block = pos / block_bits;
+		const uint64_t entry = blocks_[block];
+		size_t rank = ones_before(block);
+		const size_t sub = pos % block_bits / sub_bits;
+		for (size_t i{}; i < sub; ++i) {
+			rank += (entry >> (i * 10)) & 1023;
+		}
+		for (size_t word = block * (block_bits / 64) + sub * (sub_bits / 64); word < pos / 64; ++word) {
+			rank += popcount(words[word]);
+		}
+		if (pos % 64) {
+			rank += popcount(words[pos / 64] >> (64 - pos % 64));
+		}
+
+		return rank;
+	}
+
+	template<bool One>
+	BITARRAY_ALWAYS_INLINE size_t rank_select_index::select_scan(const uint64_t* words, size_t k) const {
+		auto before = [this](size_t block) {
+			return One ? ones_before(block) : block * block_bits - ones_before(block);
+		};
+
+		// the last block with before(block) <= k, between two samples
+		const std::vector<size_t>& hints = One ? select1_hints_ : select0_hints_;
+		size_t low = hints[k / select_sample];
+		size_t high = k / select_sample + 1 < hints.size() ? hints[k / select_sample + 1] + 1 : blocks_.size();
+		while (high - low > 1) {
+			const size_t middle = low + (high - low) / 2;
+			if (before(middle) <= k) {
+				low = middle;
+			}
+			else {
+				high = middle;
+			}
+		}
+		k -= before(low);
+
+		const uint64_t entry = blocks_[low];
+		size_t sub = 0;
+		for (; sub < 3; ++sub) {
+			const size_t sub_ones = (entry >> (sub * 10)) & 1023;
+			const size_t count = One ? sub_ones : sub_bits - sub_ones;
+			if (k < count) {
+				break;
+			}
+			k -= count;
+		}
+
+		for (size_t word = low * (block_bits / 64) + sub * (sub_bits / 64);; ++word) {
+			const uint64_t bits = One ? words[word] : ~words[word];
+			const size_t count = popcount(bits);
+			if (k < count) {
+				return word * 64 + select_in_word(bits, k);
+			}
+			k -= count;
+		}
+	}
+
+	inline size_t rank_select_index::ones() const {
+		return ones_;
+	}
+
+	inline size_t rank_select_index::size() const {
+		return size_;
+	}
+
+	// rank/select index of BitArray<1> (made on the first query), nothing for other widths
+	template<bool Enabled>
+	struct rank_holder {
+		void rank_touch(size_t) {
+		}
+	};
+
+	template<>
+	struct rank_holder<true> {
+		mutable std::unique_ptr<rank_select_index> rank_index;
+
+		void rank_touch(size_t first) {	// elements from first on may have changed
+			if (rank_index && first < rank_index->dirty_from) {
+				rank_index->dirty_from = first;
+			}
+		}
+	};
+
+	// words stored inside the BitArray object (small buffer), empty for 0 => no footprint (EBO)
+	template<size_t Words>
+	struct inline_words {
+		uint64_t words[Words];
+
+		uint64_t* inline_memory() {
+			return words;
+		}
+		const uint64_t* inline_memory() const {
+			return words;
+		}
+	};
+
+	template<>
+	struct inline_words<0> {
+		uint64_t* inline_memory() {
+			return nullptr;
+		}
+		const uint64_t* inline_memory() const {
+			return nullptr;
+		}
+	};
+}
+
+// order of element accesses in gather/scatter
+enum class BitArrayBatchOrder {
+	as_given,	// idx order
+	by_word		// grouped by word range first (locality for big random batches)
+};
+
+// samples of a sorted BitArray for lower_bound/upper_bound/equal_range: every stride-th element,
+// stride = elements in 64 bytes => after the search in the samples the rest probes 64 bytes of packed words
+// made by BitArray::skip_table(), valid until the array is changed
+class BitArraySkipTable {
+private:
+	std::vector<uint64_t> samples_;
+	size_t stride_;
+	size_t size_;	// elements of the array it was made for
+
+	template<size_t, size_t, BitArrayOverflow> friend class BitArray;
+public:
+	inline BitArraySkipTable();
+
+	inline size_t stride() const;
+	inline size_t memory_bytes() const;
+};
+
+// memory resources for BitArray storage (any std::pmr::memory_resource can be used)
+
+// every block is aligned to alignment (cache line by default)
+class BitArrayAlignedResource : public std::pmr::memory_resource {
+private:
+	size_t alignment_;
+	std::pmr::memory_resource* upstream_;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+public:
+	explicit BitArrayAlignedResource(size_t alignment = 64,
+		std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+};
+
+// big blocks are mapped at huge page boundary and advised for transparent huge pages
+// small blocks go to upstream
+class BitArrayHugePageResource : public std::pmr::memory_resource {
+private:
+	std::pmr::memory_resource* upstream_;
+
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override;
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+public:
+	static constexpr size_t huge_page_size = size_t(2) * 1024 * 1024;
+
+	explicit BitArrayHugePageResource(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+};
+
+template<size_t Bits>
+class MappedBitArray;	// MappedBitArray.h
+
+template<size_t Bits>
+class AtomicBitArray;	// AtomicBitArray.h
+
+class DynamicBitArray;	// DynamicBitArray.h
+
+enum class BitArrayEncoding;
+template<size_t Bits, BitArrayEncoding Encoding>
+class EncodedBitArray;	// EncodedBitArray.h
+
+template<size_t Bits, size_t ChunkWords>
+class SegmentedBitArray;	// SegmentedBitArray.h
+
+template<size_t Bits, typename Word>
+class BitArrayView;	// BitArrayView.h
+
+namespace bitarray_detail {
+	struct parallel_access;	// ParallelBitArray.h
+}
+
+// InlineWords - words kept inside the object, the heap is used only for bigger arrays
+// Overflow - what element arithmetic (BitArrayRef, bulk operations) does with results that don't fit Bits
+template<size_t Bits, size_t InlineWords = 0, BitArrayOverflow Overflow = BitArrayOverflow::throw_error>
+class BitArray : private bitarray_detail::inline_words<InlineWords>, private bitarray_detail::rank_holder<Bits == 1> {
+public:
+	class iterator;
+	class const_iterator;
+private:
+	static_assert(Bits >= 1 && Bits <= 63, "Bits must be in [1..63]");
+	static constexpr uint64_t mask_ = bitarray_detail::mask_of<Bits>();
+
+	uint64_t* memory_;	// heap block or the inline words
+	std::pmr::memory_resource* resource_;
+
+	size_t size_;
+	size_t capacity_;
+
+	friend class MappedBitArray<Bits>;	// lends its mapping as memory_
+	friend struct bitarray_detail::parallel_access;	// chunks of the parallel algorithms
+	friend class AtomicBitArray<Bits>;	// copies memory_ in and out
+	friend class DynamicBitArray;	// copies memory_ in and out
+	template<size_t, size_t, BitArrayOverflow> friend class BitArray;	// repacks memory_ of other widths
+	template<size_t, BitArrayEncoding> friend class EncodedBitArray;	// packs encoded blocks into memory_
+	template<size_t, size_t> friend class SegmentedBitArray;	// copies memory_ into its chunks
+	template<size_t, typename> friend class BitArrayView;	// views memory_
+
+	inline bool is_overflow(const uint64_t& val) const;
+	static inline uint64_t fit(uint64_t result, bool overflowed, uint64_t limit);	// by Overflow, limit - saturated value
+	inline void check_range(size_t first, size_t count) const;
+	[[noreturn]] static void throw_index(size_t index);	// out of line => checked calls stay small
+
+	inline uint64_t* allocate_words(size_t count);
+	inline void deallocate_words(uint64_t* memory, size_t count);
+	inline size_t capacity_words() const;
+	inline bool is_inline() const;
+
+	template<typename T_it>
+	void init_from_range(const T_it& beg_it, const T_it& end_it);
+	template<typename T_it>
+	void add_from_range(const T_it& beg_it, const T_it& end_it);
+	template<typename T_it>
+	uint64_t write_range(size_t first, const T_it& beg_it, size_t count);
+	template<typename T>
+	static auto data_begin(const std::vector<T>& vect);
+	inline void truncate(size_t new_size);
+	inline size_t index_of(const BitArray<Bits, InlineWords, Overflow>::iterator& it) const;
+	template<bitarray_detail::word_op Op>
+	BitArray& apply_words(const BitArray<Bits, InlineWords, Overflow>& other);
+	inline const bitarray_detail::rank_select_index& rank_index_ready() const;	// made/updated on demand
+	void open_gap(size_t index, size_t count);
+
+	class BitArrayRef {
+	private:
+		uint64_t* place_ptr;
+		uint32_t bit_index;
+		BitArray<Bits, InlineWords, Overflow>* ref_ptr;
+
+		inline BitArrayRef(BitArray<Bits, InlineWords, Overflow>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index);
+		inline void store(uint64_t val);	// val <= mask
+		friend class BitArray<Bits, InlineWords, Overflow>;
+		friend class BitArray<Bits, InlineWords, Overflow>::iterator;
+	public:
+		inline BitArrayRef(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other);
+
+		inline operator uint64_t() const;
+
+		// results that don't fit Bits are handled by Overflow
+		inline BitArrayRef& operator=(const uint64_t& other);
+		inline BitArrayRef& operator=(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref);	// copies the value
+		inline BitArrayRef& operator+=(const uint64_t& other);
+		inline BitArrayRef& operator-=(const uint64_t& other);
+		inline BitArrayRef& operator*=(const uint64_t& other);
+		inline BitArrayRef& operator/=(const uint64_t& other);
+		inline BitArrayRef& operator++();	// previx
+		inline BitArrayRef& operator--();	// prefix
+		inline uint64_t operator++(int);	// postfix
+		inline uint64_t operator--(int);	// postfix
+		inline bool operator==(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref) const;	// compares values
+		inline bool operator!=(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref) const;
+
+		friend inline void swap(BitArrayRef left, BitArrayRef right) {	// swaps values (std::sort, std::reverse)
+			const uint64_t tmp = left;
+			left = static_cast<uint64_t>(right);
+			right = tmp;
+		}
+	};
+public:
+	// random access iterator, dereference gives BitArrayRef proxy
+	// range is checked only in debug builds (assert)
+	class iterator {
+	private:
+		BitArrayRef bit_ref;
+		inline iterator(BitArray<Bits, InlineWords, Overflow>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index);
+		friend class BitArray<Bits, InlineWords, Overflow>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = BitArrayRef;
+
+		iterator();
+		iterator(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it);
+
+		inline BitArrayRef operator*() const;
+		inline BitArrayRef operator[](difference_type value) const;
+		inline iterator& operator++();	// prefix
+		inline iterator& operator--();	// prefix
+		inline iterator operator++(int);	// postfix
+		inline iterator operator--(int);	// postfix
+		inline iterator& operator+=(difference_type val);
+		inline iterator& operator-=(difference_type val);
+		inline iterator operator+(difference_type value) const;
+		inline iterator operator-(difference_type value) const;
+		inline iterator& operator=(const BitArray<Bits, InlineWords, Overflow>::iterator& other);
+		inline difference_type operator-(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const;
+		inline bool operator==(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+		inline bool operator!=(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+		inline bool operator<(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+		inline bool operator>(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+		inline bool operator<=(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+		inline bool operator>=(const BitArray<Bits, InlineWords, Overflow>::iterator& other) const;
+
+		friend inline iterator operator+(difference_type value, const iterator& it) {
+			return it + value;
+		}
+	};
+
+	// random access iterator, dereference gives the value
+	class const_iterator {
+	private:
+		iterator it;
+		friend class BitArray<Bits, InlineWords, Overflow>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = uint64_t;
+
+		const_iterator();
+		const_iterator(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it);	// iterator => const_iterator
+
+		inline uint64_t operator*() const;
+		inline uint64_t operator[](difference_type value) const;
+		inline const_iterator& operator++();	// prefix
+		inline const_iterator& operator--();	// prefix
+		inline const_iterator operator++(int);	// postfix
+		inline const_iterator operator--(int);	// postfix
+		inline const_iterator& operator+=(difference_type val);
+		inline const_iterator& operator-=(difference_type val);
+		inline const_iterator operator+(difference_type value) const;
+		inline const_iterator operator-(difference_type value) const;
+		inline difference_type operator-(const BitArray<Bits, InlineWords, Overflow>::const_iterator& other_it) const;
+
+		friend inline const_iterator operator+(difference_type value, const const_iterator& it) {
+			return it + value;
+		}
+		// friends => mixed iterator/const_iterator comparison
+		friend inline bool operator==(const const_iterator& left, const const_iterator& right) {
+			return left.it == right.it;
+		}
+		friend inline bool operator!=(const const_iterator& left, const const_iterator& right) {
+			return left.it != right.it;
+		}
+		friend inline bool operator<(const const_iterator& left, const const_iterator& right) {
+			return left.it < right.it;
+		}
+		friend inline bool operator>(const const_iterator& left, const const_iterator& right) {
+			return left.it > right.it;
+		}
+		friend inline bool operator<=(const const_iterator& left, const const_iterator& right) {
+			return left.it <= right.it;
+		}
+		friend inline bool operator>=(const const_iterator& left, const const_iterator& right) {
+			return left.it >= right.it;
+		}
+	};
+
+	inline BitArray();
+	inline explicit BitArray(std::pmr::memory_resource* resource);
+	BitArray(const BitArray<Bits, InlineWords, Overflow>& other);
+	BitArray(const BitArray<Bits, InlineWords, Overflow>& other, std::pmr::memory_resource* resource);
+	inline BitArray(BitArray<Bits, InlineWords, Overflow>&& other) noexcept;
+	// from another width (or InlineWords/Overflow) in one pass, values over the mask follow Overflow
+	template<size_t OtherBits, size_t OtherInlineWords, BitArrayOverflow OtherOverflow>
+	explicit BitArray(const BitArray<OtherBits, OtherInlineWords, OtherOverflow>& other,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~BitArray();
+	template<typename T> BitArray(const std::initializer_list<T>& init_list);
+	template<typename T> BitArray(const std::vector<T>& vect);
+
+	inline size_t size() const;
+	inline size_t capacity() const;
+	inline bool empty() const;
+	inline std::pmr::memory_resource* resource() const;
+
+	inline BitArray<Bits, InlineWords, Overflow>::BitArrayRef front();
+	inline BitArray<Bits, InlineWords, Overflow>::BitArrayRef back();
+
+	inline BitArray<Bits, InlineWords, Overflow>::iterator begin();
+	inline BitArray<Bits, InlineWords, Overflow>::iterator end();
+	inline BitArray<Bits, InlineWords, Overflow>::const_iterator begin() const;
+	inline BitArray<Bits, InlineWords, Overflow>::const_iterator end() const;
+	inline BitArray<Bits, InlineWords, Overflow>::const_iterator cbegin() const;
+	inline BitArray<Bits, InlineWords, Overflow>::const_iterator cend() const;
+	
+	void resize(size_t new_size);
+	void reserve(size_t new_capacity);
+	void clear();
+	void shrink_to_fit();
+	inline void swap(BitArray<Bits, InlineWords, Overflow>& other) noexcept;
+
+	inline void pop_back();
+	void push_back(const uint64_t val);
+
+	void erase(BitArray<Bits, InlineWords, Overflow>::iterator beg_it, BitArray<Bits, InlineWords, Overflow>::iterator end_it);
+
+	void insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const uint64_t& val);
+	void insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const uint64_t& val, const size_t count);
+	void insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const BitArray<Bits, InlineWords, Overflow>& other);
+
+	// element access:
+	// at - throws std::out_of_range
+	// operator[] - checked only in debug builds (assert)
+	// unchecked_get/unchecked_set - caller guarantees index < size() and val <= mask (assert in debug builds)
+	inline BitArrayRef at(size_t index);
+	inline uint64_t at(size_t index) const;
+	inline BitArrayRef operator[](size_t index);
+	inline uint64_t operator[](size_t index) const;
+	inline uint64_t unchecked_get(size_t index) const;
+	inline void unchecked_set(size_t index, uint64_t val);
+
+	// bulk arithmetic over [first, first + count) (whole array without first/count), many lanes per word
+	// throw_error checks all the elements before any change
+	void fill(uint64_t val);
+	void fill(size_t first, size_t count, uint64_t val);
+	template<BitArrayOverflow Policy = Overflow> void add_scalar(uint64_t val);
+	template<BitArrayOverflow Policy = Overflow> void add_scalar(size_t first, size_t count, uint64_t val);
+	template<BitArrayOverflow Policy = Overflow> void sub_scalar(uint64_t val);
+	template<BitArrayOverflow Policy = Overflow> void sub_scalar(size_t first, size_t count, uint64_t val);
+	void shift_right_all(size_t shift);
+	void shift_right_all(size_t first, size_t count, size_t shift);
+	template<BitArrayOverflow Policy = Overflow> void add(const BitArray<Bits, InlineWords, Overflow>& other);	// element-wise, same size
+
+	// search, many lanes per word are compared at once
+	// find* - index of the first match at or after from, size() if none
+	size_t find(uint64_t val, size_t from = 0) const;
+	size_t find_first_not(uint64_t val, size_t from = 0) const;
+	template<typename Pred> size_t find_if(Pred pred, size_t from = 0) const;	// pred(uint64_t), elements are decoded in blocks
+	size_t count(uint64_t val) const;
+	size_t count_if_less(uint64_t threshold) const;
+	size_t mismatch(const BitArray<Bits, InlineWords, Overflow>& other) const;	// first differing index, the smaller size if none
+	size_t min_width() const;	// bits of the biggest element (1 for an empty array) => narrowest BitArray<B> that holds it
+
+	// sorting: counting sort for Bits <= 16 and size() >= 2^Bits (runs are written by fill), LSD radix sort over packed words otherwise;
+	// the temporary counters/scratch come from the default heap, so arrays on any resource (also null_memory_resource) sort
+	void sort();
+	// sorted arrays only: lower_bound - first element >= val, upper_bound - first > val (size() if none),
+	// the table overloads search its samples first and then 64 bytes of packed words
+	size_t lower_bound(uint64_t val) const;
+	size_t upper_bound(uint64_t val) const;
+	std::pair<size_t, size_t> equal_range(uint64_t val) const;
+	BitArraySkipTable skip_table() const;
+	size_t lower_bound(uint64_t val, const BitArraySkipTable& table) const;
+	size_t upper_bound(uint64_t val, const BitArraySkipTable& table) const;
+	std::pair<size_t, size_t> equal_range(uint64_t val, const BitArraySkipTable& table) const;
+
+	// reductions over [first, first + count) (whole array without first/count): lane sums/lane-wise min and max
+	// on whole words for Bits dividing 64 (SWAR, AVX2), decoded blocks otherwise; sum is modulo 2^64,
+	// min/max/minmax of an empty range - std::out_of_range
+	uint64_t sum() const;
+	uint64_t sum(size_t first, size_t count) const;
+	uint64_t min() const;
+	uint64_t min(size_t first, size_t count) const;
+	uint64_t max() const;
+	uint64_t max(size_t first, size_t count) const;
+	std::pair<uint64_t, uint64_t> minmax() const;
+	std::pair<uint64_t, uint64_t> minmax(size_t first, size_t count) const;
+	// prefix sums into out[0, count) starting from init: exclusive - elements before i, inclusive - up to i;
+	// return init + sum of the range (the next offset)
+	uint64_t exclusive_scan(uint64_t* out, uint64_t init = 0) const;
+	uint64_t exclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init = 0) const;
+	uint64_t inclusive_scan(uint64_t* out, uint64_t init = 0) const;
+	uint64_t inclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init = 0) const;
+
+	// bitwise algebra over whole words, sizes must match (element-wise for Bits > 1)
+	BitArray& operator&=(const BitArray<Bits, InlineWords, Overflow>& other);
+	BitArray& operator|=(const BitArray<Bits, InlineWords, Overflow>& other);
+	BitArray& operator^=(const BitArray<Bits, InlineWords, Overflow>& other);
+	BitArray& andnot(const BitArray<Bits, InlineWords, Overflow>& other);	// this & ~other
+	BitArray& flip();	// every element = mask - element
+
+	// BitArray<1> only (bitset): set elements, tests and shifts of positions,
+	// shift_left(n) moves element i to i + n like std::bitset::operator<<= (zeros come in)
+	size_t count() const;
+	bool any() const;
+	bool all() const;
+	bool none() const;
+	void shift_left(size_t n);
+	void shift_right(size_t n);
+
+	// BitArray<1> only: rank/select over an index made on the first query (~5% of the bits),
+	// element changes mark it stale from the first changed block, the next query updates it from there
+	// (not thread safe while stale => build_rank_index() before sharing)
+	size_t rank1(size_t pos) const;	// ones in [0, pos)
+	size_t rank0(size_t pos) const;	// zeros in [0, pos)
+	size_t select1(size_t k) const;	// index of one number k (from 0)
+	size_t select0(size_t k) const;	// index of zero number k (from 0)
+	void build_rank_index() const;
+	void drop_rank_index();
+
+	// batched random access, all indices (and values) are checked before any element is touched
+	void gather(const size_t* idx, size_t n, uint64_t* out,
+		BitArrayBatchOrder order = BitArrayBatchOrder::as_given,
+		size_t prefetch_distance = bitarray_detail::batch_prefetch_distance) const;
+	void scatter(const size_t* idx, const uint64_t* vals, size_t n,
+		BitArrayBatchOrder order = BitArrayBatchOrder::as_given,
+		size_t prefetch_distance = bitarray_detail::batch_prefetch_distance);
+
+	BitArray& operator=(const BitArray<Bits, InlineWords, Overflow>& other);
+	inline BitArray& operator=(BitArray<Bits, InlineWords, Overflow>&& other) noexcept;
+	template<size_t OtherBits, size_t OtherInlineWords, BitArrayOverflow OtherOverflow>
+	BitArray& operator=(const BitArray<OtherBits, OtherInlineWords, OtherOverflow>& other);	// throw_error - nothing is changed
+	template<typename T> BitArray& operator=(const std::initializer_list<T>& init_list);
+	template<typename T> BitArray& operator=(const std::vector<T>& vect);
+	template<typename T> BitArray& operator+=(const std::initializer_list<T>& init_list);
+	template<typename T> BitArray& operator+=(const std::vector<T>& vect);
+	BitArray& operator+=(const BitArray<Bits, InlineWords, Overflow>& other);
+
+	template<typename T> operator std::vector<T>() const;
+
+	template<typename T> void unpack_to(T* out, size_t first, size_t count) const;
+	template<typename T> void pack_from(const T* in, size_t count);
+
+	void save(std::ostream& os, bool checksum = true) const;
+	void load(std::istream& is);
+};
+
+// implementation
+
+// BitArraySkipTable
+inline BitArraySkipTable::BitArraySkipTable() : stride_(1), size_(0) {}
+
+inline size_t BitArraySkipTable::stride() const {
+	return stride_;
+}
+
+inline size_t BitArraySkipTable::memory_bytes() const {
+	return samples_.size() * sizeof(uint64_t);
+}
+
+// BitArrayAlignedResource
+inline BitArrayAlignedResource::BitArrayAlignedResource(size_t alignment, std::pmr::memory_resource* upstream)
+	: alignment_(alignment), upstream_(upstream) {}
+
+inline void* BitArrayAlignedResource::do_allocate(size_t bytes, size_t alignment) {
+	return upstream_->allocate(bytes, alignment > alignment_ ? alignment : alignment_);
+}
+
+inline void BitArrayAlignedResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+	upstream_->deallocate(ptr, bytes, alignment > alignment_ ? alignment : alignment_);
+}
+
+inline bool BitArrayAlignedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
+
+// BitArrayHugePageResource
+inline BitArrayHugePageResource::BitArrayHugePageResource(std::pmr::memory_resource* upstream) : upstream_(upstream) {}
+
+inline void* BitArrayHugePageResource::do_allocate(size_t bytes, size_t alignment) {
+	if (bytes < huge_page_size) {
+		return upstream_->allocate(bytes, alignment > 64 ? alignment : 64);
+	}
+
+	const size_t size = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+#ifdef BITARRAY_HAS_MMAP
+	// map with a huge page of slack, then cut the unaligned head and tail
+	char* mapped = static_cast<char*>(mmap(nullptr, size + huge_page_size,
+		PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+	if (mapped == MAP_FAILED) {
+		throw std::bad_alloc();
+	}
+	const size_t head = (huge_page_size - reinterpret_cast<uintptr_t>(mapped) % huge_page_size) % huge_page_size;
+	if (head) {
+		munmap(mapped, head);
+	}
+	if (huge_page_size - head) {
+		munmap(mapped + head + size, huge_page_size - head);
+	}
+#ifdef MADV_HUGEPAGE
+	madvise(mapped + head, size, MADV_HUGEPAGE);
+#endif
+	return mapped + head;
+#else
+	return upstream_->allocate(size, huge_page_size);
+#endif
+}
+
+inline void BitArrayHugePageResource::do_deallocate(void* ptr, size_t bytes, size_t alignment) {
+	if (bytes < huge_page_size) {
+		upstream_->deallocate(ptr, bytes, alignment > 64 ? alignment : 64);
+		return;
+	}
+
+	const size_t size = (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+#ifdef BITARRAY_HAS_MMAP
+	munmap(ptr, size);
+#else
+	upstream_->deallocate(ptr, size, huge_page_size);
+#endif
+}
+
+inline bool BitArrayHugePageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept {
+	return this == &other;
+}
+
+// BitArray
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::is_overflow(const uint64_t& val) const {
+	return val > mask_;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::fit(uint64_t result, bool overflowed, uint64_t limit) {
+	if constexpr (Overflow == BitArrayOverflow::throw_error) {
+		if (overflowed) {
+			throw std::overflow_error("Overflow");
+		}
+		return result;
+	}
+	else if constexpr (Overflow == BitArrayOverflow::wrap) {
+		return result & mask_;
+	}
+	else {	// saturate
+		return overflowed ? limit : result;
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::check_range(size_t first, size_t count) const {
+	if (first > size_ || count > size_ - first) {
+		throw std::out_of_range("Out of range");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::throw_index(size_t index) {
+	throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+}
+
+// small blocks go to the inline words (callers never need two small blocks at once)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t* BitArray<Bits, InlineWords, Overflow>::allocate_words(size_t count) {
+	if (!count) {
+		return nullptr;
+	}
+	if (count <= InlineWords) {
+		return this->inline_memory();
+	}
+
+	return static_cast<uint64_t*>(resource_->allocate(count * sizeof(uint64_t), alignof(uint64_t)));
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::deallocate_words(uint64_t* memory, size_t count) {
+	if (memory != nullptr && memory != this->inline_memory()) {
+		resource_->deallocate(memory, count * sizeof(uint64_t), alignof(uint64_t));
+	}
+}
+
+// capacity_ = words * 64 / Bits => words can be restored
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline size_t BitArray<Bits, InlineWords, Overflow>::capacity_words() const {
+	return (capacity_ * Bits + 63) / 64;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::is_inline() const {
+	return InlineWords && memory_ == this->inline_memory();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T_it>
+void BitArray<Bits, InlineWords, Overflow>::init_from_range(const T_it& beg_it, const T_it& end_it) {
+	const size_t size = end_it - beg_it;
+
+	// init memory
+	const size_t word_count = (size * Bits + 63) / 64;
+	memory_ = allocate_words(word_count);
+	for (size_t i{}; i < word_count; ++i) {	// init with nulls
+		memory_[i] = 0;
+	}
+	size_ = size;
+	capacity_ = word_count * 64 / Bits;
+	this->rank_touch(0);
+
+	// fill via values
+	if (is_overflow(write_range(0, beg_it, size))) {
+		clear();
+		throw std::overflow_error("Overflow");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T_it>
+void BitArray<Bits, InlineWords, Overflow>::add_from_range(const T_it& beg_it, const T_it& end_it) {
+	const size_t size = end_it - beg_it;
+	
+	if (capacity_ < size_ + size) {	// needs to add capacity
+		reserve(size_ + size);
+	}
+
+	const size_t old_size = size_;
+	size_ += size;
+	this->rank_touch(old_size);
+	if (is_overflow(write_range(old_size, beg_it, size))) {
+		truncate(old_size);
+		throw std::overflow_error("Overflow");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T_it>
+uint64_t BitArray<Bits, InlineWords, Overflow>::write_range(size_t first, const T_it& beg_it, size_t count) {
+	if constexpr (std::is_pointer_v<T_it>) {	// contiguous => bulk kernels
+		return bitarray_detail::pack<Bits>(memory_, first, count, beg_it);
+	}
+	else {
+		uint64_t all = 0;
+		auto it = beg_it;
+		for (size_t i{}; i < count; ++i, ++it) {
+			const uint64_t val = static_cast<uint64_t>(*it);
+			all |= val;
+			bitarray_detail::set<Bits>(memory_, first + i, val & mask_);
+		}
+
+		return all;
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T>
+auto BitArray<Bits, InlineWords, Overflow>::data_begin(const std::vector<T>& vect) {
+	if constexpr (std::is_same_v<T, bool>) {	// no data() in std::vector<bool>
+		return vect.begin();
+	}
+	else {
+		return vect.data();
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::truncate(size_t new_size) {
+	const size_t words_count = (size_ * Bits + 63) / 64;
+	const size_t new_bits = new_size * Bits;
+
+	size_t i = new_bits / 64;
+	if (new_bits % 64 != 0) {	// keep head of the word
+		memory_[i] &= ~((uint64_t(1) << (64 - new_bits % 64)) - 1);
+		++i;
+	}
+	for (; i < words_count; ++i) {
+		memory_[i] = 0;
+	}
+	size_ = new_size;
+	this->rank_touch(new_size);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline size_t BitArray<Bits, InlineWords, Overflow>::index_of(const BitArray<Bits, InlineWords, Overflow>::iterator& it) const {
+	if (it.bit_ref.place_ptr == nullptr) {	// begin()/end() of empty BitArray
+		return 0;
+	}
+
+	return ((it.bit_ref.place_ptr - memory_) * 64 + it.bit_ref.bit_index) / Bits;
+}
+
+// shifts [index, size_) by count elements to the right, gap values are unspecified
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::open_gap(size_t index, size_t count) {
+	if (capacity_ < size_ + count) {	// add memory if no free space
+		reserve(size_ + count > capacity_ * 2 ? size_ + count : capacity_ * 2);
+	}
+
+	bitarray_detail::move_bits(memory_, (index + count) * Bits, memory_, index * Bits, (size_ - index) * Bits);
+	size_ += count;
+	this->rank_touch(index);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArray() : BitArray(std::pmr::get_default_resource()) {}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArray(std::pmr::memory_resource* resource) {
+	memory_ = nullptr;
+	resource_ = resource;
+	size_ = 0;
+	capacity_ = 0;
+}
+
+// like std::pmr containers the copy doesn't inherit the resource
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>::BitArray(const BitArray<Bits, InlineWords, Overflow>& other) : BitArray(other, std::pmr::get_default_resource()) {}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>::BitArray(const BitArray<Bits, InlineWords, Overflow>& other, std::pmr::memory_resource* resource) : BitArray(resource) {
+	const size_t word_count = (other.size_ * Bits + 63) / 64;
+	memory_ = allocate_words(word_count);
+	for (size_t i{}; i < word_count; ++i) {
+		memory_[i] = other.memory_[i];
+	}
+	size_ = other.size_;
+	capacity_ = word_count * 64 / Bits;
+}
+
+// the buffer moves together with its resource
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArray(BitArray<Bits, InlineWords, Overflow>&& other) noexcept : BitArray(other.resource_) {
+	swap(other);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<size_t OtherBits, size_t OtherInlineWords, BitArrayOverflow OtherOverflow>
+BitArray<Bits, InlineWords, Overflow>::BitArray(const BitArray<OtherBits, OtherInlineWords, OtherOverflow>& other, std::pmr::memory_resource* resource) : BitArray(resource) {
+	*this = other;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T>
+BitArray<Bits, InlineWords, Overflow>::BitArray(const std::initializer_list<T>& init_list) : BitArray() {
+	init_from_range(init_list.begin(), init_list.end());
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T>
+BitArray<Bits, InlineWords, Overflow>::BitArray(const std::vector<T>& vect) : BitArray() {
+	init_from_range(data_begin(vect), data_begin(vect) + vect.size());
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>::~BitArray() {
+	clear();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline size_t BitArray<Bits, InlineWords, Overflow>::size() const {
+	return size_;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline size_t BitArray<Bits, InlineWords, Overflow>::capacity() const {
+	return capacity_;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::empty() const {
+	return !static_cast<bool>(size_);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline std::pmr::memory_resource* BitArray<Bits, InlineWords, Overflow>::resource() const {
+	return resource_;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::front() {
+	if (empty()) {
+		throw std::out_of_range("Out of range. BitArray is empty");
+	}
+
+	return BitArray<Bits, InlineWords, Overflow>::BitArrayRef(this, &memory_[0], 0);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::back() {
+	if (empty()) {
+		throw std::out_of_range("Out of range. BitArray is empty");
+	}
+
+	return BitArray<Bits, InlineWords, Overflow>::BitArrayRef(this, &memory_[(size_ - 1) * Bits / 64], ((size_ - 1) * Bits) % 64);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::begin() {
+	BitArray<Bits, InlineWords, Overflow>::iterator it(this, nullptr, 0);	// like empty
+	
+	if (size_) {	// not empty
+		it.bit_ref.place_ptr = memory_;
+		// bit_index still 0
+	}
+
+	return it;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::end() {
+	BitArray<Bits, InlineWords, Overflow>::iterator it(this, nullptr, 0);	// like_empty
+
+	if (size_) {	// not empty
+		it.bit_ref.place_ptr = memory_ + (size_ * Bits / 64);
+		it.bit_ref.bit_index = (size_ * Bits) % 64;	// +1 (end)
+	}
+
+	return it;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::begin() const {
+	return const_cast<BitArray<Bits, InlineWords, Overflow>*>(this)->begin();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::end() const {
+	return const_cast<BitArray<Bits, InlineWords, Overflow>*>(this)->end();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::cbegin() const {
+	return begin();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::cend() const {
+	return end();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::resize(size_t new_size) {
+	const size_t words_count = (size_ * Bits + 63) / 64;
+	const size_t new_words_count = (new_size * Bits + 63) / 64;
+	
+	uint64_t* tmp_memory = allocate_words(new_words_count);
+	size_t tmp_i{};
+	if (new_words_count <= words_count) {
+		for (; tmp_i < new_words_count; ++tmp_i) {
+			tmp_memory[tmp_i] = memory_[tmp_i];
+		}
+		if (new_size && (new_size * Bits) % 64 != 0) {
+			tmp_memory[tmp_i - 1] &= ~((uint64_t(1) << (64 - (new_size * Bits) % 64)) - 1);
+		}
+	}
+	else {	// >
+		for (; tmp_i < words_count; ++tmp_i) {
+			tmp_memory[tmp_i] = memory_[tmp_i];
+		}
+		for (; tmp_i < new_words_count; ++tmp_i) {
+			tmp_memory[tmp_i] = 0;
+		}
+	}
+	deallocate_words(memory_, capacity_words());
+	this->rank_touch(new_size < size_ ? new_size : size_);
+	size_ = new_size;
+	capacity_ = new_words_count * 64 / Bits;
+	memory_ = tmp_memory;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::reserve(size_t new_capacity) {
+	if (new_capacity <= capacity_) {
+		return;
+	}
+
+    const size_t words_count = (size_ * Bits + 63) / 64;
+    const size_t new_words_count = (new_capacity * Bits + 63) / 64;
+    uint64_t* new_memory = allocate_words(new_words_count);
+    for (size_t i = 0; i < words_count; ++i) {
+        new_memory[i] = memory_[i];
+    }
+    for (size_t i = words_count; i < new_words_count; ++i) {
+        new_memory[i] = 0;
+    }
+
+    deallocate_words(memory_, capacity_words());
+    memory_ = new_memory;
+    capacity_ = new_words_count * 64 / Bits;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::clear() {
+	deallocate_words(memory_, capacity_words());
+	size_ = capacity_ = 0;
+	memory_ = nullptr;
+	this->rank_touch(0);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::shrink_to_fit() {
+	const size_t words_count = (capacity_ * Bits + 63) / 64;
+	const size_t new_words_count = (size_ * Bits + 63) / 64;
+	if (new_words_count == words_count) {
+		return;
+	}
+	if (!new_words_count) {
+		clear();
+		return;
+	}
+
+	uint64_t* new_memory = allocate_words(new_words_count);
+	for (size_t i{}; i < new_words_count; ++i) {
+		new_memory[i] = memory_[i];
+	}
+
+	deallocate_words(memory_, words_count);
+	memory_ = new_memory;
+	capacity_ = new_words_count * 64 / Bits;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::swap(BitArray<Bits, InlineWords, Overflow>& other) noexcept {
+	if constexpr (Bits == 1) {	// the index describes the words
+		std::swap(this->rank_index, other.rank_index);
+	}
+	if constexpr (InlineWords != 0) {
+		if (is_inline() || other.is_inline()) {	// inline words can't change owner => swap them, repoint
+			const bool inline_left = is_inline();
+			const bool inline_right = other.is_inline();
+			for (size_t i{}; i < InlineWords; ++i) {
+				std::swap(this->inline_memory()[i], other.inline_memory()[i]);
+			}
+			uint64_t* left_memory = memory_;
+			memory_ = inline_right ? this->inline_memory() : other.memory_;
+			other.memory_ = inline_left ? other.inline_memory() : left_memory;
+			std::swap(resource_, other.resource_);
+			std::swap(size_, other.size_);
+			std::swap(capacity_, other.capacity_);
+			return;
+		}
+	}
+
+	std::swap(memory_, other.memory_);
+	std::swap(resource_, other.resource_);
+	std::swap(size_, other.size_);
+	std::swap(capacity_, other.capacity_);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::pop_back() {
+	if (empty()) {
+		throw std::out_of_range("Out of range, BitArray is empty!");
+	}
+
+	truncate(size_ - 1);	// del (=NULL) the last value
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::push_back(const uint64_t val) {
+	if (is_overflow(val)) {
+		throw std::overflow_error("Overflow");
+	}
+	
+	if (size_ == capacity_) {
+		if (!size_) {
+			reserve(1);
+		}
+		else {
+			reserve(capacity_ * 2);
+		}
+	}
+
+	this->rank_touch(size_);
+	const size_t bits_index = size_ * Bits;
+	if constexpr (64 % Bits == 0) {	// only in 1 word
+		memory_[bits_index / 64] |= val << (64 - bits_index % 64 - Bits);
+	}
+	else {	// can be in 2 words
+		if (bits_index % 64 + Bits <= 64) {	// in 1 word
+			memory_[bits_index / 64] |= val << (64 - bits_index % 64 - Bits);
+		}
+		else {	// in 2 words
+			const int second_len = Bits - 64 + bits_index % 64;
+			memory_[bits_index / 64] |= val >> (second_len);
+			memory_[bits_index / 64 + 1] |= val << (64 - second_len);
+		}
+	}
+
+	++size_;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::erase(BitArray<Bits, InlineWords, Overflow>::iterator beg_it, BitArray<Bits, InlineWords, Overflow>::iterator end_it) {
+	if (beg_it.bit_ref.ref_ptr != end_it.bit_ref.ref_ptr || beg_it.bit_ref.ref_ptr != this) {
+		throw std::out_of_range("BitArray::iterator | invalid iterator");
+	}
+
+	const size_t first = index_of(beg_it);
+	const size_t last = index_of(end_it);
+	if (first > last || last > size_) {
+		throw std::out_of_range("BitArray::iterator | invalid iterator");
+	}
+	if (first == last) {
+		return;
+	}
+
+	// shift tail to the left, then del (=NULL) the freed bits
+	this->rank_touch(first);
+	bitarray_detail::move_bits(memory_, first * Bits, memory_, last * Bits, (size_ - last) * Bits);
+	truncate(size_ - (last - first));
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const uint64_t& val) {
+	if (it.bit_ref.ref_ptr != this || it > end()) {
+		throw std::out_of_range("BitArray::iterator | invalid iterator");
+	}
+	if (is_overflow(val)) {
+		throw std::overflow_error("Overflow");
+	}
+
+	const size_t index = index_of(it);
+	open_gap(index, 1);
+	bitarray_detail::set<Bits>(memory_, index, val);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const uint64_t& val, const size_t count) {
+	if (it.bit_ref.ref_ptr != this || it > end()) {
+		throw std::out_of_range("BitArray::iterator | invalid iterator");
+	}
+	if (is_overflow(val)) {
+		throw std::overflow_error("Overflow");
+	}
+	if (count == 0) {
+		return;
+	}
+
+	const size_t index = index_of(it);
+	open_gap(index, count);
+	bitarray_detail::fill<Bits>(memory_, index, count, val);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::insert(BitArray<Bits, InlineWords, Overflow>::iterator it, const BitArray<Bits, InlineWords, Overflow>& other) {
+	if (it.bit_ref.ref_ptr != this || it > end()) {
+		throw std::out_of_range("BitArray::iterator | invalid iterator");
+	}
+
+	const size_t index = index_of(it);
+	const size_t count = other.size_;
+	open_gap(index, count);
 
-	inline BitArray();
-	~BitArray();
-	template<typename T> BitArray(const std::initializer_list<T>& init_list);
-	template<typename T> BitArray(const std::vector<T>& vect);
+	if (&other == this) {	// source is split by the gap: [0, index) + [index + count, size_)
+		bitarray_detail::move_bits(memory_, index * Bits, memory_, 0, index * Bits);
+		bitarray_detail::move_bits(memory_, 2 * index * Bits, memory_, (index + count) * Bits, (count - index) * Bits);
+	}
+	else {
+		bitarray_detail::move_bits(memory_, index * Bits, other.memory_, 0, count * Bits);
+	}
+}
 
-	inline size_t size() const;
-	inline size_t capacity() const;
-	inline bool empty() const;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::at(size_t index) {
+	if (index >= size_) {
+		throw_index(index);
+	}
 
-	inline BitArray<Bits>::BitArrayRef front();
-	inline BitArray<Bits>::BitArrayRef back();
+	return BitArray<Bits, InlineWords, Overflow>::BitArrayRef(this, &memory_[index * Bits / 64], (index * Bits) % 64);
+}
 
-	inline BitArray<Bits>::iterator begin();
-	inline BitArray<Bits>::iterator end();
-	
-	void resize(size_t new_size);
-	void reserve(size_t new_capacity);
-	void clear();
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::at(size_t index) const {
+	if (index >= size_) {
+		throw_index(index);
+	}
 
-	inline void pop_back();
-	void push_back(const uint64_t val);
+	return bitarray_detail::get<Bits>(memory_, index);
+}
 
-	void erase(BitArray<Bits>::iterator beg_it, BitArray<Bits>::iterator end_it);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::operator[](size_t index) {
+	assert(index < size_);
 
-	void insert(BitArray<Bits>::iterator it, const uint64_t& val);
-	void insert(BitArray<Bits>::iterator it, const uint64_t& val, const size_t count);
+	return BitArray<Bits, InlineWords, Overflow>::BitArrayRef(this, &memory_[index * Bits / 64], (index * Bits) % 64);
+}
 
-	inline BitArrayRef operator[](size_t index);
-	BitArray& operator=(const BitArray<Bits>& other);
-	template<typename T> BitArray& operator=(const std::initializer_list<T>& init_list);
-	template<typename T> BitArray& operator=(const std::vector<T>& vect);
-	template<typename T> BitArray& operator+=(const std::initializer_list<T>& init_list);
-	template<typename T> BitArray& operator+=(const std::vector<T>& vect);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::operator[](size_t index) const {
+	assert(index < size_);
 
-	template<typename T> operator std::vector<T>() const;
-};
+	return bitarray_detail::get<Bits>(memory_, index);
+}
 
-// implementation
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::unchecked_get(size_t index) const {
+	assert(index < size_);
 
-// BitArray
-template<size_t Bits>
-inline const uint64_t BitArray<Bits>::get_mask() const {
-	static_assert(Bits >= 1 && Bits <= 63, "Bits must be in [1..63]");
-	uint64_t mask;
-	if constexpr (Bits == 64) {	// if   
-		throw std::out_of_range("Bits must be in [1...63]");
-	}
-	else {
-		mask = (uint64_t(1) << Bits) - 1;
-	}
+	return bitarray_detail::get<Bits>(memory_, index);
+}
 
-	return mask;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::unchecked_set(size_t index, uint64_t val) {
+	assert(index < size_ && !is_overflow(val));
+
+	this->rank_touch(index);
+	bitarray_detail::set<Bits>(memory_, index, val);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::is_overflow(const uint64_t& val) const {
-	return val > mask_;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::fill(uint64_t val) {
+	fill(0, size_, val);
 }
 
-template<size_t Bits>
-template<typename T_it>
-void BitArray<Bits>::init_from_range(const T_it& beg_it, const T_it& end_it) {
-	const size_t size = end_it - beg_it;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::fill(size_t first, size_t count, uint64_t val) {
+	check_range(first, count);
+	if (is_overflow(val)) {
+		throw std::overflow_error("Overflow");
+	}
 
-	// init memory
-	const size_t word_count = (size * Bits + 63) / 64;
-	memory_ = new uint64_t[word_count]{};	// init with nulls
-	size_ = size;
-	capacity_ = word_count * 64 / Bits;
+	this->rank_touch(first);
+	bitarray_detail::fill<Bits>(memory_, first, count, val);
+}
 
-	// fill via values
-	auto this_it = this->begin();
-	auto init_it = beg_it;
-	while (init_it != end_it) {
-		const uint64_t val = static_cast<const uint64_t>(*init_it);
-		if (val > mask_) {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<BitArrayOverflow Policy>
+void BitArray<Bits, InlineWords, Overflow>::add_scalar(uint64_t val) {
+	add_scalar<Policy>(0, size_, val);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<BitArrayOverflow Policy>
+void BitArray<Bits, InlineWords, Overflow>::add_scalar(size_t first, size_t count, uint64_t val) {
+	check_range(first, count);
+	if (is_overflow(val)) {
+		if constexpr (Policy == BitArrayOverflow::throw_error) {
 			throw std::overflow_error("Overflow");
 		}
-		if constexpr (64 % Bits == 0) {	// can be only in 1 word
-			*((*this_it).place_ptr) |= val << (64 - (*this_it).bit_index - Bits);
+		else if constexpr (Policy == BitArrayOverflow::wrap) {
+			val &= mask_;
 		}
-		else {	// can be in 2 words
-			if ((*this_it).bit_index + Bits <= 64) {	// in 1 word
-				*((*this_it).place_ptr) |= val << (64 - (*this_it).bit_index - Bits);
-			}
-			else {	// in 2 words
-				const int second_len = Bits - 64 + (*this_it).bit_index;
-				*((*this_it).place_ptr) |= val >> (second_len);	// put first part 
-				*((*this_it).place_ptr + 1) |= val << (64 - second_len);	// put second part
-			}
+		else {	// every element saturates
+			this->rank_touch(first);
+			bitarray_detail::fill<Bits>(memory_, first, count, mask_);
+			return;
 		}
-
-		++this_it;
-		++init_it;
 	}
-}
-
-template<size_t Bits>
-template<typename T_it>
-void BitArray<Bits>::add_from_range(const T_it& beg_it, const T_it& end_it) {
-	if constexpr (std::is_same_v<decltype(beg_it), decltype(this->begin())>) {
-		if (beg_it == this->begin()) {
-			throw std::logic_error("BitArray | self copy banned!");
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		if (bitarray_detail::add_sub_overflows<Bits, false, true>(memory_, nullptr, val, first, count)) {
+			throw std::overflow_error("Overflow");
 		}
 	}
-	
-	const size_t size = end_it - beg_it;
-	
-	if (capacity_ < size_ + size) {	// needs to add capacity
-		reserve(size_ + size);
-	}
 
-	auto this_it = this->end();
-	auto add_it = beg_it;
-	size_ += size;
-	while (add_it != end_it) {
-		const uint64_t val = static_cast<const uint64_t>(*add_it);
-		if (val > mask_) {
+	this->rank_touch(first);
+	bitarray_detail::add_sub<Bits, false, Policy == BitArrayOverflow::saturate, true>(memory_, nullptr, val, first, count);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<BitArrayOverflow Policy>
+void BitArray<Bits, InlineWords, Overflow>::sub_scalar(uint64_t val) {
+	sub_scalar<Policy>(0, size_, val);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<BitArrayOverflow Policy>
+void BitArray<Bits, InlineWords, Overflow>::sub_scalar(size_t first, size_t count, uint64_t val) {
+	check_range(first, count);
+	if (is_overflow(val)) {
+		if constexpr (Policy == BitArrayOverflow::throw_error) {
 			throw std::overflow_error("Overflow");
 		}
-		if constexpr (64 % Bits == 0) {	// can be only in 1 word
-			*((*this_it).place_ptr) |= val << (64 - (*this_it).bit_index - Bits);
+		else if constexpr (Policy == BitArrayOverflow::wrap) {
+			val &= mask_;
 		}
-		else {	// can be in 2 words
-			if ((*this_it).bit_index + Bits <= 64) {	// in 1 word
-				*((*this_it).place_ptr) |= val << (64 - (*this_it).bit_index - Bits);
-			}
-			else {	// in 2 words
-				const int second_len = Bits - 64 + (*this_it).bit_index;
-				*((*this_it).place_ptr) |= val >> (second_len);	// put first part 
-				*((*this_it).place_ptr + 1) |= val << (64 - second_len);	// put second part
-			}
+		else {	// every element saturates
+			this->rank_touch(first);
+			bitarray_detail::fill<Bits>(memory_, first, count, 0);
+			return;
+		}
+	}
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		if (bitarray_detail::add_sub_overflows<Bits, true, true>(memory_, nullptr, val, first, count)) {
+			throw std::overflow_error("Overflow");
 		}
-
-		++this_it;
-		++add_it;
 	}
+
+	this->rank_touch(first);
+	bitarray_detail::add_sub<Bits, true, Policy == BitArrayOverflow::saturate, true>(memory_, nullptr, val, first, count);
 }
 
-template<size_t Bits>
-inline BitArray<Bits>::BitArray() {
-	memory_ = nullptr;
-	size_ = 0;
-	capacity_ = 0;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::shift_right_all(size_t shift) {
+	shift_right_all(0, size_, shift);
 }
 
-template<size_t Bits>
-template<typename T>
-BitArray<Bits>::BitArray(const std::initializer_list<T>& init_list) : BitArray() {
-	init_from_range(init_list.begin(), init_list.end());
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::shift_right_all(size_t first, size_t count, size_t shift) {
+	check_range(first, count);
+	this->rank_touch(first);
+
+	if (shift >= Bits) {	// everything shifted out
+		bitarray_detail::fill<Bits>(memory_, first, count, 0);
+	}
+	else if (shift) {
+		bitarray_detail::shift_right<Bits>(memory_, first, count, shift);
+	}
 }
 
-template<size_t Bits>
-template<typename T>
-BitArray<Bits>::BitArray(const std::vector<T>& vect) : BitArray() {
-	init_from_range(vect.begin(), vect.end());
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<BitArrayOverflow Policy>
+void BitArray<Bits, InlineWords, Overflow>::add(const BitArray<Bits, InlineWords, Overflow>& other) {
+	if (other.size_ != size_) {
+		throw std::length_error("BitArray::add | size mismatch");
+	}
+	if (!size_) {	// other.memory_ may be null
+		return;
+	}
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		if (bitarray_detail::add_sub_overflows<Bits, false, false>(memory_, other.memory_, 0, 0, size_)) {
+			throw std::overflow_error("Overflow");
+		}
+	}
+
+	this->rank_touch(0);
+	bitarray_detail::add_sub<Bits, false, Policy == BitArrayOverflow::saturate, false>(memory_, other.memory_, 0, 0, size_);
 }
 
-template<size_t Bits>
-BitArray<Bits>::~BitArray() {
-	clear();
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::find(uint64_t val, size_t from) const {
+	if (from >= size_ || is_overflow(val)) {
+		return size_;
+	}
+
+	return bitarray_detail::find<Bits, bitarray_detail::lane_test::equal>(memory_, from, size_, val);
 }
 
-template<size_t Bits>
-inline size_t BitArray<Bits>::size() const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::find_first_not(uint64_t val, size_t from) const {
+	if (from >= size_) {
+		return size_;
+	}
+	if (is_overflow(val)) {	// no element is equal
+		return from;
+	}
+
+	return bitarray_detail::find<Bits, bitarray_detail::lane_test::not_equal>(memory_, from, size_, val);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename Pred>
+size_t BitArray<Bits, InlineWords, Overflow>::find_if(Pred pred, size_t from) const {
+	constexpr size_t block = 256;
+	uint64_t vals[block];
+	for (; from < size_; from += block) {
+		const size_t count = size_ - from < block ? size_ - from : block;
+		bitarray_detail::unpack<Bits>(memory_, from, count, vals);
+		for (size_t i{}; i < count; ++i) {
+			if (pred(vals[i])) {
+				return from + i;
+			}
+		}
+	}
+
 	return size_;
 }
 
-template<size_t Bits>
-inline size_t BitArray<Bits>::capacity() const {
-	return capacity_;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::count(uint64_t val) const {
+	if (is_overflow(val)) {
+		return 0;
+	}
+
+	return bitarray_detail::count<Bits, bitarray_detail::lane_test::equal>(memory_, 0, size_, val);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::empty() const {
-	return !static_cast<bool>(size_);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::count_if_less(uint64_t threshold) const {
+	if (threshold > mask_) {	// every element is less
+		return size_;
+	}
+
+	return bitarray_detail::count<Bits, bitarray_detail::lane_test::less>(memory_, 0, size_, threshold);
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef BitArray<Bits>::front() {
-	if (empty()) {
-		throw std::out_of_range("Out of range. BitArray is empty");
+// elements are packed from bit 0 => the first differing bit gives the index (words after size are zeroed)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::mismatch(const BitArray<Bits, InlineWords, Overflow>& other) const {
+	const size_t common = size_ < other.size_ ? size_ : other.size_;
+	const size_t word_count = (common * Bits + 63) / 64;
+	const size_t word = bitarray_detail::mismatch_words(memory_, other.memory_, word_count);
+	if (word == word_count) {
+		return common;
 	}
 
-	return BitArray<Bits>::BitArrayRef(this, &memory_[0], 0);
+	const size_t index = (word * 64 + bitarray_detail::leading_zeros(memory_[word] ^ other.memory_[word])) / Bits;
+	return index < common ? index : common;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef BitArray<Bits>::back() {
-	if (empty()) {
-		throw std::out_of_range("Out of range. BitArray is empty");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::min_width() const {
+	return bitarray_detail::width_of(bitarray_detail::or_all<Bits>(memory_, size_));
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::sort() {
+	if (size_ < 2) {
+		return;
 	}
 
-	return BitArray<Bits>::BitArrayRef(this, &memory_[(size_ - 1) * Bits / 64], ((size_ - 1) * Bits) % 64);
+	this->rank_touch(0);
+	bitarray_detail::sort<Bits>(memory_, size_);
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator BitArray<Bits>::begin() {
-	BitArray<Bits>::iterator it(this, nullptr, 0);	// like empty
-	
-	if (size_) {	// not empty
-		it.bit_ref.place_ptr = memory_;
-		// bit_index still 0
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::lower_bound(uint64_t val) const {
+	if (is_overflow(val)) {
+		return size_;
 	}
 
-	return it;
+	return bitarray_detail::lower_bound<Bits>(memory_, 0, size_, val);
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator BitArray<Bits>::end() {
-	BitArray<Bits>::iterator it(this, nullptr, 0);	// like_empty
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::upper_bound(uint64_t val) const {
+	return val >= mask_ ? size_ : lower_bound(val + 1);
+}
 
-	if (size_) {	// not empty
-		it.bit_ref.place_ptr = memory_ + (size_ * Bits / 64);
-		it.bit_ref.bit_index = (size_ * Bits) % 64;	// +1 (end)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+std::pair<size_t, size_t> BitArray<Bits, InlineWords, Overflow>::equal_range(uint64_t val) const {
+	const size_t first = lower_bound(val);
+	if (first == size_ || bitarray_detail::get<Bits>(memory_, first) != val) {
+		return { first, first };
 	}
 
-	return it;
+	return { first, val == mask_ ? size_ : bitarray_detail::lower_bound<Bits>(memory_, first, size_, val + 1) };
 }
 
-template<size_t Bits>
-void BitArray<Bits>::resize(size_t new_size) {
-	const size_t words_count = (size_ * Bits + 63) / 64;
-	const size_t new_words_count = (new_size * Bits + 63) / 64;
-	
-	uint64_t* tmp_memory = new uint64_t[new_words_count];
-	size_t tmp_i{};
-	if (new_words_count <= words_count) {
-		for (; tmp_i < new_words_count; ++tmp_i) {
-			tmp_memory[tmp_i] = memory_[tmp_i];
-		}
-		if (new_size && (new_size * Bits) % 64 != 0) {
-			tmp_memory[tmp_i - 1] &= ~((uint64_t(1) << (64 - (new_size * Bits) % 64)) - 1);
-		}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArraySkipTable BitArray<Bits, InlineWords, Overflow>::skip_table() const {
+	BitArraySkipTable table;
+	table.stride_ = 512 / Bits;
+	table.size_ = size_;
+	table.samples_.reserve((size_ + table.stride_ - 1) / table.stride_);
+	for (size_t i{}; i < size_; i += table.stride_) {
+		table.samples_.push_back(bitarray_detail::get<Bits>(memory_, i));
 	}
-	else {	// >
-		for (; tmp_i < words_count; ++tmp_i) {
-			tmp_memory[tmp_i] = memory_[tmp_i];
-		}
-		for (; tmp_i < new_words_count; ++tmp_i) {
-			tmp_memory[tmp_i] = 0;
-		}
+
+	return table;
+}
+
+// samples[j] < val <= samples[j + 1] => the answer is in (j * stride, (j + 1) * stride]
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::lower_bound(uint64_t val, const BitArraySkipTable& table) const {
+	assert(table.size_ == size_);
+	if (is_overflow(val)) {
+		return size_;
 	}
-	if (memory_ != nullptr) {
-		delete[] memory_;
+
+	const size_t sample = std::lower_bound(table.samples_.begin(), table.samples_.end(), val) - table.samples_.begin();
+	if (sample == 0) {
+		return 0;
 	}
-	size_ = new_size;
-	capacity_ = new_words_count * 64 / Bits;
-	memory_ = tmp_memory;
+	const size_t first = (sample - 1) * table.stride_ + 1;
+	const size_t last = sample * table.stride_ < size_ ? sample * table.stride_ : size_;
+	return bitarray_detail::lower_bound<Bits>(memory_, first, last, val);
 }
 
-template<size_t Bits>
-void BitArray<Bits>::reserve(size_t new_capacity) {
-	if (new_capacity <= capacity_) {
-		return;
-	}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::upper_bound(uint64_t val, const BitArraySkipTable& table) const {
+	return val >= mask_ ? size_ : lower_bound(val + 1, table);
+}
 
-    const size_t words_count = (size_ * Bits + 63) / 64;
-    const size_t new_words_count = (new_capacity * Bits + 63) / 64;
-    uint64_t* new_memory = new uint64_t[new_words_count];
-    for (size_t i = 0; i < words_count; ++i) {
-        new_memory[i] = memory_[i];
-    }
-    for (size_t i = words_count; i < new_words_count; ++i) {
-        new_memory[i] = 0;
-    }
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+std::pair<size_t, size_t> BitArray<Bits, InlineWords, Overflow>::equal_range(uint64_t val, const BitArraySkipTable& table) const {
+	return { lower_bound(val, table), upper_bound(val, table) };
+}
 
-    delete[] memory_;
-    memory_ = new_memory;
-    capacity_ = new_words_count * 64 / Bits;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::sum() const {
+	return bitarray_detail::sum<Bits>(memory_, 0, size_);
 }
 
-template<size_t Bits>
-void BitArray<Bits>::clear() {
-	if (memory_ != nullptr) {
-		delete[] memory_;
-	}
-	size_ = capacity_ = 0;
-	memory_ = nullptr;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::sum(size_t first, size_t count) const {
+	check_range(first, count);
+	return bitarray_detail::sum<Bits>(memory_, first, count);
 }
 
-template<size_t Bits>
-inline void BitArray<Bits>::pop_back() {
-	if (empty()) {
-		throw std::out_of_range("Out of range, BitArray is empty!");
-	}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::min() const {
+	return minmax(0, size_).first;
+}
 
-	const size_t next_bits{ (--size_) * Bits };
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::min(size_t first, size_t count) const {
+	return minmax(first, count).first;
+}
 
-	if constexpr (64 % Bits == 0) {	// only in 1 word
-		if (next_bits % 64 == 0) {	// stats in new word
-			memory_[next_bits / 64] = 0;
-		}
-		else {
-			memory_[next_bits / 64] &= ~((uint64_t(1) << (64 - next_bits % 64)) - 1);
-		}
-	}
-	else {	// can be in 2 words
-		if (next_bits % 64 + Bits > 64) {	// in 2 words
-			memory_[next_bits / 64 + 1] = 0;
-			memory_[next_bits / 64] &= ~((uint64_t(1) << (64 - next_bits % 64)) - 1);
-		}
-		else {	// in 1 word
-			memory_[next_bits / 64] &= ~((uint64_t(1) << (64 - next_bits % 64)) - 1);
-		}
-	}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::max() const {
+	return minmax(0, size_).second;
 }
 
-template<size_t Bits>
-void BitArray<Bits>::push_back(const uint64_t val) {
-	if (is_overflow(val)) {
-		throw std::overflow_error("Overflow");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::max(size_t first, size_t count) const {
+	return minmax(first, count).second;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+std::pair<uint64_t, uint64_t> BitArray<Bits, InlineWords, Overflow>::minmax() const {
+	return minmax(0, size_);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+std::pair<uint64_t, uint64_t> BitArray<Bits, InlineWords, Overflow>::minmax(size_t first, size_t count) const {
+	check_range(first, count);
+	if (count == 0) {
+		throw std::out_of_range("Empty range");
 	}
-	
-	if (size_ == capacity_) {
-		if (!size_) {
-			reserve(1);
-		}
-		else {
-			reserve(capacity_ * 2);
-		}
+
+	return bitarray_detail::minmax<Bits>(memory_, first, count);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::exclusive_scan(uint64_t* out, uint64_t init) const {
+	return bitarray_detail::scan<Bits, false>(memory_, 0, size_, out, init);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::exclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init) const {
+	check_range(first, count);
+	return bitarray_detail::scan<Bits, false>(memory_, first, count, out, init);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::inclusive_scan(uint64_t* out, uint64_t init) const {
+	return bitarray_detail::scan<Bits, true>(memory_, 0, size_, out, init);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+uint64_t BitArray<Bits, InlineWords, Overflow>::inclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init) const {
+	check_range(first, count);
+	return bitarray_detail::scan<Bits, true>(memory_, first, count, out, init);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<bitarray_detail::word_op Op>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::apply_words(const BitArray<Bits, InlineWords, Overflow>& other) {
+	if (other.size_ != size_) {
+		throw std::length_error("BitArray::bitwise | size mismatch");
 	}
 
-	const size_t bits_index = size_ * Bits;
-	if constexpr (64 % Bits == 0) {	// only in 1 word
-		memory_[bits_index / 64] |= val << (64 - bits_index % 64 - Bits);
+	this->rank_touch(0);
+	bitarray_detail::bitwise<Op>(memory_, other.memory_, (size_ * Bits + 63) / 64);	// zero tails stay zero
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator&=(const BitArray<Bits, InlineWords, Overflow>& other) {
+	return apply_words<bitarray_detail::word_op::and_>(other);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator|=(const BitArray<Bits, InlineWords, Overflow>& other) {
+	return apply_words<bitarray_detail::word_op::or_>(other);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator^=(const BitArray<Bits, InlineWords, Overflow>& other) {
+	return apply_words<bitarray_detail::word_op::xor_>(other);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::andnot(const BitArray<Bits, InlineWords, Overflow>& other) {
+	return apply_words<bitarray_detail::word_op::andnot>(other);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::flip() {
+	const size_t bits = size_ * Bits;
+	const size_t words_count = (bits + 63) / 64;
+	this->rank_touch(0);
+	for (size_t i{}; i < words_count; ++i) {
+		memory_[i] = ~memory_[i];
 	}
-	else {	// can be in 2 words
-		if (bits_index % 64 + Bits <= 64) {	// in 1 word
-			memory_[bits_index / 64] |= val << (64 - bits_index % 64 - Bits);
+	if (bits % 64 != 0) {	// keep the zero tail
+		memory_[words_count - 1] &= ~((uint64_t(1) << (64 - bits % 64)) - 1);
+	}
+
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::count() const {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	return bitarray_detail::popcount_words(memory_, (size_ + 63) / 64);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+bool BitArray<Bits, InlineWords, Overflow>::any() const {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	const size_t words_count = (size_ + 63) / 64;
+	for (size_t i{}; i < words_count; ++i) {
+		if (memory_[i]) {
+			return true;
 		}
-		else {	// in 2 words
-			const int second_len = Bits - 64 + bits_index % 64;
-			memory_[bits_index / 64] |= val >> (second_len);
-			memory_[bits_index / 64 + 1] |= val << (64 - second_len);
+	}
+	return false;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+bool BitArray<Bits, InlineWords, Overflow>::all() const {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	const size_t full_words = size_ / 64;
+	for (size_t i{}; i < full_words; ++i) {
+		if (~memory_[i]) {
+			return false;
 		}
 	}
+	return size_ % 64 == 0 || memory_[full_words] == ~((uint64_t(1) << (64 - size_ % 64)) - 1);
+}
 
-	++size_;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+bool BitArray<Bits, InlineWords, Overflow>::none() const {
+	return !any();
 }
 
-template<size_t Bits>
-void BitArray<Bits>::erase(BitArray<Bits>::iterator beg_it, BitArray<Bits>::iterator end_it) {
-	if (beg_it.bit_ref.ref_ptr != end_it.bit_ref.ref_ptr || beg_it.bit_ref.ref_ptr != this) {
-		throw std::out_of_range("BitArray::iterator | invalid iterator");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::shift_left(size_t n) {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	this->rank_touch(0);
+	if (n >= size_) {
+		bitarray_detail::fill<Bits>(memory_, 0, size_, 0);
 	}
-	if (beg_it == end_it) {
-		return;
-	}	// if beg_it > end_it => gonna be UB
+	else if (n) {
+		bitarray_detail::move_bits(memory_, n, memory_, 0, size_ - n);
+		bitarray_detail::fill<Bits>(memory_, 0, n, 0);
+	}
+}
 
-	BitArray<Bits>::iterator left_it = beg_it;
-	BitArray<Bits>::iterator right_it = end_it;
-	const BitArray<Bits>::iterator c_end = end();
-	
-	// shift values
-	while (right_it != c_end) {	// change values (shift to new pos)
-		*left_it = static_cast<uint64_t>(*right_it);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::shift_right(size_t n) {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
 
-		++left_it;
-		++right_it;
+	this->rank_touch(0);
+	if (n >= size_) {
+		bitarray_detail::fill<Bits>(memory_, 0, size_, 0);
 	}
-
-	// del (=NULL) extreme values in place_ptr (left_it)
-	if ((*left_it).bit_index == 0) {	// del all the word
-		*((*left_it).place_ptr) = 0;
+	else if (n) {
+		bitarray_detail::move_bits(memory_, 0, memory_, n, size_ - n);
+		bitarray_detail::fill<Bits>(memory_, size_ - n, n, 0);
 	}
-	else {	// del only left_it+ bits (from place_ptr)
-		*((*left_it).place_ptr) &= ~((uint64_t(1) << (64 - (*left_it).bit_index)) - 1);
+}
 
-		if constexpr (64 % Bits != 0) {	// can be in 2 words
-			if ((*left_it).bit_index + Bits > 64) {	// in 2 words
-				// already deleted left part => del(=NULL) next place_ptr
-				*((*left_it).place_ptr + 1) = 0;
-			}
-		}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline const bitarray_detail::rank_select_index& BitArray<Bits, InlineWords, Overflow>::rank_index_ready() const {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	if (!this->rank_index) {
+		this->rank_index = std::make_unique<bitarray_detail::rank_select_index>();
 	}
-	// del (=NULL) extreme words (right to left_it->place_ptr)
-	const uint64_t* end_ptr = back().place_ptr + 1;
-	uint64_t* left_ptr = (*left_it).place_ptr + 1;
-	while (left_ptr != end_ptr) {
-		*left_ptr = 0;
-		++left_ptr;
+	if (this->rank_index->dirty_from != bitarray_detail::rank_select_index::up_to_date) {
+		this->rank_index->update(memory_, size_);
 	}
 
-	size_t diff = end_it - beg_it;
-	size_ -= diff;
+	return *this->rank_index;
 }
 
-template<size_t Bits>
-void BitArray<Bits>::insert(BitArray<Bits>::iterator it, const uint64_t& val) {
-	if (it.bit_ref.ref_ptr != this || it > end()) {
-		throw std::out_of_range("BitArray::iterator | invalid iterator");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::rank1(size_t pos) const {
+	if (pos > size_) {
+		throw_index(pos);
 	}
 
-	if (capacity_ == size_) {	// add memory if no free space
-		const uint64_t word_count = (size_ * Bits + 63) / 64;
-		const uint64_t new_word_count = word_count + 1;
-		uint64_t* new_memory = new uint64_t[new_word_count]{ 0 };
-		for (size_t i{}; i < word_count; ++i) {
-			new_memory[i] = memory_[i];
-		}
-		
-		it.bit_ref.place_ptr = new_memory
-			+ (it.bit_ref.place_ptr - it.bit_ref.ref_ptr->memory_);	// copy ptr owset
-		if (memory_ != nullptr) {
-			delete[] memory_;
-		}
-		memory_ = new_memory;
-		capacity_ = new_word_count * 64 / Bits;
+	return rank_index_ready().rank1(memory_, pos);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::rank0(size_t pos) const {
+	return pos - rank1(pos);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::select1(size_t k) const {
+	const bitarray_detail::rank_select_index& index = rank_index_ready();
+	if (k >= index.ones()) {
+		throw_index(k);
 	}
-	++size_;
 
-	// shift elems
-	BitArray<Bits>::iterator right_it = end() - 1;
-	BitArray<Bits>::iterator left_it = right_it - 1;
-	while (right_it != it) {
-		*right_it = static_cast<uint64_t>(*left_it);
+	return index.template select<true>(memory_, k);
+}
 
-		--right_it;
-		--left_it;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+size_t BitArray<Bits, InlineWords, Overflow>::select0(size_t k) const {
+	const bitarray_detail::rank_select_index& index = rank_index_ready();
+	if (k >= size_ - index.ones()) {
+		throw_index(k);
 	}
 
-	*right_it = val;	// right_it == it (watch function parameters)
+	return index.template select<false>(memory_, k);
 }
 
-template<size_t Bits>
-void BitArray<Bits>::insert(BitArray<Bits>::iterator it, const uint64_t& val, const size_t count) {
-	if (it.bit_ref.ref_ptr != this || it > end()) {
-		throw std::out_of_range("BitArray::iterator | invalid iterator");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::build_rank_index() const {
+	rank_index_ready();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::drop_rank_index() {
+	static_assert(Bits == 1, "bitset operations need BitArray<1>");
+
+	this->rank_index.reset();
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::gather(const size_t* idx, size_t n, uint64_t* out, BitArrayBatchOrder order, size_t prefetch_distance) const {
+	size_t max_index = 0;
+	for (size_t i{}; i < n; ++i) {
+		max_index = idx[i] > max_index ? idx[i] : max_index;
 	}
-	if (count == 0) {
-		return;
+	if (n && max_index >= size_) {
+		throw_index(max_index);
 	}
 
-	if (capacity_ < size_ + count) {	// add memory if no free space
-		const uint64_t word_count = (size_ * Bits + 63) / 64;
-		const uint64_t new_word_count = ((size_ + count) * Bits + 63) / 64;
-		uint64_t* new_memory = new uint64_t[new_word_count]{ 0 };
-		for (size_t i{}; i < word_count; ++i) {
-			new_memory[i] = memory_[i];
+	if (order == BitArrayBatchOrder::by_word && n > 1) {
+		std::vector<size_t> sorted(n);
+		std::vector<size_t> positions(n);
+		bitarray_detail::batch_order<Bits>(idx, n, max_index, sorted.data(), positions.data());
+		std::vector<uint64_t> vals(n);
+		bitarray_detail::gather<Bits>(memory_, sorted.data(), n, vals.data(), prefetch_distance);
+		for (size_t i{}; i < n; ++i) {
+			out[positions[i]] = vals[i];
 		}
+	}
+	else {
+		bitarray_detail::gather<Bits>(memory_, idx, n, out, prefetch_distance);
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::scatter(const size_t* idx, const uint64_t* vals, size_t n, BitArrayBatchOrder order, size_t prefetch_distance) {
+	size_t max_index = 0;
+	uint64_t all = 0;
+	for (size_t i{}; i < n; ++i) {
+		max_index = idx[i] > max_index ? idx[i] : max_index;
+		all |= vals[i];
+	}
+	if (n && max_index >= size_) {
+		throw_index(max_index);
+	}
+	if (is_overflow(all)) {
+		throw std::overflow_error("Overflow");
+	}
 
-		it.bit_ref.place_ptr = new_memory
-			+ (it.bit_ref.place_ptr - it.bit_ref.ref_ptr->memory_);	// copy ptr owset
-		if (memory_ != nullptr) {
-			delete[] memory_;
+	this->rank_touch(0);
+	if (order == BitArrayBatchOrder::by_word && n > 1) {
+		std::vector<size_t> sorted(n);
+		std::vector<size_t> positions(n);
+		bitarray_detail::batch_order<Bits>(idx, n, max_index, sorted.data(), positions.data());
+		std::vector<uint64_t> sorted_vals(n);
+		for (size_t i{}; i < n; ++i) {
+			sorted_vals[i] = vals[positions[i]];
 		}
-		memory_ = new_memory;
-		capacity_ = new_word_count * 64 / Bits;
+		bitarray_detail::scatter<Bits>(memory_, sorted.data(), sorted_vals.data(), n, prefetch_distance);
 	}
-	size_ += count;
+	else {
+		bitarray_detail::scatter<Bits>(memory_, idx, vals, n, prefetch_distance);
+	}
+}
 
-	// shift elems
-	BitArray<Bits>::iterator right_it = end() - 1;
-	BitArray<Bits>::iterator left_it = right_it - count;
-	while (left_it >= it) {
-		*right_it = static_cast<uint64_t>(*left_it);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator=(const BitArray<Bits, InlineWords, Overflow>& other) {
+	if (&other == this) {
+		return *this;
+	}
 
-		--right_it;
-		--left_it;
+	if (capacity_ < other.size_) {	// no place => new memory
+		clear();
+		const size_t word_count = (other.size_ * Bits + 63) / 64;
+		memory_ = allocate_words(word_count);
+		capacity_ = word_count * 64 / Bits;
+	}
+	else {	// reuse memory (words after new size must stay zeroed)
+		truncate(0);
 	}
+	size_ = other.size_;
+	this->rank_touch(0);
 
-	++left_it;
-	++right_it;
-	while (left_it != right_it) {	// insert values
-		*left_it = val;
-		++left_it;
+	const size_t word_count = (size_ * Bits + 63) / 64;
+	for (size_t i{}; i < word_count; ++i) {
+		memory_[i] = other.memory_[i];
 	}
+
+	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef BitArray<Bits>::operator[](size_t index) {
-	if (index >= size_) {
-		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator=(BitArray<Bits, InlineWords, Overflow>&& other) noexcept {
+	if (&other != this) {
+		BitArray<Bits, InlineWords, Overflow> tmp(std::move(other));	// other is left empty
+		swap(tmp);
 	}
 
-	return BitArray<Bits>::BitArrayRef(this, &memory_[index * Bits / 64], (index * Bits) % 64);
+	return *this;
 }
 
-template<size_t Bits>
-BitArray<Bits>& BitArray<Bits>::operator=(const BitArray<Bits>& other) {
-	if (&other == this) {
-		return *this;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<size_t OtherBits, size_t OtherInlineWords, BitArrayOverflow OtherOverflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator=(const BitArray<OtherBits, OtherInlineWords, OtherOverflow>& other) {
+	if constexpr (OtherBits > Bits && Overflow == BitArrayOverflow::throw_error) {	// check before any change
+		if (other.min_width() > Bits) {
+			throw std::overflow_error("Overflow");
+		}
 	}
 
-	clear();
+	if (capacity_ < other.size_) {	// no place => new memory
+		clear();
+		const size_t word_count = (other.size_ * Bits + 63) / 64;
+		memory_ = allocate_words(word_count);
+		capacity_ = word_count * 64 / Bits;
+		for (size_t i{}; i < word_count; ++i) {	// repack writes only the element bits => the tail must be zero already
+			memory_[i] = 0;
+		}
+	}
+	else {	// reuse memory (words after new size must stay zeroed)
+		truncate(0);
+	}
 	size_ = other.size_;
-	capacity_ = other.capacity_;
-	memory_ = new uint64_t[capacity_];
+	this->rank_touch(0);
 
-	size_t word_count = (size_ * Bits + 63) / 64;
-	uint64_t* this_ptr{ memory_ - 1 };
-	uint64_t* other_ptr{ other.memory_ - 1 };
-	for (size_t i{}; i < word_count; ++i) {
-		*(++this_ptr) = *(++other_ptr);
+	if constexpr (OtherBits == Bits) {	// same packing
+		const size_t word_count = (size_ * Bits + 63) / 64;
+		for (size_t i{}; i < word_count; ++i) {
+			memory_[i] = other.memory_[i];
+		}
+	}
+	else {
+		bitarray_detail::repack<OtherBits, Bits, Overflow == BitArrayOverflow::saturate>(other.memory_, memory_, size_);
 	}
 
 	return *this;
 }
 
-template<size_t Bits>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
 template<typename T>
-BitArray<Bits>& BitArray<Bits>::operator=(const std::initializer_list<T>& init_list) {
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator=(const std::initializer_list<T>& init_list) {
 	clear();
 	init_from_range(init_list.begin(), init_list.end());
 	
 	return *this;
 }
 
-template<size_t Bits>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
 template<typename T>
-BitArray<Bits>& BitArray<Bits>::operator=(const std::vector<T>& vect) {
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator=(const std::vector<T>& vect) {
 	clear();
-	init_from_range(vect.begin(), vect.end());
+	init_from_range(data_begin(vect), data_begin(vect) + vect.size());
 
 	return *this;
 }
 
-template<size_t Bits>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
 template<typename T>
-BitArray<Bits>& BitArray<Bits>::operator+=(const std::initializer_list<T>& init_list) {
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator+=(const std::initializer_list<T>& init_list) {
 	add_from_range(init_list.begin(), init_list.end());
 	
 	return *this;
 }
 
-template<size_t Bits>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
 template<typename T>
-BitArray<Bits>& BitArray<Bits>::operator+=(const std::vector<T>& vect) {
-	add_from_range(vect.begin(), vect.end());
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator+=(const std::vector<T>& vect) {
+	add_from_range(data_begin(vect), data_begin(vect) + vect.size());
 
 	return *this;
 }
 
-template<size_t Bits>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BitArray<Bits, InlineWords, Overflow>& BitArray<Bits, InlineWords, Overflow>::operator+=(const BitArray<Bits, InlineWords, Overflow>& other) {
+	const size_t count = other.size_;	// other can be *this
+	if (capacity_ < size_ + count) {	// needs to add capacity
+		reserve(size_ + count);
+	}
+
+	this->rank_touch(size_);
+	bitarray_detail::move_bits(memory_, size_ * Bits, other.memory_, 0, count * Bits);
+	size_ += count;
+
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
 template<typename T>
-BitArray<Bits>::operator std::vector<T>() const {
+BitArray<Bits, InlineWords, Overflow>::operator std::vector<T>() const {
 	std::vector<T> vect;
 	vect.resize(size_);
-	auto vect_it = vect.begin();
-	
-	BitArray<Bits>::iterator bit_it = const_cast<BitArray<Bits>*>(this)->begin();
-	BitArray<Bits>::iterator bit_it_end = const_cast<BitArray<Bits>*>(this)->end();
-	
-	while (bit_it != bit_it_end) {
-		*vect_it = static_cast<uint64_t>(*bit_it);
-		++bit_it;
-		++vect_it;
+
+	if constexpr (std::is_same_v<T, bool>) {	// no data() in std::vector<bool>
+		for (size_t i{}; i < size_; ++i) {
+			vect[i] = bitarray_detail::get<Bits>(memory_, i);
+		}
+	}
+	else {
+		unpack_to(vect.data(), 0, size_);
 	}
 
 	return vect;
 }
 
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T>
+void BitArray<Bits, InlineWords, Overflow>::unpack_to(T* out, size_t first, size_t count) const {
+	if (first > size_ || count > size_ - first) {
+		throw std::out_of_range("Out of range");
+	}
+
+	bitarray_detail::unpack<Bits>(memory_, first, count, out);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+template<typename T>
+void BitArray<Bits, InlineWords, Overflow>::pack_from(const T* in, size_t count) {
+	if (capacity_ < count) {
+		clear();
+		reserve(count);
+	}
+	else {	// reuse memory (words after new size must stay zeroed)
+		truncate(size_ < count ? size_ : count);
+	}
+	size_ = count;
+	this->rank_touch(0);
+
+	if (is_overflow(bitarray_detail::pack<Bits>(memory_, 0, count, in))) {
+		truncate(0);
+		throw std::overflow_error("Overflow");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::save(std::ostream& os, bool checksum) const {
+	unsigned char header[bitarray_detail::stream_header_size]{};
+	for (size_t i{}; i < sizeof(bitarray_detail::stream_magic); ++i) {
+		header[i] = static_cast<unsigned char>(bitarray_detail::stream_magic[i]);
+	}
+	bitarray_detail::store_le(header + 8, bitarray_detail::stream_version, 4);
+	bitarray_detail::store_le(header + 12, Bits, 4);
+	bitarray_detail::store_le(header + 16, size_, 8);
+	bitarray_detail::store_le(header + 24, bitarray_detail::stream_msb_first, 4);
+	bitarray_detail::store_le(header + 28, checksum ? bitarray_detail::stream_checksum_flag : 0, 4);
+	bitarray_detail::store_le(header + 32, bitarray_detail::stream_chunk_words, 4);
+	os.write(reinterpret_cast<const char*>(header), sizeof(header));
+
+	std::vector<uint64_t> swapped;	// only for big endian hosts
+	const size_t word_count = (size_ * Bits + 63) / 64;
+	for (size_t first{}; first < word_count && os; first += bitarray_detail::stream_chunk_words) {
+		const size_t count = word_count - first < bitarray_detail::stream_chunk_words
+			? word_count - first : bitarray_detail::stream_chunk_words;
+
+		if constexpr (bitarray_detail::is_little_endian) {
+			os.write(reinterpret_cast<const char*>(memory_ + first), count * sizeof(uint64_t));
+		}
+		else {
+			swapped.resize(count);
+			for (size_t i{}; i < count; ++i) {
+				swapped[i] = bitarray_detail::byte_swap(memory_[first + i]);
+			}
+			os.write(reinterpret_cast<const char*>(swapped.data()), count * sizeof(uint64_t));
+		}
+
+		if (checksum) {
+			unsigned char sum[8];
+			bitarray_detail::store_le(sum, bitarray_detail::checksum(memory_ + first, count), 8);
+			os.write(reinterpret_cast<const char*>(sum), sizeof(sum));
+		}
+	}
+
+	if (!os) {
+		throw std::runtime_error("BitArray::save | write failed");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+void BitArray<Bits, InlineWords, Overflow>::load(std::istream& is) {
+	unsigned char header[bitarray_detail::stream_header_size];
+	if (!is.read(reinterpret_cast<char*>(header), sizeof(header))) {
+		throw std::runtime_error("BitArray::load | unexpected end of stream");
+	}
+	for (size_t i{}; i < sizeof(bitarray_detail::stream_magic); ++i) {
+		if (header[i] != static_cast<unsigned char>(bitarray_detail::stream_magic[i])) {
+			throw std::runtime_error("BitArray::load | not a BitArray stream");
+		}
+	}
+	if (bitarray_detail::load_le(header + 8, 4) != bitarray_detail::stream_version) {
+		throw std::runtime_error("BitArray::load | unsupported version");
+	}
+	if (bitarray_detail::load_le(header + 12, 4) != Bits) {
+		throw std::runtime_error("BitArray::load | Bits mismatch");
+	}
+	if (bitarray_detail::load_le(header + 24, 4) != bitarray_detail::stream_msb_first) {
+		throw std::runtime_error("BitArray::load | unsupported packing order");
+	}
+	const uint64_t size = bitarray_detail::load_le(header + 16, 8);
+	const bool checksum = bitarray_detail::load_le(header + 28, 4) & bitarray_detail::stream_checksum_flag;
+	const size_t chunk_words = bitarray_detail::load_le(header + 32, 4);
+	if (size > SIZE_MAX / Bits || chunk_words == 0) {
+		throw std::runtime_error("BitArray::load | corrupted header");
+	}
+
+	// read straight into the new buffer (*this is untouched on failure)
+	BitArray<Bits, InlineWords, Overflow> loaded(resource_);
+	loaded.reserve(size);
+	const size_t word_count = (size * Bits + 63) / 64;
+	for (size_t first{}; first < word_count; first += chunk_words) {
+		const size_t count = word_count - first < chunk_words ? word_count - first : chunk_words;
+		uint64_t* chunk = loaded.memory_ + first;
+		if (!is.read(reinterpret_cast<char*>(chunk), count * sizeof(uint64_t))) {
+			throw std::runtime_error("BitArray::load | unexpected end of stream");
+		}
+		if constexpr (!bitarray_detail::is_little_endian) {
+			for (size_t i{}; i < count; ++i) {
+				chunk[i] = bitarray_detail::byte_swap(chunk[i]);
+			}
+		}
+
+		if (checksum) {
+			unsigned char sum[8];
+			if (!is.read(reinterpret_cast<char*>(sum), sizeof(sum))) {
+				throw std::runtime_error("BitArray::load | unexpected end of stream");
+			}
+			if (bitarray_detail::load_le(sum, 8) != bitarray_detail::checksum(chunk, count)) {
+				throw std::runtime_error("BitArray::load | checksum mismatch");
+			}
+		}
+	}
+
+	loaded.size_ = word_count * 64 / Bits;	// del (=NULL) bits after size
+	loaded.truncate(size);
+	swap(loaded);
+}
+
 // BitArrayRef
-template<size_t Bits>
-inline BitArray<Bits>::BitArrayRef::BitArrayRef(BitArray<Bits>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index) : ref_ptr(ref_ptr), place_ptr(place_ptr), bit_index(bit_index) {}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArrayRef::BitArrayRef(BitArray<Bits, InlineWords, Overflow>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index) : ref_ptr(ref_ptr), place_ptr(place_ptr), bit_index(bit_index) {}
 
-template<size_t Bits>
-BitArray<Bits>::BitArrayRef::BitArrayRef(const BitArray<Bits>::BitArrayRef& other) : place_ptr(other.place_ptr), bit_index(other.bit_index), ref_ptr(other.ref_ptr) {}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArrayRef::BitArrayRef(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other) : place_ptr(other.place_ptr), bit_index(other.bit_index), ref_ptr(other.ref_ptr) {}
 
-template<size_t Bits>
-inline BitArray<Bits>::BitArrayRef::operator uint64_t() const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator uint64_t() const {
 	uint64_t val;
 	if constexpr (64 % Bits == 0) {	// elem only in 1 word
 		val = *place_ptr >> (64 - bit_index - Bits);
@@ -659,122 +4188,133 @@ inline BitArray<Bits>::BitArrayRef::operator uint64_t() const {
 		}
 	}
 
-	return val & ref_ptr->mask_;
+	return val & bitarray_detail::mask_of<Bits>();
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator=(const uint64_t& other) {
-	if (other > ref_ptr->mask_) {
-		throw std::overflow_error("Overflow");
-	}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator=(const uint64_t& other) {
+	store(fit(other, other > bitarray_detail::mask_of<Bits>(), bitarray_detail::mask_of<Bits>()));
+	return *this;
+}
 
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void BitArray<Bits, InlineWords, Overflow>::BitArrayRef::store(uint64_t val) {
+	if constexpr (Bits == 1) {
+		ref_ptr->rank_touch((place_ptr - ref_ptr->memory_) * 64 + bit_index);
+	}
 	if constexpr (64 % Bits == 0) {	// only in 1 word
 		*place_ptr &= ~(((uint64_t(1) << Bits) - 1)
 			<< (64 - bit_index - Bits));	// delete old value
-		*place_ptr |= other << (64 - bit_index - Bits);	// set new value
+		*place_ptr |= val << (64 - bit_index - Bits);	// set new value
 	}
 	else {	// can be in 2 words
 		if (bit_index + Bits <= 64) {	// in 1 word
 			*place_ptr &= ~(((uint64_t(1) << Bits) - 1)
 				<< (64 - bit_index - Bits));	// delete old value
-			*place_ptr |= other << (64 - bit_index - Bits);	// set new value
+			*place_ptr |= val << (64 - bit_index - Bits);	// set new value
 		}
 		else {	// in 2 words
 			const int first_len = 64 - bit_index;
 			const int second_len = Bits - first_len;
 			*place_ptr &= ~((uint64_t(1) << first_len) - 1);	// del first part
-			*place_ptr |= other >> second_len;	// set first part value
+			*place_ptr |= val >> second_len;	// set first part value
 			*(place_ptr + 1) &= ~(((uint64_t(1) << second_len) - 1) << (64 - second_len)); // del second value
-			*(place_ptr + 1) |= other << (64 - second_len);
+			*(place_ptr + 1) |= val << (64 - second_len);
 		}
 	}
+}
 
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator=(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref) {
+	store(static_cast<uint64_t>(other_ref));
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator+=(const uint64_t& other) {
-	*this = static_cast<uint64_t>(*this) + other;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator+=(const uint64_t& other) {
+	const uint64_t val = static_cast<uint64_t>(*this);
+	store(fit(val + other, other > bitarray_detail::mask_of<Bits>() - val, bitarray_detail::mask_of<Bits>()));
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator-=(const uint64_t& other) {
-	*this = static_cast<uint64_t>(*this) - other;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator-=(const uint64_t& other) {
+	const uint64_t val = static_cast<uint64_t>(*this);
+	store(fit(val - other, other > val, 0));
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator*=(const uint64_t& other) {
-	*this = static_cast<uint64_t>(*this) * other;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator*=(const uint64_t& other) {
+	const uint64_t val = static_cast<uint64_t>(*this);
+	store(fit(val * other, other != 0 && val > bitarray_detail::mask_of<Bits>() / other, bitarray_detail::mask_of<Bits>()));
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator/=(const uint64_t& other) {
-	*this = static_cast<uint64_t>(*this) / other;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator/=(const uint64_t& other) {
+	store(static_cast<uint64_t>(*this) / other);
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator++() {
-	*this = static_cast<uint64_t>(*this) + 1;
-	return *this;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator++() {
+	return *this += 1;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::BitArrayRef::operator--() {
-	*this = static_cast<uint64_t>(*this) - 1;
-	return *this;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef& BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator--() {
+	return *this -= 1;
 }
 
-template<size_t Bits>
-inline uint64_t BitArray<Bits>::BitArrayRef::operator++(int) {
-	uint64_t val = static_cast<uint64_t>(*this);
-	*this = static_cast<uint64_t>(*this) + 1;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator++(int) {
+	const uint64_t val = static_cast<uint64_t>(*this);
+	*this += 1;
 	return val;
 }
 
-template<size_t Bits>
-inline uint64_t BitArray<Bits>::BitArrayRef::operator--(int) {
-	uint64_t val = static_cast<uint64_t>(*this);
-	*this = static_cast<uint64_t>(*this) - 1;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator--(int) {
+	const uint64_t val = static_cast<uint64_t>(*this);
+	*this -= 1;
 	return val;
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::BitArrayRef::operator==(const BitArray<Bits>::BitArrayRef& other_ref) const {
-	return ref_ptr == other_ref.ref_ptr
-		&& place_ptr == other_ref.place_ptr
-		&& bit_index == other_ref.bit_index;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator==(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref) const {
+	return static_cast<uint64_t>(*this) == static_cast<uint64_t>(other_ref);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::BitArrayRef::operator!=(const BitArray<Bits>::BitArrayRef& other_ref) const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::BitArrayRef::operator!=(const BitArray<Bits, InlineWords, Overflow>::BitArrayRef& other_ref) const {
 	return !(*this == other_ref);
 }
 
 // iterator
-template<size_t Bits>
-inline BitArray<Bits>::iterator::iterator(BitArray<Bits>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index) : bit_ref(BitArray<Bits>::BitArrayRef(ref_ptr, place_ptr, bit_index)) {}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::iterator::iterator(BitArray<Bits, InlineWords, Overflow>* ref_ptr, uint64_t* place_ptr, uint32_t bit_index) : bit_ref(BitArray<Bits, InlineWords, Overflow>::BitArrayRef(ref_ptr, place_ptr, bit_index)) {}
 
-template<size_t Bits>
-inline BitArray<Bits>::iterator::iterator() : bit_ref(BitArray<Bits>::BitArrayRef(nullptr, nullptr, 0)) {}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::iterator::iterator() : bit_ref(BitArray<Bits, InlineWords, Overflow>::BitArrayRef(nullptr, nullptr, 0)) {}
 
-template<size_t Bits>
-inline BitArray<Bits>::iterator::iterator(const BitArray<Bits>::iterator& other_it) : bit_ref(other_it.bit_ref) {}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::iterator::iterator(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) : bit_ref(other_it.bit_ref) {}
 
-template<size_t Bits>
-inline typename BitArray<Bits>::BitArrayRef& BitArray<Bits>::iterator::operator*() {
-	if (*this >= bit_ref.ref_ptr->end()) {
-		throw std::out_of_range("Out of range");
-	}
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::iterator::operator*() const {
+	assert(bit_ref.ref_ptr != nullptr && *this >= bit_ref.ref_ptr->begin() && *this < bit_ref.ref_ptr->end());
 
 	return bit_ref;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator++() {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::BitArrayRef BitArray<Bits, InlineWords, Overflow>::iterator::operator[](difference_type value) const {
+	return *(*this + value);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator& BitArray<Bits, InlineWords, Overflow>::iterator::operator++() {
 	bit_ref.bit_index += Bits;
 	
 	if (bit_ref.bit_index >= 64) {
@@ -785,8 +4325,8 @@ inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator++()
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator--() {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator& BitArray<Bits, InlineWords, Overflow>::iterator::operator--() {
 	if (bit_ref.bit_index < Bits) {
 		bit_ref.place_ptr -= 1;
 		bit_ref.bit_index = 64 - (Bits - bit_ref.bit_index);
@@ -798,36 +4338,43 @@ inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator--()
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator+=(const uint64_t& val) {
-	const size_t bits = bit_ref.bit_index + val * Bits;
-	bit_ref.place_ptr += bits / 64;
-	bit_ref.bit_index = bits % 64;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::iterator::operator++(int) {
+	iterator it(*this);
+	++(*this);
+	return it;
+}
 
-	return *this;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::iterator::operator--(int) {
+	iterator it(*this);
+	--(*this);
+	return it;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator-=(const uint64_t& val) {
-	const size_t bits = val * Bits;
-	if (bits <= bit_ref.bit_index) {
-		bit_ref.bit_index -= bits;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator& BitArray<Bits, InlineWords, Overflow>::iterator::operator+=(difference_type val) {
+	const difference_type bits = static_cast<difference_type>(bit_ref.bit_index) + val * static_cast<difference_type>(Bits);
+	difference_type words = bits / 64;
+	difference_type rest = bits % 64;
+	if (rest < 0) {	// floor for negative shifts
+		rest += 64;
+		--words;
 	}
-	else {
-		const size_t diff = bits - bit_ref.bit_index;
 
-		bit_ref.place_ptr -= (diff + 63) / 64;
-		bit_ref.bit_index = 64 - (diff % 64);
-		if (bit_ref.bit_index == 64) {
-			bit_ref.bit_index = 0;
-		}
-	}
+	bit_ref.place_ptr += words;
+	bit_ref.bit_index = static_cast<uint32_t>(rest);
 
 	return *this;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator=(const BitArray<Bits>::iterator& other_it) {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator& BitArray<Bits, InlineWords, Overflow>::iterator::operator-=(difference_type val) {
+	return *this += -val;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator& BitArray<Bits, InlineWords, Overflow>::iterator::operator=(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) {
 	bit_ref.place_ptr = other_it.bit_ref.place_ptr;
 	bit_ref.bit_index = other_it.bit_ref.bit_index;
 	bit_ref.ref_ptr = other_it.bit_ref.ref_ptr;
@@ -835,52 +4382,42 @@ inline typename BitArray<Bits>::iterator& BitArray<Bits>::iterator::operator=(co
 	return *this;
 }
 
-template<size_t Bits>
-inline size_t BitArray<Bits>::iterator::operator-(BitArray<Bits>::iterator other_it) {
-	//static_assert(this->bit_ref.ref_ptr == other_it.bit_ref.ref_ptr, "iterators must be from the same BitArray");
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator::difference_type BitArray<Bits, InlineWords, Overflow>::iterator::operator-(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
+	assert(bit_ref.ref_ptr == other_it.bit_ref.ref_ptr);
 	
-	return ((this->bit_ref.place_ptr - other_it.bit_ref.place_ptr) * 64 
-		+ (this->bit_ref.bit_index - other_it.bit_ref.bit_index)) / Bits;
+	return ((bit_ref.place_ptr - other_it.bit_ref.place_ptr) * 64
+		+ (static_cast<difference_type>(bit_ref.bit_index) - static_cast<difference_type>(other_it.bit_ref.bit_index)))
+		/ static_cast<difference_type>(Bits);
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator BitArray<Bits>::iterator::operator+(size_t value) const {
-	const size_t shift = bit_ref.bit_index + value * Bits;
-	return BitArray<Bits>::iterator(bit_ref.ref_ptr, bit_ref.place_ptr + shift / 64, shift % 64);
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::iterator::operator+(difference_type value) const {
+	iterator it(*this);
+	it += value;
+	return it;
 }
 
-template<size_t Bits>
-inline typename BitArray<Bits>::iterator BitArray<Bits>::iterator::operator-(size_t value) const {
-	BitArray<Bits>::iterator it(bit_ref.ref_ptr, bit_ref.place_ptr, bit_ref.bit_index);
-	const size_t shift = value * Bits;
-	if (shift <= bit_ref.bit_index) {
-		it.bit_ref.bit_index -= shift;
-	}
-	else {
-		const size_t diff = shift - bit_ref.bit_index;
-
-		it.bit_ref.place_ptr -= (diff + 63) / 64;
-		it.bit_ref.bit_index = 64 - (diff % 64);
-		if (it.bit_ref.bit_index == 64) {
-			it.bit_ref.bit_index = 0;
-		}
-	}
-
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::iterator BitArray<Bits, InlineWords, Overflow>::iterator::operator-(difference_type value) const {
+	iterator it(*this);
+	it += -value;
 	return it;
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator==(const BitArray<Bits>::iterator& other_it) const {
-	return bit_ref == other_it.bit_ref;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator==(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
+	return bit_ref.place_ptr == other_it.bit_ref.place_ptr
+		&& bit_ref.bit_index == other_it.bit_ref.bit_index;
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator!=(const BitArray<Bits>::iterator& other_it) const {
-	return bit_ref != other_it.bit_ref;
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator!=(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
+	return !(*this == other_it);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator<(const BitArray<Bits>::iterator& other_it) const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator<(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
 	assert(bit_ref.ref_ptr == other_it.bit_ref.ref_ptr);
 
 	return bit_ref.place_ptr < other_it.bit_ref.place_ptr
@@ -888,19 +4425,90 @@ inline bool BitArray<Bits>::iterator::operator<(const BitArray<Bits>::iterator&
 			&& bit_ref.bit_index < other_it.bit_ref.bit_index);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator>(const BitArray<Bits>::iterator& other_it) const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator>(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
 	return other_it < *this;
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator<=(const BitArray<Bits>::iterator& other_it) const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator<=(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
 	return !(other_it < *this);
 }
 
-template<size_t Bits>
-inline bool BitArray<Bits>::iterator::operator>=(const BitArray<Bits>::iterator& other_it) const {
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline bool BitArray<Bits, InlineWords, Overflow>::iterator::operator>=(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) const {
 	return !(*this < other_it);
 }
 
+// const_iterator
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::const_iterator::const_iterator() : it() {}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArray<Bits, InlineWords, Overflow>::const_iterator::const_iterator(const BitArray<Bits, InlineWords, Overflow>::iterator& other_it) : it(other_it) {}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::const_iterator::operator*() const {
+	return static_cast<uint64_t>(*it);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline uint64_t BitArray<Bits, InlineWords, Overflow>::const_iterator::operator[](difference_type value) const {
+	return static_cast<uint64_t>(it[value]);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator& BitArray<Bits, InlineWords, Overflow>::const_iterator::operator++() {
+	++it;
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator& BitArray<Bits, InlineWords, Overflow>::const_iterator::operator--() {
+	--it;
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::const_iterator::operator++(int) {
+	return it++;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::const_iterator::operator--(int) {
+	return it--;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator& BitArray<Bits, InlineWords, Overflow>::const_iterator::operator+=(difference_type val) {
+	it += val;
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator& BitArray<Bits, InlineWords, Overflow>::const_iterator::operator-=(difference_type val) {
+	it -= val;
+	return *this;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::const_iterator::operator+(difference_type value) const {
+	return it + value;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator BitArray<Bits, InlineWords, Overflow>::const_iterator::operator-(difference_type value) const {
+	return it - value;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline typename BitArray<Bits, InlineWords, Overflow>::const_iterator::difference_type BitArray<Bits, InlineWords, Overflow>::const_iterator::operator-(const BitArray<Bits, InlineWords, Overflow>::const_iterator& other_it) const {
+	return it - other_it.it;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+inline void swap(BitArray<Bits, InlineWords, Overflow>& left, BitArray<Bits, InlineWords, Overflow>& right) noexcept {
+	left.swap(right);
+}
+
 #endif
\ No newline at end of file
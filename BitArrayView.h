@@ -0,0 +1,1445 @@
+#ifndef BITARRAYVIEW_H
+#define BITARRAYVIEW_H
+
+#include "BitArray.h"
+
+#include <type_traits>
+
+namespace bitarray_detail {
+	// the rank index of the BitArray<1> a writable view was made from, nothing otherwise; every write through the view
+	// (and its references) marks the index stale from the first changed bit, like the writes of BitArray itself
+	template<bool Enabled>
+	struct view_rank_link {
+		void rank_touch(const uint64_t*, size_t) const {
+		}
+	};
+
+	template<>
+	struct view_rank_link<true> {
+		rank_holder<true>* holder = nullptr;	// null for views of words without an index
+		const uint64_t* memory = nullptr;	// word 0 of the BitArray
+
+		void rank_touch(const uint64_t* place, size_t bit) const {	// bits from bit of place on may change
+			if (holder) {
+				holder->rank_touch(static_cast<size_t>(place - memory) * 64 + bit);
+			}
+		}
+	};
+}
+
+// non-owning view of Bits-bit packed elements in words it doesn't own (shared memory, file reads, part of a BitArray):
+// element i is at bit bit_offset + i * Bits counting from the high bit of words[0] (the BitArray layout)
+// Word = const uint64_t - read-only, uint64_t - elements can be written (BitArraySpan<Bits>)
+// constness is shallow like std::span: the view is a pointer, const members of a BitArraySpan write its elements
+// bulk algorithms run the BitArray kernels on the words in place when the elements are on the grid of the words
+// (bit offset is a multiple of Bits: views of a BitArray and all their subviews), other offsets go through
+// aligned blocks (funnel-shift copy in and, for writes, back)
+template<size_t Bits, typename Word = const uint64_t>
+class BitArrayView : private bitarray_detail::view_rank_link<Bits == 1 && !std::is_const_v<Word>> {
+public:
+	class reference;
+	class iterator;
+	class const_iterator;
+private:
+	static_assert(Bits >= 1 && Bits <= 63, "Bits must be in [1..63]");
+	static_assert(std::is_same_v<std::remove_const_t<Word>, uint64_t>, "Word must be uint64_t or const uint64_t");
+
+	static constexpr bool writable = !std::is_const_v<Word>;
+	static constexpr uint64_t mask_ = bitarray_detail::mask_of<Bits>();
+	static constexpr size_t group_bits = bitarray_detail::group_words<Bits> * 64;
+	static constexpr size_t block_elems = 4 * bitarray_detail::repack_block;
+	static constexpr size_t block_words = (block_elems * Bits + 63) / 64 + bitarray_detail::group_words<Bits> + 1;
+
+	using rank_link = bitarray_detail::view_rank_link<Bits == 1 && writable>;
+
+	Word* words_;	// start of a group of the given words => the grid of element positions is kept
+	size_t bit_;	// of element 0, < group_bits
+	size_t size_;
+
+	template<size_t, typename> friend class BitArrayView;
+
+	inline bool on_grid() const;
+	inline void check_range(size_t first, size_t count) const;
+	static void throw_index(size_t index);
+	inline reference reference_at(size_t index) const;
+	inline uint64_t get_at(size_t index) const;
+	inline void set_at(size_t index, uint64_t val) const;
+
+	// f(memory, first, count, done) for the elements [from + done, from + done + count) of the view at
+	// [first, first + count) of memory, f returns false to stop; on the grid it's one call on the words,
+	// otherwise blocks are copied to a buffer (Write - and back after f)
+	template<bool Write, typename F> void for_blocks(size_t from, size_t count, F f) const;
+	// f(memory, other_memory, first, count, done): the same for [0, count) of both views, other at the same positions
+	template<bool Write, typename F> void for_block_pairs(const BitArrayView<Bits>& other, size_t count, F f) const;
+
+	// bit ranges: both memories at the same bit positions
+	static size_t first_difference(const uint64_t* left, const uint64_t* right, size_t bit, size_t count);	// count if none
+	template<bitarray_detail::word_op Op> static void apply_bits(uint64_t* memory, const uint64_t* other, size_t bit, size_t count);
+	static void flip_bits(uint64_t* memory, size_t bit, size_t count);
+	template<bitarray_detail::word_op Op> const BitArrayView& apply_words(const BitArrayView<Bits>& other) const;
+public:
+	// proxy of one element: the word and the bit it starts at (+ the rank index link of the view)
+	class reference : private rank_link {
+	private:
+		Word* place_ptr;
+		size_t bit_index;	// < 64
+
+		inline reference(Word* place_ptr, size_t bit_index, const rank_link& link);
+		friend class BitArrayView<Bits, Word>;
+		friend class BitArrayView<Bits, Word>::iterator;
+	public:
+		inline reference(const reference& other) = default;
+
+		inline operator uint64_t() const;
+		inline reference& operator=(uint64_t val);	// std::overflow_error if val doesn't fit Bits
+		inline reference& operator=(const reference& other);	// copies the value
+
+		friend inline void swap(reference left, reference right) {	// swaps values (std::sort, std::reverse)
+			const uint64_t tmp = left;
+			left = static_cast<uint64_t>(right);
+			right = tmp;
+		}
+	};
+
+	// random access iterator, dereference gives reference proxy
+	// keeps the word and the bit like BitArray::iterator => sequential access costs the same
+	class iterator {
+	private:
+		typename BitArrayView<Bits, Word>::reference bit_ref;
+
+		inline iterator(Word* place_ptr, size_t bit_index, const rank_link& link);
+		friend class BitArrayView<Bits, Word>;
+		friend class BitArrayView<Bits, Word>::const_iterator;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = typename BitArrayView<Bits, Word>::reference;
+
+		inline iterator();
+		inline iterator(const iterator& other_it);
+
+		inline reference operator*() const;
+		inline reference operator[](difference_type value) const;
+		inline iterator& operator++();	// prefix
+		inline iterator& operator--();	// prefix
+		inline iterator operator++(int);	// postfix
+		inline iterator operator--(int);	// postfix
+		inline iterator& operator+=(difference_type val);
+		inline iterator& operator-=(difference_type val);
+		inline iterator& operator=(const iterator& other_it);	// rebinds (reference= would copy the value)
+		inline iterator operator+(difference_type value) const;
+		inline iterator operator-(difference_type value) const;
+		inline difference_type operator-(const iterator& other_it) const;
+		inline bool operator==(const iterator& other_it) const;
+		inline bool operator!=(const iterator& other_it) const;
+		inline bool operator<(const iterator& other_it) const;
+		inline bool operator>(const iterator& other_it) const;
+		inline bool operator<=(const iterator& other_it) const;
+		inline bool operator>=(const iterator& other_it) const;
+
+		friend inline iterator operator+(difference_type value, const iterator& it) {
+			return it + value;
+		}
+	};
+
+	// random access iterator, dereference gives the value
+	class const_iterator {
+	private:
+		iterator it;
+		friend class BitArrayView<Bits, Word>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = uint64_t;
+
+		inline const_iterator();
+		inline const_iterator(const iterator& other_it);	// iterator => const_iterator
+
+		inline uint64_t operator*() const;
+		inline uint64_t operator[](difference_type value) const;
+		inline const_iterator& operator++();	// prefix
+		inline const_iterator& operator--();	// prefix
+		inline const_iterator operator++(int);	// postfix
+		inline const_iterator operator--(int);	// postfix
+		inline const_iterator& operator+=(difference_type val);
+		inline const_iterator& operator-=(difference_type val);
+		inline const_iterator operator+(difference_type value) const;
+		inline const_iterator operator-(difference_type value) const;
+		inline difference_type operator-(const const_iterator& other_it) const;
+
+		friend inline const_iterator operator+(difference_type value, const const_iterator& it) {
+			return it + value;
+		}
+		// friends => mixed iterator/const_iterator comparison
+		friend inline bool operator==(const const_iterator& left, const const_iterator& right) {
+			return left.it == right.it;
+		}
+		friend inline bool operator!=(const const_iterator& left, const const_iterator& right) {
+			return left.it != right.it;
+		}
+		friend inline bool operator<(const const_iterator& left, const const_iterator& right) {
+			return left.it < right.it;
+		}
+		friend inline bool operator>(const const_iterator& left, const const_iterator& right) {
+			return left.it > right.it;
+		}
+		friend inline bool operator<=(const const_iterator& left, const const_iterator& right) {
+			return left.it <= right.it;
+		}
+		friend inline bool operator>=(const const_iterator& left, const const_iterator& right) {
+			return left.it >= right.it;
+		}
+	};
+
+	inline BitArrayView();
+	inline BitArrayView(Word* words, size_t bit_offset, size_t count);
+	template<typename OtherWord, typename = std::enable_if_t<!writable && !std::is_const_v<OtherWord>>>
+	inline BitArrayView(const BitArrayView<Bits, OtherWord>& other);	// BitArraySpan => read-only view
+	// the whole BitArray; writes through a writable view of BitArray<1> (its subviews, references and iterators)
+	// mark the rank index stale, like the writes of the BitArray
+	template<size_t InlineWords, BitArrayOverflow Overflow>
+	inline BitArrayView(const BitArray<Bits, InlineWords, Overflow>& array);	// read-only views only
+	template<size_t InlineWords, BitArrayOverflow Overflow>
+	inline BitArrayView(BitArray<Bits, InlineWords, Overflow>& array);
+
+	inline size_t size() const;
+	inline bool empty() const;
+	inline Word* data() const;	// word of element 0 is data()[bit_offset() / 64]
+	inline size_t bit_offset() const;
+	inline BitArrayView subview(size_t first, size_t count) const;	// std::out_of_range, no copy
+
+	inline iterator begin() const;
+	inline iterator end() const;
+	inline const_iterator cbegin() const;
+	inline const_iterator cend() const;
+
+	// at - std::out_of_range, operator[] - checked only in debug builds (assert)
+	// unchecked_get/unchecked_set - caller guarantees index < size() and val <= mask (assert in debug builds)
+	inline reference front() const;
+	inline reference back() const;
+	inline reference at(size_t index) const;
+	inline reference operator[](size_t index) const;
+	inline uint64_t unchecked_get(size_t index) const;
+	inline void unchecked_set(size_t index, uint64_t val) const;
+
+	template<typename T> void unpack_to(T* out, size_t first, size_t count) const;
+	template<typename T> void pack_from(const T* in, size_t first, size_t count) const;	// checked before any write
+
+	// writable views: same as BitArray, throw_error checks all the elements before any change
+	void fill(uint64_t val) const;
+	void fill(size_t first, size_t count, uint64_t val) const;
+	template<BitArrayOverflow Policy = BitArrayOverflow::throw_error> void add_scalar(uint64_t val) const;
+	template<BitArrayOverflow Policy = BitArrayOverflow::throw_error> void add_scalar(size_t first, size_t count, uint64_t val) const;
+	template<BitArrayOverflow Policy = BitArrayOverflow::throw_error> void sub_scalar(uint64_t val) const;
+	template<BitArrayOverflow Policy = BitArrayOverflow::throw_error> void sub_scalar(size_t first, size_t count, uint64_t val) const;
+	void shift_right_all(size_t shift) const;
+	void shift_right_all(size_t first, size_t count, size_t shift) const;
+	template<BitArrayOverflow Policy = BitArrayOverflow::throw_error> void add(const BitArrayView<Bits>& other) const;	// same size
+
+	// search (see BitArray)
+	size_t find(uint64_t val, size_t from = 0) const;
+	size_t find_first_not(uint64_t val, size_t from = 0) const;
+	template<typename Pred> size_t find_if(Pred pred, size_t from = 0) const;
+	size_t count(uint64_t val) const;
+	size_t count_if_less(uint64_t threshold) const;
+	size_t mismatch(const BitArrayView<Bits>& other) const;	// first differing index, the smaller size if none
+	size_t min_width() const;
+
+	// sorting goes through an aligned copy of the elements (the BitArray sort kernels start at word 0)
+	void sort() const;
+	size_t lower_bound(uint64_t val) const;
+	size_t upper_bound(uint64_t val) const;
+	std::pair<size_t, size_t> equal_range(uint64_t val) const;
+
+	// reductions and prefix sums (see BitArray)
+	uint64_t sum() const;
+	uint64_t sum(size_t first, size_t count) const;
+	uint64_t min() const;
+	uint64_t min(size_t first, size_t count) const;
+	uint64_t max() const;
+	uint64_t max(size_t first, size_t count) const;
+	std::pair<uint64_t, uint64_t> minmax() const;
+	std::pair<uint64_t, uint64_t> minmax(size_t first, size_t count) const;
+	uint64_t exclusive_scan(uint64_t* out, uint64_t init = 0) const;
+	uint64_t exclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init = 0) const;
+	uint64_t inclusive_scan(uint64_t* out, uint64_t init = 0) const;
+	uint64_t inclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init = 0) const;
+
+	// bitwise algebra over the bits of the views (writable views), sizes must match
+	const BitArrayView& operator&=(const BitArrayView<Bits>& other) const;
+	const BitArrayView& operator|=(const BitArrayView<Bits>& other) const;
+	const BitArrayView& operator^=(const BitArrayView<Bits>& other) const;
+	const BitArrayView& andnot(const BitArrayView<Bits>& other) const;	// this & ~other
+	const BitArrayView& flip() const;	// every element = mask - element
+
+	// Bits == 1 only (bitset), shift_left/shift_right are writable views only
+	size_t count() const;
+	bool any() const;
+	bool all() const;
+	bool none() const;
+	void shift_left(size_t n) const;
+	void shift_right(size_t n) const;
+
+	// batched random access, all indices (and values) are checked before any element is touched
+	void gather(const size_t* idx, size_t n, uint64_t* out,
+		BitArrayBatchOrder order = BitArrayBatchOrder::as_given,
+		size_t prefetch_distance = bitarray_detail::batch_prefetch_distance) const;
+	void scatter(const size_t* idx, const uint64_t* vals, size_t n,
+		BitArrayBatchOrder order = BitArrayBatchOrder::as_given,
+		size_t prefetch_distance = bitarray_detail::batch_prefetch_distance) const;
+};
+
+template<size_t Bits>
+using BitArraySpan = BitArrayView<Bits, uint64_t>;
+
+// implementation
+
+// BitArrayView
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::on_grid() const {
+	return bit_ % Bits == 0;
+}
+
+template<size_t Bits, typename Word>
+inline void BitArrayView<Bits, Word>::check_range(size_t first, size_t count) const {
+	if (first > size_ || count > size_ - first) {
+		throw std::out_of_range("Out of range");
+	}
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::throw_index(size_t index) {
+	throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::reference_at(size_t index) const {
+	const size_t bit = bit_ + index * Bits;
+	return reference(words_ + bit / 64, bit % 64, *this);
+}
+
+template<size_t Bits, typename Word>
+inline uint64_t BitArrayView<Bits, Word>::get_at(size_t index) const {
+	return bitarray_detail::read_bits(words_, bit_ + index * Bits, Bits) >> (64 - Bits);
+}
+
+template<size_t Bits, typename Word>
+inline void BitArrayView<Bits, Word>::set_at(size_t index, uint64_t val) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+
+	this->rank_touch(words_, bit_ + index * Bits);
+	bitarray_detail::write_bits(words_, bit_ + index * Bits, Bits, val << (64 - Bits));
+}
+
+template<size_t Bits, typename Word>
+template<bool Write, typename F>
+void BitArrayView<Bits, Word>::for_blocks(size_t from, size_t count, F f) const {
+	using memory_type = std::conditional_t<Write, uint64_t*, const uint64_t*>;
+	if constexpr (Write) {
+		this->rank_touch(words_, bit_ + from * Bits);
+	}
+	if (on_grid()) {	// kernels work on the words in place
+		f(const_cast<memory_type>(words_), bit_ / Bits + from, count, size_t(0));
+		return;
+	}
+
+	uint64_t block[block_words]{};
+	for (size_t done{}; done < count; done += block_elems) {
+		const size_t n = count - done < block_elems ? count - done : block_elems;
+		const size_t bit = bit_ + (from + done) * Bits;
+		bitarray_detail::move_bits(block, 0, words_, bit, n * Bits);
+		const bool more = f(static_cast<memory_type>(block), size_t(0), n, done);
+		if constexpr (Write) {
+			bitarray_detail::move_bits(const_cast<uint64_t*>(words_), bit, block, 0, n * Bits);
+		}
+		if (!more) {
+			return;
+		}
+	}
+}
+
+// on the grid the block of this is read in place (other goes to its positions), otherwise both are copied
+template<size_t Bits, typename Word>
+template<bool Write, typename F>
+void BitArrayView<Bits, Word>::for_block_pairs(const BitArrayView<Bits>& other, size_t count, F f) const {
+	using memory_type = std::conditional_t<Write, uint64_t*, const uint64_t*>;
+	if constexpr (Write) {
+		this->rank_touch(words_, bit_);
+	}
+	if (on_grid() && other.bit_ == bit_) {	// same layout
+		f(const_cast<memory_type>(words_), other.words_, bit_ / Bits, count, size_t(0));
+		return;
+	}
+
+	uint64_t block[block_words]{};
+	uint64_t other_block[block_words]{};
+	for (size_t done{}; done < count; done += block_elems) {
+		const size_t n = count - done < block_elems ? count - done : block_elems;
+		memory_type memory = block;
+		size_t first = 0;
+		if (on_grid()) {
+			const size_t index = bit_ / Bits + done;
+			memory = const_cast<memory_type>(words_) + index / bitarray_detail::group_elems<Bits> * bitarray_detail::group_words<Bits>;
+			first = index % bitarray_detail::group_elems<Bits>;
+		}
+		else {
+			bitarray_detail::move_bits(block, 0, words_, bit_ + done * Bits, n * Bits);
+		}
+		bitarray_detail::move_bits(other_block, first * Bits, other.words_, other.bit_ + done * Bits, n * Bits);
+
+		const bool more = f(memory, static_cast<const uint64_t*>(other_block), first, n, done);
+		if constexpr (Write) {
+			if (!on_grid()) {
+				bitarray_detail::move_bits(const_cast<uint64_t*>(words_), bit_ + done * Bits, block, 0, n * Bits);
+			}
+		}
+		if (!more) {
+			return;
+		}
+	}
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::first_difference(const uint64_t* left, const uint64_t* right, size_t bit, size_t count) {
+	size_t done = 0;
+	if (count && bit % 64 != 0) {	// head of the first word
+		const size_t len = 64 - bit % 64 < count ? 64 - bit % 64 : count;
+		const uint64_t diff = bitarray_detail::read_bits(left, bit, len) ^ bitarray_detail::read_bits(right, bit, len);
+		if (diff) {
+			return bitarray_detail::leading_zeros(diff);
+		}
+		done = len;
+	}
+
+	const size_t word = (bit + done) / 64;
+	const size_t words = (count - done) / 64;
+	const size_t differs = bitarray_detail::mismatch_words(left + word, right + word, words);
+	if (differs != words) {
+		return done + differs * 64 + bitarray_detail::leading_zeros(left[word + differs] ^ right[word + differs]);
+	}
+	done += words * 64;
+
+	if (done < count) {	// tail
+		const uint64_t diff = bitarray_detail::read_bits(left, bit + done, count - done) ^ bitarray_detail::read_bits(right, bit + done, count - done);
+		if (diff) {
+			return done + bitarray_detail::leading_zeros(diff);
+		}
+	}
+	return count;
+}
+
+template<size_t Bits, typename Word>
+template<bitarray_detail::word_op Op>
+void BitArrayView<Bits, Word>::apply_bits(uint64_t* memory, const uint64_t* other, size_t bit, size_t count) {
+	if (count && bit % 64 != 0) {	// head of the first word
+		const size_t len = 64 - bit % 64 < count ? 64 - bit % 64 : count;
+		bitarray_detail::write_bits(memory, bit, len,
+			bitarray_detail::apply<Op>(bitarray_detail::read_bits(memory, bit, len), bitarray_detail::read_bits(other, bit, len)));
+		bit += len;
+		count -= len;
+	}
+
+	bitarray_detail::bitwise<Op>(memory + bit / 64, other + bit / 64, count / 64);
+	bit += count / 64 * 64;
+	count %= 64;
+
+	if (count) {	// tail
+		bitarray_detail::write_bits(memory, bit, count,
+			bitarray_detail::apply<Op>(bitarray_detail::read_bits(memory, bit, count), bitarray_detail::read_bits(other, bit, count)));
+	}
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::flip_bits(uint64_t* memory, size_t bit, size_t count) {
+	if (count && bit % 64 != 0) {	// head of the first word
+		const size_t len = 64 - bit % 64 < count ? 64 - bit % 64 : count;
+		bitarray_detail::write_bits(memory, bit, len, ~bitarray_detail::read_bits(memory, bit, len));
+		bit += len;
+		count -= len;
+	}
+
+	uint64_t* words = memory + bit / 64;
+	for (size_t i{}; i < count / 64; ++i) {
+		words[i] = ~words[i];
+	}
+	bit += count / 64 * 64;
+	count %= 64;
+
+	if (count) {	// tail
+		bitarray_detail::write_bits(memory, bit, count, ~bitarray_detail::read_bits(memory, bit, count));
+	}
+}
+
+template<size_t Bits, typename Word>
+template<bitarray_detail::word_op Op>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::apply_words(const BitArrayView<Bits>& other) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	if (other.size_ != size_) {
+		throw std::length_error("BitArrayView::bitwise | size mismatch");
+	}
+
+	for_block_pairs<true>(other, size_, [](uint64_t* memory, const uint64_t* other_memory, size_t first, size_t count, size_t) {
+		apply_bits<Op>(memory, other_memory, first * Bits, count * Bits);
+		return true;
+	});
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::BitArrayView() : words_(nullptr), bit_(0), size_(0) {}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::BitArrayView(Word* words, size_t bit_offset, size_t count)
+	: words_(words + bit_offset / group_bits * bitarray_detail::group_words<Bits>), bit_(bit_offset % group_bits), size_(count) {}
+
+template<size_t Bits, typename Word>
+template<typename OtherWord, typename>
+inline BitArrayView<Bits, Word>::BitArrayView(const BitArrayView<Bits, OtherWord>& other)
+	: words_(other.words_), bit_(other.bit_), size_(other.size_) {}
+
+template<size_t Bits, typename Word>
+template<size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArrayView<Bits, Word>::BitArrayView(const BitArray<Bits, InlineWords, Overflow>& array)
+	: words_(array.memory_), bit_(0), size_(array.size_) {
+	static_assert(!writable, "BitArraySpan needs a non-const BitArray");
+}
+
+template<size_t Bits, typename Word>
+template<size_t InlineWords, BitArrayOverflow Overflow>
+inline BitArrayView<Bits, Word>::BitArrayView(BitArray<Bits, InlineWords, Overflow>& array)
+	: words_(array.memory_), bit_(0), size_(array.size_) {
+	if constexpr (Bits == 1 && writable) {
+		this->holder = &array;
+		this->memory = array.memory_;
+	}
+}
+
+template<size_t Bits, typename Word>
+inline size_t BitArrayView<Bits, Word>::size() const {
+	return size_;
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::empty() const {
+	return !size_;
+}
+
+template<size_t Bits, typename Word>
+inline Word* BitArrayView<Bits, Word>::data() const {
+	return words_;
+}
+
+template<size_t Bits, typename Word>
+inline size_t BitArrayView<Bits, Word>::bit_offset() const {
+	return bit_;
+}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word> BitArrayView<Bits, Word>::subview(size_t first, size_t count) const {
+	check_range(first, count);
+	BitArrayView<Bits, Word> view(words_, bit_ + first * Bits, count);
+	static_cast<rank_link&>(view) = *this;	// the same BitArray
+	return view;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::begin() const {
+	return iterator(words_ + bit_ / 64, bit_ % 64, *this);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::end() const {
+	const size_t bit = bit_ + size_ * Bits;
+	return iterator(words_ + bit / 64, bit % 64, *this);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::cbegin() const {
+	return begin();
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::cend() const {
+	return end();
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::front() const {
+	return at(0);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::back() const {
+	if (!size_) {
+		throw_index(0);
+	}
+
+	return reference_at(size_ - 1);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::at(size_t index) const {
+	if (index >= size_) {
+		throw_index(index);
+	}
+
+	return reference_at(index);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::operator[](size_t index) const {
+	assert(index < size_);
+	return reference_at(index);
+}
+
+template<size_t Bits, typename Word>
+inline uint64_t BitArrayView<Bits, Word>::unchecked_get(size_t index) const {
+	assert(index < size_);
+	return get_at(index);
+}
+
+template<size_t Bits, typename Word>
+inline void BitArrayView<Bits, Word>::unchecked_set(size_t index, uint64_t val) const {
+	assert(index < size_ && val <= mask_);
+	set_at(index, val);
+}
+
+template<size_t Bits, typename Word>
+template<typename T>
+void BitArrayView<Bits, Word>::unpack_to(T* out, size_t first, size_t count) const {
+	check_range(first, count);
+	for_blocks<false>(first, count, [out](const uint64_t* memory, size_t from, size_t n, size_t done) {
+		bitarray_detail::unpack<Bits>(memory, from, n, out + done);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+template<typename T>
+void BitArrayView<Bits, Word>::pack_from(const T* in, size_t first, size_t count) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	check_range(first, count);
+	uint64_t all = 0;
+	for (size_t i{}; i < count; ++i) {
+		all |= static_cast<uint64_t>(in[i]);
+	}
+	if (all > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+
+	for_blocks<true>(first, count, [in](uint64_t* memory, size_t from, size_t n, size_t done) {
+		bitarray_detail::pack<Bits>(memory, from, n, in + done);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::fill(uint64_t val) const {
+	fill(0, size_, val);
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::fill(size_t first, size_t count, uint64_t val) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	check_range(first, count);
+	if (val > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+
+	for_blocks<true>(first, count, [val](uint64_t* memory, size_t from, size_t n, size_t) {
+		bitarray_detail::fill<Bits>(memory, from, n, val);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+template<BitArrayOverflow Policy>
+void BitArrayView<Bits, Word>::add_scalar(uint64_t val) const {
+	add_scalar<Policy>(0, size_, val);
+}
+
+template<size_t Bits, typename Word>
+template<BitArrayOverflow Policy>
+void BitArrayView<Bits, Word>::add_scalar(size_t first, size_t count, uint64_t val) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	check_range(first, count);
+	if (val > mask_) {
+		if constexpr (Policy == BitArrayOverflow::throw_error) {
+			throw std::overflow_error("Overflow");
+		}
+		else if constexpr (Policy == BitArrayOverflow::wrap) {
+			val &= mask_;
+		}
+		else {	// every element saturates
+			fill(first, count, mask_);
+			return;
+		}
+	}
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		bool overflows = false;
+		for_blocks<false>(first, count, [val, &overflows](const uint64_t* memory, size_t from, size_t n, size_t) {
+			overflows = bitarray_detail::add_sub_overflows<Bits, false, true>(const_cast<uint64_t*>(memory), nullptr, val, from, n);
+			return !overflows;
+		});
+		if (overflows) {
+			throw std::overflow_error("Overflow");
+		}
+	}
+
+	for_blocks<true>(first, count, [val](uint64_t* memory, size_t from, size_t n, size_t) {
+		bitarray_detail::add_sub<Bits, false, Policy == BitArrayOverflow::saturate, true>(memory, nullptr, val, from, n);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+template<BitArrayOverflow Policy>
+void BitArrayView<Bits, Word>::sub_scalar(uint64_t val) const {
+	sub_scalar<Policy>(0, size_, val);
+}
+
+template<size_t Bits, typename Word>
+template<BitArrayOverflow Policy>
+void BitArrayView<Bits, Word>::sub_scalar(size_t first, size_t count, uint64_t val) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	check_range(first, count);
+	if (val > mask_) {
+		if constexpr (Policy == BitArrayOverflow::throw_error) {
+			throw std::overflow_error("Overflow");
+		}
+		else if constexpr (Policy == BitArrayOverflow::wrap) {
+			val &= mask_;
+		}
+		else {	// every element saturates
+			fill(first, count, 0);
+			return;
+		}
+	}
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		bool overflows = false;
+		for_blocks<false>(first, count, [val, &overflows](const uint64_t* memory, size_t from, size_t n, size_t) {
+			overflows = bitarray_detail::add_sub_overflows<Bits, true, true>(const_cast<uint64_t*>(memory), nullptr, val, from, n);
+			return !overflows;
+		});
+		if (overflows) {
+			throw std::overflow_error("Overflow");
+		}
+	}
+
+	for_blocks<true>(first, count, [val](uint64_t* memory, size_t from, size_t n, size_t) {
+		bitarray_detail::add_sub<Bits, true, Policy == BitArrayOverflow::saturate, true>(memory, nullptr, val, from, n);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::shift_right_all(size_t shift) const {
+	shift_right_all(0, size_, shift);
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::shift_right_all(size_t first, size_t count, size_t shift) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	check_range(first, count);
+	if (shift >= Bits) {	// everything shifted out
+		fill(first, count, 0);
+	}
+	else if (shift) {
+		for_blocks<true>(first, count, [shift](uint64_t* memory, size_t from, size_t n, size_t) {
+			bitarray_detail::shift_right<Bits>(memory, from, n, shift);
+			return true;
+		});
+	}
+}
+
+template<size_t Bits, typename Word>
+template<BitArrayOverflow Policy>
+void BitArrayView<Bits, Word>::add(const BitArrayView<Bits>& other) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	if (other.size_ != size_) {
+		throw std::length_error("BitArrayView::add | size mismatch");
+	}
+	if constexpr (Policy == BitArrayOverflow::throw_error) {
+		bool overflows = false;
+		for_block_pairs<false>(other, size_, [&overflows](const uint64_t* memory, const uint64_t* other_memory, size_t first, size_t count, size_t) {
+			overflows = bitarray_detail::add_sub_overflows<Bits, false, false>(const_cast<uint64_t*>(memory), other_memory, 0, first, count);
+			return !overflows;
+		});
+		if (overflows) {
+			throw std::overflow_error("Overflow");
+		}
+	}
+
+	for_block_pairs<true>(other, size_, [](uint64_t* memory, const uint64_t* other_memory, size_t first, size_t count, size_t) {
+		bitarray_detail::add_sub<Bits, false, Policy == BitArrayOverflow::saturate, false>(memory, other_memory, 0, first, count);
+		return true;
+	});
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::find(uint64_t val, size_t from) const {
+	if (from >= size_ || val > mask_) {
+		return size_;
+	}
+
+	size_t found = size_;
+	for_blocks<false>(from, size_ - from, [val, from, &found](const uint64_t* memory, size_t first, size_t count, size_t done) {
+		const size_t index = bitarray_detail::find<Bits, bitarray_detail::lane_test::equal>(memory, first, first + count, val);
+		if (index != first + count) {
+			found = from + done + (index - first);
+			return false;
+		}
+		return true;
+	});
+	return found;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::find_first_not(uint64_t val, size_t from) const {
+	if (from >= size_) {
+		return size_;
+	}
+	if (val > mask_) {	// no element is equal
+		return from;
+	}
+
+	size_t found = size_;
+	for_blocks<false>(from, size_ - from, [val, from, &found](const uint64_t* memory, size_t first, size_t count, size_t done) {
+		const size_t index = bitarray_detail::find<Bits, bitarray_detail::lane_test::not_equal>(memory, first, first + count, val);
+		if (index != first + count) {
+			found = from + done + (index - first);
+			return false;
+		}
+		return true;
+	});
+	return found;
+}
+
+template<size_t Bits, typename Word>
+template<typename Pred>
+size_t BitArrayView<Bits, Word>::find_if(Pred pred, size_t from) const {
+	constexpr size_t block = 256;
+	uint64_t vals[block];
+	for (; from < size_; from += block) {
+		const size_t count = size_ - from < block ? size_ - from : block;
+		unpack_to(vals, from, count);
+		for (size_t i{}; i < count; ++i) {
+			if (pred(vals[i])) {
+				return from + i;
+			}
+		}
+	}
+
+	return size_;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::count(uint64_t val) const {
+	if (val > mask_) {
+		return 0;
+	}
+
+	size_t hits = 0;
+	for_blocks<false>(0, size_, [val, &hits](const uint64_t* memory, size_t first, size_t count, size_t) {
+		hits += bitarray_detail::count<Bits, bitarray_detail::lane_test::equal>(memory, first, first + count, val);
+		return true;
+	});
+	return hits;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::count_if_less(uint64_t threshold) const {
+	if (threshold > mask_) {	// every element is less
+		return size_;
+	}
+
+	size_t hits = 0;
+	for_blocks<false>(0, size_, [threshold, &hits](const uint64_t* memory, size_t first, size_t count, size_t) {
+		hits += bitarray_detail::count<Bits, bitarray_detail::lane_test::less>(memory, first, first + count, threshold);
+		return true;
+	});
+	return hits;
+}
+
+// the first differing bit of the same positions gives the index
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::mismatch(const BitArrayView<Bits>& other) const {
+	const size_t common = size_ < other.size_ ? size_ : other.size_;
+	size_t found = common;
+	for_block_pairs<false>(other, common, [&found](const uint64_t* memory, const uint64_t* other_memory, size_t first, size_t count, size_t done) {
+		const size_t bit = first_difference(memory, other_memory, first * Bits, count * Bits);
+		if (bit != count * Bits) {
+			found = done + bit / Bits;
+			return false;
+		}
+		return true;
+	});
+	return found;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::min_width() const {
+	return bitarray_detail::width_of(size_ ? max() : 0);
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::sort() const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	if (size_ < 2) {
+		return;
+	}
+
+	this->rank_touch(words_, bit_);
+	const size_t word_count = (size_ * Bits + 63) / 64;
+	std::vector<uint64_t> words(word_count, 0);
+	bitarray_detail::move_bits(words.data(), 0, words_, bit_, size_ * Bits);
+	bitarray_detail::sort<Bits>(words.data(), size_);
+	bitarray_detail::move_bits(words_, bit_, words.data(), 0, size_ * Bits);
+}
+
+// branch-free halving like the kernel, with gets at any bit offset
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::lower_bound(uint64_t val) const {
+	if (val > mask_) {
+		return size_;
+	}
+	if (on_grid()) {
+		const size_t first = bit_ / Bits;
+		return bitarray_detail::lower_bound<Bits>(words_, first, first + size_, val) - first;
+	}
+
+	size_t first = 0;
+	size_t count = size_;
+	while (count) {
+		const size_t half = count / 2;
+		const bool less = get_at(first + half) < val;
+		first = less ? first + half + 1 : first;
+		count = less ? count - half - 1 : half;
+	}
+	return first;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::upper_bound(uint64_t val) const {
+	return val >= mask_ ? size_ : lower_bound(val + 1);
+}
+
+template<size_t Bits, typename Word>
+std::pair<size_t, size_t> BitArrayView<Bits, Word>::equal_range(uint64_t val) const {
+	const size_t first = lower_bound(val);
+	if (first == size_ || get_at(first) != val) {
+		return { first, first };
+	}
+
+	return { first, upper_bound(val) };
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::sum() const {
+	return sum(0, size_);
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::sum(size_t first, size_t count) const {
+	check_range(first, count);
+	uint64_t total = 0;
+	for_blocks<false>(first, count, [&total](const uint64_t* memory, size_t from, size_t n, size_t) {
+		total += bitarray_detail::sum<Bits>(memory, from, n);
+		return true;
+	});
+	return total;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::min() const {
+	return minmax(0, size_).first;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::min(size_t first, size_t count) const {
+	return minmax(first, count).first;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::max() const {
+	return minmax(0, size_).second;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::max(size_t first, size_t count) const {
+	return minmax(first, count).second;
+}
+
+template<size_t Bits, typename Word>
+std::pair<uint64_t, uint64_t> BitArrayView<Bits, Word>::minmax() const {
+	return minmax(0, size_);
+}
+
+template<size_t Bits, typename Word>
+std::pair<uint64_t, uint64_t> BitArrayView<Bits, Word>::minmax(size_t first, size_t count) const {
+	check_range(first, count);
+	if (count == 0) {
+		throw std::out_of_range("Empty range");
+	}
+
+	std::pair<uint64_t, uint64_t> result{ mask_, 0 };
+	for_blocks<false>(first, count, [&result](const uint64_t* memory, size_t from, size_t n, size_t) {
+		const std::pair<uint64_t, uint64_t> block = bitarray_detail::minmax<Bits>(memory, from, n);
+		result.first = block.first < result.first ? block.first : result.first;
+		result.second = block.second > result.second ? block.second : result.second;
+		return true;
+	});
+	return result;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::exclusive_scan(uint64_t* out, uint64_t init) const {
+	return exclusive_scan(out, 0, size_, init);
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::exclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init) const {
+	check_range(first, count);
+	for_blocks<false>(first, count, [out, &init](const uint64_t* memory, size_t from, size_t n, size_t done) {
+		init = bitarray_detail::scan<Bits, false>(memory, from, n, out + done, init);
+		return true;
+	});
+	return init;
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::inclusive_scan(uint64_t* out, uint64_t init) const {
+	return inclusive_scan(out, 0, size_, init);
+}
+
+template<size_t Bits, typename Word>
+uint64_t BitArrayView<Bits, Word>::inclusive_scan(uint64_t* out, size_t first, size_t count, uint64_t init) const {
+	check_range(first, count);
+	for_blocks<false>(first, count, [out, &init](const uint64_t* memory, size_t from, size_t n, size_t done) {
+		init = bitarray_detail::scan<Bits, true>(memory, from, n, out + done, init);
+		return true;
+	});
+	return init;
+}
+
+template<size_t Bits, typename Word>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::operator&=(const BitArrayView<Bits>& other) const {
+	return apply_words<bitarray_detail::word_op::and_>(other);
+}
+
+template<size_t Bits, typename Word>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::operator|=(const BitArrayView<Bits>& other) const {
+	return apply_words<bitarray_detail::word_op::or_>(other);
+}
+
+template<size_t Bits, typename Word>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::operator^=(const BitArrayView<Bits>& other) const {
+	return apply_words<bitarray_detail::word_op::xor_>(other);
+}
+
+template<size_t Bits, typename Word>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::andnot(const BitArrayView<Bits>& other) const {
+	return apply_words<bitarray_detail::word_op::andnot>(other);
+}
+
+template<size_t Bits, typename Word>
+const BitArrayView<Bits, Word>& BitArrayView<Bits, Word>::flip() const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+
+	this->rank_touch(words_, bit_);
+	flip_bits(words_, bit_, size_ * Bits);
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+size_t BitArrayView<Bits, Word>::count() const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+
+	return sum();
+}
+
+template<size_t Bits, typename Word>
+bool BitArrayView<Bits, Word>::any() const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+
+	return find(1) != size_;
+}
+
+template<size_t Bits, typename Word>
+bool BitArrayView<Bits, Word>::all() const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+
+	return find(0) == size_;
+}
+
+template<size_t Bits, typename Word>
+bool BitArrayView<Bits, Word>::none() const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+
+	return !any();
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::shift_left(size_t n) const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+
+	if (n >= size_) {
+		fill(0);
+	}
+	else if (n) {
+		this->rank_touch(words_, bit_);
+		bitarray_detail::move_bits(words_, bit_ + n, words_, bit_, size_ - n);
+		fill(0, n, 0);
+	}
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::shift_right(size_t n) const {
+	static_assert(Bits == 1, "bitset operations need BitArrayView<1>");
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+
+	if (n >= size_) {
+		fill(0);
+	}
+	else if (n) {
+		this->rank_touch(words_, bit_);
+		bitarray_detail::move_bits(words_, bit_, words_, bit_ + n, size_ - n);
+		fill(size_ - n, n, 0);
+	}
+}
+
+// on the grid the kernels get indices of the words (+ first element), otherwise a plain loop
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::gather(const size_t* idx, size_t n, uint64_t* out, BitArrayBatchOrder order, size_t prefetch_distance) const {
+	size_t max_index = 0;
+	for (size_t i{}; i < n; ++i) {
+		max_index = idx[i] > max_index ? idx[i] : max_index;
+	}
+	if (n && max_index >= size_) {
+		throw_index(max_index);
+	}
+
+	if (!on_grid()) {
+		for (size_t i{}; i < n; ++i) {
+			out[i] = get_at(idx[i]);
+		}
+		return;
+	}
+
+	const size_t first = bit_ / Bits;
+	std::vector<size_t> shifted;
+	if (first) {
+		shifted.assign(idx, idx + n);
+		for (size_t& index : shifted) {
+			index += first;
+		}
+		idx = shifted.data();
+	}
+	if (order == BitArrayBatchOrder::by_word && n > 1) {
+		std::vector<size_t> sorted(n);
+		std::vector<size_t> positions(n);
+		bitarray_detail::batch_order<Bits>(idx, n, max_index + first, sorted.data(), positions.data());
+		std::vector<uint64_t> vals(n);
+		bitarray_detail::gather<Bits>(words_, sorted.data(), n, vals.data(), prefetch_distance);
+		for (size_t i{}; i < n; ++i) {
+			out[positions[i]] = vals[i];
+		}
+	}
+	else {
+		bitarray_detail::gather<Bits>(words_, idx, n, out, prefetch_distance);
+	}
+}
+
+template<size_t Bits, typename Word>
+void BitArrayView<Bits, Word>::scatter(const size_t* idx, const uint64_t* vals, size_t n, BitArrayBatchOrder order, size_t prefetch_distance) const {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	size_t max_index = 0;
+	uint64_t all = 0;
+	for (size_t i{}; i < n; ++i) {
+		max_index = idx[i] > max_index ? idx[i] : max_index;
+		all |= vals[i];
+	}
+	if (n && max_index >= size_) {
+		throw_index(max_index);
+	}
+	if (all > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+
+	if (!on_grid()) {
+		for (size_t i{}; i < n; ++i) {
+			set_at(idx[i], vals[i]);
+		}
+		return;
+	}
+
+	this->rank_touch(words_, bit_);
+	const size_t first = bit_ / Bits;
+	std::vector<size_t> shifted;
+	if (first) {
+		shifted.assign(idx, idx + n);
+		for (size_t& index : shifted) {
+			index += first;
+		}
+		idx = shifted.data();
+	}
+	if (order == BitArrayBatchOrder::by_word && n > 1) {
+		std::vector<size_t> sorted(n);
+		std::vector<size_t> positions(n);
+		bitarray_detail::batch_order<Bits>(idx, n, max_index + first, sorted.data(), positions.data());
+		std::vector<uint64_t> sorted_vals(n);
+		for (size_t i{}; i < n; ++i) {
+			sorted_vals[i] = vals[positions[i]];
+		}
+		bitarray_detail::scatter<Bits>(words_, sorted.data(), sorted_vals.data(), n, prefetch_distance);
+	}
+	else {
+		bitarray_detail::scatter<Bits>(words_, idx, vals, n, prefetch_distance);
+	}
+}
+
+// BitArrayView::reference
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::reference::reference(Word* place_ptr, size_t bit_index, const rank_link& link)
+	: rank_link(link), place_ptr(place_ptr), bit_index(bit_index) {}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::reference::operator uint64_t() const {
+	return bitarray_detail::read_bits(place_ptr, bit_index, Bits) >> (64 - Bits);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference& BitArrayView<Bits, Word>::reference::operator=(uint64_t val) {
+	static_assert(writable, "BitArrayView is read-only, use BitArraySpan");
+	if (val > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+
+	this->rank_touch(place_ptr, bit_index);
+	bitarray_detail::write_bits(place_ptr, bit_index, Bits, val << (64 - Bits));
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference& BitArrayView<Bits, Word>::reference::operator=(const reference& other) {
+	return *this = static_cast<uint64_t>(other);
+}
+
+// BitArrayView::iterator
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::iterator::iterator(Word* place_ptr, size_t bit_index, const rank_link& link)
+	: bit_ref(place_ptr, bit_index, link) {}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::iterator::iterator() : bit_ref(nullptr, 0, rank_link()) {}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::iterator::iterator(const iterator& other_it) : bit_ref(other_it.bit_ref) {}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::iterator::operator*() const {
+	assert(bit_ref.place_ptr != nullptr);
+
+	return bit_ref;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::reference BitArrayView<Bits, Word>::iterator::operator[](difference_type value) const {
+	return *(*this + value);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator& BitArrayView<Bits, Word>::iterator::operator++() {
+	bit_ref.bit_index += Bits;
+
+	if (bit_ref.bit_index >= 64) {
+		bit_ref.place_ptr += 1;
+		bit_ref.bit_index -= 64;
+	}
+
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator& BitArrayView<Bits, Word>::iterator::operator--() {
+	if (bit_ref.bit_index < Bits) {
+		bit_ref.place_ptr -= 1;
+		bit_ref.bit_index = 64 - (Bits - bit_ref.bit_index);
+	}
+	else {
+		bit_ref.bit_index -= Bits;
+	}
+
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::iterator::operator++(int) {
+	iterator it(*this);
+	++(*this);
+	return it;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::iterator::operator--(int) {
+	iterator it(*this);
+	--(*this);
+	return it;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator& BitArrayView<Bits, Word>::iterator::operator+=(difference_type val) {
+	const difference_type bits = static_cast<difference_type>(bit_ref.bit_index) + val * static_cast<difference_type>(Bits);
+	difference_type words = bits / 64;
+	difference_type rest = bits % 64;
+	if (rest < 0) {	// floor for negative shifts
+		rest += 64;
+		--words;
+	}
+
+	bit_ref.place_ptr += words;
+	bit_ref.bit_index = static_cast<size_t>(rest);
+
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator& BitArrayView<Bits, Word>::iterator::operator-=(difference_type val) {
+	return *this += -val;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator& BitArrayView<Bits, Word>::iterator::operator=(const iterator& other_it) {
+	static_cast<rank_link&>(bit_ref) = other_it.bit_ref;
+	bit_ref.place_ptr = other_it.bit_ref.place_ptr;
+	bit_ref.bit_index = other_it.bit_ref.bit_index;
+
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::iterator::operator+(difference_type value) const {
+	iterator it(*this);
+	it += value;
+	return it;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator BitArrayView<Bits, Word>::iterator::operator-(difference_type value) const {
+	iterator it(*this);
+	it += -value;
+	return it;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::iterator::difference_type BitArrayView<Bits, Word>::iterator::operator-(const iterator& other_it) const {
+	return ((bit_ref.place_ptr - other_it.bit_ref.place_ptr) * 64
+		+ (static_cast<difference_type>(bit_ref.bit_index) - static_cast<difference_type>(other_it.bit_ref.bit_index)))
+		/ static_cast<difference_type>(Bits);
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator==(const iterator& other_it) const {
+	return bit_ref.place_ptr == other_it.bit_ref.place_ptr
+		&& bit_ref.bit_index == other_it.bit_ref.bit_index;
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator!=(const iterator& other_it) const {
+	return !(*this == other_it);
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator<(const iterator& other_it) const {
+	return bit_ref.place_ptr < other_it.bit_ref.place_ptr
+		|| (bit_ref.place_ptr == other_it.bit_ref.place_ptr
+			&& bit_ref.bit_index < other_it.bit_ref.bit_index);
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator>(const iterator& other_it) const {
+	return other_it < *this;
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator<=(const iterator& other_it) const {
+	return !(other_it < *this);
+}
+
+template<size_t Bits, typename Word>
+inline bool BitArrayView<Bits, Word>::iterator::operator>=(const iterator& other_it) const {
+	return !(*this < other_it);
+}
+
+// BitArrayView::const_iterator
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::const_iterator::const_iterator() : it() {}
+
+template<size_t Bits, typename Word>
+inline BitArrayView<Bits, Word>::const_iterator::const_iterator(const iterator& other_it) : it(other_it) {}
+
+template<size_t Bits, typename Word>
+inline uint64_t BitArrayView<Bits, Word>::const_iterator::operator*() const {
+	return static_cast<uint64_t>(*it);
+}
+
+template<size_t Bits, typename Word>
+inline uint64_t BitArrayView<Bits, Word>::const_iterator::operator[](difference_type value) const {
+	return static_cast<uint64_t>(it[value]);
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator& BitArrayView<Bits, Word>::const_iterator::operator++() {
+	++it;
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator& BitArrayView<Bits, Word>::const_iterator::operator--() {
+	--it;
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::const_iterator::operator++(int) {
+	return it++;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::const_iterator::operator--(int) {
+	return it--;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator& BitArrayView<Bits, Word>::const_iterator::operator+=(difference_type val) {
+	it += val;
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator& BitArrayView<Bits, Word>::const_iterator::operator-=(difference_type val) {
+	it -= val;
+	return *this;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::const_iterator::operator+(difference_type value) const {
+	return it + value;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator BitArrayView<Bits, Word>::const_iterator::operator-(difference_type value) const {
+	return it - value;
+}
+
+template<size_t Bits, typename Word>
+inline typename BitArrayView<Bits, Word>::const_iterator::difference_type BitArrayView<Bits, Word>::const_iterator::operator-(const const_iterator& other_it) const {
+	return it - other_it.it;
+}
+
+#endif
@@ -0,0 +1,468 @@
+#ifndef BLOCKBITARRAY_H
+#define BLOCKBITARRAY_H
+
+#include "DynamicBitArray.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace bitarray_detail {
+	constexpr size_t block_stack_bytes = 8192;	// bigger block buffers go to the heap (BlockSize up to 65536)
+
+	// BlockSize values of scratch: an array on the stack when small, one heap allocation otherwise
+	template<typename T, size_t Size, bool Heap = (Size * sizeof(T) > block_stack_bytes)>
+	struct block_scratch {
+		T values[Size];
+
+		T* data() {
+			return values;
+		}
+	};
+
+	template<typename T, size_t Size>
+	struct block_scratch<T, Size, true> {
+		std::unique_ptr<T[]> values{ new T[Size] };	// not zeroed, every use writes first
+
+		T* data() {
+			return values.get();
+		}
+	};
+}
+
+// read-only compressed array (PFOR-like): every BlockSize elements are packed with their own width,
+// the width is the cheapest one counting the exceptions => a few outliers don't widen the whole array
+// in a block of width w the code 2^w - 1 marks an exception, its value is kept aside (lane + value)
+// random access: directory entry of the block + one runtime width get (+ a search among the block's exceptions)
+template<size_t BlockSize = 128>
+class BlockBitArray {
+public:
+	class const_iterator;
+private:
+	static_assert(BlockSize % 64 == 0 && BlockSize <= 65536, "BlockSize must be a multiple of 64 up to 65536");
+
+	struct block_entry {	// one per block + the end
+		uint64_t word : 56;	// first payload word
+		uint64_t bits : 8;
+		uint64_t exception;	// first exception of the block
+	};
+
+	std::pmr::vector<uint64_t> words_;	// payloads, each block from a new word
+	std::pmr::vector<block_entry> blocks_;
+	std::pmr::vector<uint16_t> exception_lanes_;	// ascending within a block
+	std::pmr::vector<uint64_t> exception_values_;
+	size_t size_;
+
+	static inline size_t choose_bits(const uint64_t* values, size_t count);
+	void append_block(const uint64_t* values, size_t count);
+	inline uint64_t exception_of(size_t block, size_t lane) const;
+	template<typename T> void decode_block(size_t block, T* out) const;	// all elements of the block
+	inline void check_index(size_t index) const;
+public:
+	// random access iterator, dereference gives the value
+	class const_iterator {
+	private:
+		const BlockBitArray<BlockSize>* ref_ptr;
+		size_t index;
+
+		inline const_iterator(const BlockBitArray<BlockSize>* ref_ptr, size_t index);
+		friend class BlockBitArray<BlockSize>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = uint64_t;
+
+		inline const_iterator();
+
+		inline uint64_t operator*() const;
+		inline uint64_t operator[](difference_type value) const;
+		inline const_iterator& operator++();	// prefix
+		inline const_iterator& operator--();	// prefix
+		inline const_iterator operator++(int);	// postfix
+		inline const_iterator operator--(int);	// postfix
+		inline const_iterator& operator+=(difference_type val);
+		inline const_iterator& operator-=(difference_type val);
+		inline const_iterator operator+(difference_type value) const;
+		inline const_iterator operator-(difference_type value) const;
+		inline difference_type operator-(const const_iterator& other_it) const;
+		inline bool operator==(const const_iterator& other_it) const;
+		inline bool operator!=(const const_iterator& other_it) const;
+		inline bool operator<(const const_iterator& other_it) const;
+		inline bool operator>(const const_iterator& other_it) const;
+		inline bool operator<=(const const_iterator& other_it) const;
+		inline bool operator>=(const const_iterator& other_it) const;
+
+		friend inline const_iterator operator+(difference_type value, const const_iterator& it) {
+			return it + value;
+		}
+	};
+
+	explicit BlockBitArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	template<typename T>
+	explicit BlockBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+	explicit BlockBitArray(const BitArray<Bits, InlineWords, Overflow>& other,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+
+	template<typename T> void assign(const T* in, size_t count);	// values up to 64 bits
+
+	inline size_t size() const;
+	inline bool empty() const;
+	inline std::pmr::memory_resource* resource() const;
+	inline size_t blocks() const;
+	inline size_t block_bits(size_t block) const;
+	inline size_t exceptions() const;
+	size_t memory_bytes() const;	// payload + directory + exceptions
+
+	inline const_iterator begin() const;
+	inline const_iterator end() const;
+	inline const_iterator cbegin() const;
+	inline const_iterator cend() const;
+
+	// at - std::out_of_range, operator[] - checked only in debug builds (assert)
+	inline uint64_t at(size_t index) const;
+	inline uint64_t operator[](size_t index) const;
+
+	// sequential decode: whole blocks through the unpack kernels of their width, then the exceptions are patched
+	template<typename T> void decode_to(T* out, size_t first, size_t count) const;
+};
+
+// implementation
+
+// BlockBitArray
+template<size_t BlockSize>
+BlockBitArray<BlockSize>::BlockBitArray(std::pmr::memory_resource* resource)
+	: words_(resource), blocks_(1, block_entry{ 0, 0, 0 }, resource),
+	exception_lanes_(resource), exception_values_(resource), size_(0) {}
+
+template<size_t BlockSize>
+template<typename T>
+BlockBitArray<BlockSize>::BlockBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource)
+	: BlockBitArray(resource) {
+	assign(vect.data(), vect.size());
+}
+
+template<size_t BlockSize>
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+BlockBitArray<BlockSize>::BlockBitArray(const BitArray<Bits, InlineWords, Overflow>& other, std::pmr::memory_resource* resource)
+	: BlockBitArray(resource) {
+	bitarray_detail::block_scratch<uint64_t, BlockSize> values;
+	for (size_t first{}; first < other.size(); first += BlockSize) {
+		const size_t count = other.size() - first < BlockSize ? other.size() - first : BlockSize;
+		other.unpack_to(values.data(), first, count);
+		append_block(values.data(), count);
+	}
+}
+
+// cost of width w: payload words + (lane, value) of every value >= 2^w - 1
+template<size_t BlockSize>
+inline size_t BlockBitArray<BlockSize>::choose_bits(const uint64_t* values, size_t count) {
+	size_t widths[65]{};	// values by bit length
+	size_t all_ones[65]{};	// values 2^w - 1 by w
+	for (size_t i{}; i < count; ++i) {
+		const size_t width = values[i] ? bitarray_detail::width_of(values[i]) : 0;
+		++widths[width];
+		all_ones[width] += (values[i] & (values[i] + 1)) == 0;
+	}
+
+	size_t best_bits = 64;
+	size_t best_cost = ~size_t(0);
+	size_t wider = count - widths[0];	// values longer than bits
+	for (size_t bits = 1; bits <= 64; ++bits) {
+		wider -= widths[bits];
+		const size_t exceptions = wider + all_ones[bits];
+		const size_t cost = (count * bits + 63) / 64 * sizeof(uint64_t)
+			+ exceptions * (sizeof(uint16_t) + sizeof(uint64_t));
+		if (cost < best_cost) {
+			best_cost = cost;
+			best_bits = bits;
+		}
+	}
+
+	return best_bits;
+}
+
+template<size_t BlockSize>
+void BlockBitArray<BlockSize>::append_block(const uint64_t* values, size_t count) {
+	const size_t bits = choose_bits(values, count);
+	const uint64_t escape = ~uint64_t(0) >> (64 - bits);
+
+	bitarray_detail::block_scratch<uint64_t, BlockSize> scratch;
+	uint64_t* codes = scratch.data();
+	for (size_t lane{}; lane < count; ++lane) {
+		if (values[lane] >= escape) {
+			exception_lanes_.push_back(static_cast<uint16_t>(lane));
+			exception_values_.push_back(values[lane]);
+			codes[lane] = escape;
+		}
+		else {
+			codes[lane] = values[lane];
+		}
+	}
+
+	const size_t first_word = words_.size();
+	words_.resize(first_word + (count * bits + 63) / 64, 0);
+	uint64_t* payload = words_.data() + first_word;
+	bitarray_detail::visit_width(bits, [&](auto width) {
+		bitarray_detail::pack<decltype(width)::value>(payload, 0, count, codes);
+	});
+
+	blocks_.back().bits = bits;
+	blocks_.push_back(block_entry{ words_.size(), 0, exception_values_.size() });
+	size_ += count;
+}
+
+template<size_t BlockSize>
+template<typename T>
+void BlockBitArray<BlockSize>::assign(const T* in, size_t count) {
+	words_.clear();
+	blocks_.assign(1, block_entry{ 0, 0, 0 });
+	exception_lanes_.clear();
+	exception_values_.clear();
+	size_ = 0;
+
+	bitarray_detail::block_scratch<uint64_t, BlockSize> scratch;
+	uint64_t* values = scratch.data();
+	for (size_t first{}; first < count; first += BlockSize) {
+		const size_t n = count - first < BlockSize ? count - first : BlockSize;
+		for (size_t i{}; i < n; ++i) {
+			values[i] = static_cast<uint64_t>(in[first + i]);
+		}
+		append_block(values, n);
+	}
+}
+
+template<size_t BlockSize>
+inline uint64_t BlockBitArray<BlockSize>::exception_of(size_t block, size_t lane) const {
+	const auto first = exception_lanes_.begin() + blocks_[block].exception;
+	const auto last = exception_lanes_.begin() + blocks_[block + 1].exception;
+	return exception_values_[std::lower_bound(first, last, lane) - exception_lanes_.begin()];
+}
+
+template<size_t BlockSize>
+template<typename T>
+void BlockBitArray<BlockSize>::decode_block(size_t block, T* out) const {
+	const size_t count = block + 1 < blocks() ? BlockSize : size_ - block * BlockSize;
+	const uint64_t* payload = words_.data() + blocks_[block].word;
+	bitarray_detail::visit_width(blocks_[block].bits, [&](auto width) {
+		bitarray_detail::unpack<decltype(width)::value>(payload, 0, count, out);
+	});
+
+	for (size_t i = blocks_[block].exception; i < blocks_[block + 1].exception; ++i) {	// patch
+		out[exception_lanes_[i]] = static_cast<T>(exception_values_[i]);
+	}
+}
+
+template<size_t BlockSize>
+inline void BlockBitArray<BlockSize>::check_index(size_t index) const {
+	if (index >= size_) {
+		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+	}
+}
+
+template<size_t BlockSize>
+inline size_t BlockBitArray<BlockSize>::size() const {
+	return size_;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::empty() const {
+	return size_ == 0;
+}
+
+template<size_t BlockSize>
+inline std::pmr::memory_resource* BlockBitArray<BlockSize>::resource() const {
+	return words_.get_allocator().resource();
+}
+
+template<size_t BlockSize>
+inline size_t BlockBitArray<BlockSize>::blocks() const {
+	return blocks_.size() - 1;
+}
+
+template<size_t BlockSize>
+inline size_t BlockBitArray<BlockSize>::block_bits(size_t block) const {
+	return blocks_[block].bits;
+}
+
+template<size_t BlockSize>
+inline size_t BlockBitArray<BlockSize>::exceptions() const {
+	return exception_values_.size();
+}
+
+template<size_t BlockSize>
+size_t BlockBitArray<BlockSize>::memory_bytes() const {
+	return words_.size() * sizeof(uint64_t) + blocks_.size() * sizeof(block_entry)
+		+ exception_lanes_.size() * sizeof(uint16_t) + exception_values_.size() * sizeof(uint64_t);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::begin() const {
+	return const_iterator(this, 0);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::end() const {
+	return const_iterator(this, size_);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::cbegin() const {
+	return begin();
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::cend() const {
+	return end();
+}
+
+template<size_t BlockSize>
+inline uint64_t BlockBitArray<BlockSize>::at(size_t index) const {
+	check_index(index);
+	return (*this)[index];
+}
+
+template<size_t BlockSize>
+inline uint64_t BlockBitArray<BlockSize>::operator[](size_t index) const {
+	assert(index < size_);
+	const size_t block = index / BlockSize;
+	const size_t lane = index % BlockSize;
+	const size_t bits = blocks_[block].bits;
+	const uint64_t escape = ~uint64_t(0) >> (64 - bits);
+
+	const uint64_t code = bitarray_detail::get(words_.data() + blocks_[block].word, lane, bits, escape);
+	return code != escape ? code : exception_of(block, lane);
+}
+
+template<size_t BlockSize>
+template<typename T>
+void BlockBitArray<BlockSize>::decode_to(T* out, size_t first, size_t count) const {
+	if (first > size_ || count > size_ - first) {
+		throw std::out_of_range("Out of range");
+	}
+
+	bitarray_detail::block_scratch<T, BlockSize> scratch;	// partial blocks only
+	T* buffer = scratch.data();
+	while (count) {
+		const size_t block = first / BlockSize;
+		const size_t lane = first % BlockSize;
+		const size_t block_size = block + 1 < blocks() ? BlockSize : size_ - block * BlockSize;
+		const size_t n = block_size - lane < count ? block_size - lane : count;
+
+		if (n == block_size) {	// whole block => straight to out
+			decode_block(block, out);
+		}
+		else {
+			decode_block(block, buffer);
+			std::copy(buffer + lane, buffer + lane + n, out);
+		}
+		out += n;
+		first += n;
+		count -= n;
+	}
+}
+
+// BlockBitArray::const_iterator
+template<size_t BlockSize>
+inline BlockBitArray<BlockSize>::const_iterator::const_iterator(const BlockBitArray<BlockSize>* ref_ptr, size_t index)
+	: ref_ptr(ref_ptr), index(index) {}
+
+template<size_t BlockSize>
+inline BlockBitArray<BlockSize>::const_iterator::const_iterator() : ref_ptr(nullptr), index(0) {}
+
+template<size_t BlockSize>
+inline uint64_t BlockBitArray<BlockSize>::const_iterator::operator*() const {
+	assert(ref_ptr != nullptr && index < ref_ptr->size());
+	return (*ref_ptr)[index];
+}
+
+template<size_t BlockSize>
+inline uint64_t BlockBitArray<BlockSize>::const_iterator::operator[](difference_type value) const {
+	return *(*this + value);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator& BlockBitArray<BlockSize>::const_iterator::operator++() {
+	++index;
+	return *this;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator& BlockBitArray<BlockSize>::const_iterator::operator--() {
+	--index;
+	return *this;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::const_iterator::operator++(int) {
+	const_iterator tmp = *this;
+	++index;
+	return tmp;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::const_iterator::operator--(int) {
+	const_iterator tmp = *this;
+	--index;
+	return tmp;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator& BlockBitArray<BlockSize>::const_iterator::operator+=(difference_type val) {
+	index += val;
+	return *this;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator& BlockBitArray<BlockSize>::const_iterator::operator-=(difference_type val) {
+	index -= val;
+	return *this;
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::const_iterator::operator+(difference_type value) const {
+	return const_iterator(ref_ptr, index + value);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator BlockBitArray<BlockSize>::const_iterator::operator-(difference_type value) const {
+	return const_iterator(ref_ptr, index - value);
+}
+
+template<size_t BlockSize>
+inline typename BlockBitArray<BlockSize>::const_iterator::difference_type BlockBitArray<BlockSize>::const_iterator::operator-(const const_iterator& other_it) const {
+	return static_cast<difference_type>(index) - static_cast<difference_type>(other_it.index);
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator==(const const_iterator& other_it) const {
+	return index == other_it.index;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator!=(const const_iterator& other_it) const {
+	return index != other_it.index;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator<(const const_iterator& other_it) const {
+	return index < other_it.index;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator>(const const_iterator& other_it) const {
+	return index > other_it.index;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator<=(const const_iterator& other_it) const {
+	return index <= other_it.index;
+}
+
+template<size_t BlockSize>
+inline bool BlockBitArray<BlockSize>::const_iterator::operator>=(const const_iterator& other_it) const {
+	return index >= other_it.index;
+}
+
+#endif
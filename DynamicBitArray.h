@@ -0,0 +1,420 @@
+#ifndef DYNAMICBITARRAY_H
+#define DYNAMICBITARRAY_H
+
+#include "BitArray.h"
+
+#include <memory_resource>
+
+namespace bitarray_detail {
+	constexpr size_t dynamic_max_bits = 64;
+
+	// f(std::integral_constant<size_t, Bits>) for bits in [1, 64]: one table jump per call,
+	// the kernels inside f are compiled for every width
+	template<typename F, size_t... Widths>
+	decltype(auto) visit_width(size_t bits, F& f, std::index_sequence<Widths...>) {
+		using result = decltype(f(std::integral_constant<size_t, 1>{}));
+		using entry = result(*)(F&);
+		static constexpr entry table[] = { [](F& g) -> result {
+			return g(std::integral_constant<size_t, Widths + 1>{});
+		}... };
+
+		return table[bits - 1](f);
+	}
+
+	template<typename F>
+	decltype(auto) visit_width(size_t bits, F&& f) {
+		return visit_width(bits, f, std::make_index_sequence<dynamic_max_bits>{});
+	}
+
+	// runtime width get/set (same layout as get<Bits>/set<Bits>)
+	inline uint64_t get(const uint64_t* memory, size_t index, size_t bits, uint64_t mask) {
+		const size_t bit = index * bits;
+		const uint64_t* place = memory + bit / 64;
+		const size_t offset = bit % 64;
+
+		if (offset + bits <= 64) {
+			return (*place >> (64 - offset - bits)) & mask;
+		}
+		return ((place[0] << (offset + bits - 64)) | (place[1] >> (128 - offset - bits))) & mask;
+	}
+
+	// val must be <= mask
+	inline void set(uint64_t* memory, size_t index, size_t bits, uint64_t mask, uint64_t val) {
+		const size_t bit = index * bits;
+		uint64_t* place = memory + bit / 64;
+		const size_t offset = bit % 64;
+
+		if (offset + bits <= 64) {	// in 1 word
+			const size_t shift = 64 - offset - bits;
+			*place = (*place & ~(mask << shift)) | (val << shift);
+		}
+		else {	// in 2 words
+			const size_t second_len = offset + bits - 64;
+			place[0] = (place[0] & ~(mask >> second_len)) | (val >> second_len);
+			place[1] = (place[1] & (~uint64_t(0) >> second_len)) | (val << (64 - second_len));
+		}
+	}
+
+	// repack<From, To> with both widths known at runtime: two table jumps per block of repack_block elements
+	inline void repack(const uint64_t* src, size_t from_bits, uint64_t* dst, size_t to_bits, size_t count) {
+		uint64_t buffer[repack_block];
+		for (size_t first{}; first < count; first += repack_block) {
+			const size_t n = count - first < repack_block ? count - first : repack_block;
+			visit_width(from_bits, [&](auto width) {
+				unpack<decltype(width)::value>(src, first, n, buffer);
+			});
+			visit_width(to_bits, [&](auto width) {
+				pack<decltype(width)::value>(dst, first, n, buffer);
+			});
+		}
+	}
+}
+
+// array with the element width (1..64 bits) chosen at runtime, same packing as BitArray<Bits>
+// element access computes with the width, bulk operations pick the kernels of the width once per call
+class DynamicBitArray {
+private:
+	size_t bits_;
+	uint64_t mask_;
+	std::pmr::vector<uint64_t> words_;	// bits after size are zero
+	size_t size_;
+
+	inline void check_index(size_t index) const;
+	inline void check_value(uint64_t val) const;
+	inline void check_range(size_t first, size_t count) const;
+	inline size_t words_for(size_t size) const;
+	static inline size_t words_for(size_t size, size_t bits);
+	void clear_tail();	// zeroes the bits after size in the last word
+public:
+	explicit DynamicBitArray(size_t bits, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	DynamicBitArray(size_t bits, size_t size, std::pmr::memory_resource* resource = std::pmr::get_default_resource());	// zeros
+	template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+	explicit DynamicBitArray(const BitArray<Bits, InlineWords, Overflow>& other,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());	// copies the words
+
+	inline size_t bits() const;
+	inline uint64_t mask() const;	// the biggest element
+	inline size_t size() const;
+	inline size_t capacity() const;
+	inline bool empty() const;
+	inline std::pmr::memory_resource* resource() const;
+
+	void resize(size_t new_size);	// new elements are zero
+	void reserve(size_t new_capacity);
+	void clear();
+	void shrink_to_fit();
+
+	void push_back(uint64_t val);
+	inline void pop_back();
+
+	// at/set - std::out_of_range, set/push_back - std::overflow_error for values > mask() (nothing is changed)
+	// operator[] - checked only in debug builds (assert), unchecked_* - caller guarantees index and value
+	inline uint64_t at(size_t index) const;
+	inline void set(size_t index, uint64_t val);
+	inline uint64_t operator[](size_t index) const;
+	inline uint64_t unchecked_get(size_t index) const;
+	inline void unchecked_set(size_t index, uint64_t val);
+
+	// bulk operations (kernels of bits())
+	template<typename T> void unpack_to(T* out, size_t first, size_t count) const;
+	template<typename T> void pack_from(const T* in, size_t count);
+	void fill(uint64_t val);
+	void fill(size_t first, size_t count, uint64_t val);
+	size_t find(uint64_t val, size_t from = 0) const;	// size() if none
+	size_t count(uint64_t val) const;
+
+	// width change: narrower - in place, std::overflow_error if an element doesn't fit (nothing is changed),
+	// wider - into new words
+	size_t min_width() const;	// bits of the biggest element (1 for an empty array)
+	void repack(size_t bits);
+	size_t repack_to_min_width();	// narrows and frees the unused words, returns the new bits()
+
+	// BitArray<Bits> with the same words, std::runtime_error if Bits != bits()
+	template<size_t Bits> BitArray<Bits> to_bit_array() const;
+};
+
+// implementation
+
+// DynamicBitArray
+inline DynamicBitArray::DynamicBitArray(size_t bits, std::pmr::memory_resource* resource)
+	: bits_(bits), mask_(0), words_(resource), size_(0) {
+	if (bits < 1 || bits > bitarray_detail::dynamic_max_bits) {
+		throw std::invalid_argument("DynamicBitArray | bits must be in [1..64]");
+	}
+	mask_ = ~uint64_t(0) >> (64 - bits);
+}
+
+inline DynamicBitArray::DynamicBitArray(size_t bits, size_t size, std::pmr::memory_resource* resource)
+	: DynamicBitArray(bits, resource) {
+	resize(size);
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+DynamicBitArray::DynamicBitArray(const BitArray<Bits, InlineWords, Overflow>& other, std::pmr::memory_resource* resource)
+	: DynamicBitArray(Bits, resource) {
+	words_.assign(other.memory_, other.memory_ + words_for(other.size_));
+	size_ = other.size_;
+}
+
+inline void DynamicBitArray::check_index(size_t index) const {
+	if (index >= size_) {
+		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+	}
+}
+
+inline void DynamicBitArray::check_value(uint64_t val) const {
+	if (val > mask_) {
+		throw std::overflow_error("Overflow");
+	}
+}
+
+inline void DynamicBitArray::check_range(size_t first, size_t count) const {
+	if (first > size_ || count > size_ - first) {
+		throw std::out_of_range("Out of range");
+	}
+}
+
+inline size_t DynamicBitArray::words_for(size_t size) const {
+	return words_for(size, bits_);
+}
+
+inline size_t DynamicBitArray::words_for(size_t size, size_t bits) {
+	return size / 64 * bits + (size % 64 * bits + 63) / 64;	// no overflow of size * bits
+}
+
+inline void DynamicBitArray::clear_tail() {
+	const size_t used = size_ % 64 * bits_ % 64;
+	if (used) {
+		words_[words_for(size_) - 1] &= ~(~uint64_t(0) >> used);
+	}
+}
+
+inline size_t DynamicBitArray::bits() const {
+	return bits_;
+}
+
+inline uint64_t DynamicBitArray::mask() const {
+	return mask_;
+}
+
+inline size_t DynamicBitArray::size() const {
+	return size_;
+}
+
+inline size_t DynamicBitArray::capacity() const {
+	return words_.capacity() * 64 / bits_;
+}
+
+inline bool DynamicBitArray::empty() const {
+	return size_ == 0;
+}
+
+inline std::pmr::memory_resource* DynamicBitArray::resource() const {
+	return words_.get_allocator().resource();
+}
+
+inline void DynamicBitArray::resize(size_t new_size) {
+	if (new_size < size_) {
+		size_ = new_size;
+		words_.resize(words_for(new_size));
+		clear_tail();
+	}
+	else {
+		words_.resize(words_for(new_size), 0);
+		size_ = new_size;
+	}
+}
+
+inline void DynamicBitArray::reserve(size_t new_capacity) {
+	words_.reserve(words_for(new_capacity));
+}
+
+inline void DynamicBitArray::clear() {
+	words_.clear();
+	size_ = 0;
+}
+
+inline void DynamicBitArray::shrink_to_fit() {
+	words_.shrink_to_fit();
+}
+
+inline void DynamicBitArray::push_back(uint64_t val) {
+	check_value(val);
+	if (words_for(size_ + 1) > words_.size()) {
+		words_.push_back(0);
+	}
+	bitarray_detail::set(words_.data(), size_++, bits_, mask_, val);
+}
+
+inline void DynamicBitArray::pop_back() {
+	if (size_) {
+		resize(size_ - 1);
+	}
+}
+
+inline uint64_t DynamicBitArray::at(size_t index) const {
+	check_index(index);
+	return bitarray_detail::get(words_.data(), index, bits_, mask_);
+}
+
+inline void DynamicBitArray::set(size_t index, uint64_t val) {
+	check_index(index);
+	check_value(val);
+	bitarray_detail::set(words_.data(), index, bits_, mask_, val);
+}
+
+inline uint64_t DynamicBitArray::operator[](size_t index) const {
+	assert(index < size_);
+	return bitarray_detail::get(words_.data(), index, bits_, mask_);
+}
+
+inline uint64_t DynamicBitArray::unchecked_get(size_t index) const {
+	assert(index < size_);
+	return bitarray_detail::get(words_.data(), index, bits_, mask_);
+}
+
+inline void DynamicBitArray::unchecked_set(size_t index, uint64_t val) {
+	assert(index < size_ && val <= mask_);
+	bitarray_detail::set(words_.data(), index, bits_, mask_, val);
+}
+
+template<typename T>
+void DynamicBitArray::unpack_to(T* out, size_t first, size_t count) const {
+	check_range(first, count);
+
+	const uint64_t* memory = words_.data();
+	bitarray_detail::visit_width(bits_, [&](auto width) {
+		bitarray_detail::unpack<decltype(width)::value>(memory, first, count, out);
+	});
+}
+
+template<typename T>
+void DynamicBitArray::pack_from(const T* in, size_t count) {
+	clear();
+	words_.resize(words_for(count), 0);
+	size_ = count;
+
+	uint64_t* memory = words_.data();
+	const uint64_t all = bitarray_detail::visit_width(bits_, [&](auto width) {
+		return bitarray_detail::pack<decltype(width)::value>(memory, 0, count, in);
+	});
+	if (all > mask_) {
+		clear();
+		throw std::overflow_error("Overflow");
+	}
+}
+
+inline void DynamicBitArray::fill(uint64_t val) {
+	fill(0, size_, val);
+}
+
+inline void DynamicBitArray::fill(size_t first, size_t count, uint64_t val) {
+	check_range(first, count);
+	check_value(val);
+
+	uint64_t* memory = words_.data();
+	bitarray_detail::visit_width(bits_, [&](auto width) {
+		bitarray_detail::fill<decltype(width)::value>(memory, first, count, val);
+	});
+}
+
+inline size_t DynamicBitArray::find(uint64_t val, size_t from) const {
+	if (val > mask_ || from >= size_) {
+		return size_;
+	}
+
+	const uint64_t* memory = words_.data();
+	const size_t last = size_;
+	return bitarray_detail::visit_width(bits_, [&](auto width) {
+		constexpr size_t Bits = decltype(width)::value;
+		if constexpr (Bits == 64) {	// a lane is a word
+			size_t i = from;
+			for (; i < last && memory[i] != val; ++i) {
+			}
+			return i;
+		}
+		else {
+			return bitarray_detail::find<Bits, bitarray_detail::lane_test::equal>(memory, from, last, val);
+		}
+	});
+}
+
+inline size_t DynamicBitArray::count(uint64_t val) const {
+	if (val > mask_) {
+		return 0;
+	}
+
+	const uint64_t* memory = words_.data();
+	const size_t last = size_;
+	return bitarray_detail::visit_width(bits_, [&](auto width) {
+		constexpr size_t Bits = decltype(width)::value;
+		if constexpr (Bits == 64) {
+			size_t hits = 0;
+			for (size_t i{}; i < last; ++i) {
+				hits += memory[i] == val;
+			}
+			return hits;
+		}
+		else {
+			return bitarray_detail::count<Bits, bitarray_detail::lane_test::equal>(memory, 0, last, val);
+		}
+	});
+}
+
+inline size_t DynamicBitArray::min_width() const {
+	const uint64_t* memory = words_.data();
+	const size_t last = size_;
+	return bitarray_detail::width_of(bitarray_detail::visit_width(bits_, [&](auto width) {
+		return bitarray_detail::or_all<decltype(width)::value>(memory, last);
+	}));
+}
+
+inline void DynamicBitArray::repack(size_t bits) {
+	if (bits < 1 || bits > bitarray_detail::dynamic_max_bits) {
+		throw std::invalid_argument("DynamicBitArray | bits must be in [1..64]");
+	}
+	if (bits == bits_) {
+		return;
+	}
+
+	if (bits < bits_) {
+		if (min_width() > bits) {
+			throw std::overflow_error("Overflow");
+		}
+		bitarray_detail::repack(words_.data(), bits_, words_.data(), bits, size_);
+		bits_ = bits;
+		mask_ = ~uint64_t(0) >> (64 - bits);
+		words_.resize(words_for(size_));
+		clear_tail();
+	}
+	else {
+		std::pmr::vector<uint64_t> words(words_for(size_, bits), 0, resource());
+		bitarray_detail::repack(words_.data(), bits_, words.data(), bits, size_);
+		words_.swap(words);
+		bits_ = bits;
+		mask_ = ~uint64_t(0) >> (64 - bits);
+	}
+}
+
+inline size_t DynamicBitArray::repack_to_min_width() {
+	repack(min_width());
+	shrink_to_fit();
+	return bits_;
+}
+
+template<size_t Bits>
+BitArray<Bits> DynamicBitArray::to_bit_array() const {
+	if (Bits != bits_) {
+		throw std::runtime_error("DynamicBitArray | Bits mismatch");
+	}
+
+	BitArray<Bits> copy;
+	copy.resize(size_);
+	for (size_t i{}; i < words_for(size_); ++i) {
+		copy.memory_[i] = words_[i];
+	}
+
+	return copy;
+}
+
+#endif
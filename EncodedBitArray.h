@@ -0,0 +1,605 @@
+#ifndef ENCODEDBITARRAY_H
+#define ENCODEDBITARRAY_H
+
+#include "BitArray.h"
+
+#include <type_traits>
+
+enum class BitArrayEncoding {
+	offset,	// uint64_t values in [base, base + 2^Bits), element = value - base
+	zigzag	// int64_t values in [base - 2^(Bits - 1), base + 2^(Bits - 1)), element = zigzag(value - base)
+};
+
+// frame of reference array: one base per array plus Bits-bit packed differences
+// (timestamps, ids from a known range, signed deltas) => Bits is the width of the spread, not of the values
+// new elements (resize) are base, values that don't fit => std::overflow_error (nothing is changed)
+template<size_t Bits, BitArrayEncoding Encoding = BitArrayEncoding::offset>
+class EncodedBitArray {
+public:
+	using value_type = std::conditional_t<Encoding == BitArrayEncoding::zigzag, int64_t, uint64_t>;
+
+	class reference;
+	class iterator;
+	class const_iterator;
+private:
+	BitArray<Bits> packed_;
+	value_type base_;
+
+	inline bool encode(value_type val, uint64_t& code) const;	// false => doesn't fit
+	inline uint64_t encode_checked(value_type val) const;
+	inline value_type decode(uint64_t code) const;
+	inline void check_index(size_t index) const;
+public:
+	// proxy of one element, reads/writes decoded values
+	class reference {
+	private:
+		EncodedBitArray<Bits, Encoding>* ref_ptr;
+		size_t index;
+
+		inline reference(EncodedBitArray<Bits, Encoding>* ref_ptr, size_t index);
+		friend class EncodedBitArray<Bits, Encoding>;
+		friend class EncodedBitArray<Bits, Encoding>::iterator;
+	public:
+		inline reference(const reference& other) = default;
+
+		inline operator value_type() const;
+		inline reference& operator=(value_type val);
+		inline reference& operator=(const reference& other);	// copies the value
+
+		friend inline void swap(reference left, reference right) {	// swaps values (std::sort, std::reverse)
+			const value_type tmp = left;
+			left = static_cast<value_type>(right);
+			right = tmp;
+		}
+	};
+
+	// random access iterator, dereference gives reference proxy (range is checked only in debug builds)
+	class iterator {
+	private:
+		EncodedBitArray<Bits, Encoding>* ref_ptr;
+		size_t index;
+
+		inline iterator(EncodedBitArray<Bits, Encoding>* ref_ptr, size_t index);
+		friend class EncodedBitArray<Bits, Encoding>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = typename EncodedBitArray<Bits, Encoding>::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = typename EncodedBitArray<Bits, Encoding>::reference;
+
+		inline iterator();
+
+		inline reference operator*() const;
+		inline reference operator[](difference_type value) const;
+		inline iterator& operator++();	// prefix
+		inline iterator& operator--();	// prefix
+		inline iterator operator++(int);	// postfix
+		inline iterator operator--(int);	// postfix
+		inline iterator& operator+=(difference_type val);
+		inline iterator& operator-=(difference_type val);
+		inline iterator operator+(difference_type value) const;
+		inline iterator operator-(difference_type value) const;
+		inline difference_type operator-(const iterator& other_it) const;
+		inline bool operator==(const iterator& other_it) const;
+		inline bool operator!=(const iterator& other_it) const;
+		inline bool operator<(const iterator& other_it) const;
+		inline bool operator>(const iterator& other_it) const;
+		inline bool operator<=(const iterator& other_it) const;
+		inline bool operator>=(const iterator& other_it) const;
+
+		friend inline iterator operator+(difference_type value, const iterator& it) {
+			return it + value;
+		}
+	};
+
+	// random access iterator, dereference gives the value
+	class const_iterator {
+	private:
+		iterator it;
+		friend class EncodedBitArray<Bits, Encoding>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = typename EncodedBitArray<Bits, Encoding>::value_type;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = value_type;
+
+		inline const_iterator();
+		inline const_iterator(const iterator& other_it);	// iterator => const_iterator
+
+		inline value_type operator*() const;
+		inline value_type operator[](difference_type value) const;
+		inline const_iterator& operator++();	// prefix
+		inline const_iterator& operator--();	// prefix
+		inline const_iterator operator++(int);	// postfix
+		inline const_iterator operator--(int);	// postfix
+		inline const_iterator& operator+=(difference_type val);
+		inline const_iterator& operator-=(difference_type val);
+		inline const_iterator operator+(difference_type value) const;
+		inline const_iterator operator-(difference_type value) const;
+		inline difference_type operator-(const const_iterator& other_it) const;
+
+		friend inline const_iterator operator+(difference_type value, const const_iterator& it) {
+			return it + value;
+		}
+		// friends => mixed iterator/const_iterator comparison
+		friend inline bool operator==(const const_iterator& left, const const_iterator& right) {
+			return left.it == right.it;
+		}
+		friend inline bool operator!=(const const_iterator& left, const const_iterator& right) {
+			return left.it != right.it;
+		}
+		friend inline bool operator<(const const_iterator& left, const const_iterator& right) {
+			return left.it < right.it;
+		}
+		friend inline bool operator>(const const_iterator& left, const const_iterator& right) {
+			return left.it > right.it;
+		}
+		friend inline bool operator<=(const const_iterator& left, const const_iterator& right) {
+			return left.it <= right.it;
+		}
+		friend inline bool operator>=(const const_iterator& left, const const_iterator& right) {
+			return left.it >= right.it;
+		}
+	};
+
+	explicit EncodedBitArray(value_type base = 0, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	template<typename T>
+	explicit EncodedBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource = std::pmr::get_default_resource());	// base from the values
+
+	inline value_type base() const;
+	inline size_t size() const;
+	inline size_t capacity() const;
+	inline bool empty() const;
+	inline std::pmr::memory_resource* resource() const;
+	inline const BitArray<Bits>& packed() const;	// the stored differences (save, DynamicBitArray, ...)
+
+	inline iterator begin();
+	inline iterator end();
+	inline const_iterator begin() const;
+	inline const_iterator end() const;
+	inline const_iterator cbegin() const;
+	inline const_iterator cend() const;
+
+	void resize(size_t new_size);	// new elements are base
+	void reserve(size_t new_capacity);
+	void clear();
+	void shrink_to_fit();
+
+	inline void pop_back();
+	void push_back(value_type val);
+
+	// at - std::out_of_range, operator[] - checked only in debug builds (assert)
+	inline reference at(size_t index);
+	inline value_type at(size_t index) const;
+	inline reference operator[](size_t index);
+	inline value_type operator[](size_t index) const;
+	inline value_type unchecked_get(size_t index) const;
+
+	// bulk: values go through the packing kernels in blocks, encode/decode is a plain loop over the block
+	// assign picks the base from min/max (midpoint for zigzag), std::overflow_error if the spread doesn't fit Bits
+	void assign(const value_type* in, size_t count);
+	void decode_to(value_type* out, size_t first, size_t count) const;
+};
+
+// implementation
+
+// EncodedBitArray
+template<size_t Bits, BitArrayEncoding Encoding>
+EncodedBitArray<Bits, Encoding>::EncodedBitArray(value_type base, std::pmr::memory_resource* resource)
+	: packed_(resource), base_(base) {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+template<typename T>
+EncodedBitArray<Bits, Encoding>::EncodedBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource)
+	: EncodedBitArray(0, resource) {
+	if constexpr (std::is_same_v<T, value_type>) {
+		assign(vect.data(), vect.size());
+	}
+	else {
+		const std::vector<value_type> values(vect.begin(), vect.end());
+		assign(values.data(), values.size());
+	}
+}
+
+// differences are taken modulo 2^64, the sign test catches the wrapped ones
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::encode(value_type val, uint64_t& code) const {
+	const uint64_t diff = static_cast<uint64_t>(val) - static_cast<uint64_t>(base_);
+	if constexpr (Encoding == BitArrayEncoding::offset) {
+		code = diff;
+		return val >= base_ && diff <= bitarray_detail::mask_of<Bits>();
+	}
+	else {
+		const int64_t signed_diff = static_cast<int64_t>(diff);
+		code = (diff << 1) ^ static_cast<uint64_t>(signed_diff >> 63);
+		return (val >= base_) == (signed_diff >= 0) && code <= bitarray_detail::mask_of<Bits>();
+	}
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline uint64_t EncodedBitArray<Bits, Encoding>::encode_checked(value_type val) const {
+	uint64_t code;
+	if (!encode(val, code)) {
+		throw std::overflow_error("Overflow");
+	}
+
+	return code;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::decode(uint64_t code) const {
+	if constexpr (Encoding == BitArrayEncoding::offset) {
+		return base_ + code;
+	}
+	else {
+		const uint64_t diff = (code >> 1) ^ (uint64_t(0) - (code & 1));
+		return static_cast<value_type>(static_cast<uint64_t>(base_) + diff);
+	}
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline void EncodedBitArray<Bits, Encoding>::check_index(size_t index) const {
+	if (index >= packed_.size()) {
+		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+	}
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::base() const {
+	return base_;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline size_t EncodedBitArray<Bits, Encoding>::size() const {
+	return packed_.size();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline size_t EncodedBitArray<Bits, Encoding>::capacity() const {
+	return packed_.capacity();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::empty() const {
+	return packed_.empty();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline std::pmr::memory_resource* EncodedBitArray<Bits, Encoding>::resource() const {
+	return packed_.resource();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline const BitArray<Bits>& EncodedBitArray<Bits, Encoding>::packed() const {
+	return packed_;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::begin() {
+	return iterator(this, 0);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::end() {
+	return iterator(this, packed_.size());
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::begin() const {
+	return iterator(const_cast<EncodedBitArray<Bits, Encoding>*>(this), 0);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::end() const {
+	return iterator(const_cast<EncodedBitArray<Bits, Encoding>*>(this), packed_.size());
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::cbegin() const {
+	return begin();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::cend() const {
+	return end();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::resize(size_t new_size) {
+	packed_.resize(new_size);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::reserve(size_t new_capacity) {
+	packed_.reserve(new_capacity);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::clear() {
+	packed_.clear();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::shrink_to_fit() {
+	packed_.shrink_to_fit();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline void EncodedBitArray<Bits, Encoding>::pop_back() {
+	packed_.pop_back();
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::push_back(value_type val) {
+	packed_.push_back(encode_checked(val));
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference EncodedBitArray<Bits, Encoding>::at(size_t index) {
+	check_index(index);
+	return reference(this, index);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::at(size_t index) const {
+	check_index(index);
+	return decode(packed_.unchecked_get(index));
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference EncodedBitArray<Bits, Encoding>::operator[](size_t index) {
+	assert(index < packed_.size());
+	return reference(this, index);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::operator[](size_t index) const {
+	return decode(packed_[index]);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::unchecked_get(size_t index) const {
+	return decode(packed_.unchecked_get(index));
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::assign(const value_type* in, size_t count) {
+	value_type low = count ? in[0] : 0;
+	value_type high = low;
+	for (size_t i{}; i < count; ++i) {
+		low = in[i] < low ? in[i] : low;
+		high = in[i] > high ? in[i] : high;
+	}
+	const uint64_t spread = static_cast<uint64_t>(high) - static_cast<uint64_t>(low);
+
+	if (spread > bitarray_detail::mask_of<Bits>()) {	// spread + 1 values don't fit 2^Bits codes
+		throw std::overflow_error("Overflow");
+	}
+
+	value_type base = low;
+	if constexpr (Encoding == BitArrayEncoding::zigzag) {	// differences in [-ceil(spread / 2), floor(spread / 2)]
+		base = static_cast<value_type>(static_cast<uint64_t>(low) + (spread - spread / 2));
+	}
+
+	packed_.clear();
+	packed_.resize(count);
+	base_ = base;
+
+	uint64_t codes[bitarray_detail::repack_block];
+	for (size_t first{}; first < count; first += bitarray_detail::repack_block) {
+		const size_t n = count - first < bitarray_detail::repack_block ? count - first : bitarray_detail::repack_block;
+		for (size_t i{}; i < n; ++i) {
+			encode(in[first + i], codes[i]);
+		}
+		bitarray_detail::pack<Bits>(packed_.memory_, first, n, codes);
+	}
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+void EncodedBitArray<Bits, Encoding>::decode_to(value_type* out, size_t first, size_t count) const {
+	if (first > packed_.size() || count > packed_.size() - first) {
+		throw std::out_of_range("Out of range");
+	}
+
+	for (size_t done{}; done < count; done += bitarray_detail::repack_block) {	// decoded while the block is in L1
+		const size_t n = count - done < bitarray_detail::repack_block ? count - done : bitarray_detail::repack_block;
+		value_type* block = out + done;
+		bitarray_detail::unpack<Bits>(packed_.memory_, first + done, n, block);
+		for (size_t i{}; i < n; ++i) {
+			block[i] = decode(static_cast<uint64_t>(block[i]));
+		}
+	}
+}
+
+// EncodedBitArray::reference
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::reference::reference(EncodedBitArray<Bits, Encoding>* ref_ptr, size_t index)
+	: ref_ptr(ref_ptr), index(index) {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::reference::operator value_type() const {
+	return ref_ptr->decode(ref_ptr->packed_.unchecked_get(index));
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference& EncodedBitArray<Bits, Encoding>::reference::operator=(value_type val) {
+	ref_ptr->packed_.unchecked_set(index, ref_ptr->encode_checked(val));
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference& EncodedBitArray<Bits, Encoding>::reference::operator=(const reference& other) {
+	return *this = static_cast<value_type>(other);
+}
+
+// EncodedBitArray::iterator
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::iterator::iterator(EncodedBitArray<Bits, Encoding>* ref_ptr, size_t index)
+	: ref_ptr(ref_ptr), index(index) {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::iterator::iterator() : ref_ptr(nullptr), index(0) {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference EncodedBitArray<Bits, Encoding>::iterator::operator*() const {
+	assert(ref_ptr != nullptr && index < ref_ptr->size());
+	return typename EncodedBitArray<Bits, Encoding>::reference(ref_ptr, index);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::reference EncodedBitArray<Bits, Encoding>::iterator::operator[](difference_type value) const {
+	return *(*this + value);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator& EncodedBitArray<Bits, Encoding>::iterator::operator++() {
+	++index;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator& EncodedBitArray<Bits, Encoding>::iterator::operator--() {
+	--index;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::iterator::operator++(int) {
+	iterator tmp = *this;
+	++index;
+	return tmp;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::iterator::operator--(int) {
+	iterator tmp = *this;
+	--index;
+	return tmp;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator& EncodedBitArray<Bits, Encoding>::iterator::operator+=(difference_type val) {
+	index += val;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator& EncodedBitArray<Bits, Encoding>::iterator::operator-=(difference_type val) {
+	index -= val;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::iterator::operator+(difference_type value) const {
+	return iterator(ref_ptr, index + value);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator EncodedBitArray<Bits, Encoding>::iterator::operator-(difference_type value) const {
+	return iterator(ref_ptr, index - value);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::iterator::difference_type EncodedBitArray<Bits, Encoding>::iterator::operator-(const iterator& other_it) const {
+	return static_cast<difference_type>(index) - static_cast<difference_type>(other_it.index);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator==(const iterator& other_it) const {
+	return index == other_it.index;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator!=(const iterator& other_it) const {
+	return index != other_it.index;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator<(const iterator& other_it) const {
+	return index < other_it.index;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator>(const iterator& other_it) const {
+	return index > other_it.index;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator<=(const iterator& other_it) const {
+	return index <= other_it.index;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline bool EncodedBitArray<Bits, Encoding>::iterator::operator>=(const iterator& other_it) const {
+	return index >= other_it.index;
+}
+
+// EncodedBitArray::const_iterator
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::const_iterator::const_iterator() : it() {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline EncodedBitArray<Bits, Encoding>::const_iterator::const_iterator(const iterator& other_it) : it(other_it) {}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::const_iterator::operator*() const {
+	return static_cast<value_type>(*it);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::value_type EncodedBitArray<Bits, Encoding>::const_iterator::operator[](difference_type value) const {
+	return static_cast<value_type>(it[value]);
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator& EncodedBitArray<Bits, Encoding>::const_iterator::operator++() {
+	++it;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator& EncodedBitArray<Bits, Encoding>::const_iterator::operator--() {
+	--it;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::const_iterator::operator++(int) {
+	return it++;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::const_iterator::operator--(int) {
+	return it--;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator& EncodedBitArray<Bits, Encoding>::const_iterator::operator+=(difference_type val) {
+	it += val;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator& EncodedBitArray<Bits, Encoding>::const_iterator::operator-=(difference_type val) {
+	it -= val;
+	return *this;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::const_iterator::operator+(difference_type value) const {
+	return it + value;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator EncodedBitArray<Bits, Encoding>::const_iterator::operator-(difference_type value) const {
+	return it - value;
+}
+
+template<size_t Bits, BitArrayEncoding Encoding>
+inline typename EncodedBitArray<Bits, Encoding>::const_iterator::difference_type EncodedBitArray<Bits, Encoding>::const_iterator::operator-(const const_iterator& other_it) const {
+	return it - other_it.it;
+}
+
+#endif
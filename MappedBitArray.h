@@ -0,0 +1,433 @@
+#ifndef MAPPEDBITARRAY_H
+#define MAPPEDBITARRAY_H
+
+#include "BitArray.h"
+
+#include <string>
+#include <system_error>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+enum class BitArrayMapMode {
+	read_only,	// read-only mapping, the file is never changed, size is fixed, only const access
+	read_write,	// shared mapping of an existing file
+	create		// new (or truncated) file, shared mapping
+};
+
+// file layout: header (64 bytes) + packed words of BitArray<Bits> (native byte order)
+struct BitArrayFileHeader {
+	static constexpr char magic_value[8] = { 'B', 'I', 'T', 'A', 'R', 'R', 'A', 'Y' };
+	static constexpr uint32_t msb_first = 1;	// element 0 in the high bits of word 0
+	static constexpr uint64_t endian_value = 0x0102030405060708;
+
+	char magic[8];
+	uint32_t version;
+	uint32_t bits;
+	uint64_t size;	// elements
+	uint32_t order;
+	uint32_t reserved0;
+	uint64_t endian;
+	uint8_t reserved[24];
+};
+static_assert(sizeof(BitArrayFileHeader) == 64, "BitArrayFileHeader must be 64 bytes");
+
+// BitArray whose words live in a memory mapped file
+// opening is O(1): header is validated, the words are used in place
+// non-const element access and every change throw std::logic_error for read_only (the pages can't be written)
+template<size_t Bits>
+class MappedBitArray {
+private:
+	BitArray<Bits> array_;	// memory_ points into the mapping, never allocates
+	int fd_;
+	BitArrayMapMode mode_;
+	char* mapping_;
+	size_t mapping_size_;
+
+	inline BitArrayFileHeader* header() const;
+	void map(size_t file_size);
+	void unmap();
+	void grow(size_t new_capacity);
+	inline void sync_size();
+	inline void check_writable() const;
+	[[noreturn]] static void throw_errno(const char* what);
+public:
+	MappedBitArray(const std::string& path, BitArrayMapMode mode = BitArrayMapMode::read_write);
+	MappedBitArray(MappedBitArray<Bits>&& other) noexcept;
+	MappedBitArray(const MappedBitArray<Bits>& other) = delete;
+	~MappedBitArray();
+
+	MappedBitArray& operator=(MappedBitArray<Bits>&& other) noexcept;
+	MappedBitArray& operator=(const MappedBitArray<Bits>& other) = delete;
+
+	inline size_t size() const;
+	inline size_t capacity() const;
+	inline bool empty() const;
+	inline BitArrayMapMode mode() const;
+	inline const BitArray<Bits>& array() const;
+
+	inline typename BitArray<Bits>::BitArrayRef front();
+	inline typename BitArray<Bits>::BitArrayRef back();
+	inline uint64_t front() const;
+	inline uint64_t back() const;
+
+	inline typename BitArray<Bits>::iterator begin();
+	inline typename BitArray<Bits>::iterator end();
+	inline typename BitArray<Bits>::const_iterator begin() const;
+	inline typename BitArray<Bits>::const_iterator end() const;
+
+	void resize(size_t new_size);
+	void reserve(size_t new_capacity);
+	void clear();
+
+	inline void pop_back();
+	void push_back(const uint64_t val);
+
+	inline typename BitArray<Bits>::BitArrayRef at(size_t index);
+	inline typename BitArray<Bits>::BitArrayRef operator[](size_t index);
+	inline uint64_t at(size_t index) const;
+	inline uint64_t operator[](size_t index) const;
+
+	void flush();
+};
+
+// implementation
+
+// MappedBitArray
+template<size_t Bits>
+MappedBitArray<Bits>::MappedBitArray(const std::string& path, BitArrayMapMode mode)
+	: array_(std::pmr::null_memory_resource()), fd_(-1), mode_(mode), mapping_(nullptr), mapping_size_(0) {
+	const int flags = mode == BitArrayMapMode::read_only ? O_RDONLY
+		: mode == BitArrayMapMode::read_write ? O_RDWR
+		: O_RDWR | O_CREAT | O_TRUNC;
+	fd_ = ::open(path.c_str(), flags, 0644);
+	if (fd_ < 0) {
+		throw_errno("MappedBitArray | open failed");
+	}
+
+	if (mode == BitArrayMapMode::create) {	// write header of empty BitArray
+		BitArrayFileHeader new_header{};
+		std::memcpy(new_header.magic, BitArrayFileHeader::magic_value, sizeof(new_header.magic));
+		new_header.version = 1;
+		new_header.bits = Bits;
+		new_header.size = 0;
+		new_header.order = BitArrayFileHeader::msb_first;
+		new_header.endian = BitArrayFileHeader::endian_value;
+		if (::pwrite(fd_, &new_header, sizeof(new_header), 0) != static_cast<ssize_t>(sizeof(new_header))) {
+			const int error = errno;
+			::close(fd_);
+			errno = error;
+			throw_errno("MappedBitArray | header write failed");
+		}
+	}
+
+	struct stat file_stat;
+	if (::fstat(fd_, &file_stat) != 0) {
+		const int error = errno;
+		::close(fd_);
+		errno = error;
+		throw_errno("MappedBitArray | stat failed");
+	}
+	const size_t file_size = static_cast<size_t>(file_stat.st_size);
+	if (file_size < sizeof(BitArrayFileHeader) || (file_size - sizeof(BitArrayFileHeader)) % 8 != 0) {
+		::close(fd_);
+		throw std::runtime_error("MappedBitArray | not a BitArray file");
+	}
+
+	try {
+		map(file_size);
+	}
+	catch (...) {
+		::close(fd_);
+		throw;
+	}
+
+	const BitArrayFileHeader* file_header = header();
+	const char* error = nullptr;
+	if (std::memcmp(file_header->magic, BitArrayFileHeader::magic_value, sizeof(file_header->magic)) != 0) {
+		error = "MappedBitArray | not a BitArray file";
+	}
+	else if (file_header->version != 1) {
+		error = "MappedBitArray | unsupported version";
+	}
+	else if (file_header->endian != BitArrayFileHeader::endian_value) {
+		error = "MappedBitArray | foreign byte order";
+	}
+	else if (file_header->order != BitArrayFileHeader::msb_first) {
+		error = "MappedBitArray | unsupported packing order";
+	}
+	else if (file_header->bits != Bits) {
+		error = "MappedBitArray | Bits mismatch";
+	}
+	else if (file_header->size > array_.capacity_) {
+		error = "MappedBitArray | file is truncated";
+	}
+	if (error != nullptr) {
+		unmap();
+		::close(fd_);
+		throw std::runtime_error(error);
+	}
+
+	array_.size_ = file_header->size;
+}
+
+template<size_t Bits>
+MappedBitArray<Bits>::MappedBitArray(MappedBitArray<Bits>&& other) noexcept
+	: array_(std::pmr::null_memory_resource()), fd_(-1), mode_(other.mode_), mapping_(nullptr), mapping_size_(0) {
+	*this = std::move(other);
+}
+
+template<size_t Bits>
+MappedBitArray<Bits>::~MappedBitArray() {
+	unmap();
+	if (fd_ >= 0) {
+		::close(fd_);
+	}
+}
+
+template<size_t Bits>
+MappedBitArray<Bits>& MappedBitArray<Bits>::operator=(MappedBitArray<Bits>&& other) noexcept {
+	if (&other != this) {
+		unmap();
+		if (fd_ >= 0) {
+			::close(fd_);
+		}
+
+		array_.swap(other.array_);
+		fd_ = other.fd_;
+		mode_ = other.mode_;
+		mapping_ = other.mapping_;
+		mapping_size_ = other.mapping_size_;
+
+		other.fd_ = -1;
+		other.mapping_ = nullptr;
+		other.mapping_size_ = 0;
+	}
+
+	return *this;
+}
+
+template<size_t Bits>
+inline BitArrayFileHeader* MappedBitArray<Bits>::header() const {
+	return reinterpret_cast<BitArrayFileHeader*>(mapping_);
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::map(size_t file_size) {
+	const bool read_only = mode_ == BitArrayMapMode::read_only;
+	void* mapped = ::mmap(nullptr, file_size, read_only ? PROT_READ : PROT_READ | PROT_WRITE,
+		read_only ? MAP_PRIVATE : MAP_SHARED, fd_, 0);
+	if (mapped == MAP_FAILED) {
+		throw_errno("MappedBitArray | mmap failed");
+	}
+
+	mapping_ = static_cast<char*>(mapped);
+	mapping_size_ = file_size;
+
+	const size_t word_count = (file_size - sizeof(BitArrayFileHeader)) / 8;
+	array_.memory_ = word_count ? reinterpret_cast<uint64_t*>(mapping_ + sizeof(BitArrayFileHeader)) : nullptr;
+	array_.capacity_ = word_count * 64 / Bits;
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::unmap() {
+	if (mapping_ != nullptr) {
+		::munmap(mapping_, mapping_size_);
+	}
+	mapping_ = nullptr;
+	mapping_size_ = 0;
+	array_.memory_ = nullptr;	// not owned => nothing to deallocate
+	array_.size_ = 0;
+	array_.capacity_ = 0;
+}
+
+// ftruncate + remap, new words are zeroed by the file system
+template<size_t Bits>
+void MappedBitArray<Bits>::grow(size_t new_capacity) {
+	check_writable();
+	if (new_capacity <= array_.capacity_) {
+		return;
+	}
+
+	const size_t size = array_.size_;
+	const size_t file_size = sizeof(BitArrayFileHeader) + (new_capacity * Bits + 63) / 64 * 8;
+	if (::ftruncate(fd_, static_cast<off_t>(file_size)) != 0) {
+		throw_errno("MappedBitArray | ftruncate failed");
+	}
+
+	unmap();
+	map(file_size);
+	array_.size_ = size;
+}
+
+template<size_t Bits>
+inline void MappedBitArray<Bits>::sync_size() {
+	header()->size = array_.size_;
+}
+
+template<size_t Bits>
+inline void MappedBitArray<Bits>::check_writable() const {
+	if (mode_ == BitArrayMapMode::read_only) {
+		throw std::logic_error("MappedBitArray | read only mapping");
+	}
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::throw_errno(const char* what) {
+	throw std::system_error(errno, std::generic_category(), what);
+}
+
+template<size_t Bits>
+inline size_t MappedBitArray<Bits>::size() const {
+	return array_.size();
+}
+
+template<size_t Bits>
+inline size_t MappedBitArray<Bits>::capacity() const {
+	return array_.capacity();
+}
+
+template<size_t Bits>
+inline bool MappedBitArray<Bits>::empty() const {
+	return array_.empty();
+}
+
+template<size_t Bits>
+inline BitArrayMapMode MappedBitArray<Bits>::mode() const {
+	return mode_;
+}
+
+template<size_t Bits>
+inline const BitArray<Bits>& MappedBitArray<Bits>::array() const {
+	return array_;
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::BitArrayRef MappedBitArray<Bits>::front() {
+	check_writable();
+	return array_.front();
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::BitArrayRef MappedBitArray<Bits>::back() {
+	check_writable();
+	return array_.back();
+}
+
+template<size_t Bits>
+inline uint64_t MappedBitArray<Bits>::front() const {
+	return array_.at(0);
+}
+
+template<size_t Bits>
+inline uint64_t MappedBitArray<Bits>::back() const {
+	if (array_.empty()) {
+		throw std::out_of_range("Out of range, MappedBitArray is empty!");
+	}
+
+	return array_.at(array_.size() - 1);
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::iterator MappedBitArray<Bits>::begin() {
+	check_writable();
+	return array_.begin();
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::iterator MappedBitArray<Bits>::end() {
+	check_writable();
+	return array_.end();
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::const_iterator MappedBitArray<Bits>::begin() const {
+	return array_.begin();
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::const_iterator MappedBitArray<Bits>::end() const {
+	return array_.end();
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::resize(size_t new_size) {
+	check_writable();
+	if (new_size > array_.capacity_) {
+		grow(new_size);
+	}
+
+	if (new_size < array_.size_) {
+		array_.truncate(new_size);
+	}
+	else {	// words after size are zeroed
+		array_.rank_touch(array_.size_);
+		array_.size_ = new_size;
+	}
+	sync_size();
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::reserve(size_t new_capacity) {
+	grow(new_capacity);
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::clear() {
+	check_writable();
+	array_.truncate(0);
+	sync_size();
+}
+
+template<size_t Bits>
+inline void MappedBitArray<Bits>::pop_back() {
+	check_writable();
+	array_.pop_back();
+	sync_size();
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::push_back(const uint64_t val) {
+	check_writable();
+	if (array_.size_ == array_.capacity_) {
+		grow(array_.capacity_ ? array_.capacity_ * 2 : 64);
+	}
+
+	array_.push_back(val);
+	sync_size();
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::BitArrayRef MappedBitArray<Bits>::at(size_t index) {
+	check_writable();
+	return array_.at(index);
+}
+
+template<size_t Bits>
+inline typename BitArray<Bits>::BitArrayRef MappedBitArray<Bits>::operator[](size_t index) {
+	check_writable();
+	return array_[index];
+}
+
+template<size_t Bits>
+inline uint64_t MappedBitArray<Bits>::at(size_t index) const {
+	return array_.at(index);
+}
+
+template<size_t Bits>
+inline uint64_t MappedBitArray<Bits>::operator[](size_t index) const {
+	return array_[index];
+}
+
+template<size_t Bits>
+void MappedBitArray<Bits>::flush() {
+	if (mode_ != BitArrayMapMode::read_only && mapping_ != nullptr
+		&& ::msync(mapping_, mapping_size_, MS_SYNC) != 0) {
+		throw_errno("MappedBitArray | msync failed");
+	}
+}
+
+#endif
@@ -0,0 +1,451 @@
+#ifndef PARALLELBITARRAY_H
+#define PARALLELBITARRAY_H
+
+#include "BitArray.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+// work-stealing thread pool for the parallel algorithms
+// run(tasks, task) gives every thread an equal run of task numbers, a thread that runs out
+// takes the back half of another thread's run; the calling thread works too
+class BitArrayThreadPool {
+private:
+	struct alignas(64) task_queue {	// tasks [next, end), owner takes from next, thieves from end
+		std::mutex lock;
+		size_t next = 0;
+		size_t end = 0;
+	};
+
+	std::vector<std::thread> workers_;
+	std::unique_ptr<task_queue[]> queues_;	// [0] - the calling thread
+
+	std::mutex lock_;
+	std::condition_variable wake_;
+	std::condition_variable done_;
+	std::mutex run_lock_;	// one run at a time
+	void (*job_)(void*, size_t);
+	void* job_data_;
+	size_t generation_;
+	size_t active_;	// workers still in the current run
+	bool stop_;
+	std::exception_ptr error_;
+	std::atomic<bool> failed_;	// the remaining tasks are skipped
+
+	static inline thread_local const BitArrayThreadPool* current_ = nullptr;	// pool of the running task
+
+	void worker(size_t self);
+	void work(size_t self);
+	bool take(size_t self, size_t& task);
+	void stop();
+public:
+	explicit BitArrayThreadPool(size_t threads = 0);	// threads including the caller, 0 => hardware_concurrency
+	BitArrayThreadPool(const BitArrayThreadPool& other) = delete;
+	~BitArrayThreadPool();
+
+	BitArrayThreadPool& operator=(const BitArrayThreadPool& other) = delete;
+
+	inline size_t size() const;	// threads including the caller
+
+	// task(i) for every i in [0, tasks), returns when all are done and rethrows the first exception
+	// (a run from inside a task of the same pool is done by the calling thread alone)
+	template<typename F> void run(size_t tasks, F&& task);
+
+	static BitArrayThreadPool& shared();	// hardware_concurrency threads, made on the first use
+};
+
+namespace bitarray_detail {
+	constexpr size_t parallel_min_chunk = size_t(1) << 16;	// elements, smaller chunks cost more than they save
+	constexpr size_t parallel_chunks_per_thread = 8;	// spare chunks to steal
+	constexpr size_t parallel_block = 256;	// elements decoded at once
+
+	// chunk length is a multiple of align (elements of whole words) => no two chunks share a word
+	inline size_t parallel_chunk(size_t size, size_t threads, size_t align) {
+		size_t chunk = size / (threads * parallel_chunks_per_thread);
+		chunk = chunk < parallel_min_chunk ? parallel_min_chunk : chunk;
+
+		return (chunk + align - 1) / align * align;
+	}
+
+	// f(first, count) for word aligned chunks of [0, size)
+	template<size_t Align, typename F>
+	void parallel_chunks(BitArrayThreadPool& pool, size_t size, F&& f) {
+		const size_t chunk = parallel_chunk(size, pool.size(), Align);
+		pool.run((size + chunk - 1) / chunk, [&](size_t task) {
+			const size_t first = task * chunk;
+			f(first, size - first < chunk ? size - first : chunk);
+		});
+	}
+
+	// f(values, first, count) for blocks of [first, first + count), values decoded
+	template<size_t Bits, typename F>
+	void decode_blocks(const uint64_t* memory, size_t first, size_t count, F&& f) {
+		uint64_t values[parallel_block];
+		while (count) {
+			const size_t n = count < parallel_block ? count : parallel_block;
+			unpack<Bits>(memory, first, n, values);
+			f(values, first, n);
+			first += n;
+			count -= n;
+		}
+	}
+
+	// members of BitArray the parallel algorithms need
+	struct parallel_access {
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static uint64_t* words(BitArray<Bits, InlineWords, Overflow>& arr) {
+			return arr.memory_;
+		}
+
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static const uint64_t* words(const BitArray<Bits, InlineWords, Overflow>& arr) {
+			return arr.memory_;
+		}
+
+		// before the threads write: the rank/select index (BitArray<1>) is marked stale once,
+		// the writes of the threads only read dirty_from then
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static void touch_all(BitArray<Bits, InlineWords, Overflow>& arr) {
+			arr.rank_touch(0);
+		}
+
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static uint64_t fit(uint64_t val) {	// by Overflow of the array
+			using array = BitArray<Bits, InlineWords, Overflow>;
+			return array::fit(val & array::mask_, val > array::mask_, array::mask_);
+		}
+
+		// size = count, words after it stay zeroed (as pack_from)
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static void prepare(BitArray<Bits, InlineWords, Overflow>& arr, size_t count) {
+			if (arr.capacity_ < count) {
+				arr.clear();
+				arr.reserve(count);
+			}
+			else {
+				arr.truncate(arr.size_ < count ? arr.size_ : count);
+			}
+			arr.size_ = count;
+			arr.rank_touch(0);
+		}
+
+		template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow>
+		static void truncate(BitArray<Bits, InlineWords, Overflow>& arr, size_t new_size) {
+			arr.truncate(new_size);
+		}
+	};
+}
+
+// parallel algorithms, chunks start and end at group boundaries (lcm(Bits, 64) bits),
+// so the threads never write to the same word; the array must not be resized meanwhile
+
+// f(BitArrayRef) for every element (changes go through the overflow policy of the array)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename F>
+void parallel_for_each(BitArray<Bits, InlineWords, Overflow>& arr, F f, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+
+// f(uint64_t) for every element, elements are decoded in blocks
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename F>
+void parallel_for_each(const BitArray<Bits, InlineWords, Overflow>& arr, F f, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+
+// dst[i] = op(src[i]), dst gets the size of src (can be the same array),
+// results that don't fit go through the overflow policy of dst (throw_error => dst is partly written)
+template<size_t SrcBits, size_t SrcInline, BitArrayOverflow SrcOverflow,
+	size_t DstBits, size_t DstInline, BitArrayOverflow DstOverflow, typename Op>
+void parallel_transform(const BitArray<SrcBits, SrcInline, SrcOverflow>& src, BitArray<DstBits, DstInline, DstOverflow>& dst,
+	Op op, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+
+// op(...op(op(init, a), b)...) in any order and grouping (op must be associative and commutative, like std::reduce)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T, typename Op = std::plus<>>
+T parallel_reduce(const BitArray<Bits, InlineWords, Overflow>& arr, T init, Op op = Op{}, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+
+// arr = [in, in + count) / arr = vect, packed by chunks (std::overflow_error and an empty array if a value doesn't fit)
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T>
+void parallel_pack_from(BitArray<Bits, InlineWords, Overflow>& arr, const T* in, size_t count, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T>
+void parallel_assign(BitArray<Bits, InlineWords, Overflow>& arr, const std::vector<T>& vect, BitArrayThreadPool& pool = BitArrayThreadPool::shared());
+
+// implementation
+
+// BitArrayThreadPool
+inline BitArrayThreadPool::BitArrayThreadPool(size_t threads)
+	: job_(nullptr), job_data_(nullptr), generation_(0), active_(0), stop_(false), failed_(false) {
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+		threads = threads ? threads : 1;
+	}
+
+	queues_ = std::make_unique<task_queue[]>(threads);
+	workers_.reserve(threads - 1);
+	try {
+		for (size_t i = 1; i < threads; ++i) {
+			workers_.emplace_back(&BitArrayThreadPool::worker, this, i);
+		}
+	}
+	catch (...) {	// no more threads => join the started ones
+		stop();
+		throw;
+	}
+}
+
+inline BitArrayThreadPool::~BitArrayThreadPool() {
+	stop();
+}
+
+inline void BitArrayThreadPool::stop() {
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+	for (std::thread& thread : workers_) {
+		thread.join();
+	}
+	workers_.clear();
+}
+
+inline size_t BitArrayThreadPool::size() const {
+	return workers_.size() + 1;
+}
+
+inline BitArrayThreadPool& BitArrayThreadPool::shared() {
+	static BitArrayThreadPool pool;
+	return pool;
+}
+
+template<typename F>
+void BitArrayThreadPool::run(size_t tasks, F&& task) {
+	if (workers_.empty() || tasks < 2 || current_ == this) {	// nothing to share
+		for (size_t i{}; i < tasks; ++i) {
+			task(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> run_guard(run_lock_);
+	const size_t threads = size();
+	for (size_t i{}; i < threads; ++i) {
+		std::lock_guard<std::mutex> guard(queues_[i].lock);
+		queues_[i].next = tasks * i / threads;
+		queues_[i].end = tasks * (i + 1) / threads;
+	}
+
+	using task_type = std::remove_reference_t<F>;
+	{
+		std::lock_guard<std::mutex> guard(lock_);
+		job_ = [](void* data, size_t i) {
+			(*static_cast<task_type*>(data))(i);
+		};
+		job_data_ = const_cast<void*>(static_cast<const void*>(std::addressof(task)));
+		error_ = nullptr;
+		failed_.store(false, std::memory_order_relaxed);
+		active_ = workers_.size();
+		++generation_;
+	}
+	wake_.notify_all();
+
+	const BitArrayThreadPool* outer = current_;
+	current_ = this;
+	work(0);
+	current_ = outer;
+
+	std::unique_lock<std::mutex> lock(lock_);
+	done_.wait(lock, [this] { return active_ == 0; });
+	if (error_) {
+		std::exception_ptr error = error_;
+		error_ = nullptr;
+		std::rethrow_exception(error);
+	}
+}
+
+inline void BitArrayThreadPool::worker(size_t self) {
+	current_ = this;
+	size_t seen = 0;
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(lock_);
+			wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+			if (stop_) {
+				return;
+			}
+			seen = generation_;
+		}
+
+		work(self);
+
+		std::lock_guard<std::mutex> guard(lock_);
+		if (--active_ == 0) {
+			done_.notify_one();
+		}
+	}
+}
+
+inline void BitArrayThreadPool::work(size_t self) {
+	size_t task;
+	while (take(self, task)) {
+		if (failed_.load(std::memory_order_relaxed)) {
+			continue;	// drain the queues
+		}
+		try {
+			job_(job_data_, task);
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> guard(lock_);
+			if (!error_) {
+				error_ = std::current_exception();
+			}
+			failed_.store(true, std::memory_order_relaxed);
+		}
+	}
+}
+
+inline bool BitArrayThreadPool::take(size_t self, size_t& task) {
+	{
+		std::lock_guard<std::mutex> guard(queues_[self].lock);
+		if (queues_[self].next < queues_[self].end) {
+			task = queues_[self].next++;
+			return true;
+		}
+	}
+
+	const size_t threads = size();
+	for (size_t i = 1; i < threads; ++i) {	// steal the back half of the next non-empty queue
+		task_queue& victim = queues_[(self + i) % threads];
+		size_t first;
+		size_t last;
+		{
+			std::lock_guard<std::mutex> guard(victim.lock);
+			const size_t left = victim.end - victim.next;
+			if (left == 0) {
+				continue;
+			}
+			last = victim.end;
+			first = last - (left + 1) / 2;
+			victim.end = first;
+		}
+
+		task = first;
+		if (first + 1 < last) {
+			std::lock_guard<std::mutex> guard(queues_[self].lock);
+			queues_[self].next = first + 1;
+			queues_[self].end = last;
+		}
+		return true;
+	}
+
+	return false;
+}
+
+// algorithms
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename F>
+void parallel_for_each(BitArray<Bits, InlineWords, Overflow>& arr, F f, BitArrayThreadPool& pool) {
+	bitarray_detail::parallel_access::touch_all(arr);
+	bitarray_detail::parallel_chunks<bitarray_detail::group_elems<Bits>>(pool, arr.size(), [&](size_t first, size_t count) {
+		auto it = arr.begin() + first;
+		for (size_t i{}; i < count; ++i, ++it) {
+			f(*it);
+		}
+	});
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename F>
+void parallel_for_each(const BitArray<Bits, InlineWords, Overflow>& arr, F f, BitArrayThreadPool& pool) {
+	const uint64_t* memory = bitarray_detail::parallel_access::words(arr);
+	bitarray_detail::parallel_chunks<bitarray_detail::group_elems<Bits>>(pool, arr.size(), [&](size_t first, size_t count) {
+		bitarray_detail::decode_blocks<Bits>(memory, first, count, [&](const uint64_t* values, size_t, size_t n) {
+			for (size_t i{}; i < n; ++i) {
+				f(values[i]);
+			}
+		});
+	});
+}
+
+template<size_t SrcBits, size_t SrcInline, BitArrayOverflow SrcOverflow,
+	size_t DstBits, size_t DstInline, BitArrayOverflow DstOverflow, typename Op>
+void parallel_transform(const BitArray<SrcBits, SrcInline, SrcOverflow>& src, BitArray<DstBits, DstInline, DstOverflow>& dst,
+	Op op, BitArrayThreadPool& pool) {
+	using access = bitarray_detail::parallel_access;
+	constexpr size_t align = std::lcm(bitarray_detail::group_elems<SrcBits>, bitarray_detail::group_elems<DstBits>);
+
+	const size_t size = src.size();
+	if (dst.size() != size) {
+		dst.resize(size);
+	}
+	access::touch_all(dst);
+
+	const uint64_t* in = access::words(src);
+	uint64_t* out = access::words(dst);
+	bitarray_detail::parallel_chunks<align>(pool, size, [&](size_t first, size_t count) {
+		uint64_t results[bitarray_detail::parallel_block];
+		bitarray_detail::decode_blocks<SrcBits>(in, first, count, [&](const uint64_t* values, size_t block_first, size_t n) {
+			for (size_t i{}; i < n; ++i) {
+				results[i] = access::fit<DstBits, DstInline, DstOverflow>(static_cast<uint64_t>(op(values[i])));
+			}
+			bitarray_detail::pack<DstBits>(out, block_first, n, results);
+		});
+	});
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T, typename Op>
+T parallel_reduce(const BitArray<Bits, InlineWords, Overflow>& arr, T init, Op op, BitArrayThreadPool& pool) {
+	const size_t size = arr.size();
+	if (size == 0) {
+		return init;
+	}
+
+	const uint64_t* memory = bitarray_detail::parallel_access::words(arr);
+	const size_t chunk = bitarray_detail::parallel_chunk(size, pool.size(), bitarray_detail::group_elems<Bits>);
+	const size_t tasks = (size + chunk - 1) / chunk;
+	std::vector<T> partial(tasks, init);	// chunk results, init is only a placeholder
+	pool.run(tasks, [&](size_t task) {
+		const size_t first = task * chunk;
+		const size_t count = size - first < chunk ? size - first : chunk;
+		T sum = static_cast<T>(arr.unchecked_get(first));
+		bitarray_detail::decode_blocks<Bits>(memory, first + 1, count - 1, [&](const uint64_t* values, size_t, size_t n) {
+			for (size_t i{}; i < n; ++i) {
+				sum = op(sum, static_cast<T>(values[i]));
+			}
+		});
+		partial[task] = sum;
+	});
+
+	for (size_t i{}; i < tasks; ++i) {
+		init = op(init, partial[i]);
+	}
+
+	return init;
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T>
+void parallel_pack_from(BitArray<Bits, InlineWords, Overflow>& arr, const T* in, size_t count, BitArrayThreadPool& pool) {
+	using access = bitarray_detail::parallel_access;
+
+	access::prepare(arr, count);
+	uint64_t* memory = access::words(arr);
+	std::atomic<bool> overflow(false);
+	bitarray_detail::parallel_chunks<bitarray_detail::group_elems<Bits>>(pool, count, [&](size_t first, size_t n) {
+		if (bitarray_detail::pack<Bits>(memory, first, n, in + first) > bitarray_detail::mask_of<Bits>()) {
+			overflow.store(true, std::memory_order_relaxed);
+		}
+	});
+
+	if (overflow.load(std::memory_order_relaxed)) {
+		access::truncate(arr, 0);
+		throw std::overflow_error("Overflow");
+	}
+}
+
+template<size_t Bits, size_t InlineWords, BitArrayOverflow Overflow, typename T>
+void parallel_assign(BitArray<Bits, InlineWords, Overflow>& arr, const std::vector<T>& vect, BitArrayThreadPool& pool) {
+	if constexpr (std::is_same_v<T, bool>) {	// no data() in std::vector<bool>
+		arr = vect;
+	}
+	else {
+		parallel_pack_from(arr, vect.data(), vect.size(), pool);
+	}
+}
+
+#endif
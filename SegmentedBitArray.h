@@ -0,0 +1,1066 @@
+#ifndef SEGMENTEDBITARRAY_H
+#define SEGMENTEDBITARRAY_H
+
+#include "BitArray.h"
+
+#include <algorithm>
+#include <new>
+
+// packed elements in chunks of ChunkWords words (deque-like): growth only adds chunks => the existing words are
+// never copied and there is never an old + new buffer at once; insert/erase move bits inside one chunk
+// (+ an update of the chunk directory), a full chunk is split evenly, small neighbours are merged after an erase
+// chunk of an element: index / chunk_elems while all the chunks are full (appends), otherwise a binary search of firsts_
+// iterators keep the chunk words => sequential access is a get in the chunk + one compare
+template<size_t Bits, size_t ChunkWords = 4096>
+class SegmentedBitArray {
+public:
+	class reference;
+	class iterator;
+	class const_iterator;
+
+	static constexpr size_t chunk_elems = ChunkWords * 64 / Bits;
+private:
+	static_assert(Bits >= 1 && Bits <= 63, "Bits must be in [1..63]");
+	static_assert(ChunkWords >= 1, "ChunkWords must be at least 1");
+
+	static constexpr size_t merge_limit = chunk_elems - chunk_elems / 4;	// below a full chunk => no split/merge ping-pong
+
+	std::pmr::vector<uint64_t*> chunks_;	// bits after the elements of a chunk are zero
+	std::pmr::vector<size_t> firsts_;	// first element of every chunk + size at the end (unused without chunks)
+
+	inline uint64_t* allocate_chunk();	// zeroed
+	inline void deallocate_chunk(uint64_t* chunk);
+	template<typename T>
+	static inline void adopt(std::pmr::vector<T>& target, std::pmr::vector<T>& source) noexcept;	// buffer and resource
+	inline size_t chunk_of(size_t index) const;	// index <= size, the last chunk for size
+	inline iterator iterator_at(size_t chunk, size_t index) const;	// begin()/end() without a search
+	inline size_t count_of(size_t chunk) const;
+	inline void clear_elems(size_t chunk, size_t first, size_t last);	// zeroes words of [first, last) after first
+	void append(size_t count);	// zeros at the end, nothing is changed on std::bad_alloc
+	void open_gap(size_t index, size_t count);	// gap values are unspecified
+	void remove(size_t first, size_t last);
+	void drop_chunk(size_t chunk);	// empty one
+	void merge_next(size_t chunk);
+	void fill(size_t first, size_t count, uint64_t val);
+	inline void check_index(size_t index) const;
+public:
+	// proxy of one element
+	class reference {
+	private:
+		uint64_t* words;
+		size_t index;	// in the chunk
+
+		inline reference(uint64_t* words, size_t index);
+		friend class SegmentedBitArray<Bits, ChunkWords>;
+		friend class SegmentedBitArray<Bits, ChunkWords>::iterator;
+	public:
+		inline reference(const reference& other) = default;
+
+		inline operator uint64_t() const;
+		inline reference& operator=(uint64_t val);	// std::overflow_error if val doesn't fit Bits
+		inline reference& operator=(const reference& other);	// copies the value
+
+		friend inline void swap(reference left, reference right) {	// swaps values (std::sort, std::reverse)
+			const uint64_t tmp = left;
+			left = static_cast<uint64_t>(right);
+			right = tmp;
+		}
+	};
+
+	// random access iterator, dereference gives reference proxy (range is checked only in debug builds)
+	// any insert/erase/resize invalidates all the iterators
+	class iterator {
+	private:
+		SegmentedBitArray<Bits, ChunkWords>* ref_ptr;
+		size_t chunk;
+		size_t index;	// in the chunk, < chunk_end except for end()
+		uint64_t* words;
+		size_t chunk_end;	// elements of the chunk
+
+		inline iterator(SegmentedBitArray<Bits, ChunkWords>* ref_ptr, size_t chunk, size_t index);
+		inline void seek(size_t position);	// element of the whole array
+		inline size_t position() const;
+		friend class SegmentedBitArray<Bits, ChunkWords>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = typename SegmentedBitArray<Bits, ChunkWords>::reference;
+
+		inline iterator();
+
+		inline reference operator*() const;
+		inline reference operator[](difference_type value) const;
+		inline iterator& operator++();	// prefix
+		inline iterator& operator--();	// prefix
+		inline iterator operator++(int);	// postfix
+		inline iterator operator--(int);	// postfix
+		inline iterator& operator+=(difference_type val);
+		inline iterator& operator-=(difference_type val);
+		inline iterator operator+(difference_type value) const;
+		inline iterator operator-(difference_type value) const;
+		inline difference_type operator-(const iterator& other_it) const;
+		inline bool operator==(const iterator& other_it) const;
+		inline bool operator!=(const iterator& other_it) const;
+		inline bool operator<(const iterator& other_it) const;
+		inline bool operator>(const iterator& other_it) const;
+		inline bool operator<=(const iterator& other_it) const;
+		inline bool operator>=(const iterator& other_it) const;
+
+		friend inline iterator operator+(difference_type value, const iterator& it) {
+			return it + value;
+		}
+	};
+
+	// random access iterator, dereference gives the value
+	class const_iterator {
+	private:
+		iterator it;
+		friend class SegmentedBitArray<Bits, ChunkWords>;
+	public:
+		using iterator_category = std::random_access_iterator_tag;
+		using value_type = uint64_t;
+		using difference_type = std::ptrdiff_t;
+		using pointer = void;
+		using reference = uint64_t;
+
+		inline const_iterator();
+		inline const_iterator(const iterator& other_it);	// iterator => const_iterator
+
+		inline uint64_t operator*() const;
+		inline uint64_t operator[](difference_type value) const;
+		inline const_iterator& operator++();	// prefix
+		inline const_iterator& operator--();	// prefix
+		inline const_iterator operator++(int);	// postfix
+		inline const_iterator operator--(int);	// postfix
+		inline const_iterator& operator+=(difference_type val);
+		inline const_iterator& operator-=(difference_type val);
+		inline const_iterator operator+(difference_type value) const;
+		inline const_iterator operator-(difference_type value) const;
+		inline difference_type operator-(const const_iterator& other_it) const;
+
+		friend inline const_iterator operator+(difference_type value, const const_iterator& it) {
+			return it + value;
+		}
+		// friends => mixed iterator/const_iterator comparison
+		friend inline bool operator==(const const_iterator& left, const const_iterator& right) {
+			return left.it == right.it;
+		}
+		friend inline bool operator!=(const const_iterator& left, const const_iterator& right) {
+			return left.it != right.it;
+		}
+		friend inline bool operator<(const const_iterator& left, const const_iterator& right) {
+			return left.it < right.it;
+		}
+		friend inline bool operator>(const const_iterator& left, const const_iterator& right) {
+			return left.it > right.it;
+		}
+		friend inline bool operator<=(const const_iterator& left, const const_iterator& right) {
+			return left.it <= right.it;
+		}
+		friend inline bool operator>=(const const_iterator& left, const const_iterator& right) {
+			return left.it >= right.it;
+		}
+	};
+
+	explicit SegmentedBitArray(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	template<typename T>
+	explicit SegmentedBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	template<size_t InlineWords, BitArrayOverflow Overflow>
+	explicit SegmentedBitArray(const BitArray<Bits, InlineWords, Overflow>& other,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	SegmentedBitArray(const SegmentedBitArray<Bits, ChunkWords>& other);	// default resource, like BitArray
+	SegmentedBitArray(const SegmentedBitArray<Bits, ChunkWords>& other, std::pmr::memory_resource* resource);
+	inline SegmentedBitArray(SegmentedBitArray<Bits, ChunkWords>&& other) noexcept;
+	~SegmentedBitArray();
+
+	SegmentedBitArray& operator=(const SegmentedBitArray<Bits, ChunkWords>& other);
+	inline SegmentedBitArray& operator=(SegmentedBitArray<Bits, ChunkWords>&& other) noexcept;
+	inline void swap(SegmentedBitArray<Bits, ChunkWords>& other) noexcept;	// the resources are swapped too, like BitArray
+
+	inline size_t size() const;
+	inline bool empty() const;
+	inline std::pmr::memory_resource* resource() const;
+	inline size_t chunks() const;
+	size_t memory_bytes() const;	// chunks + directory
+
+	inline iterator begin();
+	inline iterator end();
+	inline const_iterator begin() const;
+	inline const_iterator end() const;
+	inline const_iterator cbegin() const;
+	inline const_iterator cend() const;
+
+	void resize(size_t new_size);	// new elements are 0
+	void clear();
+	void shrink_to_fit();	// packs the chunks full (index => chunk by division again), frees the rest
+
+	inline void pop_back();
+	void push_back(uint64_t val);
+
+	void erase(iterator beg_it, iterator end_it);
+	void insert(iterator it, uint64_t val);
+	void insert(iterator it, uint64_t val, size_t count);
+
+	// at - std::out_of_range, operator[] - checked only in debug builds (assert)
+	inline reference at(size_t index);
+	inline uint64_t at(size_t index) const;
+	inline reference operator[](size_t index);
+	inline uint64_t operator[](size_t index) const;
+	inline uint64_t unchecked_get(size_t index) const;
+
+	// bulk: the packing kernels run chunk by chunk
+	template<typename T> void unpack_to(T* out, size_t first, size_t count) const;
+	template<typename T> void pack_from(const T* in, size_t count);	// replaces the content, std::overflow_error => empty
+};
+
+// implementation
+
+// SegmentedBitArray
+template<size_t Bits, size_t ChunkWords>
+SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(std::pmr::memory_resource* resource)
+	: chunks_(resource), firsts_(resource) {}
+
+template<size_t Bits, size_t ChunkWords>
+template<typename T>
+SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(const std::vector<T>& vect, std::pmr::memory_resource* resource)
+	: SegmentedBitArray(resource) {
+	if constexpr (std::is_same_v<T, bool>) {	// no data() in std::vector<bool>
+		append(vect.size());
+		for (size_t i{}; i < vect.size(); ++i) {
+			if (vect[i]) {
+				(*this)[i] = 1;
+			}
+		}
+	}
+	else {
+		pack_from(vect.data(), vect.size());
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+template<size_t InlineWords, BitArrayOverflow Overflow>
+SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(const BitArray<Bits, InlineWords, Overflow>& other, std::pmr::memory_resource* resource)
+	: SegmentedBitArray(resource) {
+	append(other.size_);
+	for (size_t chunk{}; chunk < chunks_.size(); ++chunk) {
+		bitarray_detail::move_bits(chunks_[chunk], 0, other.memory_, firsts_[chunk] * Bits, count_of(chunk) * Bits);
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(const SegmentedBitArray<Bits, ChunkWords>& other)
+	: SegmentedBitArray(other, std::pmr::get_default_resource()) {}
+
+// same chunk layout, the used words of every chunk are copied
+template<size_t Bits, size_t ChunkWords>
+SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(const SegmentedBitArray<Bits, ChunkWords>& other, std::pmr::memory_resource* resource)
+	: SegmentedBitArray(resource) {
+	chunks_.reserve(other.chunks_.size());
+	firsts_.reserve(other.firsts_.size());
+	if (!other.chunks_.empty()) {
+		firsts_.push_back(0);
+	}
+	for (size_t chunk{}; chunk < other.chunks_.size(); ++chunk) {
+		uint64_t* words = allocate_chunk();
+		const size_t word_count = (other.count_of(chunk) * Bits + 63) / 64;
+		for (size_t i{}; i < word_count; ++i) {
+			words[i] = other.chunks_[chunk][i];
+		}
+		chunks_.push_back(words);
+		firsts_.push_back(other.firsts_[chunk + 1]);
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::SegmentedBitArray(SegmentedBitArray<Bits, ChunkWords>&& other) noexcept
+	: chunks_(std::move(other.chunks_)), firsts_(std::move(other.firsts_)) {
+	other.chunks_.clear();
+	other.firsts_.clear();
+}
+
+template<size_t Bits, size_t ChunkWords>
+SegmentedBitArray<Bits, ChunkWords>::~SegmentedBitArray() {
+	clear();
+}
+
+template<size_t Bits, size_t ChunkWords>
+SegmentedBitArray<Bits, ChunkWords>& SegmentedBitArray<Bits, ChunkWords>::operator=(const SegmentedBitArray<Bits, ChunkWords>& other) {
+	if (&other != this) {
+		SegmentedBitArray<Bits, ChunkWords> tmp(other, resource());
+		swap(tmp);
+	}
+
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>& SegmentedBitArray<Bits, ChunkWords>::operator=(SegmentedBitArray<Bits, ChunkWords>&& other) noexcept {
+	if (&other != this) {
+		SegmentedBitArray<Bits, ChunkWords> tmp(std::move(other));	// other is left empty
+		swap(tmp);
+	}
+
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::swap(SegmentedBitArray<Bits, ChunkWords>& other) noexcept {
+	if (resource() == other.resource()) {
+		chunks_.swap(other.chunks_);
+		firsts_.swap(other.firsts_);
+		return;
+	}
+
+	// pmr vectors never exchange allocators (swap is undefined, assignment copies) => the chunks would be freed
+	// through the wrong resource; the directories are rebuilt by move construction, which takes the resource along
+	std::pmr::vector<uint64_t*> chunks(std::move(chunks_));
+	std::pmr::vector<size_t> firsts(std::move(firsts_));
+	adopt(chunks_, other.chunks_);
+	adopt(firsts_, other.firsts_);
+	adopt(other.chunks_, chunks);
+	adopt(other.firsts_, firsts);
+}
+
+template<size_t Bits, size_t ChunkWords>
+template<typename T>
+inline void SegmentedBitArray<Bits, ChunkWords>::adopt(std::pmr::vector<T>& target, std::pmr::vector<T>& source) noexcept {
+	using vector = std::pmr::vector<T>;
+	target.~vector();
+	new (&target) vector(std::move(source));
+	source.clear();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t* SegmentedBitArray<Bits, ChunkWords>::allocate_chunk() {
+	uint64_t* chunk = static_cast<uint64_t*>(resource()->allocate(ChunkWords * sizeof(uint64_t), alignof(uint64_t)));
+	for (size_t i{}; i < ChunkWords; ++i) {
+		chunk[i] = 0;
+	}
+
+	return chunk;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::deallocate_chunk(uint64_t* chunk) {
+	if (chunk != nullptr) {
+		resource()->deallocate(chunk, ChunkWords * sizeof(uint64_t), alignof(uint64_t));
+	}
+}
+
+// a chunk never holds more than chunk_elems => the chunk is at least index / chunk_elems
+template<size_t Bits, size_t ChunkWords>
+inline size_t SegmentedBitArray<Bits, ChunkWords>::chunk_of(size_t index) const {
+	const size_t chunks = chunks_.size();
+	const size_t guess = index / chunk_elems;
+	if (guess < chunks && index < firsts_[guess + 1]) {
+		return guess;
+	}
+	if (!chunks) {
+		return 0;
+	}
+
+	const auto from = firsts_.begin() + (guess < chunks ? guess + 1 : chunks);
+	const auto to = firsts_.begin() + chunks;
+	return std::upper_bound(from, to, index) - firsts_.begin() - 1;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::iterator_at(size_t chunk, size_t index) const {
+	return iterator(const_cast<SegmentedBitArray<Bits, ChunkWords>*>(this), chunk, index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline size_t SegmentedBitArray<Bits, ChunkWords>::count_of(size_t chunk) const {
+	return firsts_[chunk + 1] - firsts_[chunk];
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::clear_elems(size_t chunk, size_t first, size_t last) {
+	uint64_t* words = chunks_[chunk];
+	const size_t bit = first * Bits;
+	size_t i = bit / 64;
+	if (bit % 64 != 0) {	// keep head of the word
+		words[i] &= ~(~uint64_t(0) >> (bit % 64));
+		++i;
+	}
+	const size_t end = (last * Bits + 63) / 64;
+	for (; i < end; ++i) {
+		words[i] = 0;
+	}
+}
+
+// fills the last chunk, then adds full chunks
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::append(size_t count) {
+	if (!count) {
+		return;
+	}
+
+	const size_t old_chunks = chunks_.size();
+	const size_t old_size = size();
+	const size_t room = old_chunks ? chunk_elems - count_of(old_chunks - 1) : 0;
+	if (count <= room) {
+		firsts_.back() += count;
+		return;
+	}
+
+	const size_t added = (count - room + chunk_elems - 1) / chunk_elems;
+	try {
+		chunks_.reserve(old_chunks + added);
+		firsts_.reserve(old_chunks + added + 1);
+		if (!old_chunks) {
+			firsts_.assign(1, 0);
+		}
+		firsts_.back() += room;
+		count -= room;
+		for (; count; ) {
+			const size_t take = std::min(count, chunk_elems);
+			chunks_.push_back(allocate_chunk());
+			firsts_.push_back(firsts_.back() + take);
+			count -= take;
+		}
+	}
+	catch (...) {
+		for (size_t chunk = old_chunks; chunk < chunks_.size(); ++chunk) {
+			deallocate_chunk(chunks_[chunk]);
+		}
+		chunks_.resize(old_chunks);
+		firsts_.resize(old_chunks ? old_chunks + 1 : 0);
+		if (old_chunks) {
+			firsts_.back() = old_size;
+		}
+		throw;
+	}
+}
+
+// head [0, local) + gap + tail [local, n) of the chunk are spread evenly over the fewest chunks,
+// the parts after the first go to new chunks before the first one is shifted in place
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::open_gap(size_t index, size_t count) {
+	if (index == size()) {
+		append(count);
+		return;
+	}
+
+	size_t chunk = chunk_of(index);
+	size_t local = index - firsts_[chunk];
+	if (local == 0 && chunk > 0 && count_of(chunk - 1) + count <= chunk_elems) {	// room at the end of the previous chunk
+		--chunk;
+		local = count_of(chunk);
+	}
+	uint64_t* words = chunks_[chunk];
+	const size_t n = count_of(chunk);
+
+	if (n + count <= chunk_elems) {	// fits the chunk
+		bitarray_detail::move_bits(words, (local + count) * Bits, words, local * Bits, (n - local) * Bits);
+		for (size_t i = chunk + 1; i < firsts_.size(); ++i) {
+			firsts_[i] += count;
+		}
+		return;
+	}
+
+	const size_t total = n + count;
+	const size_t parts = (total + chunk_elems - 1) / chunk_elems;
+	chunks_.reserve(chunks_.size() + parts - 1);
+	firsts_.reserve(firsts_.size() + parts - 1);
+	std::pmr::vector<uint64_t*> fresh(parts - 1, nullptr, resource());
+	try {
+		for (uint64_t*& part : fresh) {
+			part = allocate_chunk();
+		}
+	}
+	catch (...) {
+		for (uint64_t* part : fresh) {
+			deallocate_chunk(part);
+		}
+		throw;
+	}
+
+	const size_t gap_end = local + count;
+	const size_t first_end = total / parts + (total % parts != 0);	// part 0 = [0, first_end)
+	size_t part_first = first_end;
+	for (size_t part = 1; part < parts; ++part) {
+		const size_t part_last = part_first + total / parts + (part < total % parts);
+		uint64_t* out = fresh[part - 1];
+		if (part_first < local) {	// head elements
+			const size_t last = std::min(part_last, local);
+			bitarray_detail::move_bits(out, 0, words, part_first * Bits, (last - part_first) * Bits);
+		}
+		const size_t tail_first = std::max(part_first, gap_end);
+		if (tail_first < part_last) {	// tail elements
+			bitarray_detail::move_bits(out, (tail_first - part_first) * Bits, words, (tail_first - count) * Bits,
+				(part_last - tail_first) * Bits);
+		}
+		part_first = part_last;
+	}
+	if (gap_end < first_end) {	// tail elements staying in the chunk
+		bitarray_detail::move_bits(words, gap_end * Bits, words, local * Bits, (first_end - gap_end) * Bits);
+	}
+	clear_elems(chunk, first_end, n);
+
+	chunks_.insert(chunks_.begin() + chunk + 1, fresh.begin(), fresh.end());
+	firsts_.insert(firsts_.begin() + chunk + 1, parts - 1, 0);
+	part_first = firsts_[chunk] + first_end;
+	for (size_t part = 1; part < parts; ++part) {
+		firsts_[chunk + part] = part_first;
+		part_first += total / parts + (part < total % parts);
+	}
+	for (size_t i = chunk + parts; i < firsts_.size(); ++i) {
+		firsts_[i] += count;
+	}
+}
+
+// [first, last), first < last <= size: the ends stay in their chunks, whole chunks between are freed
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::remove(size_t first, size_t last) {
+	const size_t removed = last - first;
+	const size_t first_chunk = chunk_of(first);
+	const size_t last_chunk = chunk_of(last - 1);
+	const size_t head = first - firsts_[first_chunk];	// kept in first_chunk
+	const size_t tail = last - firsts_[last_chunk];	// removed from last_chunk
+	const size_t last_count = count_of(last_chunk);
+
+	uint64_t* words = chunks_[last_chunk];
+	if (first_chunk == last_chunk) {
+		bitarray_detail::move_bits(words, head * Bits, words, tail * Bits, (last_count - tail) * Bits);
+		clear_elems(last_chunk, last_count - removed, last_count);
+	}
+	else {
+		clear_elems(first_chunk, head, count_of(first_chunk));
+		bitarray_detail::move_bits(words, 0, words, tail * Bits, (last_count - tail) * Bits);
+		clear_elems(last_chunk, last_count - tail, last_count);
+
+		for (size_t chunk = first_chunk + 1; chunk < last_chunk; ++chunk) {
+			deallocate_chunk(chunks_[chunk]);
+		}
+		chunks_.erase(chunks_.begin() + first_chunk + 1, chunks_.begin() + last_chunk);
+		firsts_.erase(firsts_.begin() + first_chunk + 1, firsts_.begin() + last_chunk);
+		firsts_[first_chunk + 1] = firsts_[first_chunk] + head;	// start of the rest of last_chunk
+	}
+	for (size_t i = (first_chunk == last_chunk ? first_chunk + 1 : first_chunk + 2); i < firsts_.size(); ++i) {
+		firsts_[i] -= removed;
+	}
+
+	size_t chunk = first_chunk;
+	if (first_chunk != last_chunk && !count_of(chunk + 1)) {
+		drop_chunk(chunk + 1);
+	}
+	if (!count_of(chunk)) {	// chunk is the next one after this
+		drop_chunk(chunk);
+	}
+	if (chunk < chunks_.size()) {
+		merge_next(chunk);
+	}
+	if (chunk > 0) {
+		merge_next(chunk - 1);
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::drop_chunk(size_t chunk) {
+	deallocate_chunk(chunks_[chunk]);
+	chunks_.erase(chunks_.begin() + chunk);
+	firsts_.erase(firsts_.begin() + chunk);	// == firsts_[chunk + 1]
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::merge_next(size_t chunk) {
+	if (chunk + 1 >= chunks_.size()) {
+		return;
+	}
+	const size_t count = count_of(chunk);
+	const size_t next_count = count_of(chunk + 1);
+	if (count + next_count > merge_limit) {
+		return;
+	}
+
+	bitarray_detail::move_bits(chunks_[chunk], count * Bits, chunks_[chunk + 1], 0, next_count * Bits);
+	deallocate_chunk(chunks_[chunk + 1]);
+	chunks_.erase(chunks_.begin() + chunk + 1);
+	firsts_.erase(firsts_.begin() + chunk + 1);
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::fill(size_t first, size_t count, uint64_t val) {
+	for (size_t chunk = chunk_of(first); count; ++chunk) {
+		const size_t local = first - firsts_[chunk];
+		const size_t take = std::min(count, count_of(chunk) - local);
+		bitarray_detail::fill<Bits>(chunks_[chunk], local, take, val);
+		first += take;
+		count -= take;
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::check_index(size_t index) const {
+	if (index >= size()) {
+		throw std::out_of_range("Index " + std::to_string(index) + " out of range");
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline size_t SegmentedBitArray<Bits, ChunkWords>::size() const {
+	return chunks_.empty() ? 0 : firsts_.back();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::empty() const {
+	return chunks_.empty();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline std::pmr::memory_resource* SegmentedBitArray<Bits, ChunkWords>::resource() const {
+	return chunks_.get_allocator().resource();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline size_t SegmentedBitArray<Bits, ChunkWords>::chunks() const {
+	return chunks_.size();
+}
+
+template<size_t Bits, size_t ChunkWords>
+size_t SegmentedBitArray<Bits, ChunkWords>::memory_bytes() const {
+	return chunks_.size() * ChunkWords * sizeof(uint64_t)
+		+ chunks_.capacity() * sizeof(uint64_t*) + firsts_.capacity() * sizeof(size_t);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::begin() {
+	return iterator_at(0, 0);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::end() {
+	return chunks_.empty() ? iterator_at(0, 0) : iterator_at(chunks_.size() - 1, count_of(chunks_.size() - 1));
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::begin() const {
+	return iterator_at(0, 0);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::end() const {
+	return chunks_.empty() ? iterator_at(0, 0) : iterator_at(chunks_.size() - 1, count_of(chunks_.size() - 1));
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::cbegin() const {
+	return begin();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::cend() const {
+	return end();
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::resize(size_t new_size) {
+	if (new_size < size()) {
+		remove(new_size, size());
+	}
+	else {
+		append(new_size - size());
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::clear() {
+	for (uint64_t* chunk : chunks_) {
+		deallocate_chunk(chunk);
+	}
+	chunks_.clear();
+	firsts_.clear();
+}
+
+// elements move towards the front (never past their source) => one pass in place, no second copy of the data
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::shrink_to_fit() {
+	size_t out_chunk = 0;
+	size_t out_index = 0;
+	for (size_t chunk{}; chunk < chunks_.size(); ++chunk) {
+		const size_t count = count_of(chunk);
+		for (size_t done{}; done < count; ) {
+			const size_t take = std::min(count - done, chunk_elems - out_index);
+			bitarray_detail::move_bits(chunks_[out_chunk], out_index * Bits, chunks_[chunk], done * Bits, take * Bits);
+			done += take;
+			out_index += take;
+			if (out_index == chunk_elems) {
+				++out_chunk;
+				out_index = 0;
+			}
+		}
+	}
+
+	const size_t kept = out_chunk + (out_index != 0);
+	if (out_index != 0) {
+		clear_elems(out_chunk, out_index, chunk_elems);
+	}
+	for (size_t chunk = kept; chunk < chunks_.size(); ++chunk) {
+		deallocate_chunk(chunks_[chunk]);
+	}
+	const size_t count = size();
+	chunks_.resize(kept);
+	firsts_.resize(kept ? kept + 1 : 0);
+	for (size_t chunk{}; chunk < kept; ++chunk) {
+		firsts_[chunk] = chunk * chunk_elems;
+	}
+	if (kept) {
+		firsts_[kept] = count;
+	}
+	chunks_.shrink_to_fit();
+	firsts_.shrink_to_fit();
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::pop_back() {
+	if (empty()) {
+		throw std::out_of_range("Out of range, SegmentedBitArray is empty!");
+	}
+
+	remove(size() - 1, size());
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::push_back(uint64_t val) {
+	if (val > bitarray_detail::mask_of<Bits>()) {
+		throw std::overflow_error("Overflow");
+	}
+
+	append(1);
+	const size_t chunk = chunks_.size() - 1;
+	bitarray_detail::set<Bits>(chunks_[chunk], count_of(chunk) - 1, val);
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::erase(iterator beg_it, iterator end_it) {
+	if (beg_it.ref_ptr != end_it.ref_ptr || beg_it.ref_ptr != this) {
+		throw std::out_of_range("SegmentedBitArray::iterator | invalid iterator");
+	}
+
+	const size_t first = beg_it.position();
+	const size_t last = end_it.position();
+	if (first > last || last > size()) {
+		throw std::out_of_range("SegmentedBitArray::iterator | invalid iterator");
+	}
+	if (first != last) {
+		remove(first, last);
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::insert(iterator it, uint64_t val) {
+	insert(it, val, 1);
+}
+
+template<size_t Bits, size_t ChunkWords>
+void SegmentedBitArray<Bits, ChunkWords>::insert(iterator it, uint64_t val, size_t count) {
+	if (it.ref_ptr != this || it.position() > size()) {
+		throw std::out_of_range("SegmentedBitArray::iterator | invalid iterator");
+	}
+	if (val > bitarray_detail::mask_of<Bits>()) {
+		throw std::overflow_error("Overflow");
+	}
+	if (count == 0) {
+		return;
+	}
+
+	const size_t index = it.position();
+	open_gap(index, count);
+	fill(index, count, val);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference SegmentedBitArray<Bits, ChunkWords>::at(size_t index) {
+	check_index(index);
+	return (*this)[index];
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t SegmentedBitArray<Bits, ChunkWords>::at(size_t index) const {
+	check_index(index);
+	return unchecked_get(index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference SegmentedBitArray<Bits, ChunkWords>::operator[](size_t index) {
+	assert(index < size());
+	const size_t chunk = chunk_of(index);
+	return reference(chunks_[chunk], index - firsts_[chunk]);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t SegmentedBitArray<Bits, ChunkWords>::operator[](size_t index) const {
+	assert(index < size());
+	return unchecked_get(index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t SegmentedBitArray<Bits, ChunkWords>::unchecked_get(size_t index) const {
+	const size_t chunk = chunk_of(index);
+	return bitarray_detail::get<Bits>(chunks_[chunk], index - firsts_[chunk]);
+}
+
+template<size_t Bits, size_t ChunkWords>
+template<typename T>
+void SegmentedBitArray<Bits, ChunkWords>::unpack_to(T* out, size_t first, size_t count) const {
+	if (first > size() || count > size() - first) {
+		throw std::out_of_range("Out of range");
+	}
+
+	for (size_t chunk = count ? chunk_of(first) : 0; count; ++chunk) {
+		const size_t local = first - firsts_[chunk];
+		const size_t take = std::min(count, count_of(chunk) - local);
+		bitarray_detail::unpack<Bits>(chunks_[chunk], local, take, out);
+		out += take;
+		first += take;
+		count -= take;
+	}
+}
+
+template<size_t Bits, size_t ChunkWords>
+template<typename T>
+void SegmentedBitArray<Bits, ChunkWords>::pack_from(const T* in, size_t count) {
+	clear();
+	append(count);
+
+	uint64_t all = 0;
+	for (size_t chunk{}; chunk < chunks_.size(); ++chunk) {
+		all |= bitarray_detail::pack<Bits>(chunks_[chunk], 0, count_of(chunk), in + firsts_[chunk]);
+	}
+	if (all > bitarray_detail::mask_of<Bits>()) {
+		clear();
+		throw std::overflow_error("Overflow");
+	}
+}
+
+// SegmentedBitArray::reference
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::reference::reference(uint64_t* words, size_t index) : words(words), index(index) {}
+
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::reference::operator uint64_t() const {
+	return bitarray_detail::get<Bits>(words, index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference& SegmentedBitArray<Bits, ChunkWords>::reference::operator=(uint64_t val) {
+	if (val > bitarray_detail::mask_of<Bits>()) {
+		throw std::overflow_error("Overflow");
+	}
+
+	bitarray_detail::set<Bits>(words, index, val);
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference& SegmentedBitArray<Bits, ChunkWords>::reference::operator=(const reference& other) {
+	return *this = static_cast<uint64_t>(other);
+}
+
+// SegmentedBitArray::iterator
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::iterator::iterator(SegmentedBitArray<Bits, ChunkWords>* ref_ptr, size_t chunk, size_t index)
+	: ref_ptr(ref_ptr), chunk(chunk), index(index) {
+	const bool any = !ref_ptr->chunks_.empty();
+	words = any ? ref_ptr->chunks_[chunk] : nullptr;
+	chunk_end = any ? ref_ptr->count_of(chunk) : 0;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::iterator::iterator()
+	: ref_ptr(nullptr), chunk(0), index(0), words(nullptr), chunk_end(0) {}
+
+template<size_t Bits, size_t ChunkWords>
+inline void SegmentedBitArray<Bits, ChunkWords>::iterator::seek(size_t position) {
+	const size_t found = ref_ptr->chunk_of(position);
+	*this = iterator(ref_ptr, found, ref_ptr->chunks_.empty() ? 0 : position - ref_ptr->firsts_[found]);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline size_t SegmentedBitArray<Bits, ChunkWords>::iterator::position() const {
+	return words != nullptr ? ref_ptr->firsts_[chunk] + index : 0;	// no chunks => 0
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference SegmentedBitArray<Bits, ChunkWords>::iterator::operator*() const {
+	assert(ref_ptr != nullptr && index < chunk_end);
+	return typename SegmentedBitArray<Bits, ChunkWords>::reference(words, index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::reference SegmentedBitArray<Bits, ChunkWords>::iterator::operator[](difference_type value) const {
+	return *(*this + value);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator& SegmentedBitArray<Bits, ChunkWords>::iterator::operator++() {
+	if (++index == chunk_end && chunk + 1 < ref_ptr->chunks_.size()) {	// next chunk (end() stays in the last one)
+		++chunk;
+		index = 0;
+		words = ref_ptr->chunks_[chunk];
+		chunk_end = ref_ptr->count_of(chunk);
+	}
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator& SegmentedBitArray<Bits, ChunkWords>::iterator::operator--() {
+	if (index == 0) {
+		--chunk;
+		words = ref_ptr->chunks_[chunk];
+		chunk_end = ref_ptr->count_of(chunk);
+		index = chunk_end;
+	}
+	--index;
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::iterator::operator++(int) {
+	iterator tmp = *this;
+	++(*this);
+	return tmp;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::iterator::operator--(int) {
+	iterator tmp = *this;
+	--(*this);
+	return tmp;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator& SegmentedBitArray<Bits, ChunkWords>::iterator::operator+=(difference_type val) {
+	if (val >= 0 ? index + val < chunk_end : index >= static_cast<size_t>(-val)) {	// same chunk
+		index += val;
+	}
+	else {
+		seek(position() + val);
+	}
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator& SegmentedBitArray<Bits, ChunkWords>::iterator::operator-=(difference_type val) {
+	return *this += -val;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::iterator::operator+(difference_type value) const {
+	iterator tmp = *this;
+	return tmp += value;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator SegmentedBitArray<Bits, ChunkWords>::iterator::operator-(difference_type value) const {
+	iterator tmp = *this;
+	return tmp += -value;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::iterator::difference_type SegmentedBitArray<Bits, ChunkWords>::iterator::operator-(const iterator& other_it) const {
+	return static_cast<difference_type>(position()) - static_cast<difference_type>(other_it.position());
+}
+
+// positions are unique (an element is never at the end of a chunk) => (chunk, index) compare like positions
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator==(const iterator& other_it) const {
+	return index == other_it.index && chunk == other_it.chunk;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator!=(const iterator& other_it) const {
+	return !(*this == other_it);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator<(const iterator& other_it) const {
+	return chunk < other_it.chunk || (chunk == other_it.chunk && index < other_it.index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator>(const iterator& other_it) const {
+	return other_it < *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator<=(const iterator& other_it) const {
+	return !(other_it < *this);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline bool SegmentedBitArray<Bits, ChunkWords>::iterator::operator>=(const iterator& other_it) const {
+	return !(*this < other_it);
+}
+
+// SegmentedBitArray::const_iterator
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::const_iterator::const_iterator() : it() {}
+
+template<size_t Bits, size_t ChunkWords>
+inline SegmentedBitArray<Bits, ChunkWords>::const_iterator::const_iterator(const iterator& other_it) : it(other_it) {}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator*() const {
+	assert(it.ref_ptr != nullptr && it.index < it.chunk_end);
+	return bitarray_detail::get<Bits>(it.words, it.index);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline uint64_t SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator[](difference_type value) const {
+	return static_cast<uint64_t>(it[value]);
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator& SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator++() {
+	++it;
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator& SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator--() {
+	--it;
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator++(int) {
+	return it++;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator--(int) {
+	return it--;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator& SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator+=(difference_type val) {
+	it += val;
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator& SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator-=(difference_type val) {
+	it -= val;
+	return *this;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator+(difference_type value) const {
+	return it + value;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator-(difference_type value) const {
+	return it - value;
+}
+
+template<size_t Bits, size_t ChunkWords>
+inline typename SegmentedBitArray<Bits, ChunkWords>::const_iterator::difference_type SegmentedBitArray<Bits, ChunkWords>::const_iterator::operator-(const const_iterator& other_it) const {
+	return it - other_it.it;
+}
+
+#endif
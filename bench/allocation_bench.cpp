@@ -0,0 +1,51 @@
+#include "BitArray.h"
+#include "bench.h"
+
+#include <memory_resource>
+
+// BitArray<3> storage from the built-in resources: allocation + zeroing, sequential and random reads
+template<typename Resource>
+static void run(const char* name, Resource& resource, size_t count) {
+	double resize_ms = 0;
+	double sum_ms = 0;
+	double random_ms = 0;
+	{
+		BitArray<3> array(&resource);
+		resize_ms = bench_ms([&] {
+			BitArray<3> fresh(&resource);
+			fresh.resize(count);
+			bench_keep(fresh.size());
+		}, 3);
+
+		array.resize(count);
+		array.fill(5);
+		sum_ms = bench_ms([&] { bench_keep(array.sum()); }, 3);
+
+		const std::vector<uint64_t> idx = bench_values(size_t(1) << 22, count);
+		random_ms = bench_ms([&] {
+			uint64_t total = 0;
+			for (uint64_t index : idx) {
+				total += array.unchecked_get(index);
+			}
+			bench_keep(total);
+		}, 3);
+	}
+	std::printf("%-12s resize %9.1f ms   sum %8.1f ms   random get %6.1f ns\n",
+		name, resize_ms, sum_ms, random_ms * 1e6 / (size_t(1) << 22));
+}
+
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, 1000000000);
+	std::printf("BitArray<3>, %zu elements (%zu MB)\n", count, count * 3 / 8 / 1000000);
+
+	std::pmr::memory_resource& plain = *std::pmr::new_delete_resource();
+	BitArrayAlignedResource aligned;
+	BitArrayHugePageResource huge;
+	run("new/delete", plain, count);
+	run("aligned 64", aligned, count);
+	run("huge pages", huge, count);
+	{
+		std::pmr::monotonic_buffer_resource arena(count * 3 / 8 + 4096);
+		run("monotonic", arena, count);
+	}
+}
@@ -0,0 +1,49 @@
+#include "AtomicBitArray.h"
+#include "bench.h"
+
+#include <atomic>
+#include <thread>
+
+// histogram increments from several threads: AtomicBitArray<6> (elements straddle words => striped locks)
+// and AtomicBitArray<8> against std::vector<std::atomic<uint8_t>>
+template<typename F>
+static double run_threads(size_t threads, const std::vector<uint64_t>& idx, F increment) {
+	return bench_ms([&] {
+		std::vector<std::thread> workers;
+		const size_t per_thread = idx.size() / threads;
+		for (size_t t{}; t < threads; ++t) {
+			workers.emplace_back([&, t] {
+				for (size_t i = t * per_thread; i < (t + 1) * per_thread; ++i) {
+					increment(idx[i]);
+				}
+			});
+		}
+		for (std::thread& worker : workers) {
+			worker.join();
+		}
+	}, 3);
+}
+
+int main(int argc, char** argv) {
+	const size_t increments = bench_count(argc, argv, size_t(1) << 23);
+	const size_t max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4;
+	std::printf("%zu increments, ns/increment (wall time / increments)\n", increments);
+	for (size_t bins : { size_t(64), size_t(1) << 20 }) {
+		const std::vector<uint64_t> idx = bench_values(increments, bins);
+		std::printf("%zu bins\nthreads  atomic<uint8_t>  Atomic<8> add  Atomic<6> add  Atomic<6> saturate\n", bins);
+		for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+			std::vector<std::atomic<uint8_t>> baseline(bins);
+			AtomicBitArray<8> bytes(bins);
+			AtomicBitArray<6> counters(bins);
+			AtomicBitArray<6> saturated(bins);
+			const double times[4] = {
+				run_threads(threads, idx, [&](uint64_t bin) { baseline[bin].fetch_add(1, std::memory_order_relaxed); }),
+				run_threads(threads, idx, [&](uint64_t bin) { bytes.fetch_add(bin, 1, std::memory_order_relaxed); }),
+				run_threads(threads, idx, [&](uint64_t bin) { counters.fetch_add(bin, 1, std::memory_order_relaxed); }),
+				run_threads(threads, idx, [&](uint64_t bin) { saturated.fetch_add_saturate(bin, 1, std::memory_order_relaxed); }),
+			};
+			std::printf("%7zu  %15.1f  %13.1f  %13.1f  %17.1f\n", threads,
+				times[0] * 1e6 / increments, times[1] * 1e6 / increments, times[2] * 1e6 / increments, times[3] * 1e6 / increments);
+		}
+	}
+}
@@ -0,0 +1,45 @@
+#ifndef BITARRAY_BENCH_BENCH_H
+#define BITARRAY_BENCH_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// best of runs calls of f, milliseconds
+template<typename F>
+double bench_ms(F f, int runs = 5) {
+	double best = 0;
+	for (int run{}; run < runs; ++run) {
+		const auto start = std::chrono::steady_clock::now();
+		f();
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		best = run == 0 || ms < best ? ms : best;
+	}
+	return best;
+}
+
+// keeps a result alive so the measured loop isn't optimized out
+template<typename T>
+inline void bench_keep(const T& val) {
+	asm volatile("" : : "g"(&val) : "memory");
+}
+
+// element count from argv[1], fallback otherwise (smaller runs on small machines)
+inline size_t bench_count(int argc, char** argv, size_t fallback) {
+	return argc > 1 ? static_cast<size_t>(std::strtod(argv[1], nullptr)) : fallback;
+}
+
+// count random values below limit (fixed seed => runs compare)
+inline std::vector<uint64_t> bench_values(size_t count, uint64_t limit, uint64_t seed = 1) {
+	std::mt19937_64 rng(seed);
+	std::vector<uint64_t> values(count);
+	for (uint64_t& val : values) {
+		val = rng() % limit;
+	}
+	return values;
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "BlockBitArray.h"
+#include "bench.h"
+
+// skewed data (99% in [0, 8), 1% 20-bit): compression, decode throughput and random access against BitArray<20>
+template<typename Array>
+static void run(const char* name, const Array& array, double bytes, size_t count, const std::vector<uint64_t>& idx) {
+	std::vector<uint64_t> out(count);
+	const double decode = bench_ms([&] {
+		array.decode_to(out.data(), 0, count);
+		bench_keep(out[0]);
+	});
+	const double random = bench_ms([&] {
+		uint64_t total = 0;
+		for (uint64_t index : idx) {
+			total += array[index];
+		}
+		bench_keep(total);
+	});
+	std::printf("%-15s %6.1f MB  decode %5.2f GB/s (of uint64_t)  random access %5.1f ns\n", name, bytes / 1e6,
+		double(count * sizeof(uint64_t)) / decode / 1e6, random * 1e6 / idx.size());
+}
+
+// BitArray<20> under the same names as BlockBitArray
+struct plain_array {
+	BitArray<20> array;
+
+	void decode_to(uint64_t* out, size_t first, size_t count) const {
+		array.unpack_to(out, first, count);
+	}
+	uint64_t operator[](size_t index) const {
+		return array[index];
+	}
+};
+
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 24);
+	std::vector<uint64_t> values = bench_values(count, 8);
+	const std::vector<uint64_t> outliers = bench_values(count, 100, 2);
+	const std::vector<uint64_t> wide = bench_values(count, uint64_t(1) << 20, 3);
+	for (size_t i{}; i < count; ++i) {
+		values[i] = outliers[i] == 0 ? wide[i] : values[i];
+	}
+	const std::vector<uint64_t> idx = bench_values(size_t(1) << 22, count, 4);
+
+	plain_array plain{ BitArray<20>(values) };
+	const BlockBitArray<128> small_blocks(values);
+	const BlockBitArray<1024> big_blocks(values);
+	std::printf("%zu values, 99%% in [0, 8), 1%% 20-bit\n", count);
+	run("BitArray<20>", plain, double((count * 20 + 63) / 64 * 8), count, idx);
+	run("BlockSize 128", small_blocks, double(small_blocks.memory_bytes()), count, idx);
+	run("BlockSize 1024", big_blocks, double(big_blocks.memory_bytes()), count, idx);
+}
@@ -0,0 +1,40 @@
+#include "EncodedBitArray.h"
+#include "bench.h"
+
+// allocated bytes of the packed words
+template<size_t Bits>
+static double megabytes(const BitArray<Bits>& array) {
+	return double((array.capacity() * Bits + 63) / 64 * 8) / 1e6;
+}
+
+// memory and bulk decode of encoded arrays against a plain BitArray that covers the full range
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 24);
+	std::vector<uint64_t> out(count);
+	std::vector<int64_t> signed_out(count);
+
+	// millisecond timestamps of a 2^20 ms window: 41 bits absolute, 20 bits from the base
+	std::vector<uint64_t> stamps = bench_values(count, uint64_t(1) << 20);
+	for (uint64_t& stamp : stamps) {
+		stamp += 1700000000000;
+	}
+	const BitArray<41> plain(stamps);
+	const EncodedBitArray<20, BitArrayEncoding::offset> offsets(stamps);
+	std::printf("%zu timestamps\n", count);
+	std::printf("  BitArray<41>                %6.1f MB, decode %5.1f ms\n", megabytes(plain),
+		bench_ms([&] { plain.unpack_to(out.data(), 0, count); bench_keep(out[0]); }));
+	std::printf("  EncodedBitArray<20, offset> %6.1f MB, decode %5.1f ms\n", megabytes(offsets.packed()),
+		bench_ms([&] { offsets.decode_to(out.data(), 0, count); bench_keep(out[0]); }));
+
+	// signed deltas in [-1000, 1000]: int64_t or 11-bit zigzag
+	const std::vector<uint64_t> random = bench_values(count, 2001, 2);
+	std::vector<int64_t> deltas(count);
+	for (size_t i{}; i < count; ++i) {
+		deltas[i] = static_cast<int64_t>(random[i]) - 1000;
+	}
+	const EncodedBitArray<11, BitArrayEncoding::zigzag> zigzag(deltas);
+	std::printf("%zu deltas in [-1000, 1000]\n", count);
+	std::printf("  std::vector<int64_t>        %6.1f MB\n", double(count * sizeof(int64_t)) / 1e6);
+	std::printf("  EncodedBitArray<11, zigzag> %6.1f MB, decode %5.1f ms\n", megabytes(zigzag.packed()),
+		bench_ms([&] { zigzag.decode_to(signed_out.data(), 0, count); bench_keep(signed_out[0]); }));
+}
@@ -0,0 +1,49 @@
+#include "BitArray.h"
+#include "bench.h"
+
+// random lookups into 2^26 x BitArray<13>: operator[] loop against gather/scatter
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 26);
+	const size_t lookups = size_t(1) << 22;
+	BitArray<13> array(bench_values(count, uint64_t(1) << 13));
+	const BitArray<13>& const_array = array;
+	const std::vector<uint64_t> random = bench_values(lookups, count, 2);
+	const std::vector<size_t> idx(random.begin(), random.end());
+	const std::vector<uint64_t> vals = bench_values(lookups, uint64_t(1) << 13, 3);
+	std::vector<uint64_t> out(lookups);
+
+	const double loop = bench_ms([&] {
+		for (size_t i{}; i < lookups; ++i) {
+			out[i] = const_array[idx[i]];
+		}
+		bench_keep(out[0]);
+	});
+	const double gather = bench_ms([&] {
+		array.gather(idx.data(), lookups, out.data());
+		bench_keep(out[0]);
+	});
+	const double gather_no_prefetch = bench_ms([&] {
+		array.gather(idx.data(), lookups, out.data(), BitArrayBatchOrder::as_given, 0);
+		bench_keep(out[0]);
+	});
+	const double gather_by_word = bench_ms([&] {
+		array.gather(idx.data(), lookups, out.data(), BitArrayBatchOrder::by_word);
+		bench_keep(out[0]);
+	});
+	const double set_loop = bench_ms([&] {
+		for (size_t i{}; i < lookups; ++i) {
+			array[idx[i]] = vals[i];
+		}
+	});
+	const double scatter = bench_ms([&] {
+		array.scatter(idx.data(), vals.data(), lookups);
+	});
+
+	std::printf("BitArray<13>, %zu elements, %zu random indices, ns/lookup\n", count, lookups);
+	std::printf("operator[] get loop     %.1f\n", loop * 1e6 / lookups);
+	std::printf("gather                  %.1f\n", gather * 1e6 / lookups);
+	std::printf("gather, no prefetch     %.1f\n", gather_no_prefetch * 1e6 / lookups);
+	std::printf("gather, by_word         %.1f\n", gather_by_word * 1e6 / lookups);
+	std::printf("operator[] set loop     %.1f\n", set_loop * 1e6 / lookups);
+	std::printf("scatter                 %.1f\n", scatter * 1e6 / lookups);
+}
@@ -0,0 +1,52 @@
+#include "BitArray.h"
+#include "bench.h"
+
+#include <numeric>
+#include <stdexcept>
+
+// sequential traversal of BitArray<13>: the old checked dereference (end() rebuilt and compared per element)
+// against the iterators and std::accumulate
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 24);
+	const std::vector<uint64_t> values = bench_values(count, uint64_t(1) << 13);
+	BitArray<13> array(values);
+	const BitArray<13>& const_array = array;
+
+	const double checked = bench_ms([&] {
+		uint64_t total = 0;
+		for (auto it = array.begin(); it != array.end(); ++it) {
+			if (!(it < array.end())) {	// what operator* used to do
+				throw std::out_of_range("Out of range");
+			}
+			total += *it;
+		}
+		bench_keep(total);
+	});
+	const double mutable_it = bench_ms([&] {
+		uint64_t total = 0;
+		for (auto it = array.begin(); it != array.end(); ++it) {
+			total += *it;
+		}
+		bench_keep(total);
+	});
+	const double const_it = bench_ms([&] {
+		uint64_t total = 0;
+		for (uint64_t val : const_array) {
+			total += val;
+		}
+		bench_keep(total);
+	});
+	const double accumulate = bench_ms([&] {
+		bench_keep(std::accumulate(const_array.cbegin(), const_array.cend(), uint64_t(0)));
+	});
+	const double vector = bench_ms([&] {
+		bench_keep(std::accumulate(values.begin(), values.end(), uint64_t(0)));
+	});
+
+	std::printf("BitArray<13>, %zu elements, ns/element\n", count);
+	std::printf("old checked dereference  %.2f\n", checked * 1e6 / count);
+	std::printf("iterator                 %.2f\n", mutable_it * 1e6 / count);
+	std::printf("const_iterator range-for %.2f\n", const_it * 1e6 / count);
+	std::printf("std::accumulate          %.2f\n", accumulate * 1e6 / count);
+	std::printf("std::vector<uint64_t>    %.2f\n", vector * 1e6 / count);
+}
@@ -0,0 +1,46 @@
+#include "BitArray.h"
+#include "bench.h"
+
+#include <stdexcept>
+
+// random ++ on 4-bit counters (most of them overflow once the counters fill up) and bulk add_scalar per policy
+template<BitArrayOverflow Policy>
+static void run(const char* name, size_t counters, const std::vector<uint64_t>& idx) {
+	BitArray<4, 0, Policy> array;
+	array.resize(counters);
+	const double increment = bench_ms([&] {
+		for (uint64_t index : idx) {
+			if constexpr (Policy == BitArrayOverflow::throw_error) {
+				try {
+					++array[index];
+				}
+				catch (const std::overflow_error&) {
+				}
+			}
+			else {
+				++array[index];
+			}
+		}
+	}, 1);
+	array.fill(0);
+	const double bulk = bench_ms([&] {
+		try {
+			array.add_scalar(1);
+		}
+		catch (const std::overflow_error&) {
+		}
+	});
+
+	std::printf("%-12s ++ %7.1f ns   add_scalar %6.3f ns/element\n", name, increment * 1e6 / idx.size(), bulk * 1e6 / counters);
+}
+
+int main(int argc, char** argv) {
+	const size_t increments = bench_count(argc, argv, size_t(1) << 24);
+	for (size_t counters : { size_t(1) << 20, size_t(1) << 16 }) {
+		const std::vector<uint64_t> idx = bench_values(increments, counters);
+		std::printf("BitArray<4>, %zu counters, %zu random increments\n", counters, increments);
+		run<BitArrayOverflow::throw_error>("throw_error", counters, idx);
+		run<BitArrayOverflow::wrap>("wrap", counters, idx);
+		run<BitArrayOverflow::saturate>("saturate", counters, idx);
+	}
+}
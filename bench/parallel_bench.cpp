@@ -0,0 +1,40 @@
+#include "ParallelBitArray.h"
+#include "bench.h"
+
+#include <thread>
+
+// parallel algorithms on BitArray<7>, 1, 2, 4 ... threads up to argv[2] (hardware_concurrency by default)
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 26);
+	const size_t max_threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10)
+		: std::thread::hardware_concurrency() ? std::thread::hardware_concurrency() : 1;
+	const std::vector<uint8_t> values = [&] {
+		const std::vector<uint64_t> random = bench_values(count, 100);
+		return std::vector<uint8_t>(random.begin(), random.end());
+	}();
+	BitArray<7, 0, BitArrayOverflow::wrap> array(values);
+	BitArray<7, 0, BitArrayOverflow::wrap> out;
+
+	std::printf("BitArray<7>, %zu elements, ms (speedup against 1 thread)\n", count);
+	std::printf("threads  for_each        transform       reduce          assign\n");
+	double base[4]{};
+	for (size_t threads = 1;; threads *= 2) {
+		threads = threads < max_threads ? threads : max_threads;
+		BitArrayThreadPool pool(threads);
+		const double times[4] = {
+			bench_ms([&] { parallel_for_each(array, [](auto ref) { ++ref; }, pool); }, 3),
+			bench_ms([&] { parallel_transform(static_cast<const decltype(array)&>(array), out, [](uint64_t val) { return val / 2; }, pool); }, 3),
+			bench_ms([&] { bench_keep(parallel_reduce(static_cast<const decltype(array)&>(array), uint64_t(0), std::plus<>{}, pool)); }, 3),
+			bench_ms([&] { parallel_assign(out, values, pool); }, 3),
+		};
+		std::printf("%7zu", threads);
+		for (size_t i{}; i < 4; ++i) {
+			base[i] = threads == 1 ? times[i] : base[i];
+			std::printf("  %7.1f (%4.2fx)", times[i], base[i] / times[i]);
+		}
+		std::printf("\n");
+		if (threads == max_threads) {
+			break;
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#include "BitArray.h"
+#include "bench.h"
+
+// rank/select on a 2^28-bit BitArray<1> (half ones) against linear scans (element loop, popcount kernel)
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 28);
+	BitArray<1> bits(bench_values(count, 2));
+	const size_t ones = bits.count();
+	const size_t queries = size_t(1) << 20;
+	const size_t scans = 64;
+	const std::vector<uint64_t> positions = bench_values(queries, count + 1, 2);
+	const std::vector<uint64_t> ranks = bench_values(queries, ones, 3);
+
+	const double build = bench_ms([&] {
+		bits.drop_rank_index();
+		bits.build_rank_index();
+	});
+	const double rank = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t pos : positions) {
+			total += bits.rank1(pos);
+		}
+		bench_keep(total);
+	});
+	const double select = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t k : ranks) {
+			total += bits.select1(k);
+		}
+		bench_keep(total);
+	});
+	const double rank0 = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t pos : positions) {
+			total += bits.rank0(pos);
+		}
+		bench_keep(total);
+	});
+
+	// the scans: popcount of the whole words before pos (+ the partial word), ones counted word by word
+	const BitArray<1>& const_bits = bits;
+	const double rank_scan = bench_ms([&] {
+		size_t total = 0;
+		for (size_t q{}; q < scans; ++q) {
+			const size_t pos = positions[q];
+			size_t ones_before = 0;
+			for (size_t i{}; i < pos; ++i) {
+				ones_before += const_bits[i];
+			}
+			total += ones_before;
+		}
+		bench_keep(total);
+	}, 1);
+	const double rank_count = bench_ms([&] {
+		size_t total = 0;
+		for (size_t q{}; q < scans; ++q) {
+			total += const_bits.sum(0, positions[q]);
+		}
+		bench_keep(total);
+	}, 1);
+
+	const double select_count = bench_ms([&] {
+		constexpr size_t block = 4096;
+		size_t total = 0;
+		for (size_t q{}; q < scans; ++q) {
+			size_t k = ranks[q];
+			size_t first = 0;
+			for (size_t in_block; (in_block = const_bits.sum(first, block)) <= k; first += block) {
+				k -= in_block;
+			}
+			for (;; ++first) {
+				if (const_bits[first] && k-- == 0) {
+					break;
+				}
+			}
+			total += first;
+		}
+		bench_keep(total);
+	}, 1);
+
+	std::printf("BitArray<1>, %zu bits, %zu ones\n", count, ones);
+	std::printf("index build       %8.1f ms\n", build);
+	std::printf("rank1             %8.1f ns\n", rank * 1e6 / queries);
+	std::printf("rank0             %8.1f ns\n", rank0 * 1e6 / queries);
+	std::printf("select1           %8.1f ns\n", select * 1e6 / queries);
+	std::printf("rank by iterator  %8.2f ms\n", rank_scan / scans);
+	std::printf("rank by popcount  %8.2f ms\n", rank_count / scans);
+	std::printf("select by popcount %7.2f ms\n", select_count / scans);
+}
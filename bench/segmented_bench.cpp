@@ -0,0 +1,52 @@
+#include "SegmentedBitArray.h"
+#include "bench.h"
+
+#include <cstring>
+#include <sys/resource.h>
+
+// SegmentedBitArray<10> against BitArray<10>: push_back growth (worst single call, peak RSS), middle inserts, a sum
+// peak RSS is per process => one container per run, argv[2] = "bitarray" or "segmented" (both by default, RSS of both)
+template<typename Array>
+static void run(const char* name, size_t count) {
+	Array array;
+	double worst = 0;
+	const double total = bench_ms([&] {
+		for (size_t i{}; i < count; ++i) {
+			const auto start = std::chrono::steady_clock::now();
+			array.push_back(i & 1023);
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+			worst = ms > worst ? ms : worst;
+		}
+	}, 1);
+	rusage usage{};
+	getrusage(RUSAGE_SELF, &usage);
+
+	const size_t inserts = 1000;
+	const double insert = bench_ms([&] {
+		for (size_t i{}; i < inserts; ++i) {
+			array.insert(array.begin() + array.size() / 2, i & 1023);
+		}
+	}, 1);
+	const double sum = bench_ms([&] {
+		uint64_t total = 0;
+		for (uint64_t val : static_cast<const Array&>(array)) {
+			total += val;
+		}
+		bench_keep(total);
+	});
+
+	std::printf("%-10s push_back %8.1f ms (worst call %7.3f ms), peak RSS %6.1f MB | %zu middle inserts %9.2f ms | sum %6.1f ms\n",
+		name, total, worst, double(usage.ru_maxrss) / 1024, inserts, insert, sum);
+}
+
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 26);
+	const char* mode = argc > 2 ? argv[2] : "";
+	std::printf("%zu 10-bit push_backs\n", count);
+	if (std::strcmp(mode, "segmented") != 0) {
+		run<BitArray<10>>("BitArray", count);
+	}
+	if (std::strcmp(mode, "bitarray") != 0) {
+		run<SegmentedBitArray<10>>("Segmented", count);
+	}
+}
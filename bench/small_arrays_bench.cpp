@@ -0,0 +1,51 @@
+#include "BitArray.h"
+#include "bench.h"
+
+#include <memory_resource>
+
+// bytes handed out by the upstream resource
+class byte_counter : public std::pmr::memory_resource {
+public:
+	size_t bytes = 0;
+private:
+	void* do_allocate(size_t size, size_t alignment) override {
+		bytes += size;
+		return std::pmr::new_delete_resource()->allocate(size, alignment);
+	}
+	void do_deallocate(void* ptr, size_t size, size_t alignment) override {
+		bytes -= size;
+		std::pmr::new_delete_resource()->deallocate(ptr, size, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+// one million BitArray<4> with 6 flags each: object + heap bytes, build and destroy time
+template<size_t InlineWords>
+static void run(size_t count) {
+	byte_counter counter;
+	std::vector<BitArray<4, InlineWords>> arrays;
+	arrays.reserve(count);
+	const double build = bench_ms([&] {
+		for (size_t i{}; i < count; ++i) {
+			arrays.emplace_back(&counter);
+			for (uint64_t flag{}; flag < 6; ++flag) {
+				arrays.back().push_back(flag);
+			}
+		}
+	}, 1);
+	const size_t heap = counter.bytes;
+	const double destroy = bench_ms([&] { arrays.clear(); }, 1);
+
+	std::printf("InlineWords %zu: %2zu B object + %5.1f B heap per array, build %5.1f ns, destroy %5.1f ns\n",
+		InlineWords, sizeof(BitArray<4, InlineWords>), double(heap) / count, build * 1e6 / count, destroy * 1e6 / count);
+}
+
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, 1000000);
+	std::printf("%zu x BitArray<4> with 6 elements (heap bytes as requested from the resource)\n", count);
+	run<0>(count);
+	run<1>(count);
+	run<2>(count);
+}
@@ -0,0 +1,76 @@
+#include "BitArray.h"
+#include "bench.h"
+
+#include <algorithm>
+
+// sort() and lower_bound (plain, with the skip table) against std::sort/std::lower_bound on std::vector<uint32_t>,
+// plus short arrays of 16-bit elements (radix sort below 2^16 elements, counting sort from there on)
+template<size_t Bits>
+static void run(size_t count, const std::vector<uint64_t>& keys) {
+	const std::vector<uint64_t> values = bench_values(count, uint64_t(1) << Bits);
+	const std::vector<uint32_t> narrow(values.begin(), values.end());
+
+	BitArray<Bits> array;
+	const double sort = bench_ms([&] {
+		array = values;
+		array.sort();
+	}, 3);
+	std::vector<uint32_t> vect;
+	const double std_sort = bench_ms([&] {
+		vect = narrow;
+		std::sort(vect.begin(), vect.end());
+	}, 3);
+
+	const BitArraySkipTable table = array.skip_table();
+	const double search = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t key : keys) {
+			total += array.lower_bound(key & bitarray_detail::mask_of<Bits>());
+		}
+		bench_keep(total);
+	});
+	const double table_search = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t key : keys) {
+			total += array.lower_bound(key & bitarray_detail::mask_of<Bits>(), table);
+		}
+		bench_keep(total);
+	});
+	const double std_search = bench_ms([&] {
+		size_t total = 0;
+		for (uint64_t key : keys) {
+			total += std::lower_bound(vect.begin(), vect.end(), uint32_t(key & bitarray_detail::mask_of<Bits>())) - vect.begin();
+		}
+		bench_keep(total);
+	});
+
+	std::printf("Bits %2zu: sort %8.2f ms, std::sort %8.2f ms | %zu lower_bound %7.2f ms, skip table %7.2f ms, std %7.2f ms\n",
+		Bits, sort, std_sort, keys.size(), search, table_search, std_search);
+}
+
+// many short arrays: before the size switch every sort() cleared and scanned 2^16 counters
+static void run_short(size_t count) {
+	const std::vector<uint64_t> values = bench_values(count, uint64_t(1) << 16, 5);
+	BitArray<16> array;
+	const size_t repeats = (size_t(1) << 20) / count;
+	const double sort = bench_ms([&] {
+		for (size_t r{}; r < repeats; ++r) {
+			array = values;
+			array.sort();
+		}
+		bench_keep(array);
+	}, 3);
+	std::printf("Bits 16, %6zu elements: %.3f us per sort()\n", count, sort * 1000 / double(repeats));
+}
+
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 24);
+	const std::vector<uint64_t> keys = bench_values(size_t(1) << 22, uint64_t(1) << 32, 2);
+	std::printf("%zu random values\n", count);
+	run<12>(count, keys);
+	run<20>(count, keys);
+	run<32>(count, keys);
+	for (size_t n : {size_t(100), size_t(1000), size_t(10000), size_t(100000)}) {
+		run_short(n);
+	}
+}
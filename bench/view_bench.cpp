@@ -0,0 +1,48 @@
+#include "BitArrayView.h"
+#include "bench.h"
+
+// views of 10-bit elements: on the word grid (kernels in place), off the grid (aligned blocks), the BitArray itself;
+// element writes through BitArraySpan<1> with and without the rank index link of a BitArray<1>
+int main(int argc, char** argv) {
+	const size_t count = bench_count(argc, argv, size_t(1) << 24);
+	const BitArray<10> array(bench_values(count, 1024));
+	std::vector<uint64_t> shifted((count * 10 + 63) / 64 + 1, 0);
+	const BitArraySpan<10> off_grid(shifted.data(), 3, count);
+	for (size_t i{}; i < count; ++i) {
+		off_grid[i] = array[i];
+	}
+	const BitArrayView<10> on_grid(array);
+
+	std::printf("%zu 10-bit elements, ms: sum, count(7), minmax\n", count);
+	std::printf("BitArray  %7.1f %7.1f %7.1f\n",
+		bench_ms([&] { bench_keep(array.sum()); }),
+		bench_ms([&] { bench_keep(array.count(7)); }),
+		bench_ms([&] { bench_keep(array.minmax()); }));
+	std::printf("on grid   %7.1f %7.1f %7.1f\n",
+		bench_ms([&] { bench_keep(on_grid.sum()); }),
+		bench_ms([&] { bench_keep(on_grid.count(7)); }),
+		bench_ms([&] { bench_keep(on_grid.minmax()); }));
+	std::printf("off grid  %7.1f %7.1f %7.1f\n",
+		bench_ms([&] { bench_keep(off_grid.sum()); }),
+		bench_ms([&] { bench_keep(off_grid.count(7)); }),
+		bench_ms([&] { bench_keep(off_grid.minmax()); }));
+
+	BitArray<1> bits(bench_values(count, 2, 2));
+	bits.build_rank_index();
+	std::vector<uint64_t> words((count + 63) / 64, 0);
+	const BitArraySpan<1> linked(bits);
+	const BitArraySpan<1> plain(words.data(), 0, count);
+	std::printf("element writes through BitArraySpan<1>, ms: of a BitArray<1> %.1f, of plain words %.1f\n",
+		bench_ms([&] {
+			for (size_t i{}; i < count; ++i) {
+				linked[i] = i & 1;
+			}
+			bench_keep(bits);
+		}),
+		bench_ms([&] {
+			for (size_t i{}; i < count; ++i) {
+				plain[i] = i & 1;
+			}
+			bench_keep(words);
+		}));
+}
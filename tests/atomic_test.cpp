@@ -0,0 +1,187 @@
+#include "AtomicBitArray.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// AtomicBitArray against an element model: every operation on every element (inside a word and across two),
+// the limits of the saturating ones, and threads adding to the same elements while their neighbours keep their values
+
+template<size_t Bits>
+static bool holds(const AtomicBitArray<Bits>& array, const std::vector<uint64_t>& model) {
+	return holds_model(array.snapshot(), model);
+}
+
+template<size_t Bits>
+static AtomicBitArray<Bits> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return AtomicBitArray<Bits>(array);
+}
+
+template<size_t Bits>
+static void test_operations() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	constexpr size_t size = 3 * 64 + 5;	// every offset in a word, elements across words for Bits not dividing 64
+	std::vector<uint64_t> model = random_values(size, Bits, Bits);
+	AtomicBitArray<Bits> array = make<Bits>(model);
+	CHECK(holds(array, model));
+
+	for (size_t i{}; i < size; ++i) {
+		CHECK(array.load(i) == model[i]);
+		const uint64_t val = (model[i] * 7 + 1) & mask;
+		CHECK(array.exchange(i, val) == model[i]);
+		model[i] = val;
+		CHECK(array.fetch_add(i, 5) == model[i]);
+		model[i] = (model[i] + 5) & mask;
+		CHECK(array.fetch_sub(i, 9) == model[i]);
+		model[i] = (model[i] - 9) & mask;
+
+		// compare_exchange: a wrong expected gets the element, nothing is written
+		uint64_t expected = model[i] ^ 1;
+		CHECK(!array.compare_exchange(i, expected, 0) && expected == model[i]);
+		CHECK(array.compare_exchange(i, expected, mask - model[i]) && expected == model[i]);
+		model[i] = mask - model[i];
+
+		// saturating at both limits
+		array.store(i, mask - 1);
+		CHECK(array.fetch_add_saturate(i) == mask - 1 && array.load(i) == mask);
+		CHECK(array.fetch_add_saturate(i, 1) == mask && array.load(i) == mask);
+		CHECK(array.fetch_add_saturate(i, mask) == mask && array.load(i) == mask);
+		CHECK(array.fetch_add(i, 1) == mask && array.load(i) == 0);	// the plain one wraps
+		CHECK(array.fetch_sub_saturate(i) == 0 && array.load(i) == 0);
+		array.store(i, 1);
+		CHECK(array.fetch_sub_saturate(i, mask) == 1 && array.load(i) == 0);
+		CHECK(array.fetch_sub(i, 1) == 0 && array.load(i) == mask);
+		array.store(i, mask / 2);
+		CHECK(array.fetch_add_saturate(i, mask / 2 + 1) == mask / 2 && array.load(i) == mask);
+		CHECK(array.fetch_sub_saturate(i, ~uint64_t(0)) == mask && array.load(i) == 0);
+		array.store(i, model[i]);
+
+		CHECK(holds(array, model));	// the neighbours are untouched
+	}
+
+	// errors change nothing
+	bool thrown = false;
+	try {
+		array.store(size - 1, mask + 1);
+	}
+	catch (const std::overflow_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	thrown = false;
+	try {
+		uint64_t expected = model[0];
+		array.compare_exchange(0, expected, mask + 1);
+	}
+	catch (const std::overflow_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	thrown = false;
+	try {
+		array.fetch_add(size, 1);
+	}
+	catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	CHECK(thrown && holds(array, model));
+}
+
+// threads add to the even elements (fetch_add, fetch_sub and a compare_exchange loop), the odd ones in between
+// must keep their values; with Bits not dividing 64 many of the even elements cross two words
+template<size_t Bits>
+static void test_threads() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	constexpr size_t size = 2 * 64 + 3;
+	constexpr size_t threads = 4;
+	constexpr size_t rounds = 2000;
+	const std::vector<uint64_t> model = random_values(size, Bits, Bits + 100);
+	AtomicBitArray<Bits> array = make<Bits>(model);
+
+	std::vector<std::thread> workers;
+	for (size_t t{}; t < threads; ++t) {
+		workers.emplace_back([&array, t]() {
+			for (size_t round{}; round < rounds; ++round) {
+				for (size_t i = 0; i < size; i += 2) {
+					switch ((i / 2 + t + round) % 3) {
+					case 0:
+						array.fetch_add(i, 3);
+						break;
+					case 1:
+						array.fetch_sub(i, 1);
+						array.fetch_add(i, 4);
+						break;
+					default: {
+						uint64_t expected = array.load(i);
+						while (!array.compare_exchange(i, expected, (expected + 3) & mask)) {
+						}
+					}
+					}
+				}
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	std::vector<uint64_t> expected = model;
+	for (size_t i = 0; i < size; i += 2) {
+		expected[i] = (expected[i] + 3 * threads * rounds) & mask;
+	}
+	CHECK(holds(array, expected));
+}
+
+// many threads saturating the same element straddling two words (or the first one for Bits dividing 64)
+template<size_t Bits>
+static void test_threads_saturate() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	constexpr size_t index = 64 / Bits;	// crosses into word 1 unless 64 % Bits == 0
+	AtomicBitArray<Bits> array(index + 2);
+	array.store(index - 1, mask);
+	array.store(index, mask - 100 < mask ? mask - 100 : 0);
+	array.store(index + 1, mask);
+
+	std::vector<std::thread> workers;
+	for (size_t t{}; t < 4; ++t) {
+		workers.emplace_back([&array]() {
+			for (size_t round{}; round < 1000; ++round) {
+				array.fetch_add_saturate(index, 1);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	CHECK(array.load(index - 1) == mask && array.load(index) == mask && array.load(index + 1) == mask);
+
+	workers.clear();
+	array.store(index, 100 < mask ? 100 : mask);
+	for (size_t t{}; t < 4; ++t) {
+		workers.emplace_back([&array]() {
+			for (size_t round{}; round < 1000; ++round) {
+				array.fetch_sub_saturate(index, 1);
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+	CHECK(array.load(index - 1) == mask && array.load(index) == 0 && array.load(index + 1) == mask);
+}
+
+int main() {
+	CHECK(AtomicBitArray<8>::is_always_lock_free && !AtomicBitArray<7>::is_always_lock_free);
+	CHECK(AtomicBitArray<3>().empty() && AtomicBitArray<3>(10).load(9) == 0);
+	for_widths<1, 3, 7, 8, 13, 16, 31, 32, 33, 63>([](auto bits) {
+		test_operations<bits>();
+		test_threads<bits>();
+		test_threads_saturate<bits>();
+	});
+	return 0;
+}
@@ -0,0 +1,176 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <vector>
+
+// bitwise algebra, flip and the BitArray<1> bitset operations against std::vector<bool> / element models
+// (bitset_scalar runs it again with BITARRAY_NO_SIMD)
+
+template<size_t Bits>
+static BitArray<Bits> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+// the bits after size() in the last word must still be zero: growing keeps that word as it is
+template<size_t Bits>
+static bool zero_tail(BitArray<Bits> array) {
+	const size_t size = array.size();
+	array.resize(size + 130);
+	for (size_t i = size; i < array.size(); ++i) {
+		if (array[i] != 0) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static const size_t sizes[] = {0, 1, 5, 63, 64, 65, 127, 128, 200, 1000};
+
+template<size_t Bits>
+static void test_algebra() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	for (size_t size : sizes) {
+		const std::vector<uint64_t> x = random_values(size, Bits, size * 7 + Bits);
+		const std::vector<uint64_t> y = random_values(size, Bits, size * 11 + Bits);
+		std::vector<uint64_t> model_and(size), model_or(size), model_xor(size), model_andnot(size), model_flip(size);
+		for (size_t i{}; i < size; ++i) {
+			model_and[i] = x[i] & y[i];
+			model_or[i] = x[i] | y[i];
+			model_xor[i] = x[i] ^ y[i];
+			model_andnot[i] = x[i] & ~y[i];
+			model_flip[i] = mask - x[i];
+		}
+		const BitArray<Bits> a = make<Bits>(x), b = make<Bits>(y);
+		BitArray<Bits> c = a;
+		c &= b;
+		CHECK(holds_model(c, model_and) && zero_tail(c));
+		c = a;
+		c |= b;
+		CHECK(holds_model(c, model_or) && zero_tail(c));
+		c = a;
+		c ^= b;
+		CHECK(holds_model(c, model_xor) && zero_tail(c));
+		c = a;
+		c.andnot(b);
+		CHECK(holds_model(c, model_andnot) && zero_tail(c));
+		c = a;
+		c.flip();
+		CHECK(holds_model(c, model_flip) && zero_tail(c));
+		c.flip();
+		CHECK(holds_model(c, x) && zero_tail(c));
+
+		// sizes must match, the target is left as it was
+		BitArray<Bits> longer = make<Bits>(x);
+		longer.push_back(0);
+		c = a;
+		bool thrown = false;
+		try {
+			c &= longer;
+		}
+		catch (const std::length_error&) {
+			thrown = true;
+		}
+		CHECK(thrown && holds_model(c, x));
+		thrown = false;
+		try {
+			longer |= c;
+		}
+		catch (const std::length_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		thrown = false;
+		try {
+			c ^= longer;
+		}
+		catch (const std::length_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+		thrown = false;
+		try {
+			c.andnot(longer);
+		}
+		catch (const std::length_error&) {
+			thrown = true;
+		}
+		CHECK(thrown && holds_model(c, x));
+	}
+}
+
+static bool same_bits(const BitArray<1>& array, const std::vector<bool>& model) {
+	if (array.size() != model.size()) {
+		return false;
+	}
+	for (size_t i{}; i < model.size(); ++i) {
+		if (array[i] != model[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void check_tests(const BitArray<1>& array, const std::vector<bool>& model) {
+	size_t ones = 0;
+	for (bool bit : model) {
+		ones += bit;
+	}
+	CHECK(array.count() == ones);
+	CHECK(array.any() == (ones != 0));
+	CHECK(array.none() == (ones == 0));
+	CHECK(array.all() == (ones == model.size()));
+}
+
+static void test_bitset() {
+	for (size_t size : sizes) {
+		const std::vector<uint64_t> values = random_values(size, 1, size + 3);
+		const std::vector<bool> model(values.begin(), values.end());
+		const BitArray<1> bits = make<1>(values);
+		check_tests(bits, model);
+
+		// all zeros / all ones, the zero tail must not spoil all()
+		BitArray<1> ones = make<1>(std::vector<uint64_t>(size, 0));
+		check_tests(ones, std::vector<bool>(size, false));
+		ones.flip();
+		check_tests(ones, std::vector<bool>(size, true));
+		CHECK(zero_tail(ones));
+
+		for (size_t shift : {size_t(0), size_t(1), size_t(7), size_t(63), size_t(64), size_t(65), size_t(130),
+				size ? size - 1 : 0, size, size + 1, size + 64}) {
+			std::vector<bool> model_left(size, false), model_right(size, false);
+			for (size_t i = shift; i < size; ++i) {
+				model_left[i] = model[i - shift];
+				model_right[i - shift] = model[i];
+			}
+			BitArray<1> left = bits;
+			left.shift_left(shift);
+			CHECK(same_bits(left, model_left) && zero_tail(left));
+			check_tests(left, model_left);
+			BitArray<1> right = bits;
+			right.shift_right(shift);
+			CHECK(same_bits(right, model_right) && zero_tail(right));
+			check_tests(right, model_right);
+
+			// shifting all ones brings in zeros at the right place
+			BitArray<1> full = ones;
+			full.shift_left(shift);
+			CHECK(full.count() == (shift < size ? size - shift : 0) && zero_tail(full));
+			full = ones;
+			full.shift_right(shift);
+			CHECK(full.count() == (shift < size ? size - shift : 0) && zero_tail(full));
+		}
+	}
+}
+
+int main() {
+	for_widths<1, 2, 3, 5, 7, 8, 13, 21, 32, 33, 63>([](auto bits) {
+		test_algebra<bits>();
+	});
+	test_bitset();
+	return 0;
+}
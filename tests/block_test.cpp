@@ -0,0 +1,109 @@
+#include "BlockBitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// BlockBitArray against the values it was built from: blocks full of exceptions, all-ones and all-zero blocks,
+// a last partial block, decode_to over any range and at() out of range; BlockSize 65536 takes the heap scratch path
+
+template<size_t BlockSize>
+static void check_array(const std::vector<uint64_t>& model) {
+	const BlockBitArray<BlockSize> array(model);
+	const size_t size = model.size();
+	CHECK(array.size() == size && array.empty() == !size);
+	CHECK(array.blocks() == (size + BlockSize - 1) / BlockSize);
+	CHECK(std::equal(model.begin(), model.end(), array.begin()) && array.end() - array.begin() == static_cast<std::ptrdiff_t>(size));
+	for (size_t i{}; i < size; i += 1 + i / 64) {
+		CHECK(array.at(i) == model[i]);
+	}
+	if (size) {
+		CHECK(array.at(size - 1) == model.back());
+	}
+
+	bool thrown = false;
+	try {
+		array.at(size);
+	}
+	catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+
+	// ranges inside a block, across blocks, into the last (partial) block, whole blocks
+	for (size_t first : {size_t(0), size_t(1), BlockSize - 1, BlockSize, size / 2, size}) {
+		for (size_t count : {size_t(0), size_t(1), size_t(2), BlockSize, BlockSize + 3, size}) {
+			if (first > size || count > size - first) {
+				continue;
+			}
+			std::vector<uint64_t> out(count + 1, 7);
+			array.decode_to(out.data(), first, count);
+			CHECK(std::equal(out.begin(), out.end() - 1, model.begin() + first) && out.back() == 7);
+		}
+	}
+	std::vector<uint32_t> narrow(size);	// another output type
+	array.decode_to(narrow.data(), 0, size);
+	for (size_t i{}; i < size; ++i) {
+		CHECK(narrow[i] == static_cast<uint32_t>(model[i]));
+	}
+	thrown = false;
+	try {
+		uint64_t out;
+		array.decode_to(&out, size, 1);
+	}
+	catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+template<size_t BlockSize>
+static void test_block_size() {
+	for (size_t size : {size_t(0), size_t(1), BlockSize - 1, BlockSize, 3 * BlockSize + 17}) {
+		// small values with rare outliers => exceptions in a narrow block
+		std::vector<uint64_t> model = random_values(size, 5, size + BlockSize);
+		const std::vector<uint64_t> wide = random_values(size, 64, size * 3 + BlockSize);
+		for (size_t i = 3; i < size; i += 37) {
+			model[i] = wide[i];
+		}
+		check_array<BlockSize>(model);
+
+		// exception heavy: every other value is big, some are exactly the escape code of the narrow width
+		for (size_t i{}; i < size; i += 2) {
+			model[i] = i % 6 == 0 ? 31 : wide[i];
+		}
+		check_array<BlockSize>(model);
+
+		// all zero, all ones of one width (each one the escape code of that width), all UINT64_MAX
+		check_array<BlockSize>(std::vector<uint64_t>(size, 0));
+		for (size_t bits : {size_t(1), size_t(7), size_t(33), size_t(64)}) {
+			check_array<BlockSize>(std::vector<uint64_t>(size, ~uint64_t(0) >> (64 - bits)));
+		}
+
+		// blocks of different kinds after each other, the last one partial
+		std::vector<uint64_t> mixed(size, 0);
+		for (size_t i{}; i < size; ++i) {
+			const size_t block = i / BlockSize;
+			mixed[i] = block % 3 == 0 ? 0 : block % 3 == 1 ? ~uint64_t(0) : wide[i] >> 40;
+		}
+		check_array<BlockSize>(mixed);
+	}
+
+	// from a BitArray, across the block ends
+	const std::vector<uint64_t> model = random_values(2 * BlockSize + 5, 13, BlockSize);
+	BitArray<13> packed;
+	for (uint64_t val : model) {
+		packed.push_back(val);
+	}
+	const BlockBitArray<BlockSize> array(packed);
+	CHECK(std::equal(model.begin(), model.end(), array.begin()) && array.size() == model.size());
+}
+
+int main() {
+	test_block_size<64>();
+	test_block_size<128>();
+	test_block_size<1024>();	// the biggest that still keeps its scratch on the stack
+	test_block_size<65536>();
+	return 0;
+}
@@ -0,0 +1,169 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <vector>
+
+// fill, add_scalar, sub_scalar, shift_right_all and add against a std::vector model, every overflow policy,
+// empty arrays included; widths dividing 64 take the SWAR/AVX2 word path, the others the group path
+// (bulk_scalar runs it all again with BITARRAY_NO_SIMD)
+
+template<size_t Bits>
+static BitArray<Bits> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits> array;	// no words at all when empty
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+// model of one element +/- val under Policy, false if throw_error overflows
+template<BitArrayOverflow Policy>
+static bool model_add_sub(uint64_t& x, uint64_t val, bool sub, uint64_t mask) {
+	const bool overflow = sub ? x < val : x + val > mask;
+	if (overflow && Policy == BitArrayOverflow::throw_error) {
+		return false;
+	}
+	if (Policy == BitArrayOverflow::saturate && overflow) {
+		x = sub ? 0 : mask;
+	}
+	else {
+		x = (sub ? x - val : x + val) & mask;
+	}
+	return true;
+}
+
+// op changes array, expect changes the model (false => op must throw std::overflow_error and change nothing)
+template<typename Array, typename Op, typename Expect>
+static void check_op(const Array& before, const std::vector<uint64_t>& model, Op op, Expect expect) {
+	Array array = before;
+	std::vector<uint64_t> expected = model;
+	const bool succeeds = expect(expected);
+	try {
+		op(array);
+	}
+	catch (const std::overflow_error&) {
+		CHECK(!succeeds && holds_model(array, model));
+		return;
+	}
+	CHECK(succeeds && holds_model(array, expected));
+}
+
+template<size_t Bits, BitArrayOverflow Policy>
+static void test_policy() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	for (size_t count : {size_t(0), size_t(1), size_t(3), size_t(70), size_t(1000)}) {
+		// values in the lower half => small adds fit and throw_error takes the no-throw path too
+		const std::vector<uint64_t> model = random_values(count, Bits > 1 ? Bits - 1 : 1, count * 64 + Bits);
+		const std::vector<uint64_t> other_model = random_values(count, Bits, count * 64 + Bits + 1);
+		const BitArray<Bits> array = make<Bits>(model);
+		const BitArray<Bits> other = make<Bits>(other_model);
+		const size_t first = count / 3;
+		const size_t part = count - first - count / 5;	// ends inside a word for most widths
+
+		for (auto [from, n] : {std::pair<size_t, size_t>(0, count), std::pair<size_t, size_t>(first, part)}) {
+			for (uint64_t val : {uint64_t(0), uint64_t(1), mask / 3, mask, mask + 1}) {
+				check_op(array, model, [&](BitArray<Bits>& a) { a.template add_scalar<Policy>(from, n, val); }, [&](std::vector<uint64_t>& m) {
+					if (val > mask && Policy == BitArrayOverflow::throw_error) {
+						return false;
+					}
+					for (size_t i = from; i < from + n; ++i) {
+						uint64_t x = m[i];
+						if (!model_add_sub<Policy>(x, val, false, mask)) {
+							return false;
+						}
+					}
+					for (size_t i = from; i < from + n; ++i) {
+						model_add_sub<Policy>(m[i], val, false, mask);
+					}
+					return true;
+				});
+				check_op(array, model, [&](BitArray<Bits>& a) { a.template sub_scalar<Policy>(from, n, val); }, [&](std::vector<uint64_t>& m) {
+					if (val > mask && Policy == BitArrayOverflow::throw_error) {
+						return false;
+					}
+					for (size_t i = from; i < from + n; ++i) {
+						uint64_t x = m[i];
+						if (!model_add_sub<Policy>(x, val, true, mask)) {
+							return false;
+						}
+					}
+					for (size_t i = from; i < from + n; ++i) {
+						model_add_sub<Policy>(m[i], val, true, mask);
+					}
+					return true;
+				});
+				check_op(array, model, [&](BitArray<Bits>& a) { a.fill(from, n, val); }, [&](std::vector<uint64_t>& m) {
+					if (val > mask) {	// every policy
+						return false;
+					}
+					for (size_t i = from; i < from + n; ++i) {
+						m[i] = val;
+					}
+					return true;
+				});
+			}
+			for (size_t shift : {size_t(0), size_t(1), Bits - 1, Bits, Bits + 5}) {
+				check_op(array, model, [&](BitArray<Bits>& a) { a.shift_right_all(from, n, shift); }, [&](std::vector<uint64_t>& m) {
+					for (size_t i = from; i < from + n; ++i) {
+						m[i] = shift >= Bits ? 0 : m[i] >> shift;
+					}
+					return true;
+				});
+			}
+		}
+
+		// element-wise add: the lower half + any value overflows somewhere for most sizes, never for other - other
+		for (const BitArray<Bits>* addend : {&other, &array}) {
+			const std::vector<uint64_t>& addend_model = addend == &other ? other_model : model;
+			check_op(array, model, [&](BitArray<Bits>& a) { a.template add<Policy>(*addend); }, [&](std::vector<uint64_t>& m) {
+				for (size_t i{}; i < count; ++i) {
+					uint64_t x = m[i];
+					if (!model_add_sub<Policy>(x, addend_model[i], false, mask)) {
+						return false;
+					}
+				}
+				for (size_t i{}; i < count; ++i) {
+					model_add_sub<Policy>(m[i], addend_model[i], false, mask);
+				}
+				return true;
+			});
+		}
+		if (count) {
+			BitArray<Bits> longer = other;
+			longer.push_back(0);
+			bool thrown = false;
+			try {
+				BitArray<Bits>(array).template add<Policy>(longer);
+			}
+			catch (const std::length_error&) {
+				thrown = true;
+			}
+			CHECK(thrown);
+		}
+	}
+}
+
+// the empty arrays of the report: no words, the kernels must not read other[0]
+static void test_empty() {
+	BitArray<4> a;
+	BitArray<4> b;
+	a.add(b);
+	a.add<BitArrayOverflow::wrap>(b);
+	a.add<BitArrayOverflow::saturate>(b);
+	a.fill(3);
+	a.add_scalar(1);
+	a.sub_scalar(1);
+	a.shift_right_all(2);
+	CHECK(a.empty() && b.empty());
+}
+
+int main() {
+	test_empty();
+	for_widths<1, 2, 3, 4, 5, 7, 8, 12, 13, 16, 21, 31, 32, 33, 48, 63>([](auto bits) {
+		test_policy<bits, BitArrayOverflow::throw_error>();
+		test_policy<bits, BitArrayOverflow::wrap>();
+		test_policy<bits, BitArrayOverflow::saturate>();
+	});
+	return 0;
+}
@@ -0,0 +1,61 @@
+#ifndef BITARRAY_TESTS_CHECK_H
+#define BITARRAY_TESTS_CHECK_H
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// assert that stays in release builds
+#define CHECK(cond) do { \
+	if (!(cond)) { \
+		std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+		std::exit(1); \
+	} \
+} while (0)
+
+// count random values of bits bits (fixed seed => a failure repeats)
+inline std::vector<uint64_t> random_values(size_t count, size_t bits, uint64_t seed) {
+	std::mt19937_64 rng(seed);
+	std::vector<uint64_t> values(count);
+	for (uint64_t& val : values) {
+		val = rng() >> (64 - bits);
+	}
+	return values;
+}
+
+// same size and elements as the model
+template<typename Array>
+bool holds_model(const Array& array, const std::vector<uint64_t>& model) {
+	if (array.size() != model.size()) {
+		return false;
+	}
+	for (size_t i{}; i < model.size(); ++i) {
+		if (array[i] != model[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// f(std::integral_constant<size_t, Bits>{}) for the listed widths
+template<size_t... Bits, typename F>
+void for_widths(F f) {
+	(f(std::integral_constant<size_t, Bits>{}), ...);
+}
+
+template<typename F, size_t... Index>
+void for_all_widths(F f, std::index_sequence<Index...>) {
+	(f(std::integral_constant<size_t, Index + 1>{}), ...);
+}
+
+// every width 1..63
+template<typename F>
+void for_all_widths(F f) {
+	for_all_widths(f, std::make_index_sequence<63>{});
+}
+
+#endif
@@ -0,0 +1,210 @@
+#include "BitArray.h"
+#include "DynamicBitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// converting constructor/assignment between widths under every overflow policy, min_width
+// and DynamicBitArray::repack against an element model
+
+static size_t naive_width(const std::vector<uint64_t>& model) {
+	uint64_t biggest = 0;
+	for (uint64_t val : model) {
+		biggest = std::max(biggest, val);
+	}
+	size_t bits = 1;
+	while (bits < 64 && (biggest >> bits)) {
+		++bits;
+	}
+	return bits;
+}
+
+template<size_t Bits, size_t InlineWords = 0, BitArrayOverflow Overflow = BitArrayOverflow::throw_error>
+static BitArray<Bits, InlineWords, Overflow> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits, InlineWords, Overflow> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+template<size_t To, BitArrayOverflow Policy>
+static std::vector<uint64_t> narrowed(std::vector<uint64_t> model) {
+	constexpr uint64_t mask = bitarray_detail::mask_of<To>();
+	for (uint64_t& val : model) {
+		val = Policy == BitArrayOverflow::wrap ? val & mask : std::min(val, mask);
+	}
+	return model;
+}
+
+template<size_t From, size_t To, size_t InlineWords, BitArrayOverflow Policy>
+static void check_conversion(const std::vector<uint64_t>& model) {
+	using target = BitArray<To, InlineWords, Policy>;
+	const BitArray<From> source = make<From>(model);
+	const bool fits = naive_width(model) <= To;
+
+	if (Policy == BitArrayOverflow::throw_error && !fits) {
+		bool thrown = false;
+		try {
+			target copy(source);
+		}
+		catch (const std::overflow_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		// the assignment checks first => the target keeps its old elements
+		const std::vector<uint64_t> old = random_values(37, To, From * 64 + To);
+		target array = make<To, InlineWords, Policy>(old);
+		thrown = false;
+		try {
+			array = source;
+		}
+		catch (const std::overflow_error&) {
+			thrown = true;
+		}
+		CHECK(thrown && holds_model(array, old));
+		array.push_back(1);	// and stays usable
+		CHECK(array.size() == old.size() + 1 && array[old.size()] == 1);
+		return;
+	}
+
+	const std::vector<uint64_t> expected = fits ? model : narrowed<To, Policy>(model);
+	const target copy(source);
+	CHECK(holds_model(copy, expected));
+	CHECK(copy.min_width() == naive_width(expected));
+
+	// assignment into a bigger, a smaller and an empty target
+	for (size_t old_size : {size_t(0), size_t(3), model.size() + 100}) {
+		target array = make<To, InlineWords, Policy>(std::vector<uint64_t>(old_size, bitarray_detail::mask_of<To>()));
+		array = source;
+		CHECK(holds_model(array, expected));
+		array.resize(array.size() + 70);	// words after the new size stay zero
+		for (size_t i = expected.size(); i < array.size(); ++i) {
+			CHECK(array[i] == 0);
+		}
+	}
+}
+
+template<size_t From, size_t To>
+static void test_pair() {
+	for (size_t size : {size_t(0), size_t(1), size_t(100), size_t(1000)}) {
+		// values that fit the narrower width, and values of the full source width
+		const std::vector<uint64_t> small = random_values(size, std::min(From, To), size + From * 64 + To);
+		const std::vector<uint64_t> full = random_values(size, From, size * 3 + From * 64 + To);
+		for (const std::vector<uint64_t>* model : {&small, &full}) {
+			check_conversion<From, To, 0, BitArrayOverflow::throw_error>(*model);
+			check_conversion<From, To, 2, BitArrayOverflow::throw_error>(*model);
+			check_conversion<From, To, 0, BitArrayOverflow::wrap>(*model);
+			check_conversion<From, To, 0, BitArrayOverflow::saturate>(*model);
+		}
+	}
+	// one element over the limit at the very end
+	if constexpr (From > To) {
+		std::vector<uint64_t> model(300, 0);
+		model.back() = bitarray_detail::mask_of<To>() + 1;
+		check_conversion<From, To, 0, BitArrayOverflow::throw_error>(model);
+		check_conversion<From, To, 0, BitArrayOverflow::wrap>(model);
+		check_conversion<From, To, 0, BitArrayOverflow::saturate>(model);
+	}
+}
+
+template<size_t Bits>
+static void test_min_width() {
+	CHECK(BitArray<Bits>().min_width() == 1);
+	for (size_t width = 1; width <= Bits; ++width) {
+		std::vector<uint64_t> model(200, 0);
+		model[width * 3] = bitarray_detail::mask_of<Bits>() >> (Bits - width);	// 2^width - 1
+		CHECK(make<Bits>(model).min_width() == width);
+		model.back() = uint64_t(1) << (width - 1);
+		CHECK(make<Bits>(model).min_width() == width);
+	}
+}
+
+static bool dynamic_holds(const DynamicBitArray& array, const std::vector<uint64_t>& model) {
+	if (array.size() != model.size()) {
+		return false;
+	}
+	for (size_t i{}; i < model.size(); ++i) {
+		if (array.at(i) != model[i]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void test_repack() {
+	for (size_t bits = 1; bits <= 64; ++bits) {
+		for (size_t size : {size_t(0), size_t(1), size_t(300)}) {
+			const std::vector<uint64_t> model = random_values(size, bits, size * 64 + bits);
+			const size_t min_bits = naive_width(model);
+			DynamicBitArray array(bits);
+			for (uint64_t val : model) {
+				array.push_back(val);
+			}
+			CHECK(array.min_width() == min_bits);
+
+			// every target width: narrower than min_width - overflow_error and nothing changed
+			for (size_t to = 1; to <= 64; ++to) {
+				DynamicBitArray copy = array;
+				if (to < min_bits) {
+					bool thrown = false;
+					try {
+						copy.repack(to);
+					}
+					catch (const std::overflow_error&) {
+						thrown = true;
+					}
+					CHECK(thrown && copy.bits() == bits && dynamic_holds(copy, model));
+				}
+				else {
+					copy.repack(to);
+					CHECK(copy.bits() == to && dynamic_holds(copy, model));
+					copy.push_back(copy.mask());	// the tail after the repack is clean
+					CHECK(copy.at(size) == copy.mask() && copy.min_width() == to);
+				}
+			}
+
+			// down to the minimum width and back up
+			DynamicBitArray copy = array;
+			CHECK(copy.repack_to_min_width() == min_bits && copy.bits() == min_bits && dynamic_holds(copy, model));
+			copy.repack(64);
+			CHECK(copy.bits() == 64 && dynamic_holds(copy, model));
+			copy.repack(bits);
+			CHECK(copy.bits() == bits && dynamic_holds(copy, model));
+		}
+	}
+
+	DynamicBitArray array(8);
+	bool thrown = false;
+	try {
+		array.repack(0);
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	thrown = false;
+	try {
+		array.repack(65);
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown && array.bits() == 8);
+}
+
+int main() {
+	for_widths<1, 3, 8, 13, 32, 33, 63>([](auto from) {
+		for_widths<1, 3, 8, 13, 32, 33, 63>([](auto to) {
+			test_pair<decltype(from)::value, decltype(to)::value>();
+		});
+	});
+	for_widths<1, 2, 7, 8, 31, 32, 33, 63>([](auto bits) {
+		test_min_width<bits>();
+	});
+	test_repack();
+	return 0;
+}
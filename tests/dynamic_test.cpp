@@ -0,0 +1,194 @@
+#include "BitArray.h"
+#include "DynamicBitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+// DynamicBitArray for every width 1..64 against an element model: visit_width dispatch, element access,
+// the bulk operations, conversions to and from BitArray<Bits> and repack
+// (dynamic_scalar runs it again with BITARRAY_NO_SIMD)
+
+template<typename F>
+static bool throws_out_of_range(F f) {
+	try {
+		f();
+	}
+	catch (const std::out_of_range&) {
+		return true;
+	}
+	return false;
+}
+
+template<typename F>
+static bool throws_overflow(F f) {
+	try {
+		f();
+	}
+	catch (const std::overflow_error&) {
+		return true;
+	}
+	return false;
+}
+
+static void test_visit_width() {
+	for (size_t bits = 1; bits <= 64; ++bits) {
+		CHECK(bitarray_detail::visit_width(bits, [](auto width) { return decltype(width)::value; }) == bits);
+		CHECK(bitarray_detail::visit_width(bits, [](auto width) { return bitarray_detail::mask_of<decltype(width)::value>(); })
+			== ~uint64_t(0) >> (64 - bits));
+
+		// the same functor object is called (state is kept), void results work
+		size_t seen = 0;
+		auto record = [&seen](auto width) { seen += decltype(width)::value; };
+		bitarray_detail::visit_width(bits, record);
+		bitarray_detail::visit_width(bits, record);
+		CHECK(seen == 2 * bits);
+	}
+}
+
+static void test_width(size_t bits) {
+	const uint64_t mask = ~uint64_t(0) >> (64 - bits);
+	for (size_t size : {size_t(0), size_t(1), size_t(63), size_t(64), size_t(65), size_t(1000)}) {
+		std::vector<uint64_t> model = random_values(size, bits, size * 64 + bits);
+		DynamicBitArray array(bits);
+		for (uint64_t val : model) {
+			array.push_back(val);
+		}
+		CHECK(array.bits() == bits && array.mask() == mask && array.size() == size && array.empty() == !size);
+		CHECK(holds_model(array, model));
+
+		// element access, neighbours kept
+		for (size_t i = 0; i < size; i += 7) {
+			model[i] = mask - model[i];
+			array.set(i, model[i]);
+			if (i + 1 < size) {
+				model[i + 1] = model[i] / 3;
+				array.unchecked_set(i + 1, model[i + 1]);
+			}
+		}
+		CHECK(holds_model(array, model));
+		for (size_t i{}; i < size; ++i) {
+			CHECK(array.at(i) == model[i] && array.unchecked_get(i) == model[i]);
+		}
+		CHECK(throws_out_of_range([&]() { array.at(size); }));
+		CHECK(throws_out_of_range([&]() { array.set(size, 0); }));
+		if (bits < 64) {
+			CHECK(throws_overflow([&]() { array.push_back(mask + 1); }));
+			if (size) {
+				CHECK(throws_overflow([&]() { array.set(0, mask + 1); }));
+			}
+		}
+		CHECK(holds_model(array, model));
+
+		// find/count
+		for (uint64_t val : {uint64_t(0), model.empty() ? mask : model[size / 2], mask}) {
+			size_t hits = 0, first = size;
+			for (size_t i = size; i-- > 0;) {
+				if (model[i] == val) {
+					++hits;
+					first = i;
+				}
+			}
+			CHECK(array.count(val) == hits && array.find(val) == first);
+		}
+		if (bits < 64) {
+			CHECK(array.find(mask + 1) == size && array.count(mask + 1) == 0);
+		}
+
+		// unpack_to/pack_from, inside words and across them
+		if (size > 10) {
+			std::vector<uint64_t> out(size - 10);
+			array.unpack_to(out.data(), 3, size - 10);
+			CHECK(std::equal(out.begin(), out.end(), model.begin() + 3));
+		}
+		CHECK(throws_out_of_range([&]() { uint64_t out; array.unpack_to(&out, size, 1); }));
+		DynamicBitArray packed(bits, 5);
+		packed.pack_from(model.data(), size);
+		CHECK(holds_model(packed, model));
+		if (bits < 64 && size) {
+			std::vector<uint64_t> over = model;
+			over.back() = mask + 1;
+			CHECK(throws_overflow([&]() { packed.pack_from(over.data(), size); }) && packed.empty());
+		}
+
+		// fill a range, resize (new elements are zero, the tail is cleared when shrinking)
+		if (size > 5) {
+			array.fill(2, size - 5, mask);
+			std::fill(model.begin() + 2, model.end() - 3, mask);
+			CHECK(holds_model(array, model));
+		}
+		array.resize(size / 2);
+		model.resize(size / 2);
+		array.resize(size + 70);
+		model.resize(size + 70, 0);
+		CHECK(holds_model(array, model));
+		array.pop_back();
+		model.pop_back();
+		CHECK(holds_model(array, model));
+		array.clear();
+		CHECK(array.empty() && array.bits() == bits);
+	}
+
+	bool thrown = false;
+	try {
+		DynamicBitArray array(bits == 64 ? 65 : 0);
+	}
+	catch (const std::invalid_argument&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+// words are shared with BitArray<Bits>: both directions, the wrong width, after a repack
+template<size_t Bits>
+static void test_conversion() {
+	for (size_t size : {size_t(0), size_t(1), size_t(100), size_t(1000)}) {
+		const std::vector<uint64_t> model = random_values(size, Bits, size * 64 + Bits);
+		BitArray<Bits> array;
+		for (uint64_t val : model) {
+			array.push_back(val);
+		}
+		const DynamicBitArray dynamic(array);
+		CHECK(dynamic.bits() == Bits && holds_model(dynamic, model));
+		const BitArray<Bits> back = dynamic.to_bit_array<Bits>();
+		CHECK(holds_model(back, model));
+
+		bool thrown = false;
+		try {
+			if constexpr (Bits < 63) {
+				dynamic.to_bit_array<Bits + 1>();
+			}
+			else {
+				dynamic.to_bit_array<Bits - 1>();
+			}
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		// through another width and back to BitArray
+		DynamicBitArray wide = dynamic;
+		wide.repack(Bits < 63 ? Bits + 1 : 64);
+		CHECK(holds_model(wide, model));
+		if constexpr (Bits < 63) {
+			CHECK(holds_model(wide.to_bit_array<Bits + 1>(), model));
+		}
+		wide.repack(Bits);
+		CHECK(holds_model(wide.to_bit_array<Bits>(), model));
+		const size_t narrow = wide.repack_to_min_width();
+		CHECK(narrow <= Bits && holds_model(wide, model));
+	}
+}
+
+int main() {
+	test_visit_width();
+	for (size_t bits = 1; bits <= 64; ++bits) {
+		test_width(bits);
+	}
+	for_all_widths([](auto bits) {
+		test_conversion<bits>();
+	});
+	return 0;
+}
@@ -0,0 +1,139 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <vector>
+
+// move_bits against a bit by bit copy (separate and overlapping, both directions), and insert/erase/append
+// at the front, middle and end across word boundaries against a std::vector model, including a.insert(it, a) and a += a
+
+static bool bit_of(const std::vector<uint64_t>& words, size_t bit) {
+	return (words[bit / 64] >> (63 - bit % 64)) & 1;
+}
+
+static void set_bit(std::vector<uint64_t>& words, size_t bit, bool val) {
+	const uint64_t one = uint64_t(1) << (63 - bit % 64);
+	words[bit / 64] = val ? words[bit / 64] | one : words[bit / 64] & ~one;
+}
+
+static void test_move_bits() {
+	const size_t offsets[] = {0, 1, 31, 63, 64, 65, 127, 130, 191};
+	const size_t counts[] = {0, 1, 5, 63, 64, 65, 128, 129, 200, 500};
+	for (size_t dst : offsets) {
+		for (size_t src : offsets) {
+			for (size_t count : counts) {
+				const std::vector<uint64_t> source = random_values(12, 64, dst * 1000 + src * 10 + count);
+				const std::vector<uint64_t> background = random_values(12, 64, dst + src * 10 + count * 1000);
+
+				// separate memory: only [dst, dst + count) changes
+				std::vector<uint64_t> out = background, model = background;
+				for (size_t i{}; i < count; ++i) {
+					set_bit(model, dst + i, bit_of(source, src + i));
+				}
+				bitarray_detail::move_bits(out.data(), dst, source.data(), src, count);
+				CHECK(out == model);
+
+				// the same memory (memmove semantics, forward or backward)
+				std::vector<uint64_t> same = source;
+				model = source;
+				for (size_t i{}; i < count; ++i) {
+					set_bit(model, dst + i, bit_of(source, src + i));
+				}
+				bitarray_detail::move_bits(same.data(), dst, same.data(), src, count);
+				CHECK(same == model);
+			}
+		}
+	}
+}
+
+template<size_t Bits, size_t InlineWords>
+static void test_edits() {
+	using array_type = BitArray<Bits, InlineWords>;
+	constexpr size_t per_word = 64 / Bits;
+	for (size_t size : {size_t(0), size_t(1), per_word, per_word + 1, size_t(200), size_t(1001)}) {
+		const std::vector<uint64_t> values = random_values(size, Bits, size * 64 + Bits);
+		array_type base;
+		for (uint64_t val : values) {
+			base.push_back(val);
+		}
+		std::vector<size_t> positions = {0, 1, per_word - 1, per_word, per_word + 1, size / 2, size};
+		if (size) {
+			positions.push_back(size - 1);
+		}
+
+		for (size_t pos : positions) {
+			if (pos > size) {
+				continue;
+			}
+			const uint64_t val = values.empty() ? 1 : values[pos % size] ^ 1;
+
+			// one value, a run of values, another array, the array itself
+			for (size_t count : {size_t(0), size_t(1), size_t(65), size_t(200)}) {
+				array_type array = base;
+				std::vector<uint64_t> model = values;
+				if (count == 1) {
+					array.insert(array.begin() + pos, val);
+				}
+				else {
+					array.insert(array.begin() + pos, val, count);
+				}
+				model.insert(model.begin() + pos, count, val);
+				CHECK(holds_model(array, model));
+
+				const std::vector<uint64_t> other_values = random_values(count, Bits, count + pos);
+				array = base;
+				model = values;
+				array_type other;
+				for (uint64_t x : other_values) {
+					other.push_back(x);
+				}
+				array.insert(array.begin() + pos, other);
+				model.insert(model.begin() + pos, other_values.begin(), other_values.end());
+				CHECK(holds_model(array, model));
+			}
+			array_type array = base;
+			std::vector<uint64_t> model = values;
+			array.insert(array.begin() + pos, array);
+			model.insert(model.begin() + pos, values.begin(), values.end());
+			CHECK(holds_model(array, model));
+
+			// erase ranges from pos, the freed tail must read as zeros when the array grows again
+			for (size_t count : {size_t(0), size_t(1), size_t(2), per_word, size_t(70), size - pos}) {
+				if (count > size - pos) {
+					continue;
+				}
+				array = base;
+				model = values;
+				array.erase(array.begin() + pos, array.begin() + pos + count);
+				model.erase(model.begin() + pos, model.begin() + pos + count);
+				CHECK(holds_model(array, model));
+				array.resize(size);
+				model.resize(size, 0);
+				CHECK(holds_model(array, model));
+			}
+		}
+
+		// a += a with and without room for it, and appending another array
+		for (bool reserved : {false, true}) {
+			array_type array = base;
+			if (reserved) {
+				array.reserve(2 * size + 1);
+			}
+			array += array;
+			std::vector<uint64_t> model = values;
+			model.insert(model.end(), values.begin(), values.end());
+			CHECK(holds_model(array, model));
+			array += base;
+			model.insert(model.end(), values.begin(), values.end());
+			CHECK(holds_model(array, model));
+		}
+	}
+}
+
+int main() {
+	test_move_bits();
+	for_widths<1, 3, 7, 8, 13, 32, 33, 63>([](auto bits) {
+		test_edits<bits, 0>();
+		test_edits<bits, 4>();
+	});
+	return 0;
+}
@@ -0,0 +1,153 @@
+#include "EncodedBitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+// EncodedBitArray against exact (128-bit) range arithmetic: the limits of both encodings for bases up to the
+// ends of the 64-bit range, values just outside through every write path, and assign moving the base
+
+using int128 = __int128;
+
+template<typename F>
+static bool throws_overflow(F f) {
+	try {
+		f();
+	}
+	catch (const std::overflow_error&) {
+		return true;
+	}
+	return false;
+}
+
+// value must fit, or every write must throw and change nothing
+template<size_t Bits, BitArrayEncoding Encoding>
+static void check_value(EncodedBitArray<Bits, Encoding>& array, typename EncodedBitArray<Bits, Encoding>::value_type val, bool fits) {
+	using value_type = typename EncodedBitArray<Bits, Encoding>::value_type;
+	const size_t size = array.size();
+	std::vector<value_type> before(array.begin(), array.end());
+
+	if (fits) {
+		array.push_back(val);
+		CHECK(array.size() == size + 1 && array.at(size) == val && array.packed()[size] <= bitarray_detail::mask_of<Bits>());
+		if (size) {
+			array[0] = val;
+			CHECK(array.at(0) == val);
+			array[0] = before[0];
+		}
+		array.pop_back();
+	}
+	else {
+		CHECK(throws_overflow([&]() { array.push_back(val); }));
+		if (size) {
+			CHECK(throws_overflow([&]() { array.at(size - 1) = val; }));
+		}
+	}
+	CHECK(array.size() == size && std::equal(before.begin(), before.end(), array.begin()));
+}
+
+template<size_t Bits>
+static void test_offset() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	constexpr uint64_t top = std::numeric_limits<uint64_t>::max();
+	for (uint64_t base : {uint64_t(0), uint64_t(1), uint64_t(1) << 40, top - mask - 1, top - mask, top - 5, top}) {
+		EncodedBitArray<Bits> array(base);
+		CHECK(array.base() == base);
+		array.resize(3);	// new elements are base
+		CHECK(array[0] == base && array[2] == base);
+
+		const int128 low = base, high = int128(base) + mask;	// [base, base + 2^Bits)
+		for (int128 val : {low - 2, low - 1, low, low + 1, high - 1, high, high + 1, high + 2, int128(0), int128(top)}) {
+			if (val < 0 || val > int128(top)) {
+				continue;
+			}
+			check_value(array, static_cast<uint64_t>(val), val >= low && val <= high);
+		}
+	}
+}
+
+template<size_t Bits>
+static void test_zigzag() {
+	constexpr int64_t min = std::numeric_limits<int64_t>::min(), max = std::numeric_limits<int64_t>::max();
+	constexpr int128 half = int128(1) << (Bits - 1);
+	for (int64_t base : {int64_t(0), int64_t(-1), int64_t(1000), int64_t(min + half), int64_t(min + half - 1), min,
+			int64_t(max - half + 1), int64_t(max - half), max}) {
+		using array_type = EncodedBitArray<Bits, BitArrayEncoding::zigzag>;
+		array_type array(base);
+		array.resize(2);
+		CHECK(array[1] == base);
+
+		const int128 low = int128(base) - half, high = int128(base) + half - 1;	// [base - 2^(Bits-1), base + 2^(Bits-1))
+		for (int128 val : {low - 2, low - 1, low, low + 1, int128(base), high - 1, high, high + 1, high + 2, int128(min), int128(max)}) {
+			if (val < min || val > max) {
+				continue;
+			}
+			check_value(array, static_cast<int64_t>(val), val >= low && val <= high);
+		}
+	}
+}
+
+// assign takes the base from the values (min for offset, midpoint for zigzag), a spread over Bits changes nothing
+template<size_t Bits, BitArrayEncoding Encoding>
+static void test_assign() {
+	using array_type = EncodedBitArray<Bits, Encoding>;
+	using value_type = typename array_type::value_type;
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	const std::vector<uint64_t> codes = random_values(700, Bits, Bits);
+
+	array_type array(static_cast<value_type>(5));
+	for (value_type start : {value_type(0), static_cast<value_type>(123456789), std::numeric_limits<value_type>::max() - static_cast<value_type>(mask),
+			std::numeric_limits<value_type>::min()}) {
+		if (start > std::numeric_limits<value_type>::max() - static_cast<value_type>(mask)) {	// start + mask must be a value
+			continue;
+		}
+		std::vector<value_type> values(codes.size());
+		for (size_t i{}; i < codes.size(); ++i) {
+			values[i] = static_cast<value_type>(static_cast<uint64_t>(start) + codes[i]);
+		}
+		values[3] = start;	// the whole spread
+		values[4] = static_cast<value_type>(static_cast<uint64_t>(start) + mask);
+		array.assign(values.data(), values.size());
+		if constexpr (Encoding == BitArrayEncoding::offset) {
+			CHECK(array.base() == start);
+		}
+		else {
+			CHECK(array.base() == static_cast<value_type>(static_cast<uint64_t>(start) + (mask - mask / 2)));
+		}
+		CHECK(std::equal(values.begin(), values.end(), array.begin()) && array.size() == values.size());
+
+		std::vector<value_type> out(values.size() - 10);
+		array.decode_to(out.data(), 7, out.size());
+		CHECK(std::equal(out.begin(), out.end(), values.begin() + 7));
+
+		// one more than the spread fits
+		{
+			std::vector<value_type> wide = values;
+			wide.back() = static_cast<value_type>(static_cast<uint64_t>(start) + mask + 1);
+			const value_type base = array.base();
+			CHECK(throws_overflow([&]() { array.assign(wide.data(), wide.size()); }));
+			CHECK(array.base() == base && std::equal(values.begin(), values.end(), array.begin()));
+		}
+	}
+
+	array.assign(nullptr, 0);
+	CHECK(array.empty());
+
+	// the vector constructor assigns the same way
+	const array_type made(std::vector<int>{41, 40, 41});
+	CHECK(made.size() == 3 && made[0] == 41 && made[1] == 40 && made[2] == 41);
+	CHECK(made.base() == (Encoding == BitArrayEncoding::offset ? 40 : 41));
+}
+
+int main() {
+	for_widths<1, 3, 8, 13, 32, 33, 63>([](auto bits) {
+		test_offset<bits>();
+		test_zigzag<bits>();
+		test_assign<bits, BitArrayEncoding::offset>();
+		test_assign<bits, BitArrayEncoding::zigzag>();
+	});
+	return 0;
+}
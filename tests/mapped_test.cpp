@@ -0,0 +1,66 @@
+#include "MappedBitArray.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <utility>
+
+int main() {
+	char path[] = "/tmp/bitarray_mapped_XXXXXX";
+	const int fd = ::mkstemp(path);
+	CHECK(fd >= 0);
+	::close(fd);
+
+	{
+		MappedBitArray<5> file(path, BitArrayMapMode::create);
+		for (size_t i{}; i < 1000; ++i) {
+			file.push_back(i % 31);
+		}
+		file[7] = 3;
+	}
+
+	{
+		const MappedBitArray<5> file(path, BitArrayMapMode::read_only);
+		CHECK(file.size() == 1000);
+		CHECK(file[7] == 3 && file.at(8) == 8 && file.front() == 0 && file.back() == 999 % 31);
+		size_t i = 0;
+		for (uint64_t val : file) {
+			CHECK(val == (i == 7 ? 3 : i % 31));
+			++i;
+		}
+		CHECK(i == 1000);
+	}
+
+	{	// writes to a read-only mapping are refused instead of lost
+		MappedBitArray<5> file(path, BitArrayMapMode::read_only);
+		bool threw = false;
+		try {
+			file[7] = 4;
+		}
+		catch (const std::logic_error&) {
+			threw = true;
+		}
+		CHECK(threw);
+		threw = false;
+		try {
+			file.begin();
+		}
+		catch (const std::logic_error&) {
+			threw = true;
+		}
+		CHECK(threw);
+		CHECK(std::as_const(file)[7] == 3);
+
+		MappedBitArray<5> moved(std::move(file));
+		CHECK(moved.size() == 1000 && std::as_const(moved)[7] == 3);
+		CHECK(file.size() == 0 && file.empty());
+	}
+
+	{	// read_write sees the data and grows
+		MappedBitArray<5> file(path, BitArrayMapMode::read_write);
+		file[7] = 4;
+		file.resize(5000);
+		CHECK(file[7] == 4 && file[4999] == 0 && file.size() == 5000);
+	}
+
+	::unlink(path);
+}
@@ -0,0 +1,94 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <type_traits>
+#include <vector>
+
+// pack/unpack kernels for every width 1..64 and element type, starts and lengths off the word and group boundaries,
+// against a bit by bit model; pack_scalar runs the same with BITARRAY_NO_SIMD => the SIMD path (AVX2/AVX-512
+// when the CPU has it) and the scalar one must give the same words
+
+static uint64_t read_element(const std::vector<uint64_t>& words, size_t index, size_t bits) {
+	uint64_t val = 0;
+	for (size_t bit = index * bits; bit < (index + 1) * bits; ++bit) {
+		val = (val << 1) | ((words[bit / 64] >> (63 - bit % 64)) & 1);
+	}
+	return val;
+}
+
+static void write_element(std::vector<uint64_t>& words, size_t index, size_t bits, uint64_t val) {
+	for (size_t i{}; i < bits; ++i) {
+		const size_t bit = index * bits + i;
+		const uint64_t one = uint64_t(1) << (63 - bit % 64);
+		words[bit / 64] = (val >> (bits - 1 - i)) & 1 ? words[bit / 64] | one : words[bit / 64] & ~one;
+	}
+}
+
+template<size_t Bits, typename T>
+static void test_type() {
+	constexpr size_t group = bitarray_detail::group_elems<Bits>;
+	constexpr size_t type_bits = sizeof(T) * 8;
+	for (size_t first : {size_t(0), size_t(1), size_t(3), group - 1, group, group + 1, 5 * group + 3}) {
+		for (size_t count : {size_t(0), size_t(1), size_t(2), group - 1, group, 4 * group + 1, 8 * group + 5, 40 * group + 7}) {
+			const size_t words_count = ((first + count) * Bits + 63) / 64 + 2;
+			std::vector<uint64_t> memory = random_values(words_count, 64, first * 1000 + count + Bits);	// the neighbours
+			std::vector<uint64_t> model = memory;
+
+			// values of the width, or of the whole type (pack cuts them to Bits and reports them in the OR)
+			const std::vector<uint64_t> raw = random_values(count, type_bits < Bits ? type_bits : Bits, count + Bits);
+			const std::vector<uint64_t> over = random_values(count, type_bits, count + Bits + 1);
+			for (const std::vector<uint64_t>* values : {&raw, &over}) {
+				std::vector<T> in(values->begin(), values->end());
+				uint64_t all = 0;
+				for (size_t i{}; i < count; ++i) {
+					all |= static_cast<uint64_t>(in[i]);
+					write_element(model, first + i, Bits, static_cast<uint64_t>(in[i]) & bitarray_detail::mask_of<Bits>());
+				}
+				CHECK(bitarray_detail::pack<Bits>(memory.data(), first, count, in.data()) == all);
+				CHECK(memory == model);
+
+				std::vector<T> out(count + 1, T(0x5A));
+				bitarray_detail::unpack<Bits>(memory.data(), first, count, out.data());
+				for (size_t i{}; i < count; ++i) {
+					CHECK(static_cast<uint64_t>(out[i]) == (read_element(model, first + i, Bits) & (~uint64_t(0) >> (64 - type_bits))));
+				}
+				CHECK(out[count] == T(0x5A));	// nothing written past count
+			}
+		}
+	}
+}
+
+// the BitArray entry points over the same kernels
+template<size_t Bits>
+static void test_array() {
+	constexpr size_t group = bitarray_detail::group_elems<Bits>;
+	const std::vector<uint64_t> values = random_values(30 * group + 11, Bits, Bits);
+	BitArray<Bits> array;
+	array.pack_from(values.data(), values.size());
+	CHECK(holds_model(array, values));
+	std::vector<uint64_t> out(values.size() - group - 4);
+	array.unpack_to(out.data(), group + 3, out.size());
+	for (size_t i{}; i < out.size(); ++i) {
+		CHECK(out[i] == values[group + 3 + i]);
+	}
+}
+
+int main() {
+	for_all_widths([](auto bits) {
+		constexpr size_t Bits = decltype(bits)::value;
+		if constexpr (Bits <= 8) {
+			test_type<Bits, uint8_t>();
+		}
+		if constexpr (Bits <= 16) {
+			test_type<Bits, uint16_t>();
+		}
+		if constexpr (Bits <= 32) {
+			test_type<Bits, uint32_t>();
+		}
+		test_type<Bits, uint64_t>();
+		if constexpr (Bits < 64) {
+			test_array<Bits>();
+		}
+	}, std::make_index_sequence<64>{});
+	return 0;
+}
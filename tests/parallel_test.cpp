@@ -0,0 +1,154 @@
+#include "BitArray.h"
+#include "ParallelBitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+// the parallel algorithms against the serial result, widths 3, 7 and 33 on a 1 thread and a 4 thread pool
+// (sizes over parallel_min_chunk => several chunks), exceptions from tasks and reuse of the pool after them
+
+template<size_t Bits, size_t InlineWords = 0, BitArrayOverflow Overflow = BitArrayOverflow::throw_error>
+static BitArray<Bits, InlineWords, Overflow> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits, InlineWords, Overflow> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+static const size_t sizes[] = {0, 1, 1000, 3 * bitarray_detail::parallel_min_chunk + 12345};
+
+template<size_t Bits>
+static void test_width(BitArrayThreadPool& pool) {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	for (size_t size : sizes) {
+		const std::vector<uint64_t> model = random_values(size, Bits, size * 64 + Bits);
+		const BitArray<Bits> array = make<Bits>(model);
+
+		// for_each through references
+		BitArray<Bits> changed = array;
+		parallel_for_each(changed, [](auto ref) {
+			ref = (static_cast<uint64_t>(ref) * 5 + 3) & mask;
+		}, pool);
+		std::vector<uint64_t> expected = model;
+		for (uint64_t& val : expected) {
+			val = (val * 5 + 3) & mask;
+		}
+		CHECK(holds_model(changed, expected));
+
+		// for_each over decoded values
+		std::atomic<uint64_t> total(0), calls(0);
+		parallel_for_each(array, [&](uint64_t val) {
+			total.fetch_add(val, std::memory_order_relaxed);
+			calls.fetch_add(1, std::memory_order_relaxed);
+		}, pool);
+		CHECK(total.load() == array.sum() && calls.load() == size);
+
+		// reduce
+		CHECK(parallel_reduce(array, uint64_t(7), std::plus<>{}, pool) == array.sum() + 7);
+		CHECK(parallel_reduce(array, uint64_t(0), [](uint64_t x, uint64_t y) { return std::max(x, y); }, pool)
+			== (size ? array.max() : 0));
+
+		// transform into another width and policy, and in place
+		BitArray<13, 0, BitArrayOverflow::saturate> narrow = make<13, 0, BitArrayOverflow::saturate>({1, 2, 3});
+		parallel_transform(array, narrow, [](uint64_t val) { return val * 3; }, pool);
+		std::vector<uint64_t> saturated = model;
+		for (uint64_t& val : saturated) {
+			val = std::min<uint64_t>(val * 3, bitarray_detail::mask_of<13>());
+		}
+		CHECK(holds_model(narrow, saturated));
+		BitArray<Bits, 0, BitArrayOverflow::wrap> wrapped = make<Bits, 0, BitArrayOverflow::wrap>(model);
+		parallel_transform(wrapped, wrapped, [](uint64_t val) { return val + 1; }, pool);
+		for (size_t i{}; i < size; ++i) {
+			CHECK(wrapped[i] == ((model[i] + 1) & mask));
+		}
+
+		// pack_from/assign over an array with other content, words after the size stay zero
+		BitArray<Bits> packed = make<Bits>(std::vector<uint64_t>(size / 2 + 70, mask));
+		parallel_pack_from(packed, model.data(), size, pool);
+		CHECK(holds_model(packed, model));
+		packed.resize(size + 70);
+		CHECK(std::all_of(packed.begin() + size, packed.end(), [](uint64_t val) { return val == 0; }));
+		BitArray<Bits> assigned;
+		parallel_assign(assigned, model, pool);
+		CHECK(holds_model(assigned, model));
+
+		if (size) {	// a value over the mask => overflow_error and an empty array
+			std::vector<uint64_t> over = model;
+			over[size - 1] = mask + 1;
+			bool thrown = false;
+			try {
+				parallel_assign(assigned, over, pool);
+			}
+			catch (const std::overflow_error&) {
+				thrown = true;
+			}
+			CHECK(thrown && assigned.empty());
+		}
+	}
+}
+
+static void test_exceptions(BitArrayThreadPool& pool) {
+	for (int round{}; round < 3; ++round) {
+		bool thrown = false;
+		try {
+			pool.run(100, [](size_t task) {
+				if (task % 10 == 3) {
+					throw std::runtime_error("task");
+				}
+			});
+		}
+		catch (const std::runtime_error&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+
+		// the pool still runs every task afterwards
+		std::atomic<size_t> done(0);
+		pool.run(1000, [&](size_t) {
+			done.fetch_add(1, std::memory_order_relaxed);
+		});
+		CHECK(done.load() == 1000);
+	}
+
+	// from inside an algorithm
+	const std::vector<uint64_t> model = random_values(3 * bitarray_detail::parallel_min_chunk, 7, 99);
+	const BitArray<7> array = make<7>(model);
+	bool thrown = false;
+	try {
+		parallel_for_each(array, [](uint64_t val) {
+			if (val == 127) {
+				throw std::logic_error("element");
+			}
+		}, pool);
+	}
+	catch (const std::logic_error&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+	CHECK(parallel_reduce(array, uint64_t(0), std::plus<>{}, pool) == array.sum());
+
+	// a run from inside a task is done by that thread
+	std::atomic<size_t> inner(0);
+	pool.run(8, [&](size_t) {
+		pool.run(10, [&](size_t) {
+			inner.fetch_add(1, std::memory_order_relaxed);
+		});
+	});
+	CHECK(inner.load() == 80);
+}
+
+int main() {
+	for (size_t threads : {size_t(1), size_t(4)}) {
+		BitArrayThreadPool pool(threads);
+		CHECK(pool.size() == threads);
+		for_widths<3, 7, 33>([&](auto bits) {
+			test_width<bits>(pool);
+		});
+		test_exceptions(pool);
+	}
+	return 0;
+}
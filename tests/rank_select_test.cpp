@@ -0,0 +1,145 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <stdexcept>
+#include <vector>
+
+// rank1/rank0 at every position and select1/select0 of every one and zero against the model,
+// the index is built (or brought up to date) by the first query
+static void check_index(const BitArray<1>& bits, const std::vector<uint64_t>& model) {
+	CHECK(holds_model(bits, model));
+	size_t ones = 0;
+	for (size_t pos{}; pos <= model.size(); ++pos) {
+		CHECK(bits.rank1(pos) == ones && bits.rank0(pos) == pos - ones);
+		if (pos < model.size()) {
+			ones += model[pos];
+		}
+	}
+	size_t one = 0;
+	size_t zero = 0;
+	for (size_t pos{}; pos < model.size(); ++pos) {
+		CHECK(model[pos] ? bits.select1(one++) == pos : bits.select0(zero++) == pos);
+	}
+
+	bool rank_thrown = false;
+	bool select1_thrown = false;
+	bool select0_thrown = false;
+	try {
+		bits.rank1(model.size() + 1);
+	}
+	catch (const std::out_of_range&) {
+		rank_thrown = true;
+	}
+	try {
+		bits.select1(one);
+	}
+	catch (const std::out_of_range&) {
+		select1_thrown = true;
+	}
+	try {
+		bits.select0(zero);
+	}
+	catch (const std::out_of_range&) {
+		select0_thrown = true;
+	}
+	CHECK(rank_thrown && select1_thrown && select0_thrown);
+}
+
+static BitArray<1> make(const std::vector<uint64_t>& model) {
+	BitArray<1> bits;
+	for (uint64_t val : model) {
+		bits.push_back(val);
+	}
+	return bits;
+}
+
+// all zeros and all ones around the 2048-bit blocks and the 4096-one select samples
+static void test_uniform() {
+	for (uint64_t val : {uint64_t(0), uint64_t(1)}) {
+		for (size_t size : {size_t(0), size_t(1), size_t(2047), size_t(2048), size_t(2049), size_t(4096), size_t(3 * 4096 + 5)}) {
+			const std::vector<uint64_t> model(size, val);
+			check_index(make(model), model);
+		}
+	}
+}
+
+// every change after a query marks the index stale from its first bit, the next query sees it
+static void test_changes(size_t size, size_t one_in, uint64_t seed) {
+	std::vector<uint64_t> model = random_values(size, 64, seed);
+	for (uint64_t& val : model) {
+		val = val % one_in == 0;
+	}
+	BitArray<1> bits = make(model);
+	check_index(bits, model);
+
+	for (size_t i{}; i < 20; ++i) {	// across the block edge
+		bits.push_back(i % 2);
+		model.push_back(i % 2);
+	}
+	check_index(bits, model);
+
+	bits.erase(bits.begin() + 2047, bits.begin() + 2050);	// the last bit of block 0 and two of block 1
+	model.erase(model.begin() + 2047, model.begin() + 2050);
+	check_index(bits, model);
+
+	bits.insert(bits.begin() + 4095, 1, 3);
+	model.insert(model.begin() + 4095, 3, 1);
+	check_index(bits, model);
+
+	bits.insert(bits.begin() + 2, 0, 70);	// near the front: everything after moves
+	model.insert(model.begin() + 2, 70, 0);
+	check_index(bits, model);
+
+	for (size_t pos : {size_t(0), size_t(2047), size_t(2048), size_t(6000), model.size() - 1}) {
+		bits[pos] = !model[pos];
+		model[pos] = !model[pos];
+		check_index(bits, model);
+	}
+
+	std::vector<uint64_t> other_model = random_values(model.size(), 1, seed + 1);
+	const BitArray<1> other = make(other_model);
+	bits &= other;
+	for (size_t i{}; i < model.size(); ++i) {
+		model[i] &= other_model[i];
+	}
+	check_index(bits, model);
+	bits |= other;
+	for (size_t i{}; i < model.size(); ++i) {
+		model[i] |= other_model[i];
+	}
+	check_index(bits, model);
+
+	for (size_t shift : {size_t(1), size_t(64), size_t(2048), size_t(2049)}) {
+		bits.shift_left(shift);	// element i moves to i + shift
+		std::vector<uint64_t> shifted(model.size(), 0);
+		for (size_t i = shift; i < model.size(); ++i) {
+			shifted[i] = model[i - shift];
+		}
+		model = shifted;
+		check_index(bits, model);
+	}
+
+	bits.pop_back();
+	model.pop_back();
+	bits.resize(model.size() + 3000);
+	model.resize(model.size() + 3000, 0);
+	check_index(bits, model);
+
+	bits.shift_left(model.size());
+	std::fill(model.begin(), model.end(), 0);
+	check_index(bits, model);
+
+	bits.drop_rank_index();	// made again by the next query
+	bits.fill(1);
+	std::fill(model.begin(), model.end(), 1);
+	bits.build_rank_index();
+	check_index(bits, model);
+}
+
+int main() {
+	test_uniform();
+	test_changes(10000, 2, 1);	// dense
+	test_changes(10000, 300, 2);	// sparse: samples span many blocks
+	test_changes(20000, 1, 3);	// all ones
+	return 0;
+}
@@ -0,0 +1,111 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+// sum, min, max, minmax and the scans against std::accumulate / std::minmax_element / std::partial_sum,
+// every width 1..63 (dividing 64 or not) (reduce_scalar runs it again with BITARRAY_NO_SIMD)
+
+template<size_t Bits>
+static BitArray<Bits> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+template<size_t Bits>
+static void check_range(const BitArray<Bits>& array, const std::vector<uint64_t>& model, size_t first, size_t count) {
+	const auto beg = model.begin() + first, end = beg + count;
+	const uint64_t sum = std::accumulate(beg, end, uint64_t(0));	// modulo 2^64 like sum()
+	CHECK(array.sum(first, count) == sum);
+
+	if (count) {
+		const auto [min_it, max_it] = std::minmax_element(beg, end);
+		CHECK(array.min(first, count) == *min_it);
+		CHECK(array.max(first, count) == *max_it);
+		CHECK(array.minmax(first, count) == std::make_pair(*min_it, *max_it));
+	}
+	else {
+		bool thrown = false;
+		try {
+			array.minmax(first, count);
+		}
+		catch (const std::out_of_range&) {
+			thrown = true;
+		}
+		CHECK(thrown);
+	}
+
+	const uint64_t init = 12345;
+	std::vector<uint64_t> expected(count), out(count + 1, 7);
+	std::partial_sum(beg, end, expected.begin(), [](uint64_t x, uint64_t y) { return x + y; });
+	for (uint64_t& val : expected) {
+		val += init;
+	}
+	CHECK(array.inclusive_scan(out.data(), first, count, init) == init + sum);
+	CHECK(std::equal(expected.begin(), expected.end(), out.begin()) && out[count] == 7);	// nothing past count
+	for (size_t i{}; i < count; ++i) {
+		expected[i] -= model[first + i];
+	}
+	CHECK(array.exclusive_scan(out.data(), first, count, init) == init + sum);
+	CHECK(std::equal(expected.begin(), expected.end(), out.begin()) && out[count] == 7);
+}
+
+template<size_t Bits>
+static void check_array(const std::vector<uint64_t>& model) {
+	const BitArray<Bits> array = make<Bits>(model);
+	const size_t size = model.size();
+
+	CHECK(array.sum() == std::accumulate(model.begin(), model.end(), uint64_t(0)));
+	if (size) {
+		CHECK(array.minmax() == std::make_pair(*std::min_element(model.begin(), model.end()), *std::max_element(model.begin(), model.end())));
+		CHECK(array.min() == array.minmax().first && array.max() == array.minmax().second);
+	}
+	std::vector<uint64_t> out(size + 1, 7);
+	CHECK(array.inclusive_scan(out.data()) == array.sum() && out[size] == 7);
+	CHECK(array.exclusive_scan(out.data(), 1) == array.sum() + 1);
+
+	// subranges starting and ending inside words and groups
+	for (size_t first : {size_t(0), size_t(1), size_t(3), 64 / Bits + 1, size / 3}) {
+		for (size_t count : {size_t(0), size_t(1), size_t(5), 64 / Bits, 4 * (64 / Bits) + 3, size / 2, size}) {
+			if (first <= size && count <= size - first) {
+				check_range<Bits>(array, model, first, count);
+			}
+		}
+	}
+	bool thrown = false;
+	try {
+		array.sum(size, 1);
+	}
+	catch (const std::out_of_range&) {
+		thrown = true;
+	}
+	CHECK(thrown);
+}
+
+template<size_t Bits>
+static void test_width() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	for (size_t size : {size_t(0), size_t(1), size_t(7), size_t(64), size_t(201), size_t(1000)}) {
+		check_array<Bits>(random_values(size, Bits, size * 64 + Bits));
+	}
+	// all at the maximum: narrow lane sums overflow many times, wide ones wrap the 64-bit total
+	check_array<Bits>(std::vector<uint64_t>(5003, mask));
+	// a single minimum/maximum near the end of the last partial word
+	std::vector<uint64_t> model(777, mask / 2);
+	model[775] = 0;
+	model[776] = mask;
+	check_array<Bits>(model);
+}
+
+int main() {
+	for_all_widths([](auto bits) {
+		test_width<bits>();
+	});
+	return 0;
+}
@@ -0,0 +1,113 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <vector>
+
+// find, find_first_not, find_if, count, count_if_less and mismatch against naive loops, every width 1..63
+// (search_scalar runs it again with BITARRAY_NO_SIMD)
+
+template<size_t Bits>
+static BitArray<Bits> make(const std::vector<uint64_t>& model) {
+	BitArray<Bits> array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+template<typename Pred>
+static size_t naive_find(const std::vector<uint64_t>& model, size_t from, Pred pred) {
+	for (size_t i = from; i < model.size(); ++i) {
+		if (pred(model[i])) {
+			return i;
+		}
+	}
+	return model.size();
+}
+
+template<typename Pred>
+static size_t naive_count(const std::vector<uint64_t>& model, Pred pred) {
+	size_t count = 0;
+	for (uint64_t val : model) {
+		count += pred(val);
+	}
+	return count;
+}
+
+// every query for every val and from (inside words, at the last element, at and past size())
+template<size_t Bits>
+static void check_searches(const std::vector<uint64_t>& model) {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	constexpr size_t per_word = 64 / Bits;
+	const BitArray<Bits> array = make<Bits>(model);
+	const size_t size = model.size();
+
+	std::vector<size_t> froms = {0, 1, per_word / 2, per_word + 1, 3 * per_word - 1, size, size + 5};
+	if (size) {
+		froms.push_back(size - 1);
+		froms.push_back(size / 2);
+	}
+	for (uint64_t val : {uint64_t(0), uint64_t(1), uint64_t(2), uint64_t(3), mask - 1, mask, mask + 1}) {
+		for (size_t from : froms) {
+			const size_t start = from < size ? from : size;
+			CHECK(array.find(val, from) == naive_find(model, start, [val](uint64_t x) { return x == val; }));
+			CHECK(array.find_first_not(val, from) == naive_find(model, start, [val](uint64_t x) { return x != val; }));
+			CHECK(array.find_if([val](uint64_t x) { return x > val; }, from) == naive_find(model, start, [val](uint64_t x) { return x > val; }));
+		}
+		CHECK(array.count(val) == naive_count(model, [val](uint64_t x) { return x == val; }));
+		CHECK(array.count_if_less(val) == naive_count(model, [val](uint64_t x) { return x < val; }));
+	}
+	CHECK(array.count_if_less(~uint64_t(0)) == size);
+}
+
+// mismatch at every kind of position, sizes differing too
+template<size_t Bits>
+static void check_mismatch(const std::vector<uint64_t>& model) {
+	const BitArray<Bits> array = make<Bits>(model);
+	const size_t size = model.size();
+	CHECK(array.mismatch(array) == size);
+	for (size_t pos : {size_t(0), size_t(1), 64 / Bits, size / 2, size - 1}) {
+		if (pos >= size) {
+			continue;
+		}
+		std::vector<uint64_t> changed = model;
+		changed[pos] ^= 1;
+		const BitArray<Bits> other = make<Bits>(changed);
+		CHECK(array.mismatch(other) == pos && other.mismatch(array) == pos);
+	}
+	std::vector<uint64_t> prefix(model.begin(), model.begin() + size / 2);
+	const BitArray<Bits> shorter = make<Bits>(prefix);
+	CHECK(array.mismatch(shorter) == size / 2 && shorter.mismatch(array) == size / 2);
+	prefix.push_back(size ? model[size / 2] ^ 1 : 0);
+	const BitArray<Bits> differs_at_end = make<Bits>(prefix);
+	CHECK(array.mismatch(differs_at_end) == (size ? size / 2 : 0));
+}
+
+template<size_t Bits>
+static void test_width() {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	for (size_t size : {size_t(0), size_t(1), 64 / Bits, 64 / Bits + 1, size_t(63), size_t(65), size_t(257), size_t(1003)}) {
+		// a small alphabet => many matches, some lanes at the maximum
+		std::vector<uint64_t> model = random_values(size, 64, size * 64 + Bits);
+		for (uint64_t& val : model) {
+			val = val % 5 == 4 ? mask : val % 4 & mask;
+		}
+		check_searches<Bits>(model);
+		check_mismatch<Bits>(model);
+
+		// no zero at all: the zero bits after size() in the last word must not match
+		std::vector<uint64_t> full(size, mask);
+		check_searches<Bits>(full);
+		if (size) {	// the only match is the last element, in the last (partial) word
+			full.back() = 0;
+			check_searches<Bits>(full);
+		}
+	}
+}
+
+int main() {
+	for_all_widths([](auto bits) {
+		test_width<bits>();
+	});
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include "SegmentedBitArray.h"
+#include "check.h"
+
+#include <memory_resource>
+#include <set>
+#include <utility>
+
+// knows every block it handed out: a block freed through the wrong resource fails the check
+class tracking_resource : public std::pmr::memory_resource {
+public:
+	std::set<void*> blocks;
+
+	~tracking_resource() override {
+		CHECK(blocks.empty());
+	}
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		void* ptr = std::pmr::new_delete_resource()->allocate(bytes, alignment);
+		blocks.insert(ptr);
+		return ptr;
+	}
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+		CHECK(blocks.erase(ptr) == 1);
+		std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+using Segmented = SegmentedBitArray<5, 8>;	// 12 elements per chunk => many chunks from few elements
+
+static Segmented make(std::pmr::memory_resource* resource, size_t count, uint64_t offset) {
+	Segmented array(resource);
+	for (size_t i{}; i < count; ++i) {
+		array.push_back((i + offset) % 31);
+	}
+	return array;
+}
+
+static bool holds(const Segmented& array, size_t count, uint64_t offset) {
+	if (array.size() != count) {
+		return false;
+	}
+	for (size_t i{}; i < count; ++i) {
+		if (array[i] != (i + offset) % 31) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// move assignment between different resources: the target takes the source's chunks and resource
+static void test_move_assignment() {
+	tracking_resource left_resource;
+	tracking_resource right_resource;
+	{
+		Segmented left = make(&left_resource, 100, 0);
+		Segmented right = make(&right_resource, 300, 1);
+		left = std::move(right);
+		CHECK(holds(left, 300, 1) && right.empty());
+		CHECK(left.resource() == &right_resource && left_resource.blocks.empty());
+
+		right.push_back(7);	// the moved-from array still works on its own resource
+		CHECK(right.size() == 1 && right[0] == 7);
+		left.push_back(3);
+		left.insert(left.begin() + 5, 4, 20);
+		CHECK(left.size() == 321 && left[5] == 4 && left[320] == 3);
+	}
+	CHECK(right_resource.blocks.empty());
+}
+
+// swap between different resources, then growth and erases that free chunks through the swapped resources
+static void test_swap() {
+	tracking_resource left_resource;
+	tracking_resource right_resource;
+	{
+		Segmented left = make(&left_resource, 50, 0);
+		Segmented right = make(&right_resource, 500, 2);
+		left.swap(right);
+		CHECK(holds(left, 500, 2) && holds(right, 50, 0));
+		CHECK(left.resource() == &right_resource && right.resource() == &left_resource);
+
+		left.erase(left.begin(), left.begin() + 400);
+		right.resize(1000);
+		left.swap(right);
+		CHECK(left.size() == 1000 && right.size() == 100 && right[0] == (400 + 2) % 31);
+		CHECK(left.resource() == &left_resource && right.resource() == &right_resource);
+	}
+	CHECK(left_resource.blocks.empty() && right_resource.blocks.empty());
+}
+
+// a monotonic arena on one side (deallocate is a no-op there, the arena must outlive what it holds)
+static void test_arena() {
+	tracking_resource heap;
+	std::pmr::monotonic_buffer_resource arena(&heap);
+	Segmented on_heap = make(&heap, 200, 0);
+	{
+		Segmented in_arena = make(&arena, 200, 3);
+		on_heap = std::move(in_arena);
+		in_arena = make(&arena, 10, 4);
+		CHECK(holds(in_arena, 10, 4));
+	}
+	CHECK(holds(on_heap, 200, 3) && on_heap.resource() == &arena);
+	on_heap = Segmented(&heap);
+	CHECK(on_heap.empty() && on_heap.resource() == &heap);
+}
+
+int main() {
+	test_move_assignment();
+	test_swap();
+	test_arena();
+	return 0;
+}
@@ -0,0 +1,66 @@
+#include "BitArray.h"
+#include "BitArrayView.h"
+#include "check.h"
+
+#include <algorithm>
+#include <memory_resource>
+#include <vector>
+
+template<typename Array>
+static bool sorted_like(const Array& array, std::vector<uint64_t> values) {
+	std::sort(values.begin(), values.end());
+	return holds_model(array, values);
+}
+
+// counting sort widths on both sides of the 2^Bits switch (radix sort widths at the same sizes), against std::sort
+template<size_t Bits>
+static void test_sizes() {
+	constexpr size_t limit = size_t(1) << (Bits <= 16 ? Bits : 16);
+	for (size_t count : {size_t(0), size_t(1), size_t(2), size_t(100), limit - 1, limit, 3 * limit + 5}) {
+		const std::vector<uint64_t> values = random_values(count, Bits, count + Bits);
+		BitArray<Bits> array(values);
+		array.sort();
+		CHECK(sorted_like(array, values));
+	}
+}
+
+// the counters and the scratch don't come from the array's resource: inline arrays on null_memory_resource sort
+template<size_t Bits, size_t InlineWords>
+static void test_null_resource() {
+	const size_t count = InlineWords * 64 / Bits;
+	const std::vector<uint64_t> values = random_values(count, Bits, Bits);
+	BitArray<Bits, InlineWords> array(std::pmr::null_memory_resource());
+	for (uint64_t val : values) {
+		array.push_back(val);
+	}
+	array.sort();
+	CHECK(sorted_like(array, values));
+}
+
+// spans off the element grid sort through an aligned copy and leave the neighbours alone
+static void test_span() {
+	const std::vector<uint64_t> values = random_values(300, 12, 7);
+	std::vector<uint64_t> words(64, ~uint64_t(0));
+	BitArraySpan<12> span(words.data(), 5, values.size());
+	for (size_t i{}; i < values.size(); ++i) {
+		span[i] = values[i];
+	}
+	span.sort();
+	CHECK(sorted_like(span, values));
+	CHECK(words[0] >> 59 == 31);
+	CHECK((words[(5 + 300 * 12) / 64] & 1) == 1);
+}
+
+int main() {
+	test_sizes<4>();
+	test_sizes<12>();
+	test_sizes<16>();
+	test_sizes<20>();
+	test_sizes<33>();
+	test_null_resource<4, 2>();
+	test_null_resource<12, 4>();
+	test_null_resource<16, 4>();
+	test_null_resource<20, 8>();
+	test_span();
+	return 0;
+}
@@ -0,0 +1,148 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+template<typename Array>
+static Array make(const std::vector<uint64_t>& model) {
+	Array array;
+	for (uint64_t val : model) {
+		array.push_back(val);
+	}
+	return array;
+}
+
+template<typename Array>
+static std::string saved(const Array& array, bool checksum = true) {
+	std::ostringstream os;
+	array.save(os, checksum);
+	return os.str();
+}
+
+// load must throw std::runtime_error and leave the target as it was
+template<typename Array>
+static void check_rejected(const std::string& bytes, const std::vector<uint64_t>& target_model) {
+	Array target = make<Array>(target_model);
+	std::istringstream is(bytes);
+	bool thrown = false;
+	try {
+		target.load(is);
+	}
+	catch (const std::runtime_error&) {
+		thrown = true;
+	}
+	CHECK(thrown && holds_model(target, target_model));
+}
+
+// save => load into a target with other contents, with and without checksums
+template<typename Array, size_t Bits>
+static void test_round_trip(size_t count) {
+	const std::vector<uint64_t> model = random_values(count, Bits, count + Bits);
+	const std::vector<uint64_t> old_model = random_values(count / 2 + 3, Bits, count + Bits + 1);
+	const Array array = make<Array>(model);
+	for (bool checksum : {true, false}) {
+		Array target = make<Array>(old_model);
+		std::istringstream is(saved(array, checksum));
+		target.load(is);
+		CHECK(holds_model(target, model) && is.peek() == std::char_traits<char>::eof());
+		target.push_back(1);	// the bits after size() were zero
+		CHECK(target[count] == 1 && target.sum() == array.sum() + 1);
+	}
+}
+
+// every damaged stream is rejected without touching the target
+template<typename Array, size_t Bits>
+static void test_rejected(size_t count) {
+	const std::vector<uint64_t> model = random_values(count, Bits, count * 3 + Bits);
+	const std::vector<uint64_t> target_model = random_values(17, Bits, Bits);
+	const std::string good = saved(make<Array>(model));
+
+	for (size_t length : {size_t(0), size_t(7), size_t(39), size_t(40), size_t(41), good.size() - 9, good.size() - 8, good.size() - 1}) {
+		if (length < good.size()) {
+			check_rejected<Array>(good.substr(0, length), target_model);
+		}
+	}
+	std::string bad = good;
+	bad[3] = 'X';	// magic
+	check_rejected<Array>(bad, target_model);
+	bad = good;
+	bad[8] = 2;	// version
+	check_rejected<Array>(bad, target_model);
+	bad = good;
+	bad[12] = static_cast<char>(Bits + 1);	// width
+	check_rejected<Array>(bad, target_model);
+	bad = good;
+	bad[24] = 0;	// packing order
+	check_rejected<Array>(bad, target_model);
+	bad = good;
+	bad[32] = bad[33] = bad[34] = bad[35] = 0;	// chunk size 0
+	check_rejected<Array>(bad, target_model);
+	if (count) {
+		bad = good;
+		bad[40] ^= 0x10;	// a word of the first chunk
+		check_rejected<Array>(bad, target_model);
+		bad = good;
+		bad[good.size() - 1] ^= 1;	// the checksum of the last chunk
+		check_rejected<Array>(bad, target_model);
+	}
+}
+
+// the bytes of a small stream: little endian header fields and words (element 0 in the high byte of word 0)
+static void test_golden() {
+	const std::vector<unsigned char> header = {
+		'B', 'A', 'S', 'T', 'R', 'E', 'A', 'M',
+		1, 0, 0, 0,	// version
+		8, 0, 0, 0,	// Bits
+		9, 0, 0, 0, 0, 0, 0, 0,	// size
+		1, 0, 0, 0,	// msb first
+		0, 0, 0, 0,	// flags, set below
+		0, 0, 1, 0,	// 65536 words per chunk
+		0, 0, 0, 0,
+	};
+	const std::vector<unsigned char> words = {
+		0x08, 0x07, 0x06, 0x05, 0x04, 0x03, 0x02, 0x01,	// elements 1..8
+		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09,	// element 9, then zero bits
+	};
+	const std::vector<unsigned char> sum = { 0xe1, 0xe4, 0x2a, 0xc1, 0xa1, 0x04, 0x7d, 0x19 };
+
+	BitArray<8> array;
+	for (uint64_t val{ 1 }; val <= 9; ++val) {
+		array.push_back(val);
+	}
+	std::string plain(header.begin(), header.end());
+	plain.append(words.begin(), words.end());
+	std::string summed = plain;
+	summed[28] = 1;
+	summed.append(sum.begin(), sum.end());
+	CHECK(saved(array, false) == plain && saved(array) == summed);
+
+	for (const std::string& bytes : {plain, summed}) {
+		BitArray<8> loaded;
+		std::istringstream is(bytes);
+		loaded.load(is);
+		CHECK(loaded.size() == 9 && loaded[0] == 1 && loaded[8] == 9);
+	}
+}
+
+template<size_t Bits>
+static void test_width() {
+	for (size_t count : {size_t(0), size_t(1), size_t(1000)}) {
+		test_round_trip<BitArray<Bits>, Bits>(count);
+		test_rejected<BitArray<Bits>, Bits>(count);
+	}
+}
+
+int main() {
+	test_golden();
+	for_widths<1, 3, 8, 13, 33, 63>([](auto bits) {
+		test_width<bits>();
+	});
+	test_round_trip<BitArray<5, 2>, 5>(20);	// inline words
+	test_rejected<BitArray<5, 2>, 5>(20);
+	test_round_trip<BitArray<13>, 13>(400000);	// two chunks
+	test_rejected<BitArray<13>, 13>(400000);
+	return 0;
+}
@@ -0,0 +1,123 @@
+#include "BitArray.h"
+#include "check.h"
+
+#include <memory_resource>
+#include <vector>
+
+// counts what reaches the upstream resource
+class counting_resource : public std::pmr::memory_resource {
+public:
+	size_t allocations = 0;
+	size_t deallocations = 0;
+private:
+	void* do_allocate(size_t bytes, size_t alignment) override {
+		++allocations;
+		return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+	}
+	void do_deallocate(void* ptr, size_t bytes, size_t alignment) override {
+		++deallocations;
+		std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+	}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+		return this == &other;
+	}
+};
+
+template<typename Array>
+static Array make(std::pmr::memory_resource* resource, size_t count) {
+	Array array(resource);
+	for (size_t i{}; i < count; ++i) {
+		array.push_back(i % 7);
+	}
+	return array;
+}
+
+template<typename Array>
+static bool holds(const Array& array, size_t count) {
+	if (array.size() != count) {
+		return false;
+	}
+	for (size_t i{}; i < count; ++i) {
+		if (array[i] != i % 7) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// moves and swaps hand the buffer over without allocating
+static void test_moves() {
+	counting_resource counter;
+	BitArray<5> a = make<BitArray<5>>(&counter, 1000);
+	const size_t allocations = counter.allocations;
+
+	BitArray<5> b(std::move(a));
+	CHECK(holds(b, 1000) && a.empty());
+	BitArray<5> c(&counter);
+	c = std::move(b);
+	CHECK(holds(c, 1000) && b.empty());
+	c.swap(a);
+	swap(a, c);
+	CHECK(holds(c, 1000) && a.empty());
+	CHECK(c.resource() == &counter);
+	CHECK(counter.allocations == allocations);
+}
+
+// a vector of arrays relocates them by moving
+static void test_relocation() {
+	counting_resource counter;
+	std::vector<BitArray<3>> arrays;
+	for (size_t i{}; i < 100; ++i) {
+		arrays.push_back(make<BitArray<3>>(&counter, 200));
+	}
+	const size_t allocations = counter.allocations;
+	arrays.reserve(arrays.capacity() * 4);
+	arrays.insert(arrays.begin(), BitArray<3>(&counter));
+	arrays.erase(arrays.begin());
+	CHECK(counter.allocations == allocations);
+	for (const BitArray<3>& array : arrays) {
+		CHECK(holds(array, 200));
+	}
+}
+
+// arrays that fit InlineWords never reach the resource, copies and moves included
+static void test_inline() {
+	counting_resource counter;
+	{
+		BitArray<4, 2> a = make<BitArray<4, 2>>(&counter, 32);	// 2 words
+		BitArray<4, 2> b(a, &counter);
+		BitArray<4, 2> c(std::move(a));
+		BitArray<4, 2> d(&counter);
+		d = b;
+		d = std::move(c);
+		b.swap(d);
+		CHECK(holds(b, 32) && holds(d, 32));
+		d.clear();
+		d.shrink_to_fit();
+	}
+	CHECK(counter.allocations == 0);
+
+	BitArray<4, 2> e = make<BitArray<4, 2>>(&counter, 33);	// spills
+	CHECK(counter.allocations != 0 && holds(e, 33));
+	e.clear();
+	CHECK(counter.deallocations == counter.allocations);
+}
+
+// copy assignment reuses a big enough buffer
+static void test_copy_assignment() {
+	counting_resource counter;
+	BitArray<7> a = make<BitArray<7>>(&counter, 500);
+	BitArray<7> b = make<BitArray<7>>(&counter, 300);
+	const size_t allocations = counter.allocations;
+	a = b;
+	CHECK(holds(a, 300) && counter.allocations == allocations);
+	a.push_back(300 % 7);	// words past the size stay zero
+	CHECK(holds(a, 301));
+}
+
+int main() {
+	test_moves();
+	test_relocation();
+	test_inline();
+	test_copy_assignment();
+}
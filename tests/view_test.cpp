@@ -0,0 +1,420 @@
+#include "BitArrayView.h"
+#include "check.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+
+static size_t ones_before(const BitArray<1>& bits, size_t pos) {
+	size_t ones = 0;
+	for (size_t i{}; i < pos; ++i) {
+		ones += bits[i];
+	}
+	return ones;
+}
+
+// the rank index agrees with the bits at every 97th position and at the end, select1 finds the last one
+static bool rank_matches(const BitArray<1>& bits) {
+	for (size_t pos{}; pos < bits.size(); pos += 97) {
+		if (bits.rank1(pos) != ones_before(bits, pos)) {
+			return false;
+		}
+	}
+	const size_t ones = bits.count();
+	return bits.rank1(bits.size()) == ones && (!ones || bits[bits.select1(ones - 1)] == 1);
+}
+
+// every write path of a span over BitArray<1> after a rank query: the next query sees the write
+static void test_rank_after_writes() {
+	BitArray<1> bits;
+	for (size_t i{}; i < 5000; ++i) {
+		bits.push_back(i % 3 == 0);
+	}
+	BitArray<1> other = bits;
+	other.flip();
+	const BitArraySpan<1> span(bits);
+	const std::vector<size_t> idx = {4999, 7, 2048, 3000};
+	const std::vector<uint64_t> vals = {1, 1, 0, 1};
+	const std::vector<uint8_t> packed(700, 1);
+
+	CHECK(rank_matches(bits));
+	span[4000] = 1;
+	CHECK(rank_matches(bits));
+	*(span.begin() + 4500) = 1;
+	CHECK(rank_matches(bits));
+	span.at(10) = 1;
+	CHECK(rank_matches(bits));
+	std::fill(span.begin() + 100, span.begin() + 900, 1);
+	CHECK(rank_matches(bits));
+	span.unchecked_set(4990, 1);
+	CHECK(rank_matches(bits));
+	span.fill(3000, 500, 0);
+	CHECK(rank_matches(bits));
+	span.pack_from(packed.data(), 4200, packed.size());
+	CHECK(rank_matches(bits));
+	span.flip();
+	CHECK(rank_matches(bits));
+	span |= BitArrayView<1>(other);
+	CHECK(rank_matches(bits));
+	span.andnot(BitArrayView<1>(other));
+	CHECK(rank_matches(bits));
+	span.scatter(idx.data(), vals.data(), idx.size());
+	CHECK(rank_matches(bits));
+	span.shift_left(33);
+	CHECK(rank_matches(bits));
+	span.shift_right(65);
+	CHECK(rank_matches(bits));
+	span.subview(1000, 3000).fill(1);
+	CHECK(rank_matches(bits));
+	span.subview(3, 4000).subview(1, 100).flip();	// off the word grid
+	CHECK(rank_matches(bits));
+	std::reverse(span.begin(), span.end());
+	CHECK(rank_matches(bits));
+	span.sort();
+	CHECK(rank_matches(bits));
+}
+
+// element bits read and written one bit at a time (MSB first), independent of the kernels under test
+static uint64_t read_element(const std::vector<uint64_t>& words, size_t bit, size_t bits) {
+	uint64_t val = 0;
+	for (size_t i{}; i < bits; ++i, ++bit) {
+		val = val << 1 | (words[bit / 64] >> (63 - bit % 64) & 1);
+	}
+	return val;
+}
+
+static void write_element(std::vector<uint64_t>& words, size_t bit, size_t bits, uint64_t val) {
+	for (size_t i{}; i < bits; ++i, ++bit) {
+		const uint64_t one = uint64_t(1) << (63 - bit % 64);
+		words[bit / 64] = (val >> (bits - 1 - i) & 1) ? words[bit / 64] | one : words[bit / 64] & ~one;
+	}
+}
+
+// a span over random words at a bit offset and its std::vector model; every word outside the span is a guard
+template<size_t Bits>
+struct span_model {
+	std::vector<uint64_t> background;	// the words before any write
+	std::vector<uint64_t> words;
+	std::vector<uint64_t> model;
+	size_t offset;
+	BitArraySpan<Bits> span;
+
+	span_model(size_t offset, size_t count, uint64_t seed)
+		: background(random_values((offset + count * Bits + 63) / 64 + 2, 64, seed)), words(background),
+		model(random_values(count, Bits, seed + 1)), offset(offset), span(words.data(), offset, count) {
+		for (size_t i{}; i < count; ++i) {
+			span[i] = model[i];
+		}
+	}
+
+	// the words hold exactly the model inside the span and the background outside it
+	bool matches() const {
+		std::vector<uint64_t> expected = background;
+		for (size_t i{}; i < model.size(); ++i) {
+			write_element(expected, offset + i * Bits, Bits, model[i]);
+		}
+		for (size_t i{}; i < model.size(); ++i) {
+			if (read_element(words, offset + i * Bits, Bits) != model[i]) {
+				return false;
+			}
+		}
+		return words == expected && holds_model(span, model);
+	}
+};
+
+// random [first, first + count) inside size
+static std::pair<size_t, size_t> random_range(std::mt19937_64& rng, size_t size) {
+	const size_t first = size ? rng() % (size + 1) : 0;
+	return {first, size - first ? rng() % (size - first + 1) : 0};
+}
+
+// reads of the whole span, a random range and a subview against the model
+template<size_t Bits>
+static void check_reads(const span_model<Bits>& state, std::mt19937_64& rng) {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	const BitArrayView<Bits> view = state.span;	// span => read-only view
+	const std::vector<uint64_t>& model = state.model;
+	const size_t size = model.size();
+	const auto [first, count] = random_range(rng, size);
+	const auto begin = model.begin() + first;
+	const auto end = begin + count;
+
+	std::vector<uint64_t> out(count + 1, 7);
+	view.unpack_to(out.data(), first, count);
+	CHECK(std::equal(begin, end, out.begin()) && out[count] == 7);
+	CHECK(view.sum(first, count) == std::accumulate(begin, end, uint64_t(0)));
+	CHECK(std::accumulate(view.cbegin(), view.cend(), uint64_t(0)) == view.sum());
+	CHECK(size_t(view.cend() - view.cbegin()) == size);
+	if (count) {
+		CHECK(view.min(first, count) == *std::min_element(begin, end));
+		CHECK(view.max(first, count) == *std::max_element(begin, end));
+		const auto [low, high] = view.minmax(first, count);
+		CHECK(low == *std::min_element(begin, end) && high == *std::max_element(begin, end));
+	}
+	std::vector<uint64_t> scan(count);
+	uint64_t running = 5;
+	CHECK(view.exclusive_scan(scan.data(), first, count, 5) == 5 + std::accumulate(begin, end, uint64_t(0)));
+	for (size_t i{}; i < count; ++i) {
+		CHECK(scan[i] == running);
+		running += model[first + i];
+	}
+	CHECK(view.inclusive_scan(scan.data(), first, count, 5) == running);
+	CHECK(!count || scan[count - 1] == running);
+
+	const uint64_t val = size ? model[rng() % size] : 0;
+	const size_t from = size ? rng() % size : 0;
+	CHECK(view.find(val, from) == size_t(std::find(model.begin() + from, model.end(), val) - model.begin()));
+	CHECK(view.find_first_not(val, from) == size_t(std::find_if(model.begin() + from, model.end(), [val](uint64_t x) { return x != val; }) - model.begin()));
+	CHECK(view.find_if([val](uint64_t x) { return x > val; }, from) == size_t(std::find_if(model.begin() + from, model.end(), [val](uint64_t x) { return x > val; }) - model.begin()));
+	CHECK(view.count(val) == size_t(std::count(model.begin(), model.end(), val)));
+	CHECK(view.count_if_less(val) == size_t(std::count_if(model.begin(), model.end(), [val](uint64_t x) { return x < val; })));
+	CHECK(view.find(mask + 1) == size);
+	const uint64_t biggest = size ? *std::max_element(model.begin(), model.end()) : 0;
+	CHECK(view.min_width() == bitarray_detail::width_of(biggest));
+
+	std::vector<size_t> idx(count);
+	for (size_t& index : idx) {
+		index = rng() % size;
+	}
+	for (BitArrayBatchOrder order : {BitArrayBatchOrder::as_given, BitArrayBatchOrder::by_word}) {
+		std::vector<uint64_t> gathered(count);
+		view.gather(idx.data(), count, gathered.data(), order);
+		for (size_t i{}; i < count; ++i) {
+			CHECK(gathered[i] == model[idx[i]]);
+		}
+	}
+
+	const BitArrayView<Bits> sub = view.subview(first, count);
+	CHECK(holds_model(sub, std::vector<uint64_t>(begin, end)) && sub.sum() == view.sum(first, count));
+	size_t differs = 0;
+	while (differs < count && model[differs] == model[first + differs]) {
+		++differs;
+	}
+	CHECK(view.mismatch(view) == size && view.mismatch(sub) == differs);
+}
+
+// one random write through the span (or a subview), the same change in the model
+template<size_t Bits>
+static void random_write(span_model<Bits>& state, const BitArrayView<Bits>& other, const std::vector<uint64_t>& other_model,
+	std::mt19937_64& rng) {
+	constexpr uint64_t mask = bitarray_detail::mask_of<Bits>();
+	const BitArraySpan<Bits>& span = state.span;
+	std::vector<uint64_t>& model = state.model;
+	const size_t size = model.size();
+	const auto [first, count] = random_range(rng, size);
+	const uint64_t val = rng() & mask;
+
+	switch (rng() % 17) {
+	case 0:
+		if (size) {
+			const size_t index = rng() % size;
+			span[index] = val;
+			model[index] = val;
+		}
+		break;
+	case 1:
+		std::fill(span.begin() + first, span.begin() + first + count, val);
+		std::fill(model.begin() + first, model.begin() + first + count, val);
+		break;
+	case 2:
+		span.fill(first, count, val);
+		std::fill(model.begin() + first, model.begin() + first + count, val);
+		break;
+	case 3:
+		span.template add_scalar<BitArrayOverflow::wrap>(first, count, val);
+		for (size_t i = first; i < first + count; ++i) {
+			model[i] = (model[i] + val) & mask;
+		}
+		break;
+	case 4:
+		span.template sub_scalar<BitArrayOverflow::saturate>(first, count, val);
+		for (size_t i = first; i < first + count; ++i) {
+			model[i] = model[i] < val ? 0 : model[i] - val;
+		}
+		break;
+	case 5: {	// throw_error: all or nothing
+		const uint64_t small = val % 4;
+		const bool fits = std::all_of(model.begin() + first, model.begin() + first + count, [small](uint64_t x) { return x + small <= mask; });
+		bool thrown = false;
+		try {
+			span.add_scalar(first, count, small);
+		}
+		catch (const std::overflow_error&) {
+			thrown = true;
+		}
+		CHECK(thrown != fits);
+		if (fits) {
+			for (size_t i = first; i < first + count; ++i) {
+				model[i] += small;
+			}
+		}
+		break;
+	}
+	case 6: {
+		const size_t shift = rng() % (Bits + 2);
+		span.shift_right_all(first, count, shift);
+		for (size_t i = first; i < first + count; ++i) {
+			model[i] = shift >= Bits ? 0 : model[i] >> shift;
+		}
+		break;
+	}
+	case 7: {
+		const std::vector<uint64_t> in = random_values(count, Bits, rng());
+		span.pack_from(in.data(), first, count);
+		std::copy(in.begin(), in.end(), model.begin() + first);
+		break;
+	}
+	case 8:
+		span.template add<BitArrayOverflow::wrap>(other);
+		for (size_t i{}; i < size; ++i) {
+			model[i] = (model[i] + other_model[i]) & mask;
+		}
+		break;
+	case 9:
+		span &= other;
+		for (size_t i{}; i < size; ++i) {
+			model[i] &= other_model[i];
+		}
+		break;
+	case 10:
+		span |= other;
+		for (size_t i{}; i < size; ++i) {
+			model[i] |= other_model[i];
+		}
+		break;
+	case 11:
+		span ^= other;
+		for (size_t i{}; i < size; ++i) {
+			model[i] ^= other_model[i];
+		}
+		break;
+	case 12:
+		span.andnot(other);
+		for (size_t i{}; i < size; ++i) {
+			model[i] &= ~other_model[i];
+		}
+		break;
+	case 13:
+		span.subview(first, count).flip();
+		for (size_t i = first; i < first + count; ++i) {
+			model[i] = mask - model[i];
+		}
+		break;
+	case 14: {
+		std::vector<size_t> idx(size);	// distinct indices
+		std::iota(idx.begin(), idx.end(), size_t(0));
+		std::shuffle(idx.begin(), idx.end(), rng);
+		const std::vector<uint64_t> vals = random_values(count, Bits, rng());
+		span.scatter(idx.data(), vals.data(), count, rng() % 2 ? BitArrayBatchOrder::by_word : BitArrayBatchOrder::as_given);
+		for (size_t i{}; i < count; ++i) {
+			model[idx[i]] = vals[i];
+		}
+		break;
+	}
+	case 15:
+		std::reverse(span.begin() + first, span.begin() + first + count);
+		std::reverse(model.begin() + first, model.begin() + first + count);
+		break;
+	default:
+		span.subview(first, count).sort();
+		std::sort(model.begin() + first, model.begin() + first + count);
+		break;
+	}
+}
+
+// bitset members of BitArraySpan<1> against the model
+static void check_bitset(span_model<1>& state, std::mt19937_64& rng) {
+	const BitArraySpan<1>& span = state.span;
+	std::vector<uint64_t>& model = state.model;
+	const size_t size = model.size();
+	const size_t ones = std::count(model.begin(), model.end(), 1);
+	CHECK(span.count() == ones && span.any() == (ones > 0) && span.all() == (ones == size) && span.none() == !ones);
+
+	const size_t n = rng() % (size + 70);
+	std::vector<uint64_t> shifted(size, 0);
+	if (rng() % 2) {
+		span.shift_left(n);
+		for (size_t i = n; i < size; ++i) {
+			shifted[i] = model[i - n];
+		}
+	}
+	else {
+		span.shift_right(n);
+		for (size_t i{}; i + n < size; ++i) {
+			shifted[i] = model[i + n];
+		}
+	}
+	model = shifted;
+}
+
+// many random writes and reads per width, offsets on and off the grid of the words, counts up to a few blocks
+template<size_t Bits>
+static void test_model() {
+	std::mt19937_64 rng(Bits);
+	for (size_t offset : {size_t(0), 3 * Bits, size_t(5), size_t(130)}) {
+		for (size_t count : {size_t(0), size_t(1), size_t(100), size_t(2500)}) {
+			span_model<Bits> state(offset, count, Bits * 1000 + offset + count);
+			span_model<Bits> other(offset == 5 ? 0 : 5, count, Bits * 1000 + offset + count + 7);
+			CHECK(state.matches() && other.matches());
+			for (size_t round{}; round < 40; ++round) {
+				random_write(state, BitArrayView<Bits>(other.span), other.model, rng);
+				CHECK(state.matches());
+				check_reads(state, rng);
+				if constexpr (Bits == 1) {
+					check_bitset(state, rng);
+					CHECK(state.matches());
+				}
+			}
+			CHECK(other.matches());	// never written
+
+			std::vector<uint64_t> sorted = state.model;
+			std::sort(sorted.begin(), sorted.end());
+			state.span.sort();
+			state.model = sorted;
+			CHECK(state.matches());
+			const uint64_t val = count ? sorted[rng() % count] : 0;
+			const size_t low = std::lower_bound(sorted.begin(), sorted.end(), val) - sorted.begin();
+			const size_t high = std::upper_bound(sorted.begin(), sorted.end(), val) - sorted.begin();
+			CHECK(state.span.lower_bound(val) == low && state.span.upper_bound(val) == high);
+			CHECK(state.span.equal_range(val) == std::make_pair(low, high));
+		}
+	}
+}
+
+// overflowing writes throw before anything is written
+static void test_overflow() {
+	span_model<5> state(3, 90, 1);
+	const std::vector<uint8_t> in(10, 32);
+	bool fill_thrown = false;
+	bool pack_thrown = false;
+	bool ref_thrown = false;
+	try {
+		state.span.fill(32);
+	}
+	catch (const std::overflow_error&) {
+		fill_thrown = true;
+	}
+	try {
+		state.span.pack_from(in.data(), 0, in.size());
+	}
+	catch (const std::overflow_error&) {
+		pack_thrown = true;
+	}
+	try {
+		state.span[4] = 32;
+	}
+	catch (const std::overflow_error&) {
+		ref_thrown = true;
+	}
+	CHECK(fill_thrown && pack_thrown && ref_thrown && state.matches());
+}
+
+int main() {
+	test_rank_after_writes();
+	test_overflow();
+	for_widths<1, 2, 3, 4, 5, 7, 8, 9, 12, 13, 16, 17, 21, 24, 31, 32, 33, 40, 47, 48, 55, 63>([](auto bits) {
+		test_model<bits>();
+	});
+	return 0;
+}